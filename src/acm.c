@@ -0,0 +1,374 @@
+//  ==============================================================================================
+//
+//  Module: ACM
+//
+//  Description:
+//  Case-insensitive multi-pattern matcher (Aho-Corasick) for word lists
+//
+//  The patterns are folded (ASCII case, and optionally leetspeak digits/symbols and
+//  look-alike letters) and compiled into a trie with failure links, so testing a string
+//  against the whole list is a single pass over its characters no matter how many words
+//  the list holds.  The same folding is applied to the text as it is scanned.
+//
+//  Repeated letters are handled by the scanner rather than by folding the patterns: a
+//  character equal to the one before it is skipped when the current state was entered on
+//  that character and the trie has no edge for a second one.  "shiiit" thus matches "shit"
+//  while a doubled letter in a pattern is still required ("ass" does not fire on "as").
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bsd.h"
+#include "util.h"
+#include "acm.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+typedef struct {
+
+    int child;                                              // first child node, 0 = none
+    int sibling;                                  // next node of the same parent, 0 = none
+    int fail;                     // node of the longest proper suffix present in the trie
+    int out;            // pattern ending here or on the failure chain, -1 = none
+    unsigned char ch;                                 // folded byte on the edge to this node
+
+} acmNode_t;
+
+struct acmObj {
+
+    acmNode_t *nodes;                                                      // node 0 is root
+    int nodeCount;
+    int nodeMax;
+    int rootNext[256];                      // root edges indexed directly: the hot transition
+    char **patterns;                                    // original text, for reporting a hit
+    int patternCount;
+    int foldFlags;
+
+};
+
+//  Look-alike code points mapped to the ASCII letter they imitate (sorted by code point)
+//
+static const struct { unsigned short codePoint; char ascii; } acmConfusables[] = {
+    { 0x391, 'a' }, { 0x392, 'b' }, { 0x395, 'e' }, { 0x396, 'z' }, { 0x397, 'h' },   // Greek
+    { 0x399, 'i' }, { 0x39a, 'k' }, { 0x39c, 'm' }, { 0x39d, 'n' }, { 0x39f, 'o' },
+    { 0x3a1, 'p' }, { 0x3a4, 't' }, { 0x3a5, 'y' }, { 0x3a7, 'x' }, { 0x3b1, 'a' },
+    { 0x3b5, 'e' }, { 0x3b9, 'i' }, { 0x3ba, 'k' }, { 0x3bd, 'v' }, { 0x3bf, 'o' },
+    { 0x3c1, 'p' }, { 0x3c5, 'u' }, { 0x3c7, 'x' },
+    { 0x405, 's' }, { 0x406, 'i' }, { 0x408, 'j' }, { 0x410, 'a' }, { 0x412, 'b' },  // Cyrillic
+    { 0x415, 'e' }, { 0x41a, 'k' }, { 0x41c, 'm' }, { 0x41d, 'h' }, { 0x41e, 'o' },
+    { 0x420, 'p' }, { 0x421, 'c' }, { 0x422, 't' }, { 0x423, 'y' }, { 0x425, 'x' },
+    { 0x430, 'a' }, { 0x435, 'e' }, { 0x43e, 'o' }, { 0x440, 'p' }, { 0x441, 'c' },
+    { 0x443, 'y' }, { 0x445, 'x' }, { 0x455, 's' }, { 0x456, 'i' }, { 0x458, 'j' },
+};
+
+//  Latin-1 letters U+00C0..U+00FF without their accents, '-' is left alone
+//
+static const char acmLatin1[] = "aaaaaaaceeeeiiiidnooooo-ouuuuy-saaaaaaaceeeeiiiidnooooo-ouuuuy-y";
+
+
+//  ==============================================================================================
+//  _acmConfusable (local)
+//
+//  Returns the ASCII letter a look-alike code point stands for, or 0 if it is not one.
+//  Fullwidth forms (U+FF01..U+FF5E) map onto printable ASCII.
+//
+static int _acmConfusable( int codePoint )
+{
+    int lo = 0, hi = (int) (sizeof( acmConfusables ) / sizeof( acmConfusables[0] )) - 1, mid;
+
+    if (( codePoint >= 0xc0 ) && ( codePoint <= 0xff ))
+        return( ( acmLatin1[ codePoint - 0xc0 ] == '-' ) ? 0 : acmLatin1[ codePoint - 0xc0 ] );
+    if (( codePoint >= 0xff01 ) && ( codePoint <= 0xff5e ))
+        return( codePoint - 0xfee0 );
+
+    while ( lo <= hi ) {
+        mid = (lo + hi) / 2;
+        if ( acmConfusables[mid].codePoint == codePoint ) return( acmConfusables[mid].ascii );
+        if ( acmConfusables[mid].codePoint < codePoint ) lo = mid + 1; else hi = mid - 1;
+    }
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _acmLeet (local)
+//
+//  Returns the letter a leetspeak digit or symbol stands for, or the character unchanged.
+//
+static int _acmLeet( int c )
+{
+    switch ( c ) {
+    case '0':                   return( 'o' );
+    case '1': case '!':         return( 'i' );
+    case '3':                   return( 'e' );
+    case '4': case '@':         return( 'a' );
+    case '5': case '$':         return( 's' );
+    case '7': case '+':         return( 't' );
+    case '8':                   return( 'b' );
+    case '9':                   return( 'g' );
+    case '|':                   return( 'l' );
+    default:                    return( c );
+    }
+}
+
+
+//  ==============================================================================================
+//  _acmFold (local)
+//
+//  Returns the next folded byte of a string and advances past it, 0 at the end.  A 2 or 3
+//  byte UTF-8 look-alike is consumed whole and returned as its letter; any other non-ASCII
+//  byte passes through, so UTF-8 patterns still match byte for byte.
+//
+static int _acmFold( const unsigned char **pp, int foldFlags )
+{
+    const unsigned char *p = *pp;
+    int c = p[0], codePoint = -1, n = 1, ascii;
+
+    if ( c == 0 ) return( 0 );
+
+    if (( foldFlags & ACM_FOLD_CONFUSABLES ) && ( c >= 0xc0 )) {
+        if ((( c & 0xe0 ) == 0xc0 ) && (( p[1] & 0xc0 ) == 0x80 )) {
+            codePoint = (( c & 0x1f ) << 6) | ( p[1] & 0x3f );
+            n = 2;
+        }
+        else if ((( c & 0xf0 ) == 0xe0 ) && (( p[1] & 0xc0 ) == 0x80 ) && (( p[2] & 0xc0 ) == 0x80 )) {
+            codePoint = (( c & 0x0f ) << 12) | (( p[1] & 0x3f ) << 6) | ( p[2] & 0x3f );
+            n = 3;
+        }
+        if (( codePoint >= 0 ) && ( 0 != (ascii = _acmConfusable( codePoint ))))
+            c = ascii;
+        else
+            n = 1;
+    }
+    *pp = p + n;
+
+    if (( c >= 'A' ) && ( c <= 'Z' )) c += 'a' - 'A';
+    if ( foldFlags & ACM_FOLD_LEET ) c = _acmLeet( c );
+    return( c );
+}
+
+
+//  ==============================================================================================
+//  _acmChild (local)
+//
+//  Returns the node reached from a node on a folded byte, 0 if there is no such edge.
+//
+static int _acmChild( acmObj *aPtr, int node, int c )
+{
+    int i;
+
+    if ( node == 0 ) return( aPtr->rootNext[ c ] );
+    for ( i = aPtr->nodes[ node ].child; i != 0; i = aPtr->nodes[ i ].sibling )
+        if ( aPtr->nodes[ i ].ch == c ) return( i );
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _acmInsert (local)
+//
+//  Adds one pattern to the trie.  Returns 0 on success (an empty pattern is ignored),
+//  1 if out of memory.
+//
+static int _acmInsert( acmObj *aPtr, char *pattern, int patternIndex )
+{
+    const unsigned char *p = (const unsigned char *) pattern;
+    acmNode_t *grown;
+    int node = 0, next, c;
+
+    while ( 0 != (c = _acmFold( &p, aPtr->foldFlags ))) {
+        if ( 0 == (next = _acmChild( aPtr, node, c ))) {
+            if ( aPtr->nodeCount == aPtr->nodeMax ) {
+                grown = (acmNode_t *) realloc( aPtr->nodes, 2 * aPtr->nodeMax * sizeof( acmNode_t ));
+                if ( grown == NULL ) return( 1 );
+                aPtr->nodes = grown;
+                aPtr->nodeMax *= 2;
+            }
+            next = aPtr->nodeCount++;
+            memset( &aPtr->nodes[ next ], 0, sizeof( acmNode_t ));
+            aPtr->nodes[ next ].ch  = (unsigned char) c;
+            aPtr->nodes[ next ].out = -1;
+            if ( node == 0 ) {
+                aPtr->rootNext[ c ] = next;
+            }
+            else {
+                aPtr->nodes[ next ].sibling = aPtr->nodes[ node ].child;
+                aPtr->nodes[ node ].child = next;
+            }
+        }
+        node = next;
+    }
+    if (( node != 0 ) && ( aPtr->nodes[ node ].out < 0 )) aPtr->nodes[ node ].out = patternIndex;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _acmLink (local)
+//
+//  Computes failure links breadth first, and propagates each node's match along its failure
+//  chain so a scan only has to look at the state it is in.  Returns 0, or 1 if out of memory.
+//
+static int _acmLink( acmObj *aPtr )
+{
+    int *queue, head = 0, tail = 0, c, node, child, f;
+
+    if ( NULL == (queue = (int *) malloc( aPtr->nodeCount * sizeof( int )))) return( 1 );
+
+    for ( c = 0; c < 256; c++ ) {
+        if ( 0 != (child = aPtr->rootNext[ c ])) {
+            aPtr->nodes[ child ].fail = 0;
+            queue[ tail++ ] = child;
+        }
+    }
+    while ( head < tail ) {
+        node = queue[ head++ ];
+        for ( child = aPtr->nodes[ node ].child; child != 0; child = aPtr->nodes[ child ].sibling ) {
+            c = aPtr->nodes[ child ].ch;
+            f = aPtr->nodes[ node ].fail;
+            while (( f != 0 ) && ( 0 == _acmChild( aPtr, f, c ))) f = aPtr->nodes[ f ].fail;
+            aPtr->nodes[ child ].fail = _acmChild( aPtr, f, c );
+            if ( aPtr->nodes[ child ].out < 0 )
+                aPtr->nodes[ child ].out = aPtr->nodes[ aPtr->nodes[ child ].fail ].out;
+            queue[ tail++ ] = child;
+        }
+    }
+    free( queue );
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  acmCompile
+//
+//  Compiles a list of patterns with the given ACM_FOLD_* options.  Blank patterns are
+//  skipped.  Returns NULL if out of memory.
+//
+acmObj *acmCompile( char **patterns, int count, int foldFlags )
+{
+    acmObj *aPtr;
+    size_t textSize = 0;
+    char *text;
+    int i, errCode = 0;
+
+    if ( count < 0 ) count = 0;
+    for ( i = 0; i < count; i++ ) textSize += strlen( patterns[i] ) + 1;
+
+    if ( NULL == (aPtr = (acmObj *) calloc( 1, sizeof( acmObj )))) return( NULL );
+    aPtr->foldFlags = foldFlags;
+    aPtr->nodeMax   = 256;
+    aPtr->nodes     = (acmNode_t *) calloc( aPtr->nodeMax, sizeof( acmNode_t ));
+    aPtr->patterns  = (char **) malloc( (count + 1) * sizeof( char * ) + textSize );
+    if (( aPtr->nodes == NULL ) || ( aPtr->patterns == NULL )) {
+        acmDestroy( aPtr );
+        return( NULL );
+    }
+    aPtr->nodeCount = 1;
+    aPtr->nodes[0].out = -1;
+
+    text = (char *) &aPtr->patterns[ count + 1 ];
+    for ( i = 0; ( i < count ) && ( errCode == 0 ); i++ ) {
+        aPtr->patterns[i] = text;
+        strcpy( text, patterns[i] );
+        text += strlen( patterns[i] ) + 1;
+        errCode = _acmInsert( aPtr, patterns[i], i );
+    }
+    aPtr->patterns[ count ] = NULL;
+    aPtr->patternCount = count;
+
+    if (( errCode != 0 ) || ( 0 != _acmLink( aPtr ))) {
+        acmDestroy( aPtr );
+        return( NULL );
+    }
+    return( aPtr );
+}
+
+
+//  ==============================================================================================
+//  acmMatch
+//
+//  Scans a string once and returns the index of a pattern it contains, -1 if none does
+//  (or the matcher is NULL).
+//
+int acmMatch( acmObj *aPtr, char *text )
+{
+    const unsigned char *p = (const unsigned char *) text;
+    int state = 0, next, c, prev = 0;
+
+    if (( aPtr == NULL ) || ( text == NULL )) return( -1 );
+
+    while ( 0 != (c = _acmFold( &p, aPtr->foldFlags ))) {
+
+        if (( aPtr->foldFlags & ACM_FOLD_REPEATS ) && ( c == prev ) && ( state != 0 ) &&
+            ( aPtr->nodes[ state ].ch == c ) && ( 0 == _acmChild( aPtr, state, c )))
+            continue;
+        prev = c;
+
+        while ( 0 == (next = _acmChild( aPtr, state, c )) && ( state != 0 ))
+            state = aPtr->nodes[ state ].fail;
+        state = next;
+
+        if ( aPtr->nodes[ state ].out >= 0 ) return( aPtr->nodes[ state ].out );
+    }
+    return( -1 );
+}
+
+
+//  ==============================================================================================
+//  acmPattern
+//
+//  Returns the pattern text as it was given to acmCompile, or "" if out of range.
+//
+char *acmPattern( acmObj *aPtr, int patternIndex )
+{
+    if (( aPtr == NULL ) || ( patternIndex < 0 ) || ( patternIndex >= aPtr->patternCount )) return( "" );
+    return( aPtr->patterns[ patternIndex ] );
+}
+
+
+//  ==============================================================================================
+//  acmFoldParse
+//
+//  Converts a configuration string naming the folds ("leet repeats confusables", or "all")
+//  to ACM_FOLD_* flags.  Case folding is always on and needs no mention.
+//
+int acmFoldParse( char *foldSpec )
+{
+    char spec[ 256 ];
+    int foldFlags = 0;
+
+    strlcpy( spec, foldSpec, sizeof( spec ));
+    strToLowerInPlace( spec );
+
+    if ( NULL != strstr( spec, "all" ))        foldFlags = ACM_FOLD_LEET | ACM_FOLD_REPEATS | ACM_FOLD_CONFUSABLES;
+    if ( NULL != strstr( spec, "leet" ))       foldFlags |= ACM_FOLD_LEET;
+    if ( NULL != strstr( spec, "repeat" ))     foldFlags |= ACM_FOLD_REPEATS;
+    if ( NULL != strstr( spec, "confusable" )) foldFlags |= ACM_FOLD_CONFUSABLES;
+    return( foldFlags );
+}
+
+
+//  ==============================================================================================
+//  acmDestroy
+//
+//  Frees a compiled matcher; NULL is accepted.
+//
+void acmDestroy( acmObj *aPtr )
+{
+    if ( aPtr == NULL ) return;
+    free( aPtr->nodes );
+    free( aPtr->patterns );
+    free( aPtr );
+}
+
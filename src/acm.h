@@ -0,0 +1,27 @@
+//  ==============================================================================================
+//
+//  Module: ACM
+//
+//  Description:
+//  Case-insensitive multi-pattern matcher (Aho-Corasick) for word lists
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#define ACM_FOLD_LEET        (0x01)                   // 4->a 3->e 0->o 1->i 5->s $->s @->a ..
+#define ACM_FOLD_REPEATS     (0x02)               // "shiiit" matches "shit" (text side only)
+#define ACM_FOLD_CONFUSABLES (0x04)        // accented, Cyrillic, Greek, fullwidth look-alikes
+
+typedef struct acmObj acmObj;
+
+extern acmObj *acmCompile( char **patterns, int count, int foldFlags );
+extern int acmMatch( acmObj *aPtr, char *text );
+extern char *acmPattern( acmObj *aPtr, int patternIndex );
+extern int acmFoldParse( char *foldSpec );
+extern void acmDestroy( acmObj *aPtr );
+
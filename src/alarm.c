@@ -5,6 +5,16 @@
 //  Description:
 //  Alarm event handling with callback feature
 //
+//  Alarms are kept in a binary min-heap ordered by deadline, on a monotonic millisecond
+//  clock, so that wall clock changes neither fire nor stall them.  There is no limit on the
+//  number of alarms; dispatch costs one compare when nothing is due, and arming or firing
+//  an alarm is O(log n).  An alarm may be one-shot (alarmReset, alarmResetMs) or repeating
+//  (alarmRepeat), and may carry a user data pointer (alarmCreateUser).
+//
+//  On Linux a timerfd is kept armed to the earliest deadline: alarmWait() sleeps on it, so
+//  the main loop wakes up exactly when the next alarm is due, and the fd (alarmFd) can be
+//  added to any poll set.
+//
 //  Original Author:
 //  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
 //
@@ -16,41 +26,184 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-// #include <unistd.h>
 #include <time.h>
-// #include <stdarg.h>
-// #include <sys/stat.h>
+#include <stdint.h>
 
-// #include <sys/types.h>
-// #include <sys/socket.h>
-// #include <netinet/in.h>
-// #include <netdb.h>
-// #include <fcntl.h>
+#ifdef _WIN32
+#include <windows.h>
+#include "winport.h"
+#else
+#include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#endif
 
+#include "metrics.h"
 #include "alarm.h"
 
 //  ==============================================================================================
-//  Data definition 
+//  Data definition
+//
+
+//  Min-heap of armed alarm objects, earliest deadline at [0].  Each alarm keeps its own
+//  heap position so that it can be re-armed or cancelled without a search.
+//
+static alarmPtr *alarmHeap = NULL;
+static int       alarmHeapCount = 0, alarmHeapSize = 0;
+
+static int       alarmTimerFd = -1;                            // Linux timerfd, -1 if none
+static uint64_t  alarmTimerFdMs = 0;                    // deadline timerfd is armed for
+
+static metricsObj *alarmLagMetric = NULL;                // how late alarms fire (main loop busy)
+static const uint64_t alarmLagBoundsUs[] = { 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000 };
+
+
+//  ==============================================================================================
+//  alarmNowMs
+//
+//  Monotonic clock in milliseconds (not related to wall clock time)
+//
+uint64_t alarmNowMs( void )
+{
+#ifdef _WIN32
+    return( (uint64_t) GetTickCount64() );
+#else
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (uint64_t) ts.tv_sec * 1000 + (uint64_t) (ts.tv_nsec / 1000000) );
+#endif
+}
+
+
+//  ==============================================================================================
+//  _alarmHeapSet (local)
 //
+static void _alarmHeapSet( int i, alarmPtr aPtr )
+{
+    alarmHeap[i] = aPtr;
+    aPtr->heapIndex = i;
+    return;
+}
 
-//  Master array of active alarm Objects.  The alarm object is inserted here by the
-//  alarmCreate() routine, and associated callbacks are made by walking through this
-//  table from the dispatcher.
+
+//  ==============================================================================================
+//  _alarmSiftUp / _alarmSiftDown (local)
 //
-static alarmPtr alarmTable[ SISSM_MAXALARMS ];
+static void _alarmSiftUp( int i )
+{
+    alarmPtr aPtr = alarmHeap[i];
+    int parent;
+
+    while ( i > 0 ) {
+        parent = (i - 1) / 2;
+        if ( alarmHeap[parent]->alarmTimeMs <= aPtr->alarmTimeMs ) break;
+        _alarmHeapSet( i, alarmHeap[parent] );
+        i = parent;
+    }
+    _alarmHeapSet( i, aPtr );
+    return;
+}
+
+static void _alarmSiftDown( int i )
+{
+    alarmPtr aPtr = alarmHeap[i];
+    int child;
+
+    while ( (child = 2 * i + 1) < alarmHeapCount ) {
+        if (( child + 1 < alarmHeapCount ) &&
+            ( alarmHeap[child + 1]->alarmTimeMs < alarmHeap[child]->alarmTimeMs )) child++;
+        if ( aPtr->alarmTimeMs <= alarmHeap[child]->alarmTimeMs ) break;
+        _alarmHeapSet( i, alarmHeap[child] );
+        i = child;
+    }
+    _alarmHeapSet( i, aPtr );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _alarmHeapRemove (local)
+//
+static void _alarmHeapRemove( alarmPtr aPtr )
+{
+    int i = aPtr->heapIndex;
+
+    if ( i < 0 ) return;
+    aPtr->heapIndex = -1;
+    if ( --alarmHeapCount == i ) return;                                   // was the last one
+
+    _alarmHeapSet( i, alarmHeap[ alarmHeapCount ] );
+    if (( i > 0 ) && ( alarmHeap[(i - 1) / 2]->alarmTimeMs > alarmHeap[i]->alarmTimeMs ))
+        _alarmSiftUp( i );
+    else
+        _alarmSiftDown( i );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _alarmHeapPush (local)
+//
+//  Insert or reposition aPtr for its (new) alarmTimeMs.  Returns 0 on success.
+//
+static int _alarmHeapPush( alarmPtr aPtr )
+{
+    alarmPtr *newHeap;
+
+    _alarmHeapRemove( aPtr );
+    if ( alarmHeapCount == alarmHeapSize ) {
+        newHeap = (alarmPtr *) realloc( alarmHeap, (alarmHeapSize ? alarmHeapSize * 2 : 64) * sizeof( alarmPtr ));
+        if ( newHeap == NULL ) return 1;
+        alarmHeap = newHeap;
+        alarmHeapSize = alarmHeapSize ? alarmHeapSize * 2 : 64;
+    }
+    _alarmHeapSet( alarmHeapCount++, aPtr );
+    _alarmSiftUp( aPtr->heapIndex );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _alarmFdArm (local)
+//
+//  Keep the timerfd armed to the earliest deadline
+//
+static void _alarmFdArm( void )
+{
+#ifndef _WIN32
+    struct itimerspec its;
+    uint64_t deadline;
+
+    if ( alarmTimerFd < 0 ) return;
+    deadline = ( alarmHeapCount > 0 ) ? alarmHeap[0]->alarmTimeMs : 0;
+    if ( deadline == alarmTimerFdMs ) return;
+
+    memset( &its, 0, sizeof( its ));                                         // 0 = disarm
+    its.it_value.tv_sec  = (time_t) (deadline / 1000);
+    its.it_value.tv_nsec = (long) (deadline % 1000) * 1000000;
+    timerfd_settime( alarmTimerFd, TFD_TIMER_ABSTIME, &its, NULL );
+    alarmTimerFdMs = deadline;
+#endif
+    return;
+}
+
 
 //  ==============================================================================================
 //  alarmInit
 //
 //  Module initialization to be called once only.
-//  
+//
 //
 void alarmInit( void )
 {
-    int i;
-    for (i=0; i<SISSM_MAXALARMS; i++) {
-        alarmTable[ i ] = NULL;
-    }
+    alarmHeapCount = 0;
+    if ( alarmLagMetric == NULL )
+        alarmLagMetric = metricsHistogram( "sissm_alarm_lag_seconds", "Delay between an alarm deadline and its callback",
+            "", alarmLagBoundsUs, sizeof( alarmLagBoundsUs ) / sizeof( alarmLagBoundsUs[0] ));
+#ifndef _WIN32
+    if ( alarmTimerFd < 0 ) alarmTimerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+#endif
     return;
 }
 
@@ -59,25 +212,35 @@ void alarmInit( void )
 //  alarmCreate
 //
 //  Create an alarm object, optionally install a callback.  Callback may be NULL if not used.
-//  
+//
 //
 alarmObj *alarmCreate( int (*alarmCBfunc)( char * ) )
 {
     alarmObj *aPtr = NULL;
-    int i;
 
     aPtr = calloc( 1, sizeof( alarmObj ));
     if ( aPtr != NULL ) {
-        aPtr->alarmTime = 0L;
+        aPtr->alarmTimeMs = 0;
         aPtr->alarmCallbackFunction = alarmCBfunc;
+        aPtr->heapIndex = -1;
+    }
+    return aPtr;
+}
 
-        for (i = 0; i<SISSM_MAXALARMS; i++) {
-            if ( alarmTable[ i ] == NULL ) {
-                alarmTable[ i ] = aPtr;
-                aPtr->usedIndex = i;
-                break;
-            }
-        }
+
+//  ==============================================================================================
+//  alarmCreateUser
+//
+//  Create an alarm object whose callback receives the alarm and a caller-defined pointer,
+//  so that one callback can serve several alarms.
+//
+alarmObj *alarmCreateUser( int (*alarmCBfunc)( alarmObj *aPtr, void *userData ), void *userData )
+{
+    alarmObj *aPtr;
+
+    if ( NULL != (aPtr = alarmCreate( NULL ))) {
+        aPtr->alarmUserCallback = alarmCBfunc;
+        aPtr->userData = userData;
     }
     return aPtr;
 }
@@ -86,47 +249,100 @@ alarmObj *alarmCreate( int (*alarmCBfunc)( char * ) )
 //  ==============================================================================================
 //  alarmDestroy
 //
-//  Destroy an alarm object.
+//  Destroy an alarm object.  It may be called from the alarm's own callback.
 //
 //
 int alarmDestroy( alarmObj *aPtr )
 {
     int errCode = 1;
     if ( NULL != aPtr ) {
-        if ( aPtr->usedIndex != -1 ) {
-            alarmTable[ aPtr->usedIndex ] = NULL;
-            free( aPtr );
-            errCode = 0;
-        }
+        _alarmHeapRemove( aPtr );
+        _alarmFdArm();
+        free( aPtr );
+        errCode = 0;
     }
     return errCode;
 }
 
 
+//  ==============================================================================================
+//  alarmResetMs
+//
+//  Set or reset alarm for timeMs milliseconds from now (one-shot).  If the alarm is already
+//  counting, the new value supercedes the previous count and any repeat is cleared.
+//
+int alarmResetMs( alarmObj *aPtr, uint64_t timeMs )
+{
+    int errCode;
+
+    aPtr->periodMs = 0;
+    aPtr->alarmTimeMs = alarmNowMs() + ( timeMs ? timeMs : 1 );         // always a future ms
+    errCode = _alarmHeapPush( aPtr );
+    _alarmFdArm();
+    return errCode;
+}
+
+
 //  ==============================================================================================
 //  alarmReset
 //
-//  Set or reset alarm for future time.  For example, if you wish to set alarm 5 seconds from 
+//  Set or reset alarm for future time.  For example, if you wish to set alarm 5 seconds from
 //  present, then set timeSec 5.  If alarmReset() is called on an actively counting alarm,
 //  the new value timeSec supercedes the previous count.
 //
 int alarmReset( alarmObj *aPtr, unsigned long timeSec)
 {
-    aPtr->alarmTime = timeSec + time(NULL); 
-    return 0; 
+    return( alarmResetMs( aPtr, (uint64_t) timeSec * 1000 ));
 }
 
+
+//  ==============================================================================================
+//  alarmRepeat
+//
+//  Fire the alarm every periodMs milliseconds, first time periodMs from now.  Deadlines
+//  are kept on the original schedule (no drift); if dispatch falls behind by more than a
+//  period, the missed firings are skipped rather than run back to back.
+//
+int alarmRepeat( alarmObj *aPtr, uint64_t periodMs )
+{
+    int errCode;
+
+    if ( periodMs == 0 ) return 1;
+    errCode = alarmResetMs( aPtr, periodMs );
+    aPtr->periodMs = periodMs;
+    return errCode;
+}
+
+
 //  ==============================================================================================
 //  alarmCancel
 //
-//  Cancels a current alarm count.  Since the alarm instance is not destroyed it can be 
+//  Cancels a current alarm count.  Since the alarm instance is not destroyed it can be
 //  reactivated by alarmReset() call.
-//  
+//
 //
 int alarmCancel( alarmObj *aPtr )
 {
-    aPtr->alarmTime = 0L;
-    return 0; 
+    _alarmHeapRemove( aPtr );
+    _alarmFdArm();
+    aPtr->alarmTimeMs = 0;
+    aPtr->periodMs = 0;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  alarmStatusMs
+//
+//  Returns milliseconds left before the alarm is activated, or 0 if it is not armed.
+//
+int64_t alarmStatusMs( alarmObj *aPtr )
+{
+    uint64_t timeNow;
+
+    if ( aPtr->heapIndex < 0 ) return 0;
+    timeNow = alarmNowMs();
+    return( ( aPtr->alarmTimeMs > timeNow ) ? (int64_t) (aPtr->alarmTimeMs - timeNow) : 0 );
 }
 
 
@@ -135,49 +351,114 @@ int alarmCancel( alarmObj *aPtr )
 //
 //  Take a peek into currently active alarm, and returns time left before alarm is activated.
 //  If the alarm is cannceled, expired, not started, or not set, then value zero is returned.
-//  
+//
 //
 long int alarmStatus( alarmObj *aPtr )
 {
-    unsigned long retValue = 0L;
-    unsigned long timeNow;
+    return( (long int) ((alarmStatusMs( aPtr ) + 999) / 1000) );
+}
+
+
+//  ==============================================================================================
+//  alarmNextMs
+//
+//  Returns milliseconds until the earliest alarm is due (0 if overdue), or -1 if no alarm
+//  is armed.
+//
+int64_t alarmNextMs( void )
+{
+    uint64_t timeNow;
+
+    if ( alarmHeapCount == 0 ) return -1;
+    timeNow = alarmNowMs();
+    return( ( alarmHeap[0]->alarmTimeMs > timeNow ) ? (int64_t) (alarmHeap[0]->alarmTimeMs - timeNow) : 0 );
+}
+
 
-    timeNow = time(NULL);
-    if ( aPtr->alarmTime > timeNow ) retValue = aPtr->alarmTime - timeNow;
-    return retValue; 
+//  ==============================================================================================
+//  alarmFd
+//
+//  Returns a file descriptor that becomes readable when the earliest alarm is due (Linux
+//  timerfd), or -1 if not available.  After it fires, call alarmDispatch().
+//
+int alarmFd( void )
+{
+    return( alarmTimerFd );
+}
+
+
+//  ==============================================================================================
+//  alarmWait
+//
+//  Sleep until the earliest alarm is due, or at most maxWaitMs.
+//
+void alarmWait( long maxWaitMs )
+{
+    int64_t nextMs;
+
+    nextMs = alarmNextMs();
+    if (( nextMs >= 0 ) && ( nextMs < maxWaitMs )) maxWaitMs = (long) nextMs;
+    if ( maxWaitMs <= 0 ) return;
+
+#ifdef _WIN32
+    usleep( (__int64) maxWaitMs * 1000 );
+#else
+    struct pollfd pfd;
+    uint64_t expirations;
+
+    if ( alarmTimerFd < 0 ) {
+        usleep( maxWaitMs * 1000 );
+        return;
+    }
+    pfd.fd = alarmTimerFd;
+    pfd.events = POLLIN;
+    if (( 0 < poll( &pfd, 1, (int) maxWaitMs )) &&
+        ( sizeof( expirations ) != read( alarmTimerFd, &expirations, sizeof( expirations )))) {
+        // non-blocking timer: a short read only means nothing was pending
+    }
+#endif
+    return;
 }
 
 
 //  ==============================================================================================
 //  alarmDispatch
 //
-//  This polling routine is called from the master application loop, or from a
-//  periodic processing handler.   It loops through all active alarm objects, and 
-//  fires off a callback routines of the expired objects.
-//  ...
+//  This polling routine is called from the master application loop.  It fires the callback
+//  routines of all alarms that are due.  An alarm re-armed from its own callback, or by
+//  its repeat, will not fire again in the same call.
 //
 void alarmDispatch( void )
 {
     alarmObj *aPtr;
-    unsigned long timeNow;
-    int i;
- 
-    timeNow = time(NULL);
-
-    for (i = 0; i<SISSM_MAXALARMS; i++) {
-        aPtr = alarmTable[ i ];
-        if ( aPtr != NULL ) {
-            if ( aPtr->alarmTime != 0L ) {
-                if ( aPtr->alarmTime <= timeNow ) {
-                    aPtr->alarmTime = 0L;
-                    if ( aPtr->alarmCallbackFunction != NULL ) {
-                        (aPtr->alarmCallbackFunction)("alarm");
-                    }
-                }
-            }
+    uint64_t timeNow, next;
+
+    if (( alarmHeapCount == 0 ) || ( alarmHeap[0]->alarmTimeMs > (timeNow = alarmNowMs()) )) return;
+
+    while (( alarmHeapCount > 0 ) && ( alarmHeap[0]->alarmTimeMs <= timeNow )) {
+        aPtr = alarmHeap[0];
+        if ( alarmLagMetric != NULL ) metricsObserveUs( alarmLagMetric, (timeNow - aPtr->alarmTimeMs) * 1000 );
+        if ( aPtr->periodMs != 0 ) {
+            next = aPtr->alarmTimeMs + aPtr->periodMs;
+            if ( next <= timeNow ) next = timeNow + aPtr->periodMs;
+            aPtr->alarmTimeMs = next;
+            _alarmSiftDown( 0 );
+        }
+        else {
+            _alarmHeapRemove( aPtr );
+            aPtr->alarmTimeMs = 0;
+        }
+
+        // re-armed before the callback, so the callback may reset, cancel or destroy it
+        //
+        if ( aPtr->alarmUserCallback != NULL ) {
+            (aPtr->alarmUserCallback)( aPtr, aPtr->userData );
+        }
+        else if ( aPtr->alarmCallbackFunction != NULL ) {
+            (aPtr->alarmCallbackFunction)("alarm");
         }
     }
+    _alarmFdArm();
     return;
 }
 
-
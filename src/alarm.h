@@ -13,24 +13,32 @@
 //
 //  ==============================================================================================
 
+#include <stdint.h>
 
+typedef struct alarmObj {
 
-#define SISSM_MAXALARMS       (64)
-
-typedef struct {
-
-    unsigned long alarmTime;
+    uint64_t alarmTimeMs;                         // monotonic deadline in ms, 0 = not armed
+    uint64_t periodMs;                                        // repeat interval, 0 = one-shot
     int (*alarmCallbackFunction)( char * );
-    int usedIndex;
-    
+    int (*alarmUserCallback)( struct alarmObj *aPtr, void *userData );
+    void *userData;
+    int heapIndex;                                         // position in the heap, -1 = idle
+
 } alarmObj, *alarmPtr;
 
 
 extern void alarmInit( void );
 extern alarmObj *alarmCreate( int (*alarmCBfunc)( char * ) );
+extern alarmObj *alarmCreateUser( int (*alarmCBfunc)( alarmObj *aPtr, void *userData ), void *userData );
 extern int alarmDestroy( alarmObj *aPtr );
 extern int alarmReset( alarmObj *aPtr, unsigned long timeSec);
+extern int alarmResetMs( alarmObj *aPtr, uint64_t timeMs );
+extern int alarmRepeat( alarmObj *aPtr, uint64_t periodMs );
 extern int alarmCancel( alarmObj *aPtr );
 extern long int alarmStatus( alarmObj *aPtr );
+extern int64_t alarmStatusMs( alarmObj *aPtr );
 extern void alarmDispatch( void );
-
+extern uint64_t alarmNowMs( void );
+extern int64_t alarmNextMs( void );
+extern int alarmFd( void );
+extern void alarmWait( long maxWaitMs );
@@ -38,16 +38,27 @@
 #include "events.h"
 #include "rdrv.h"
 #include "alarm.h"
+#include "arena.h"
+#include "metrics.h"
 #include "sissm.h"                                              // required for sissmGetConfigPath
 #include "roster.h"
+#include "pstore.h"
+#include "banlist.h"
+#include "journal.h"
+#include "ctl.h"
+#include "acm.h"
 
+#include "sid.h"
 #include "api.h"
 
-#define API_R_BUFSIZE                (4*1024)
+#define API_R_BUFSIZE                (BUFSIZE_R)      // RCON response, from the per-tick arena
 #define API_T_BUFSIZE                (4*1024)
 
-#define API_LOG2RCON_DELAY_MICROSEC  (250000)          // system delay between log to rcon (tuned) 
 #define API_LISTPLAYERS_PERIOD           (10)     // #seconds periodic for listserver roster fetch
+#define API_JOIN_FETCH_MS               (250)         // first roster fetch after a join log line
+#define API_JOIN_GIVEUP_MS             (4000)     // stop refetching, the periodic poll takes over
+#define API_JOIN_PENDING_MAX             (32)               // joiners awaiting a roster entry
+#define API_JOIN_FORGET_SEC              (60)     // joiner never seen in the roster is dropped
 
 #define API_ROSTER_STRING_MAX         (80*64)            // max size of contatenated roster string 
 #define API_LINE_STRING_MAX             (256)   
@@ -59,6 +70,17 @@
 //
 static rdrvObj *_rPtr = NULL;                    // RCON driver handle - interface to game server
 static alarmObj *_apiPollAlarmPtr  = NULL;      // used to periodically poll roster (listplayers)
+static alarmObj *_apiPeriodicAlarmPtr = NULL;             // list file watch & journal flush
+static alarmObj *_apiJoinAlarmPtr = NULL;            // roster fetch shortly after join log lines
+static uint64_t  _apiJoinRetryMs = 0;                    // join fetch back-off, 0 = none pending
+static uint64_t  _apiJoinStartMs = 0;
+
+static struct {
+
+    char     playerName[ ROSTER_FIELD_MAX ];
+    uint64_t seenUs;                          // metricsNowUs() of the join line, 0 = free entry
+
+} _apiJoinPending[ API_JOIN_PENDING_MAX ];
 
 //  Store string concatenated roster for two consecutive iterations - previous & current.
 //  The difference produces player connection and disconnection status
@@ -72,9 +94,23 @@ static long lastRosterSuccessTime = 0L;            // marks last time listplayer
 //
 static idList_t adminIdList;                                                       // Admins list 
 static char adminListFilePath[ API_LINE_STRING_MAX ];             // full file path to admins.txt
+static fileWatch_t adminListWatch;
 
 static wordList_t badWordsList;                                               // Bad words list
+static wordList_t badWordsNew;                                       // reload staging for above
+static acmObj *badWordsMatcher = NULL;                     // above compiled into one automaton
+static int  badWordsFold = 0;                             // ACM_FOLD_* from sissm.badWordsFold
 static char badWordsFilePath[ API_LINE_STRING_MAX ];             // full file path to admins.txt
+static fileWatch_t badWordsWatch;
+
+static char playerStoreFilePath[ API_LINE_STRING_MAX ];     // player history store, "" disables
+static int  playerStoreNameIndex = 0;                  // 1=index historical names for search
+
+static char banListFilePath[ API_LINE_STRING_MAX ];             // local ban list, "" disables
+
+static char journalFilePath[ API_LINE_STRING_MAX ];          // binary event journal, "" disables
+
+static strBuf_t *apiSayCapturePtr = NULL;             // apiSay text goes here instead, if set
 
 
 //  ==============================================================================================
@@ -101,7 +137,7 @@ int apiWordListRead( char *listFile, wordList_t wordList )
                 if ( 0 != strlen( tmpLine ) ) {
                     // strToLowerInPlace( tmpLine ); 
                     strlcpy( wordList[ i ], tmpLine, WORDLISTMAXSTRSZ );
-                    if ( (++i) > WORDLISTMAXELEM) break;
+                    if ( (++i) >= WORDLISTMAXELEM) break;
                 }
             }
         }
@@ -112,25 +148,21 @@ int apiWordListRead( char *listFile, wordList_t wordList )
 
 
 //  ==============================================================================================
-//  apiWordListCheck
+//  apiWordListCompile
 //
-//  Checks if a a word is contained in the string.  This function returns a 1 if found,
-//  0 if not found.
+//  Compiles a word list into a case-insensitive matcher (ACM_FOLD_* options) that finds any
+//  of its words in a string in a single pass.  Returns NULL if out of memory.
 //
-int apiWordListCheck( char *stringTested, wordList_t wordList )
+acmObj *apiWordListCompile( wordList_t wordList, int foldFlags )
 {
+    char *words[ WORDLISTMAXELEM ];
     int i;
-    int isMatch = 0;
 
     for (i=0; i<WORDLISTMAXELEM; i++) {
-
         if ( wordList[i][0] == 0 ) break;
-        if ( NULL != strcasestr( stringTested, wordList[i] )) {
-            isMatch = 1;
-            break;
-        }
+        words[i] = wordList[i];
     }
-    return( isMatch );
+    return( acmCompile( words, i, foldFlags ));
 }
 
 
@@ -142,13 +174,14 @@ int apiWordListCheck( char *stringTested, wordList_t wordList )
 //  This function returns number of clients read.  If file fails to open, -1 is returned.
 //  The input list format is compatible wtih Sandstorm Admins.txt.
 //
-int apiIdListRead( char *listFile, idList_t idList )
+int apiIdListRead( char *listFile, idList_t *idList )
 {
     int i;
-    char tmpLine[1024], *w;
+    char tmpLine[1024], idStr[64];
+    strView_t w;
     FILE *fpr;
 
-    for (i=0; i<IDLISTMAXELEM; i++) strcpy( idList[i], "" );
+    sidSetClear( idList );
 
     i = -1;
     if (NULL != (fpr = fopen( listFile, "rt" ))) {
@@ -156,13 +189,9 @@ int apiIdListRead( char *listFile, idList_t idList )
         while (!feof( fpr )) {
             if (NULL != fgets( tmpLine, 1024, fpr )) {
                 tmpLine[ strlen( tmpLine ) - 1] = 0;
-                if ( 0 != strlen( tmpLine ) ) {
-                    w = getWord( tmpLine, 0, " \012\015\011");
-                    if (strlen(w) == IDSTEAMID64LEN) {
-                        strlcpy( idList[i], w, IDSTEAMID64LEN+1 );
-                        i++;
-                        if ( i >= (IDLISTMAXELEM-1) ) break;
-                    }
+                if ( wordView( tmpLine, 0, " \012\015\011", &w )) {
+                    strViewCopy( idStr, sizeof( idStr ), &w );
+                    if ( 0 == sidSetAdd( idList, sidParse( idStr ), 0 )) i++;
                 }
             }
         }
@@ -179,7 +208,22 @@ int apiIdListRead( char *listFile, idList_t idList )
 //
 int apiBadNameCheck( char *nameIn )
 {
-    return (apiWordListCheck( nameIn, badWordsList )); 
+    return ( NULL != apiBadWordFind( nameIn ));
+}
+
+
+//  ==============================================================================================
+//  apiBadWordFind
+//
+//  Returns the bad words list entry contained in a string (name, chat text), or NULL if
+//  the string is clean.
+//
+char *apiBadWordFind( char *stringTested )
+{
+    int found;
+
+    if ( 0 > (found = acmMatch( badWordsMatcher, stringTested ))) return( NULL );
+    return( acmPattern( badWordsMatcher, found ));
 }
 
 
@@ -189,18 +233,9 @@ int apiBadNameCheck( char *nameIn )
 //  Checks if a client GUID is contained in the idList.  This function returns a 1 if found,
 //  0 if not found.
 //
-int apiIdListCheck( char *connectID, idList_t idList )
+int apiIdListCheck( char *connectID, idList_t *idList )
 {
-    int i;
-    int isMatch = 0;
-
-    for (i=0; i<IDLISTMAXELEM; i++) {
-        if (0 == strcmp( idList[i], connectID )) {
-            isMatch = 1;
-            break;
-        }
-    }
-    return( isMatch );
+    return( sidSetHas( idList, sidParse( connectID )) );
 }
 
 //  ==============================================================================================
@@ -211,7 +246,7 @@ int apiIdListCheck( char *connectID, idList_t idList )
 //  
 int apiIsAdmin( char *connectID )
 {
-    return( apiIdListCheck( connectID, adminIdList ) );
+    return( apiIdListCheck( connectID, &adminIdList ) );
 }
 
 
@@ -227,6 +262,17 @@ unsigned long apiGetLastRosterTime( void )
     return( lastRosterSuccessTime );
 }
 
+//  ==============================================================================================
+//  apiGetRosterVersion
+//
+//  Returns a number that changes whenever players join, leave, or the map changes.  Plugins
+//  caching output derived from the roster can compare it instead of the roster itself.
+//
+unsigned long apiGetRosterVersion( void )
+{
+    return( rosterGetVersion() );
+}
+
 //  ==============================================================================================
 //  rosterSyntheticDelEvent
 //
@@ -237,6 +283,8 @@ int rosterSyntheticDelEvent(char *playerName, char *playerIP, char *playerGUID )
 {
     char strOut[API_LINE_STRING_MAX];
 
+    pstoreSessionClose( playerName, playerIP, playerGUID );               // player history first
+    journalRoster( JOURNAL_KIND_LEAVE, playerGUID, playerName, playerIP );
     snprintf( strOut, API_LINE_STRING_MAX, "~SYNTHDEL~ %s %s %s", playerGUID, playerIP, playerName );
     eventsDispatch( strOut  );
     return 0;
@@ -253,11 +301,37 @@ int rosterSyntheticAddEvent(char *playerName, char *playerIP, char *playerGUID )
 {
     char strOut[API_LINE_STRING_MAX];
 
+    pstoreSessionOpen( playerName, playerIP, playerGUID );                // player history first
+    journalRoster( JOURNAL_KIND_JOIN, playerGUID, playerName, playerIP );
     snprintf( strOut, API_LINE_STRING_MAX, "~SYNTHADD~ %s %s %s", playerGUID, playerIP, playerName );
     eventsDispatch( strOut  );
     return 0;
 }
 
+//  ==============================================================================================
+//  _apiJoinPrune (local)
+//
+//  Forgets the joiners that are now in the roster (their synthetic add event has been
+//  dispatched), and those never seen for API_JOIN_FORGET_SEC.  Returns the number of
+//  joiners still waiting.
+//
+static int _apiJoinPrune( void )
+{
+    uint64_t nowUs = metricsNowUs();
+    int i, waiting = 0;
+
+    for ( i=0; i<API_JOIN_PENDING_MAX; i++ ) {
+        if ( _apiJoinPending[i].seenUs == 0 ) continue;
+        if (( 0 != strlen( rosterLookupSteamIDFromName( _apiJoinPending[i].playerName ))) ||
+            ( nowUs - _apiJoinPending[i].seenUs > API_JOIN_FORGET_SEC * 1000000ULL ))
+            _apiJoinPending[i].seenUs = 0;
+        else
+            waiting++;
+    }
+    return( waiting );
+}
+
+
 //  ==============================================================================================
 //  _apiPollAlarmCB (local function)
 //
@@ -271,16 +345,17 @@ int rosterSyntheticAddEvent(char *playerName, char *playerIP, char *playerGUID )
 //
 int _apiPollAlarmCB( char *strIn )
 {
-    char rconCmd[API_T_BUFSIZE], rconResp[API_R_BUFSIZE];
-    int  bytesRead, errCode = 0;
+    char *rconResp;
+    int  bytesRead, errCode = 1;
 
     logPrintf( LOG_LEVEL_RAWDUMP, "api", "Roster update alarm callback ::%s::", strIn );
 
     // Fetch the roster
     //
-    snprintf( rconCmd, API_T_BUFSIZE, "listplayers" );
-    memset( rconResp, 0, API_R_BUFSIZE );
-    errCode = rdrvCommand( _rPtr, 2, rconCmd, rconResp, &bytesRead );
+    if ( NULL != (rconResp = (char *) arenaAlloc( API_R_BUFSIZE ))) {
+        memset( rconResp, 0, API_R_BUFSIZE );
+        errCode = rdrvCommand( _rPtr, 2, "listplayers", rconResp, &bytesRead );
+    }
     if ( !errCode ) {
         rosterParse( rconResp, bytesRead );
         // logPrintf( LOG_LEVEL_DEBUG, "api", "Listplayer success, player count is %d", rosterCount());
@@ -289,6 +364,8 @@ int _apiPollAlarmCB( char *strIn )
 	rosterSyntheticChangeEvent( rosterPrevious, rosterCurrent, rosterSyntheticDelEvent ); 
 	rosterSyntheticChangeEvent( rosterCurrent, rosterPrevious, rosterSyntheticAddEvent ); 
 	strlcpy( rosterPrevious, rosterCurrent, API_ROSTER_STRING_MAX );
+	rosterSyntheticChangeEvent( rosterCurrent, "", pstoreSessionTouch );  // open sessions
+        _apiJoinPrune();
 
     }
     else {
@@ -303,6 +380,30 @@ int _apiPollAlarmCB( char *strIn )
 }
 
 	
+//  ==============================================================================================
+//  _apiJoinAlarmCB (local function)
+//
+//  Roster fetch for players who joined.  There is a time lag between the log file reporting
+//  'join' and the new player showing up on the RCON roster read via the listplayers command,
+//  longer on a busy (CPU loaded) server.  If a joiner is still missing, the fetch is retried
+//  at doubling intervals until API_JOIN_GIVEUP_MS, rather than waiting for the next periodic
+//  poll, so that admission rules apply within a fraction of a second of the join.
+//
+int _apiJoinAlarmCB( char *strIn )
+{
+    _apiPollAlarmCB( "PlayerConnected" );
+
+    if (( 0 != _apiJoinPrune() ) && ( alarmNowMs() - _apiJoinStartMs + 2 * _apiJoinRetryMs <= API_JOIN_GIVEUP_MS )) {
+        _apiJoinRetryMs *= 2;
+        alarmResetMs( _apiJoinAlarmPtr, _apiJoinRetryMs );
+    }
+    else {
+        _apiJoinRetryMs = 0;
+    }
+    return 0;
+}
+
+
 //  ==============================================================================================
 //  _apiPlayerConnectedCB
 //
@@ -311,23 +412,57 @@ int _apiPollAlarmCB( char *strIn )
 //
 int _apiPlayerConnectedCB( char *strIn )
 {
+    char playerName[ ROSTER_FIELD_MAX ], *w;
+    int i, slot = 0;
+
     logPrintf( LOG_LEVEL_RAWDUMP, "api", "Player Connected callback ::%s::", strIn );
 
-    // Add delay here because there is a time lag between log file reporting 'add connection'
-    // until the new player shows up on RCON roster read via the listplayer command.
-    // The delay becomes more pronounced on a busy (CPU loaded) server state.
+    // Remember when the player joined, for plugins measuring their reaction time.  The log
+    // line may or may not end in CR: [2019.07.26-01.45.36:776][792]LogNet: Join succeeded: Name
     //
-    usleep( API_LOG2RCON_DELAY_MICROSEC );
-
-    // Update the roster which also resets the schedule for next refresh
-    // This routine resets the next alarm time 
-    // 
-    _apiPollAlarmCB("PlayerConnected");
+    strcpy( playerName, "" );
+    if ( NULL != (w = strstr( strIn, "Join succeeded: " ))) 
+        strlcpy( playerName, &w[ 16 ], ROSTER_FIELD_MAX );
+    w = &playerName[ strlen( playerName ) ];
+    while (( w > playerName ) && (( w[-1] == '\r' ) || ( w[-1] == '\n' ))) *(--w) = 0;
+
+    for ( i=0; i<API_JOIN_PENDING_MAX; i++ ) {
+        if ( _apiJoinPending[i].seenUs == 0 ) { slot = i; break; }
+        if ( _apiJoinPending[i].seenUs < _apiJoinPending[ slot ].seenUs ) slot = i;
+    }
+    strlcpy( _apiJoinPending[ slot ].playerName, playerName, ROSTER_FIELD_MAX );
+    _apiJoinPending[ slot ].seenUs = metricsNowUs();
 
+    // Fetch the roster shortly.  Joins arriving before that fetch (e.g., everyone rejoining
+    // after a map change) share it; a join during the back-off restarts the short interval.
+    //
+    if ( _apiJoinRetryMs != API_JOIN_FETCH_MS ) {
+        _apiJoinRetryMs = API_JOIN_FETCH_MS;
+        _apiJoinStartMs = alarmNowMs();
+        alarmResetMs( _apiJoinAlarmPtr, API_JOIN_FETCH_MS );
+    }
     return 0;
 }
 
 
+//  ==============================================================================================
+//  apiJoinTimeUs
+//
+//  Returns the time (metricsNowUs clock) the game log reported a player joining, or 0 if not
+//  known, e.g., already in game when SISSM started.  Available until shortly after the
+//  player's synthetic add event.
+//
+uint64_t apiJoinTimeUs( char *playerName )
+{
+    int i;
+
+    for ( i=0; i<API_JOIN_PENDING_MAX; i++ )
+        if (( _apiJoinPending[i].seenUs != 0 ) && ( 0 == strcmp( _apiJoinPending[i].playerName, playerName )))
+            return( _apiJoinPending[i].seenUs );
+    return( 0 );
+}
+
+
 //  ==============================================================================================
 //  _apiPlayerDisconnectedCB
 //
@@ -358,6 +493,147 @@ int _apiMapChangeCB( char *strIn )
 
     rosterParseMapname( strIn, API_LINE_STRING_MAX, _currMap );
     rosterSetMapName( _currMap );
+    journalEvent( SISSM_EV_MAPCHANGE, _currMap );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _apiSigtermCB
+//
+//  Call-back function dispatched when SISSM is shutting down.  The player history sessions
+//  of everyone still in game are left open with a fresh lastSeen, so that a restart soon
+//  after continues them and a longer outage credits them up to now.
+//
+int _apiSigtermCB( char *strIn )
+{
+    rosterSyntheticChangeEvent( rosterCurrent, "", pstoreSessionFlush );
+    pstoreDestroy();
+    banlistDestroy();
+    journalClose();
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _apiListsLoad (local)
+//
+//  (Re)load the admin and bad words lists, each into a staging copy that replaces the live
+//  list only if the file was read.  If forceFlag is clear, only lists whose file changed 
+//  since the last load are reloaded.
+//
+static void _apiListsLoad( int forceFlag )
+{
+    idList_t adminNew;
+    acmObj *matcherNew;
+    int count;
+
+    if ( forceFlag || fileWatchChanged( &adminListWatch, adminListFilePath )) {
+        if ( forceFlag ) fileWatchInit( &adminListWatch, adminListFilePath );
+        sidSetInit( &adminNew );
+        if ( 0 <= (count = apiIdListRead( adminListFilePath, &adminNew ))) {
+            sidSetFree( &adminIdList );
+            adminIdList = adminNew;
+        }
+        else {
+            sidSetFree( &adminNew );
+        }
+        logPrintf( LOG_LEVEL_CRITICAL, "api", "Admin list %d clients from file %s", count, adminListFilePath );
+    }
+
+    if ( forceFlag || fileWatchChanged( &badWordsWatch, badWordsFilePath )) {
+        if ( forceFlag ) fileWatchInit( &badWordsWatch, badWordsFilePath );
+        if ( 0 <= (count = apiWordListRead( badWordsFilePath, badWordsNew ))) 
+            memcpy( badWordsList, badWordsNew, sizeof( wordList_t ));
+        if (( 0 <= count ) || forceFlag ) {                 // force: sissm.badWordsFold may differ
+            if ( NULL != (matcherNew = apiWordListCompile( badWordsList, badWordsFold ))) {
+                acmDestroy( badWordsMatcher );
+                badWordsMatcher = matcherNew;
+            }
+        }
+        logPrintf( LOG_LEVEL_CRITICAL, "api", "BadWords list %d words from file %s", count, badWordsFilePath );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _apiPeriodicCB (local)
+//
+//  Call-back function dispatched every second by a repeating alarm.  Picks up edits to the admin and bad words lists,
+//  and pushes journal entries to disk.
+//
+int _apiPeriodicCB( char *strIn )
+{
+    _apiListsLoad( 0 );
+    journalFlush();
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _apiReloadConfigCB (local)
+//
+//  Call-back function dispatched after the .cfg file was reloaded.  List file paths may 
+//  have changed, so all lists are reloaded.  RCON and player store settings take effect on
+//  the next restart.
+//
+int _apiReloadConfigCB( char *strIn )
+{
+    cfsPtr cP;
+    char   newBanListFilePath[ API_LINE_STRING_MAX ];
+
+    cP = cfsCreate( sissmGetConfigPath() );
+    strlcpy( adminListFilePath, cfsFetchStr( cP, "sissm.adminListFilePath", "Admins.txt"), API_LINE_STRING_MAX );
+    strlcpy( badWordsFilePath, cfsFetchStr( cP, "sissm.badWordsFilePath", "" ), API_LINE_STRING_MAX );
+    badWordsFold = acmFoldParse( cfsFetchStr( cP, "sissm.badWordsFold", "" ));
+    strlcpy( newBanListFilePath, cfsFetchStr( cP, "sissm.banListFilePath", "" ), API_LINE_STRING_MAX );
+    cfsDestroy( cP );
+
+    _apiListsLoad( 1 );
+
+    if ( 0 != strcmp( newBanListFilePath, banListFilePath )) {
+        strlcpy( banListFilePath, newBanListFilePath, API_LINE_STRING_MAX );
+        banlistInit( banListFilePath );
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _apiMetricPlayers, _apiMetricRosterAge (local)
+//
+//  Gauges computed at scrape time: players in the roster, and seconds since the last
+//  successful roster poll (grows while the game server is down or RCON is failing).
+//
+static double _apiMetricPlayers( void )
+{
+    return( (double) rosterCount() );
+}
+
+static double _apiMetricRosterAge( void )
+{
+    return( (double) (apiTimeGet() - lastRosterSuccessTime) );
+}
+
+
+//  ==============================================================================================
+//  _apiCtlRoster (local)
+//
+//  Control socket 'roster' command: the map, then one tab separated line per player
+//  (netID, steamID, IP, score, name) from the current roster snapshot.
+//
+static int _apiCtlRoster( char *args, strBuf_t *bPtr )
+{
+    rosterSnap_t *snap = rosterSnapAcquire();
+    int i;
+
+    strBufPrintf( bPtr, "map\t%s\tplayers\t%d\n", snap->mapName, snap->count );
+    for ( i=0; i<snap->count; i++ ) {
+        strBufPrintf( bPtr, "%s\t%s\t%s\t%s\t%s\n", snap->players[i].netID, snap->players[i].steamID,
+            snap->players[i].IPaddress, snap->players[i].score, snap->players[i].playerName );
+    }
+    rosterSnapRelease( snap );
     return 0;
 }
 
@@ -372,7 +648,7 @@ int apiInit( void )
 {
     cfsPtr cP;
     char   myIP[API_LINE_STRING_MAX], myRconPassword[API_LINE_STRING_MAX];
-    int    myPort, adminCount, badWordsCount;
+    int    myPort;
     char   serverName[API_LINE_STRING_MAX], webFileName[API_LINE_STRING_MAX];
 
     // Read the "sissm" systems configuration variables
@@ -389,9 +665,27 @@ int apiInit( void )
     // read the Bad Words filename
     //
     strlcpy( badWordsFilePath, cfsFetchStr( cP, "sissm.badWordsFilePath", "" ), CFS_FETCH_MAX );
+    badWordsFold = acmFoldParse( cfsFetchStr( cP, "sissm.badWordsFold", "" ));
+
+    // read the player history store filename
+    //
+    strlcpy( playerStoreFilePath, cfsFetchStr( cP, "sissm.playerStoreFilePath", "" ), API_LINE_STRING_MAX );
+    playerStoreNameIndex = (int) cfsFetchNum( cP, "sissm.playerStoreNameIndex", 0 );
+
+    // read the local ban list filename
+    //
+    strlcpy( banListFilePath, cfsFetchStr( cP, "sissm.banListFilePath", "" ), API_LINE_STRING_MAX );
+
+    // read the binary event journal base name
+    //
+    strlcpy( journalFilePath, cfsFetchStr( cP, "sissm.journalFilePath", "" ), API_LINE_STRING_MAX );
 
     cfsDestroy( cP );
 
+    // Open the event journal first so that startup RCON traffic is recorded
+    //
+    journalOpen( journalFilePath );
+
     // Set map to unknown
     //
     rosterSetMapName( "Unknown" );
@@ -405,12 +699,23 @@ int apiInit( void )
     eventsRegister( SISSM_EV_CLIENT_ADD, _apiPlayerConnectedCB );
     eventsRegister( SISSM_EV_CLIENT_DEL, _apiPlayerDisconnectedCB );
     eventsRegister( SISSM_EV_MAPCHANGE,  _apiMapChangeCB );
+    eventsRegister( SISSM_EV_SIGTERM,    _apiSigtermCB );
+    eventsRegister( SISSM_EV_RELOAD,     _apiReloadConfigCB );
 
     // Setup Alarm (periodic callbacks) for fetching roster from RCON
     // 
     _apiPollAlarmPtr = alarmCreate( _apiPollAlarmCB );
     alarmReset( _apiPollAlarmPtr, API_LISTPLAYERS_PERIOD );
 
+    _apiPeriodicAlarmPtr = alarmCreate( _apiPeriodicCB );
+    alarmRepeat( _apiPeriodicAlarmPtr, 1000 );
+
+    _apiJoinAlarmPtr = alarmCreate( _apiJoinAlarmCB );
+
+    metricsGaugeFn( "sissm_players", "Players in the roster", "", _apiMetricPlayers );
+    metricsGaugeFn( "sissm_roster_age_seconds", "Seconds since the last successful roster poll", "", _apiMetricRosterAge );
+    ctlRegister( "roster", "players online: netID, steamID, IP, score, name", _apiCtlRoster );
+
     // Clear the Roster module that keeps track of players
     //
     rosterInit();
@@ -418,15 +723,17 @@ int apiInit( void )
     lastRosterSuccessTime = apiTimeGet();      
     rosterReset();
 
-    // Read the admin list
+    // Read the admin and Bad Words lists
+    //
+    _apiListsLoad( 1 );
+
+    // Open the player history store
     //
-    adminCount = apiIdListRead( adminListFilePath, adminIdList );
-    logPrintf( LOG_LEVEL_CRITICAL, "api", "Admin list %d clients from file %s", adminCount, adminListFilePath );
+    pstoreInit( playerStoreFilePath, playerStoreNameIndex );
 
-    // Read the Bad Words list
+    // Load the local ban list
     //
-    badWordsCount = apiWordListRead( badWordsFilePath, badWordsList );
-    logPrintf( LOG_LEVEL_CRITICAL, "api", "BadWords list %d words from file %s", badWordsCount, badWordsFilePath );
+    banlistInit( banListFilePath );
 
     return( _rPtr == NULL );
 }
@@ -441,6 +748,8 @@ int apiDestroy( void )
 {
     rdrvDestroy( _rPtr );
     _rPtr = NULL; 
+    acmDestroy( badWordsMatcher );
+    badWordsMatcher = NULL;
     return 0;
 }
 
@@ -471,16 +780,28 @@ unsigned int apiTimeGet( void )
 //  ==============================================================================================
 //  apiTimeGetHuman
 //
-//  Called from a Plugin, this method fetches human readable time.
+//  Called from a Plugin, this method fetches human readable time.  The _r variant writes to
+//  the caller's buffer (26 bytes or more).
 //
-char *apiTimeGetHuman( void )
+char *apiTimeGetHuman_r( char *timeOut, size_t outSize )
 {
-    static char humanTime[API_LINE_STRING_MAX];
     time_t current_time;
+    char   ctimeStr[32];
 
     current_time = time( NULL );
-    strlcpy( humanTime, ctime( &current_time ), API_LINE_STRING_MAX );
-    return( humanTime );
+#ifdef _WIN32
+    ctime_s( ctimeStr, sizeof( ctimeStr ), &current_time );
+#else
+    ctime_r( &current_time, ctimeStr );
+#endif
+    strlcpy( timeOut, ctimeStr, outSize );
+    return( timeOut );
+}
+
+char *apiTimeGetHuman( void )
+{
+    static char humanTime[API_LINE_STRING_MAX];
+    return( apiTimeGetHuman_r( humanTime, API_LINE_STRING_MAX ));
 }
 
 //  ==============================================================================================
@@ -490,11 +811,11 @@ char *apiTimeGetHuman( void )
 //
 int apiGameModePropertySet( char *gameModeProperty, char *value )
 {
-    char rconCmd[API_T_BUFSIZE], rconResp[API_R_BUFSIZE];
+    char *rconResp;
     int bytesRead;
 
-    snprintf( rconCmd, API_T_BUFSIZE, "gamemodeproperty %s %s", gameModeProperty, value );
-    rdrvCommand( _rPtr, 2, rconCmd, rconResp, &bytesRead );
+    if ( NULL != (rconResp = (char *) arenaAlloc( API_R_BUFSIZE )))
+        rdrvCommand( _rPtr, 2, arenaPrintf( "gamemodeproperty %s %s", gameModeProperty, value ), rconResp, &bytesRead );
 
     return( 0 );
 }
@@ -503,25 +824,32 @@ int apiGameModePropertySet( char *gameModeProperty, char *value )
 //  apiGameModePropertyGet
 //
 //  Called from a Plugin, this method reads gamemodeproperty (cvar) from the game server.
+//  The _r variant writes the value to the caller's buffer.
 //
-char *apiGameModePropertyGet( char *gameModeProperty )
+char *apiGameModePropertyGet_r( char *gameModeProperty, char *value, size_t outSize )
 {
-    static char value[16*1024];
-    char rconCmd[API_T_BUFSIZE], rconResp[API_R_BUFSIZE];
-    int bytesRead;
+    char *rconResp;
+    int bytesRead = 0;
+    strView_t w;
 
-    strcpy( value, "" );
+    strlcpy( value, "", outSize );
 
-    snprintf( rconCmd, API_T_BUFSIZE, "gamemodeproperty %s", gameModeProperty );
-    rdrvCommand( _rPtr, 2, rconCmd, rconResp, &bytesRead );
+    if ( NULL == (rconResp = (char *) arenaAlloc( API_R_BUFSIZE ))) return( value );
+    rdrvCommand( _rPtr, 2, arenaPrintf( "gamemodeproperty %s", gameModeProperty ), rconResp, &bytesRead );
 
-    if ( bytesRead > strlen( gameModeProperty )) {
-        strncpy( value, getWord( rconResp, 1, "\"" ), sizeof( value ));
+    if (( bytesRead > strlen( gameModeProperty )) && wordView( rconResp, 1, "\"", &w )) {
+        strViewCopy( value, outSize, &w );
     }
 
     return( value );
 }
 
+char *apiGameModePropertyGet( char *gameModeProperty )
+{
+    static char value[16*1024];
+    return( apiGameModePropertyGet_r( gameModeProperty, value, sizeof( value )));
+}
+
 //  ==============================================================================================
 //  apiSay
 //
@@ -530,41 +858,92 @@ char *apiGameModePropertyGet( char *gameModeProperty )
 //
 int apiSay( const char * format, ... )
 {
-    static char buffer[API_T_BUFSIZE];
-    char rconCmd[API_T_BUFSIZE], rconResp[API_R_BUFSIZE];
+    char *buffer, *rconResp;
     int bytesRead;
 
     va_list args;
+    if (( NULL == (buffer = (char *) arenaAlloc( API_T_BUFSIZE ))) ||
+        ( NULL == (rconResp = (char *) arenaAlloc( API_R_BUFSIZE )))) return 0;
+
     va_start( args, format );
     vsnprintf( buffer, API_T_BUFSIZE, format, args );
+    va_end (args);
 
-    snprintf( rconCmd, API_T_BUFSIZE, "say %s", buffer );
-    if ( 0 != strlen( buffer ) )   // say only when something to be said
-        rdrvCommand( _rPtr, 2, rconCmd, rconResp, &bytesRead );
+    if ( apiSayCapturePtr != NULL ) {                          // control socket command reply
+        strBufPrintf( apiSayCapturePtr, "%s\n", buffer );
+    }
+    else if ( 0 != strlen( buffer ) ) {  // say only when something to be said
+        rdrvCommand( _rPtr, 2, arenaPrintf( "say %s", buffer ), rconResp, &bytesRead );
+        journalAction( "say", NULL, NULL );                       // verb only, no free text
+    }
 
-    va_end (args);
     return 0;
 }
   
+//  ==============================================================================================
+//  apiSayCapture
+//
+//  While set, apiSay() text is appended to bPtr instead of being said in game, so that a
+//  picladmin command run from the control socket answers there.  Call with NULL to end.
+//
+void apiSayCapture( strBuf_t *bPtr )
+{
+    apiSayCapturePtr = bPtr;
+    return;
+}
+
+
 //  ==============================================================================================
 //  apiKickOrBanSay
 //
 //  Called from a Plugin, this method is used to kick or ban a player by SteamGUID64 identifier.
 //  Optional *reason string may be attached, or call with empty string if not needed ("").
-//  The player must be actively in game or else the command will fail.
+//  The player must be actively in game or else the command will fail.  Returns 0 if the
+//  server answered, 1 if not; the action is journaled only if answered.
 //
 int apiKickOrBan( int isBan, char *playerGUID, char *reason )
 {
-    char rconCmd[API_T_BUFSIZE], rconResp[API_R_BUFSIZE];
+    char *rconCmd, *rconResp;
     int bytesRead;
 
+    if ( NULL == (rconResp = (char *) arenaAlloc( API_R_BUFSIZE ))) return 1;
     if ( isBan ) {
-        snprintf( rconCmd, API_T_BUFSIZE, "ban %s -1 %s", playerGUID, reason );
+        rconCmd = arenaPrintf( "ban %s -1 %s", playerGUID, reason );
     }
     else {
-        snprintf( rconCmd, API_T_BUFSIZE, "kick %s %s", playerGUID, reason );
+        rconCmd = arenaPrintf( "kick %s %s", playerGUID, reason );
     }
-    rdrvCommand( _rPtr, 2, rconCmd, rconResp, &bytesRead );
+    if ( 0 != rdrvCommand( _rPtr, 2, rconCmd, rconResp, &bytesRead )) return 1;
+    journalAction( isBan ? "ban" : "kick", playerGUID, reason );
+
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  apiKickOrBanNow
+//
+//  Same as apiKickOrBan, for admission control: the command goes out as a single pipelined
+//  exchange that skips the fixed transmit/receive delays and continuation probe of a normal
+//  command, so the player is removed as soon as the server answers.  If the server does not
+//  answer, it is retried as a normal command (apiKickOrBan).  Returns 0 if answered, 1 if not.
+//
+int apiKickOrBanNow( int isBan, char *playerGUID, char *reason )
+{
+    char *rconCmd;
+    int ok;
+
+    if ( isBan ) {
+        rconCmd = arenaPrintf( "ban %s -1 %s", playerGUID, reason );
+    }
+    else {
+        rconCmd = arenaPrintf( "kick %s %s", playerGUID, reason );
+    }
+    if ( 1 != rdrvBatch( _rPtr, 2, &rconCmd, 1, &ok )) {
+        logPrintf( LOG_LEVEL_WARN, "api", "Admission %s of %s not answered, retrying", isBan ? "ban" : "kick", playerGUID );
+        return( apiKickOrBan( isBan, playerGUID, reason ));
+    }
+    journalAction( isBan ? "ban" : "kick", playerGUID, reason );
 
     return 0;
 }
@@ -582,6 +961,18 @@ int apiRcon( char *commandOut, char *statusIn )
     return( bytesRead );
 }
 
+//  ==============================================================================================
+//  apiRconBatch
+//
+//  Called from a plugin, sends up to RDRV_BATCH_MAX commands in one pipelined exchange, e.g.,
+//  a macro.  The responses are not returned: okOut[i] is set to 1 for each command the server
+//  answered.  Returns the number of commands answered.
+//
+int apiRconBatch( char **commands, int count, int *okOut )
+{
+    return( rdrvBatch( _rPtr, 2, commands, count, okOut ));
+}
+
 //  ==============================================================================================
 //  apiPlayersGetCount
 //
@@ -604,13 +995,18 @@ int apiPlayersGetCount( void )
 //  Called from a plugin, this routine returns a single contatenated string of all connected 
 //  players information such as name, GUID, IP, and score.  For different output format options
 //  see rosterPlayerList() in roster.c.  You may specify your custom delimiter string between
-//  individual player data.
+//  individual player data.  The _r variant writes to the caller's buffer.
 //
 char *apiPlayersRoster( int infoDepth, char *delimiter )
 {
     return ( rosterPlayerList(infoDepth, delimiter) );
 }
 
+char *apiPlayersRoster_r( int infoDepth, char *delimiter, char *rosterOut, size_t outSize )
+{
+    return ( rosterPlayerList_r( infoDepth, delimiter, rosterOut, outSize ) );
+}
+
 
 //  ==============================================================================================
 //  apiGetServerName
@@ -629,11 +1025,17 @@ char *apiGetServerName( void )
 //
 //  Called from a plugin, this routine returns the current map name.  Currently, the map name
 //  returned here is not valid until after the first map change as executed since the restart.
+//  The _r variant writes to the caller's buffer.
 //
 char *apiGetMapName( void )
 {
     return ( rosterGetMapName() );
 }
 
+char *apiGetMapName_r( char *mapOut, size_t outSize )
+{
+    return ( rosterGetMapName_r( mapOut, outSize ) );
+}
+
 
 
@@ -14,6 +14,11 @@
 //  ==============================================================================================
 //
 
+#include <stddef.h>
+#include <stdint.h>
+#include "util.h"
+#include "sid.h"
+
 extern int   apiInit( void );
 extern int   apiDestroy( void );
 extern int   apiServerRestart( void );
@@ -21,7 +26,9 @@ extern int   apiGameModePropertySet( char *gameModeProperty, char *value );
 extern char *apiGameModePropertyGet( char *gameModeProperty );
 extern int   apiSay( const char * format, ... );
 extern int   apiKickOrBan( int isBan, char *playerGUID, char *reason );
+extern int   apiKickOrBanNow( int isBan, char *playerGUID, char *reason );
 extern int   apiRcon( char *commandOut, char *statusIn );
+extern int   apiRconBatch( char **commands, int count, int *okOut );
 extern int   apiPlayersGetCount( void );
 extern char *apiPlayersRoster( int infoDepth, char *delimeter );
 extern char *apiGetServerName( void );
@@ -29,24 +36,35 @@ extern char *apiGetMapName( void );
 extern unsigned int apiTimeGet( void );
 extern char  *apiTimeGetHuman( void );
 extern unsigned long apiGetLastRosterTime( void );
+extern unsigned long apiGetRosterVersion( void );
+extern uint64_t apiJoinTimeUs( char *playerName );
 extern int   apiBadNameCheck( char *nameIn );
+extern char *apiBadWordFind( char *stringTested );
+extern void  apiSayCapture( strBuf_t *bPtr );              // util.h must be included first
+
+//  Reentrant variants: results go to the caller's buffer, roster data is read from the 
+//  current roster snapshot.  Safe to call from threads other than the main loop, except
+//  apiGameModePropertyGet_r which talks to RCON.
+//
+extern char *apiGameModePropertyGet_r( char *gameModeProperty, char *value, size_t outSize );
+extern char *apiPlayersRoster_r( int infoDepth, char *delimeter, char *rosterOut, size_t outSize );
+extern char *apiGetMapName_r( char *mapOut, size_t outSize );
+extern char *apiTimeGetHuman_r( char *timeOut, size_t outSize );
 
 
-#define IDLISTMAXELEM        (256)
-#define IDLISTMAXSTRSZ        (40)
-#define IDSTEAMID64LEN        (17)
+#define IDSTEAMID64LEN        (SID_STRLEN)
 
 #define WORDLISTMAXELEM     (1024)
 #define WORDLISTMAXSTRSZ      (32)
 
 
-typedef char idList_t[IDLISTMAXELEM][IDLISTMAXSTRSZ];
-extern int   apiIdListRead( char *listFile, idList_t idList );
-extern int   apiIdListCheck( char *connectID, idList_t idList );
+typedef sidSet_t idList_t;
+extern int   apiIdListRead( char *listFile, idList_t *idList );
+extern int   apiIdListCheck( char *connectID, idList_t *idList );
 extern int   apiIsAdmin( char *connectID );
 
 typedef char wordList_t[WORDLISTMAXELEM][WORDLISTMAXSTRSZ];
 extern int apiWordListRead( char *listFile, wordList_t wordList );
-extern int apiWordListCheck( char *stringTested, wordList_t wordList );
+extern struct acmObj *apiWordListCompile( wordList_t wordList, int foldFlags );    // see acm.h
 
 
@@ -0,0 +1,225 @@
+//  ==============================================================================================
+//
+//  Module: ARENA
+//
+//  Description:
+//  Per-tick bump allocator for transient strings and buffers
+//
+//  Memory handed out by arenaAlloc() lives until the end of the current pass of the main
+//  loop, when arenaReset() rewinds the arena in O(1).  It is meant for what used to be
+//  large stack or static buffers in event callbacks: the game log line, RCON command and
+//  response buffers, parsed player name/GUID/IP fields, formatted strings.  Never keep an
+//  arena pointer across passes (e.g., in a static, or in an alarm's user data).
+//
+//  Blocks are kept across resets, so in steady state no malloc() is done at all.  An
+//  oversized request gets its own block.  arenaAlloc memory is not cleared.
+//
+//  The arena belongs to the main loop thread.  Other threads use caller buffers (the _r
+//  calls) instead.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "util.h"
+#include "metrics.h"
+#include "arena.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define ARENA_ALIGN           (16)
+
+typedef struct arenaBlock {
+
+    struct arenaBlock *next;
+    size_t             size;                                         // usable bytes in data[]
+    size_t             used;
+    uint64_t           pad;                                     // keeps data[] 16-byte aligned
+    unsigned char      data[];
+
+} arenaBlock_t;
+
+static arenaBlock_t *arenaFirst = NULL;                                   // block chain
+static arenaBlock_t *arenaCurr  = NULL;                         // block being bumped into
+static arenaStats_t  arenaCounters;
+
+
+//  ==============================================================================================
+//  _arenaNewBlock (local)
+//
+static arenaBlock_t *_arenaNewBlock( size_t size )
+{
+    arenaBlock_t *b;
+
+    if ( size < ARENA_BLOCK_SIZE ) size = ARENA_BLOCK_SIZE;
+    if ( NULL != (b = (arenaBlock_t *) malloc( sizeof( arenaBlock_t ) + size ))) {
+        b->next = NULL;
+        b->size = size;
+        b->used = 0;
+        arenaCounters.capacity += size;
+        arenaCounters.blocks++;
+    }
+    return( b );
+}
+
+
+//  ==============================================================================================
+//  _arenaMetricPeak, _arenaMetricCapacity (local)
+//
+static double _arenaMetricPeak( void )
+{
+    return( (double) arenaCounters.peakBytes );
+}
+
+static double _arenaMetricCapacity( void )
+{
+    return( (double) arenaCounters.capacity );
+}
+
+
+//  ==============================================================================================
+//  arenaInit
+//
+//  Module initialization, called once before the main loop.
+//
+void arenaInit( void )
+{
+    memset( &arenaCounters, 0, sizeof( arenaCounters ));
+    if ( arenaFirst == NULL ) arenaFirst = _arenaNewBlock( ARENA_BLOCK_SIZE );
+    arenaCurr = arenaFirst;
+
+    metricsGaugeFn( "sissm_arena_peak_bytes", "Largest per-tick arena use since start", "", _arenaMetricPeak );
+    metricsGaugeFn( "sissm_arena_capacity_bytes", "Memory held by the per-tick arena", "", _arenaMetricCapacity );
+    return;
+}
+
+
+//  ==============================================================================================
+//  arenaAlloc
+//
+//  Returns 'size' bytes (16-byte aligned) valid until the next arenaReset(), or NULL if
+//  out of memory.
+//
+void *arenaAlloc( size_t size )
+{
+    arenaBlock_t *b, *prev = NULL;
+    void *p;
+
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+    if ( size == 0 ) size = ARENA_ALIGN;
+
+    // use the current block, else the next retained block that is big enough, else a new one
+    //
+    for ( b = arenaCurr; b != NULL; prev = b, b = b->next ) {
+        if ( b != arenaCurr ) b->used = 0;                     // rewind lazily (arenaReset)
+        if ( b->size - b->used >= size ) break;
+    }
+    if ( b == NULL ) {
+        if ( NULL == (b = _arenaNewBlock( size ))) return( NULL );
+        if ( prev != NULL ) prev->next = b;
+        else arenaFirst = b;
+    }
+    arenaCurr = b;
+
+    p = &b->data[ b->used ];
+    b->used += size;
+
+    arenaCounters.allocs++;
+    arenaCounters.bytes += size;
+    arenaCounters.tickBytes += size;
+    return( p );
+}
+
+
+//  ==============================================================================================
+//  arenaStrndup
+//
+//  Copies up to len characters of strIn (e.g., a strView_t) into the arena, NUL terminated.
+//  Returns "" if out of memory, so callers need not check.
+//
+char *arenaStrndup( const char *strIn, size_t len )
+{
+    char *p;
+
+    if ( NULL == (p = (char *) arenaAlloc( len + 1 ))) return( "" );
+    memcpy( p, strIn, len );
+    p[len] = 0;
+    return( p );
+}
+
+
+//  ==============================================================================================
+//  arenaStrdup
+//
+char *arenaStrdup( const char *strIn )
+{
+    return( arenaStrndup( strIn, strlen( strIn )));
+}
+
+
+//  ==============================================================================================
+//  arenaPrintf
+//
+//  printf into an arena string of exactly the needed size.  Returns "" if out of memory.
+//
+char *arenaPrintf( const char *format, ... )
+{
+    va_list args;
+    char *p;
+    int n;
+
+    va_start( args, format );
+    n = vsnprintf( NULL, 0, format, args );
+    va_end( args );
+    if (( n < 0 ) || ( NULL == (p = (char *) arenaAlloc( (size_t) n + 1 )))) return( "" );
+
+    va_start( args, format );
+    vsnprintf( p, (size_t) n + 1, format, args );
+    va_end( args );
+    return( p );
+}
+
+
+//  ==============================================================================================
+//  arenaReset
+//
+//  Release everything allocated since the last reset.  Called by the main loop at the end
+//  of every pass.  O(1): blocks after the first are rewound lazily as they are reused.
+//
+void arenaReset( void )
+{
+    if ( arenaCounters.tickBytes > arenaCounters.peakBytes )
+        arenaCounters.peakBytes = arenaCounters.tickBytes;
+    arenaCounters.tickBytes = 0;
+    arenaCounters.resets++;
+
+    if ( arenaFirst != NULL ) arenaFirst->used = 0;
+    arenaCurr = arenaFirst;
+    return;
+}
+
+
+//  ==============================================================================================
+//  arenaStats
+//
+//  Copy the allocation counters, e.g., for metrics or a debug log line.
+//
+void arenaStats( arenaStats_t *stats )
+{
+    *stats = arenaCounters;
+    return;
+}
+
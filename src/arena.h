@@ -0,0 +1,40 @@
+//  ==============================================================================================
+//
+//  Module: ARENA
+//
+//  Description:
+//  Per-tick bump allocator for transient strings and buffers
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_BLOCK_SIZE      (64*1024)                      // default block, grows as needed
+
+typedef struct {
+
+    uint64_t allocs;                                       // arenaAlloc calls since start
+    uint64_t bytes;                                        // bytes handed out since start
+    uint64_t resets;                                               // dispatch cycles seen
+    size_t   tickBytes;                                      // bytes used in current tick
+    size_t   peakBytes;                                     // largest tick since start
+    size_t   capacity;                                      // bytes held in all blocks
+    int      blocks;
+
+} arenaStats_t;
+
+extern void  arenaInit( void );
+extern void *arenaAlloc( size_t size );
+extern char *arenaStrdup( const char *strIn );
+extern char *arenaStrndup( const char *strIn, size_t len );
+extern char *arenaPrintf( const char *format, ... );
+extern void  arenaReset( void );
+extern void  arenaStats( arenaStats_t *stats );
+
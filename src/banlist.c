@@ -0,0 +1,377 @@
+//  ==============================================================================================
+//
+//  Module: BANLIST
+//
+//  Description:
+//  Local SteamID64 ban list with expiry and reason, hot-reloaded from file
+//
+//  The ban file is plain text so that community lists can be shared and merged with
+//  standard tools, one ban per line:
+//
+//      <SteamID64> [expiry-epoch] [reason...]
+//
+//  An expiry of 0 (or none) is permanent.  Blank lines and lines starting with '#' or '//'
+//  are ignored.  If an ID is listed more than once, the last line wins, so that an entry
+//  appended by an admin overrides an older one.
+//
+//  The file is memory-mapped and parsed into a SteamID64 hash set whose payload points at
+//  the expiry and reason, so that the join-time check is a hash probe regardless of list
+//  size.  The file modification time is checked on lookup, at most every few seconds, and
+//  the list is reloaded when it changed.  A failed reload keeps the previous list.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include "winport.h"
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#include "bsd.h"
+#include "log.h"
+#include "sid.h"
+#include "banlist.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define BANLIST_FILENAME_MAX  (1024)
+#define BANLIST_LINE_MAX       (512)
+#define BANLIST_STAT_SEC         (3)                     // min interval between file mtime checks
+
+typedef struct {
+
+    uint32_t expiry;                                               // epoch, 0 = permanent
+    uint32_t reasonOfs;                                                    // offset in pool
+
+} banlistEntry_t;
+
+typedef struct {
+
+    sidSet_t        set;                                        // steamID -> entry number
+    banlistEntry_t *entries;
+    uint32_t        entryCount, entrySize;
+    char           *pool;                                                 // reason strings
+    uint32_t        poolUsed, poolSize;
+
+} banlist_t;
+
+static banlist_t _ban;
+static char      _banFileName[BANLIST_FILENAME_MAX] = "";
+static time_t    _banFileMtime = 0;
+static long long _banFileSize  = -1;
+static time_t    _banLastStat  = 0;
+
+
+//  ==============================================================================================
+//  _banlistFree (local)
+//
+static void _banlistFree( banlist_t *bPtr )
+{
+    sidSetFree( &bPtr->set );
+    free( bPtr->entries );
+    free( bPtr->pool );
+    memset( bPtr, 0, sizeof( banlist_t ));
+    return;
+}
+
+
+//  ==============================================================================================
+//  _banlistPut (local)
+//
+//  Add or replace one ban.  Returns 0 on success.
+//
+static int _banlistPut( banlist_t *bPtr, sid_t id, uint32_t expiry, char *reason )
+{
+    banlistEntry_t *e;
+    uint32_t entryNo, n;
+    char *p;
+
+    n = (uint32_t) strnlen( reason, BANLIST_REASON_MAX - 1 ) + 1;
+
+    if ( bPtr->poolUsed + n > bPtr->poolSize ) {
+        p = (char *) realloc( bPtr->pool, bPtr->poolSize * 2 + n + 4096 );
+        if ( p == NULL ) return 1;
+        bPtr->pool = p;
+        bPtr->poolSize = bPtr->poolSize * 2 + n + 4096;
+    }
+
+    // a repeated ID reuses its entry; the old reason string is simply left in the pool
+    //
+    if ( !sidSetFind( &bPtr->set, id, &entryNo )) {
+        if ( bPtr->entryCount == bPtr->entrySize ) {
+            e = (banlistEntry_t *) realloc( bPtr->entries,
+                (bPtr->entrySize ? bPtr->entrySize * 2 : 1024) * sizeof( banlistEntry_t ));
+            if ( e == NULL ) return 1;
+            bPtr->entries = e;
+            bPtr->entrySize = bPtr->entrySize ? bPtr->entrySize * 2 : 1024;
+        }
+        entryNo = bPtr->entryCount;
+        if ( 0 != sidSetAdd( &bPtr->set, id, entryNo )) return 1;
+        bPtr->entryCount++;
+    }
+
+    bPtr->entries[entryNo].expiry = expiry;
+    bPtr->entries[entryNo].reasonOfs = bPtr->poolUsed;
+    strlcpy( &bPtr->pool[ bPtr->poolUsed ], reason, n );
+    bPtr->poolUsed += n;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _banlistParseLine (local)
+//
+//  Parse one NUL-terminated line into the list.  Malformed lines are skipped silently.
+//
+static void _banlistParseLine( banlist_t *bPtr, char *line )
+{
+    char idStr[SID_STRLEN+1], *p;
+    unsigned long expiry = 0;
+    sid_t id;
+
+    while (( *line == ' ' ) || ( *line == '\011' )) line++;
+    if (( *line == '#' ) || ( 0 == strncmp( line, "//", 2 ))) return;
+    if ( SID_STRLEN != strcspn( line, " \011\015" )) return;
+
+    memcpy( idStr, line, SID_STRLEN );
+    idStr[SID_STRLEN] = 0;
+    if ( 0 == (id = sidParse( idStr ))) return;
+
+    p = &line[SID_STRLEN];
+    expiry = strtoul( p, &p, 10 );
+    while (( *p == ' ' ) || ( *p == '\011' )) p++;
+    p[ strcspn( p, "\015" ) ] = 0;
+
+    _banlistPut( bPtr, id, (uint32_t) expiry, p );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _banlistParse (local)
+//
+//  Parse the whole file image (not NUL-terminated) into bPtr
+//
+static void _banlistParse( banlist_t *bPtr, char *buf, size_t size )
+{
+    char line[BANLIST_LINE_MAX], *eol;
+    size_t n;
+
+    while ( size > 0 ) {
+        eol = (char *) memchr( buf, '\n', size );
+        n = ( eol == NULL ) ? size : (size_t) (eol - buf);
+        if ( n < BANLIST_LINE_MAX ) {
+            memcpy( line, buf, n );
+            line[n] = 0;
+            _banlistParseLine( bPtr, line );
+        }
+        if ( eol == NULL ) break;
+        buf  += n + 1;
+        size -= n + 1;
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _banlistLoad (local)
+//
+//  Map and parse the ban file into bPtr.  Returns 0 on success.  A missing file is an
+//  empty list, not an error.
+//
+static int _banlistLoad( banlist_t *bPtr, struct stat *st )
+{
+    int errCode = 0;
+    char *buf;
+
+    memset( bPtr, 0, sizeof( banlist_t ));
+    if ( st->st_size == 0 ) return 0;
+
+#ifdef _WIN32
+    FILE *fpr;
+
+    if ( NULL == (buf = (char *) malloc( st->st_size ))) return 1;
+    if ( NULL != (fpr = fopen( _banFileName, "rb" ))) {
+        if ( 1 == fread( buf, st->st_size, 1, fpr )) _banlistParse( bPtr, buf, st->st_size );
+        else errCode = 1;
+        fclose( fpr );
+    }
+    else {
+        errCode = 1;
+    }
+    free( buf );
+#else
+    int fd;
+
+    if ( 0 > (fd = open( _banFileName, O_RDONLY ))) return 1;
+    buf = (char *) mmap( NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( buf == MAP_FAILED ) return 1;
+    madvise( buf, st->st_size, MADV_SEQUENTIAL );
+    _banlistParse( bPtr, buf, st->st_size );
+    munmap( buf, st->st_size );
+#endif
+
+    if ( errCode ) _banlistFree( bPtr );
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  banlistReload
+//
+//  Reload the ban file if it changed since the last load (or always, if forceFlag is set).
+//  Returns 0 if the in-memory list is current.
+//
+int banlistReload( int forceFlag )
+{
+    struct stat st;
+    banlist_t newBan;
+
+    if ( 0 == strlen( _banFileName )) return 1;
+    _banLastStat = time( NULL );
+
+    if ( 0 != stat( _banFileName, &st )) {
+        memset( &st, 0, sizeof( st ));                     // no file yet: empty list
+    }
+    if ( !forceFlag && ( st.st_mtime == _banFileMtime ) && ( (long long) st.st_size == _banFileSize ))
+        return 0;
+
+    if ( 0 != _banlistLoad( &newBan, &st )) {
+        logPrintf( LOG_LEVEL_CRITICAL, "banlist", "Unable to read ban list ::%s::, keeping previous", _banFileName );
+        return 1;
+    }
+    _banlistFree( &_ban );
+    _ban = newBan;
+    _banFileMtime = st.st_mtime;
+    _banFileSize = (long long) st.st_size;
+
+    logPrintf( LOG_LEVEL_CRITICAL, "banlist", "Ban list %u entries from file %s", _ban.set.count, _banFileName );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  banlistInit
+//
+//  Load the ban list.  Empty fileName disables the module.  Returns 0 on success.
+//
+int banlistInit( char *fileName )
+{
+    banlistDestroy();
+    strlcpy( _banFileName, fileName, BANLIST_FILENAME_MAX );
+    return( banlistReload( 1 ));
+}
+
+
+//  ==============================================================================================
+//  banlistDestroy
+//
+void banlistDestroy( void )
+{
+    _banlistFree( &_ban );
+    strlcpy( _banFileName, "", BANLIST_FILENAME_MAX );
+    _banFileMtime = 0;
+    _banFileSize = -1;
+    return;
+}
+
+
+//  ==============================================================================================
+//  banlistCheck
+//
+//  Returns 1 if the player is banned (and not expired), 0 otherwise.  If reason is not NULL
+//  the ban reason is copied to it.  Picks up file changes at most every BANLIST_STAT_SEC.
+//
+int banlistCheck( char *playerGUID, char *reason, int maxReason )
+{
+    uint32_t entryNo;
+    banlistEntry_t *e;
+    time_t timeNow;
+
+    if ( 0 == strlen( _banFileName )) return 0;
+
+    timeNow = time( NULL );
+    if ( timeNow - _banLastStat >= BANLIST_STAT_SEC ) banlistReload( 0 );
+
+    if ( !sidSetFind( &_ban.set, sidParse( playerGUID ), &entryNo )) return 0;
+
+    e = &_ban.entries[ entryNo ];
+    if (( e->expiry != 0 ) && ( (time_t) e->expiry <= timeNow )) return 0;
+    if ( reason != NULL ) strlcpy( reason, &_ban.pool[ e->reasonOfs ], maxReason );
+    return 1;
+}
+
+
+//  ==============================================================================================
+//  banlistAdd
+//
+//  Ban a player for durationSec seconds (0 = permanent).  The ban is appended to the file
+//  and takes effect immediately.  Returns 0 on success.
+//
+int banlistAdd( char *playerGUID, unsigned long durationSec, char *reason )
+{
+    struct stat st;
+    FILE *fpa;
+    uint32_t expiry = 0;
+    char cleanReason[BANLIST_REASON_MAX];
+    sid_t id;
+    int errCode = 1;
+
+    if (( 0 == strlen( _banFileName )) || ( 0 == (id = sidParse( playerGUID )))) return 1;
+
+    // pick up outside edits first so they are not mistaken for our own append later
+    //
+    banlistReload( 0 );
+
+    if ( durationSec != 0 ) expiry = (uint32_t) (time( NULL ) + durationSec);
+    strlcpy( cleanReason, reason, BANLIST_REASON_MAX );
+    cleanReason[ strcspn( cleanReason, "\012\015" ) ] = 0;
+
+    if ( NULL != (fpa = fopen( _banFileName, "at" ))) {
+        if ( 0 < fprintf( fpa, "%s %lu %s\n", playerGUID, (unsigned long) expiry, cleanReason )) errCode = 0;
+        fclose( fpa );
+    }
+    if ( errCode ) {
+        logPrintf( LOG_LEVEL_CRITICAL, "banlist", "Unable to append to ban list ::%s::", _banFileName );
+        return 1;
+    }
+
+    errCode = _banlistPut( &_ban, id, expiry, cleanReason );
+    if ( 0 == stat( _banFileName, &st )) {
+        _banFileMtime = st.st_mtime;
+        _banFileSize = (long long) st.st_size;
+    }
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  banlistCount
+//
+//  Returns the number of IDs on the list (including expired ones still on file).
+//
+unsigned long banlistCount( void )
+{
+    return( _ban.set.count );
+}
+
@@ -0,0 +1,23 @@
+//  ==============================================================================================
+//
+//  Module: BANLIST
+//
+//  Description:
+//  Local SteamID64 ban list with expiry and reason, hot-reloaded from file
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#define BANLIST_REASON_MAX   (128)                 // max reason string kept, incl. terminator
+
+extern int  banlistInit( char *fileName );
+extern void banlistDestroy( void );
+extern int  banlistReload( int forceFlag );
+extern int  banlistCheck( char *playerGUID, char *reason, int maxReason );
+extern int  banlistAdd( char *playerGUID, unsigned long durationSec, char *reason );
+extern unsigned long banlistCount( void );
@@ -5,6 +5,21 @@
 //  Description:
 //  Simple configuration file reader
 //
+//  The configuration file is parsed once into an immutable hash table of key/value pairs
+//  (case-insensitive keys, first occurrence wins, numeric values pre-converted).  The table
+//  is cached and shared by every cfsCreate() on the same file, so that the *InitConfig() of
+//  every plugin costs hash lookups rather than file rescans, and values may also be fetched
+//  at runtime.
+//
+//  The cached table is a snapshot: edits to the file are not seen until cfsReload() parses
+//  and validates a new table and swaps it in.  Every reader between two reloads therefore
+//  sees the same configuration, even if the file is being rewritten at the time, and a
+//  broken edit never replaces a working configuration.  Handles already open keep the
+//  table they were given.
+//
+//  Handles may be created, read and destroyed from any thread: the cache and reference
+//  counts are guarded by a lock, and fetches read the immutable table without one.
+//
 //  Original Author:
 //  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
 //
@@ -20,6 +35,12 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include "winport.h"    // strcasestr()
 #include "util.h"
@@ -31,40 +52,30 @@
 //  Data definition 
 //
 
+#define CFS_MINSLOTS    (256)                                      // initial hash table slots
+
+static cfsTable_t *cfsCache = NULL;                         // tables parsed, newest first
+#ifndef _WIN32
+static pthread_mutex_t cfsCacheLock = PTHREAD_MUTEX_INITIALIZER;    // cfsCache & refCounts
+#endif
+
 
 //  ==============================================================================================
-//  cfsCreate
-//
-//  Allocates and returns a .cfs (.cfg) file reader object and returns a pointer.  This method
-//  opens the configuration file.  If the file does not exist, the object is not created and
-//  NULL is returned to the caller. 
+//  _cfsLock / _cfsUnlock (local)
 //
-cfsPtr cfsCreate( char *fileName ) 
+static void _cfsLock( void )
 {
-    cfsPtr pCfs = NULL;
-    FILE    *fpr;
-
-    if ( NULL != (fpr = fopen( fileName, "rt" )) ) {
-        if ( NULL != (pCfs = (cfsPtr) calloc ( 1, sizeof( cfsObj )))) {
-            strlcpy( pCfs->cfsFilename, fileName, CFS_FILENAME_MAX );
-            pCfs->fpr = fpr;
-        }
-    }
-    return( pCfs );
+#ifndef _WIN32
+    pthread_mutex_lock( &cfsCacheLock );
+#endif
+    return;
 }
 
-
-//  ==============================================================================================
-//  cfsDestroy
-//
-//  Closes the .cfs file and deallocates the handler object.
-//
-void cfsDestroy( cfsPtr pCfs )
+static void _cfsUnlock( void )
 {
-    if ( NULL != pCfs )  {
-        if ( NULL != pCfs ) fclose( pCfs->fpr );
-        free( pCfs );
-    }
+#ifndef _WIN32
+    pthread_mutex_unlock( &cfsCacheLock );
+#endif
     return;
 }
 
@@ -79,10 +90,10 @@ void cfsDestroy( cfsPtr pCfs )
 //  4.  Remove trailing/leading spaces
 //  5.  Remove quotatino marks within which the string was packed
 //
+//  The result goes to retStr, CFS_FETCH_MAX bytes.
 //
-static char *_cfsStrWash( char *w )
+static char *_cfsStrWash( char *w, char *retStr )
 {
-    static char retStr[CFS_FETCH_MAX];
     char *v;
     int   i, j, inQuote;
 
@@ -146,38 +157,304 @@ static char *_cfsStrWash( char *w )
 
 
 //  ==============================================================================================
-//  cfsFetchStr
+//  _cfsHash (local)
 //
-//  Fetches a string variable from the .cfg file.  The defaultValue is returned if
-//  the named variable is missing from the .cfg file.
+//  Case-insensitive FNV-1a hash of a key
 //
-char *cfsFetchStr( cfsPtr pCfs, char *varName, char *defaultValue )
+static unsigned _cfsHash( char *key )
 {
-    static char retStr[CFS_FETCH_MAX], lineIn[CFS_FETCH_MAX];
-    char *w, *v, *u;
-
-    strlcpy( retStr, defaultValue, CFS_FETCH_MAX );        
-
-    if ( pCfs != NULL ) {
-        fseek( pCfs->fpr, 0L, SEEK_SET );
-
-        while ( !feof( pCfs->fpr ) ) {
-            if (NULL != fgets( lineIn, CFS_FETCH_MAX, pCfs->fpr )) {
-                w = strcasestr( lineIn, varName );
-                if ( w == lineIn ) {
-                    v = _cfsStrWash( lineIn );
-                    u = strstr( v, " " );
-                    if (u != NULL) {
-                        strTrimInPlace( u );
-                        strlcpy( retStr, u, CFS_FETCH_MAX );
-                        break;
-                    }
-                }
+    unsigned h = 2166136261u;
+
+    while ( *key != 0 ) {
+        h ^= (unsigned char) tolower( (unsigned char) *key++ );
+        h *= 16777619u;
+    }
+    return( h );
+}
+
+
+//  ==============================================================================================
+//  _cfsKeyEq (local)
+//
+//  Case-insensitive key compare, returns 1 if equal
+//
+static int _cfsKeyEq( char *a, char *b )
+{
+    while (( *a != 0 ) && ( tolower( (unsigned char) *a ) == tolower( (unsigned char) *b ))) {
+        a++;  b++;
+    }
+    return( *a == *b );
+}
+
+
+//  ==============================================================================================
+//  _cfsFind (local)
+//
+//  Returns the entry for key, or NULL if not in the table
+//
+static cfsEntry_t *_cfsFind( cfsTable_t *t, char *key )
+{
+    unsigned h, i, mask;
+    int e;
+
+    if (( t == NULL ) || ( t->slotCount == 0 )) return( NULL );
+    h = _cfsHash( key );
+    mask = t->slotCount - 1;
+    for ( i = h & mask; 0 != (e = t->slots[i]); i = (i + 1) & mask ) {
+        if (( t->entries[e-1].hash == h ) && _cfsKeyEq( t->entries[e-1].key, key ))
+            return( &t->entries[e-1] );
+    }
+    return( NULL );
+}
+
+
+//  ==============================================================================================
+//  _cfsTableFree (local)
+//
+static void _cfsTableFree( cfsTable_t *t )
+{
+    int i;
+
+    for ( i=0; i<t->entryCount; i++ ) {
+        free( t->entries[i].key );
+        free( t->entries[i].value );
+    }
+    free( t->entries );
+    free( t->slots );
+    free( t );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _cfsTableRelease (local)
+//
+//  Drop a reference.  The table is unlinked from the cache and freed at zero.
+//
+static void _cfsTableRelease( cfsTable_t *t )
+{
+    cfsTable_t **pp;
+
+    if (( t == NULL ) || ( --t->refCount > 0 )) return;
+    for ( pp = &cfsCache; *pp != NULL; pp = &(*pp)->next ) {
+        if ( *pp == t ) {
+            *pp = t->next;
+            break;
+        }
+    }
+    _cfsTableFree( t );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _cfsTableAdd (local)
+//
+//  Add a key/value pair unless the key is already there (first occurrence wins).
+//  Returns 0 on success or duplicate.
+//
+static int _cfsTableAdd( cfsTable_t *t, char *key, char *value )
+{
+    cfsEntry_t *e;
+    int *newSlots, newCount, i;
+    unsigned j, mask;
+    char *endPtr;
+
+    if ( NULL != _cfsFind( t, key )) return 0;
+
+    // keep the table at most half full
+    //
+    if ( (t->entryCount + 1) * 2 > t->slotCount ) {
+        newCount = t->slotCount ? t->slotCount * 2 : CFS_MINSLOTS;
+        if ( NULL == (newSlots = (int *) calloc( newCount, sizeof( int )))) return 1;
+        mask = newCount - 1;
+        for ( i=0; i<t->entryCount; i++ ) {
+            for ( j = t->entries[i].hash & mask; newSlots[j] != 0; j = (j + 1) & mask ) ;
+            newSlots[j] = i + 1;
+        }
+        free( t->slots );
+        t->slots = newSlots;
+        t->slotCount = newCount;
+
+        e = (cfsEntry_t *) realloc( t->entries, (newCount / 2) * sizeof( cfsEntry_t ));
+        if ( e == NULL ) return 1;
+        t->entries = e;
+    }
+
+    e = &t->entries[ t->entryCount ];
+    e->key   = strdup( key );
+    e->value = strdup( value );
+    if (( e->key == NULL ) || ( e->value == NULL )) {
+        free( e->key );  free( e->value );
+        return 1;
+    }
+    e->hash  = _cfsHash( key );
+    e->num   = strtod( value, &endPtr );
+    e->isNum = ( endPtr != value );
+
+    mask = t->slotCount - 1;
+    for ( j = e->hash & mask; t->slots[j] != 0; j = (j + 1) & mask ) ;
+    t->slots[j] = ++t->entryCount;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _cfsTableLoad (local)
+//
+//  Parse the whole .cfg file into a new table.  Each non-comment line is "key value", where
+//  value is the rest of the line.  Returns NULL if the file cannot be read.
+//
+static cfsTable_t *_cfsTableLoad( char *fileName, struct stat *st )
+{
+    cfsTable_t *t;
+    FILE *fpr;
+    char lineIn[CFS_FETCH_MAX], washed[CFS_FETCH_MAX], *v, *u;
+
+    if ( NULL == (fpr = fopen( fileName, "rt" ))) return( NULL );
+    if ( NULL == (t = (cfsTable_t *) calloc( 1, sizeof( cfsTable_t )))) {
+        fclose( fpr );
+        return( NULL );
+    }
+    strlcpy( t->fileName, fileName, CFS_FILENAME_MAX );
+    t->mtime = st->st_mtime;
+    t->size  = (long long) st->st_size;
+
+    while ( NULL != fgets( lineIn, CFS_FETCH_MAX, fpr )) {
+        v = _cfsStrWash( lineIn, washed );
+        u = strstr( v, " " );
+        if (( u != NULL ) && ( u != v )) {
+            *u++ = 0;
+            strTrimInPlace( u );
+            if ( 0 != _cfsTableAdd( t, v, u )) {
+                _cfsTableFree( t );
+                t = NULL;
+                break;
             }
         }
-        
     }
-    return( retStr );
+    fclose( fpr );
+    return( t );
+}
+
+
+//  ==============================================================================================
+//  _cfsCacheFind (local)
+//
+static cfsTable_t *_cfsCacheFind( char *fileName )
+{
+    cfsTable_t *t;
+
+    for ( t = cfsCache; t != NULL; t = t->next ) 
+        if ( 0 == strcmp( t->fileName, fileName )) break;
+    return( t );
+}
+
+
+//  ==============================================================================================
+//  _cfsCachePublish (local)
+//
+//  Make t the current snapshot of its file.  A superseded table stays alive until its last
+//  handle is destroyed.
+//
+static void _cfsCachePublish( cfsTable_t *t )
+{
+    cfsTable_t *old;
+
+    if ( NULL != (old = _cfsCacheFind( t->fileName ))) _cfsTableRelease( old );
+    t->refCount = 1;                                                        // the cache's own
+    t->next = cfsCache;
+    cfsCache = t;
+    return;
+}
+
+
+//  ==============================================================================================
+//  cfsCreate
+//
+//  Allocates and returns a .cfs (.cfg) file reader object and returns a pointer.  The file
+//  is parsed only if it was not already; otherwise the current snapshot is used (see 
+//  cfsReload).  If the file does not exist, the object is not created and NULL is returned 
+//  to the caller. 
+//
+cfsPtr cfsCreate( char *fileName ) 
+{
+    cfsPtr pCfs = NULL;
+    cfsTable_t *t;
+    struct stat st;
+
+    _cfsLock();
+    if ( NULL == (t = _cfsCacheFind( fileName ))) {
+        if (( 0 == stat( fileName, &st )) && ( NULL != (t = _cfsTableLoad( fileName, &st )))) 
+            _cfsCachePublish( t );
+    }
+
+    if (( t != NULL ) && ( NULL != (pCfs = (cfsPtr) calloc ( 1, sizeof( cfsObj ))))) {
+        strlcpy( pCfs->cfsFilename, fileName, CFS_FILENAME_MAX );
+        pCfs->table = t;
+        t->refCount++;
+    }
+    _cfsUnlock();
+    return( pCfs );
+}
+
+
+//  ==============================================================================================
+//  cfsReload
+//
+//  Parse the file into a new snapshot and, if it is valid, make it current for subsequent
+//  cfsCreate() calls.  A file that is missing, unreadable, or has no entries at all (e.g.,
+//  truncated while being rewritten) is rejected and the previous snapshot is kept.
+//  Returns 0 if the new snapshot was installed.
+//
+int cfsReload( char *fileName )
+{
+    cfsTable_t *t;
+    struct stat st;
+
+    if ( 0 != stat( fileName, &st )) return 1;
+    if ( NULL == (t = _cfsTableLoad( fileName, &st ))) return 1;
+    if ( t->entryCount == 0 ) {
+        _cfsTableFree( t );
+        return 1;
+    }
+    _cfsLock();
+    _cfsCachePublish( t );
+    _cfsUnlock();
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  cfsDestroy
+//
+//  Deallocates the handler object.  The parsed table stays cached for the next cfsCreate().
+//
+void cfsDestroy( cfsPtr pCfs )
+{
+    if ( NULL != pCfs )  {
+        _cfsLock();
+        _cfsTableRelease( pCfs->table );
+        _cfsUnlock();
+        free( pCfs );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  cfsFetchStr
+//
+//  Fetches a string variable from the .cfg file.  The defaultValue is returned if
+//  the named variable is missing from the .cfg file.  The returned string is valid
+//  until the handle is destroyed and must not be modified.
+//
+char *cfsFetchStr( cfsPtr pCfs, char *varName, char *defaultValue )
+{
+    cfsEntry_t *e = NULL;
+
+    if ( pCfs != NULL ) e = _cfsFind( pCfs->table, varName );
+    return( (e != NULL) ? e->value : defaultValue );
 }
 
 
@@ -189,18 +466,23 @@ char *cfsFetchStr( cfsPtr pCfs, char *varName, char *defaultValue )
 //
 double cfsFetchNum( cfsPtr pCfs, char *varName, double defaultValue )
 {
-    double retValue;
-    char   defaultValueString[256];
-    char   *w;
-
-    snprintf( defaultValueString, 256, "%lf", defaultValue );
-    w = cfsFetchStr( pCfs, varName, defaultValueString );
+    cfsEntry_t *e = NULL;
 
-    if ( 1 != sscanf( w, "%lf", &retValue )) retValue = defaultValue;
-
-    return( retValue );
+    if ( pCfs != NULL ) e = _cfsFind( pCfs->table, varName );
+    return( ((e != NULL) && e->isNum) ? e->num : defaultValue );
 }
 
 
+//  ==============================================================================================
+//  cfsFetchStrIndex
+//
+//  Fetches element 'index' of an array variable, i.e., "varName[index]" in the .cfg file.
+//
+char *cfsFetchStrIndex( cfsPtr pCfs, char *varName, int index, char *defaultValue )
+{
+    char keyName[CFS_FETCH_MAX];
 
+    snprintf( keyName, CFS_FETCH_MAX, "%s[%d]", varName, index );
+    return( cfsFetchStr( pCfs, keyName, defaultValue ));
+}
 
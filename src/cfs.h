@@ -17,16 +17,47 @@
 #define CFS_FILENAME_MAX   (1024) 
 #define CFS_FETCH_MAX      (1024)
 
+#include <time.h>
+
+typedef struct {
+
+    char    *key;                                            // as written in the .cfg file
+    char    *value;                                             // washed (quotes removed)
+    double   num;                                                  // valid if isNum is set
+    int      isNum;
+    unsigned hash;
+
+} cfsEntry_t;
+
+//  Parsed configuration file.  Immutable once built; shared by every cfsObj opened on the
+//  same unchanged file.
+//
+typedef struct cfsTable {
+
+    char        fileName[CFS_FILENAME_MAX];
+    time_t      mtime;
+    long long   size;
+    int         refCount;                                   // handles + 1 while cached
+    cfsEntry_t *entries;
+    int         entryCount;
+    int        *slots;                              // entry# + 1, 0 = empty, power-of-2 size
+    int         slotCount;
+    struct cfsTable *next;
+
+} cfsTable_t;
+
 typedef struct {
 
     char cfsFilename[CFS_FILENAME_MAX];
-    FILE *fpr;
+    cfsTable_t *table;
 
 } cfsObj, *cfsPtr;
 
 extern cfsPtr cfsCreate( char *fileName );
 extern void cfsDestroy( cfsPtr pCfs );
+extern int cfsReload( char *fileName );
 extern char *cfsFetchStr( cfsPtr pCfz, char *varName, char *defaultValue );
 extern double cfsFetchNum( cfsPtr pCfz, char *varName, double defaultValue );
+extern char *cfsFetchStrIndex( cfsPtr pCfs, char *varName, int index, char *defaultValue );
 
 
@@ -0,0 +1,485 @@
+//  ==============================================================================================
+//
+//  Module: CIDR
+//
+//  Description:
+//  IPv4/IPv6 address range block lists (sorted range table, binary search)
+//
+//  Ranges are collected from text or CSV files, then sorted and merged into one table per
+//  address family, so that a lookup is a binary search over non-overlapping ranges: about
+//  20 compares for a million ranges, with no pointer chasing.  IPv4 lookups first narrow
+//  the search window with a 64K-entry table indexed by the top 16 address bits, leaving a
+//  handful of compares.  A range costs 12 bytes (IPv4) or 36 bytes (IPv6); merging adjacent
+//  ranges of VPN/hosting lists shrinks the table further.
+//
+//  Accepted range formats, one per line, first field of a CSV or whitespace separated line:
+//
+//      1.2.3.0/24          2001:db8::/32          CIDR prefix
+//      1.2.3.0-1.2.3.255   2001:db8::1-2001:db8::ff   explicit range
+//      1.2.3.4             2001:db8::1            single address
+//      1.2.3.0,1.2.3.255,...                      CSV start,end (ASN / geo-IP databases)
+//      16909056,16909311,...                      CSV decimal IPv4 start,end
+//
+//  Lines starting with '#' or '//' are comments, as is anything after a '#'.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bsd.h"
+#include "util.h"
+#include "cidr.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define CIDR_LINE_MAX        (1024)
+#define CIDR_FIELD_DELIM     " \011,;\"\015\012"
+#define CIDR_BUCKETS         (65536)                      // IPv4 first level: top 16 bits
+
+
+//  ==============================================================================================
+//  _cidrHex (local)
+//
+//  Hex digit value, -1 if not a hex digit
+//
+static int _cidrHex( char c )
+{
+    if (( c >= '0' ) && ( c <= '9' )) return( c - '0' );
+    if (( c >= 'a' ) && ( c <= 'f' )) return( c - 'a' + 10 );
+    if (( c >= 'A' ) && ( c <= 'F' )) return( c - 'A' + 10 );
+    return( -1 );
+}
+
+
+//  ==============================================================================================
+//  cidrParseIPv6
+//
+//  Parse an IPv6 address ("::" compression and trailing dotted IPv4 supported) into two
+//  64-bit halves.  Returns the number of characters consumed, or 0 on formatting error.
+//
+int cidrParseIPv6( char *strIn, uint64_t *ipHi, uint64_t *ipLo )
+{
+    uint16_t g[8], out[8];
+    uint32_t v, ip4;
+    int i, n = 0, gap = -1, pos = 0, digits, k;
+
+    if ( strIn[0] == ':' ) {
+        if ( strIn[1] != ':' ) return 0;
+        gap = 0;
+        pos = 2;
+    }
+
+    while (( n < 8 ) && ( _cidrHex( strIn[pos] ) >= 0 )) {
+
+        // embedded IPv4 may only be the last 32 bits
+        //
+        if (( n <= 6 ) && ( 0 != (k = parseIPv4( &strIn[pos], &ip4 )))) {
+            g[n++] = (uint16_t) (ip4 >> 16);
+            g[n++] = (uint16_t) ip4;
+            pos += k;
+            break;
+        }
+
+        v = 0;
+        for ( digits=0; (digits < 4) && (_cidrHex( strIn[pos] ) >= 0); digits++ )
+            v = (v << 4) | _cidrHex( strIn[pos++] );
+        if ( _cidrHex( strIn[pos] ) >= 0 ) return 0;                        // 5+ digit group
+        g[n++] = (uint16_t) v;
+
+        if ( strIn[pos] != ':' ) break;
+        if ( strIn[pos+1] == ':' ) {
+            if ( gap >= 0 ) return 0;                                      // second "::"
+            gap = n;
+            pos += 2;
+        }
+        else {
+            if ( _cidrHex( strIn[pos+1] ) < 0 ) return 0;               // dangling ':'
+            pos++;
+        }
+    }
+
+    if ((( gap < 0 ) && ( n != 8 )) || (( gap >= 0 ) && ( n > 7 ))) return 0;
+
+    memset( out, 0, sizeof( out ));
+    if ( gap < 0 ) gap = n;
+    for ( i=0; i<gap; i++ )   out[i] = g[i];
+    for ( i=gap; i<n; i++ )   out[8 - n + i] = g[i];
+
+    *ipHi = ((uint64_t) out[0] << 48) | ((uint64_t) out[1] << 32) | ((uint64_t) out[2] << 16) | out[3];
+    *ipLo = ((uint64_t) out[4] << 48) | ((uint64_t) out[5] << 32) | ((uint64_t) out[6] << 16) | out[7];
+    return( pos );
+}
+
+
+//  ==============================================================================================
+//  _cidrPrefixLen (local)
+//
+//  Parse "/nn" at strIn.  Returns prefix length, or -1 if not a valid prefix up to maxLen.
+//
+static int _cidrPrefixLen( char *strIn, int maxLen )
+{
+    char *endPtr;
+    long n;
+
+    if (( strIn[0] != '/' ) || ( strIn[1] < '0' ) || ( strIn[1] > '9' )) return -1;
+    n = strtol( &strIn[1], &endPtr, 10 );
+    if (( *endPtr != 0 ) || ( n > maxLen )) return -1;
+    return( (int) n );
+}
+
+
+//  ==============================================================================================
+//  _cidrPush4 / _cidrPush6 (local)
+//
+//  Append a range to the (unsorted) table.  Returns 0 on success.
+//
+static int _cidrPush4( cidrObj *cPtr, uint32_t lo, uint32_t hi, uint32_t tag )
+{
+    cidrRange4_t *p;
+
+    if ( lo > hi ) return 1;
+    if ( cPtr->v4Count == cPtr->v4Size ) {
+        p = (cidrRange4_t *) realloc( cPtr->v4, (cPtr->v4Size ? cPtr->v4Size * 2 : 1024) * sizeof( cidrRange4_t ));
+        if ( p == NULL ) return 1;
+        cPtr->v4 = p;
+        cPtr->v4Size = cPtr->v4Size ? cPtr->v4Size * 2 : 1024;
+    }
+    cPtr->v4[ cPtr->v4Count ].lo = lo;
+    cPtr->v4[ cPtr->v4Count ].hi = hi;
+    cPtr->v4[ cPtr->v4Count ].tag = tag;
+    cPtr->v4Count++;
+    cPtr->isSorted = 0;
+    return 0;
+}
+
+static int _cidrCmp128( uint64_t aHi, uint64_t aLo, uint64_t bHi, uint64_t bLo )
+{
+    if ( aHi != bHi ) return( (aHi < bHi) ? -1 : 1 );
+    if ( aLo != bLo ) return( (aLo < bLo) ? -1 : 1 );
+    return( 0 );
+}
+
+static int _cidrPush6( cidrObj *cPtr, uint64_t loHi, uint64_t loLo, uint64_t hiHi, uint64_t hiLo, uint32_t tag )
+{
+    cidrRange6_t *p;
+
+    if ( _cidrCmp128( loHi, loLo, hiHi, hiLo ) > 0 ) return 1;
+    if ( cPtr->v6Count == cPtr->v6Size ) {
+        p = (cidrRange6_t *) realloc( cPtr->v6, (cPtr->v6Size ? cPtr->v6Size * 2 : 256) * sizeof( cidrRange6_t ));
+        if ( p == NULL ) return 1;
+        cPtr->v6 = p;
+        cPtr->v6Size = cPtr->v6Size ? cPtr->v6Size * 2 : 256;
+    }
+    p = &cPtr->v6[ cPtr->v6Count++ ];
+    p->loHi = loHi;  p->loLo = loLo;
+    p->hiHi = hiHi;  p->hiLo = hiLo;
+    p->tag = tag;
+    cPtr->isSorted = 0;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  cidrCreate
+//
+//  Create an empty block list
+//
+cidrObj *cidrCreate( void )
+{
+    return( (cidrObj *) calloc( 1, sizeof( cidrObj )));
+}
+
+
+//  ==============================================================================================
+//  cidrDestroy
+//
+void cidrDestroy( cidrObj *cPtr )
+{
+    if ( cPtr != NULL ) {
+        free( cPtr->v4 );
+        free( cPtr->v4Bucket );
+        free( cPtr->v6 );
+        free( cPtr );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  cidrAddStr
+//
+//  Add one range in any of the formats listed in the module header (except the CSV forms,
+//  which cidrLoadFile converts to "start-end").  Returns 0 on success, 1 on format error.
+//
+int cidrAddStr( cidrObj *cPtr, char *rangeStr, uint32_t tag )
+{
+    uint32_t lo4, hi4;
+    uint64_t loHi, loLo, hiHi, hiLo;
+    int n, prefix;
+
+    if ( 0 != (n = parseIPv4( rangeStr, &lo4 ))) {
+        if ( rangeStr[n] == 0 ) return( _cidrPush4( cPtr, lo4, lo4, tag ));
+        if ( rangeStr[n] == '-' ) {
+            rangeStr = &rangeStr[n+1];
+            if ( 0 == (n = parseIPv4( rangeStr, &hi4 )) || ( rangeStr[n] != 0 )) return 1;
+            return( _cidrPush4( cPtr, lo4, hi4, tag ));
+        }
+        if ( 0 > (prefix = _cidrPrefixLen( &rangeStr[n], 32 ))) return 1;
+        hi4 = ( prefix == 0 ) ? 0xFFFFFFFFu : (0xFFFFFFFFu >> prefix);
+        return( _cidrPush4( cPtr, lo4 & ~hi4, lo4 | hi4, tag ));
+    }
+
+    if ( 0 != (n = cidrParseIPv6( rangeStr, &loHi, &loLo ))) {
+        if ( rangeStr[n] == 0 ) return( _cidrPush6( cPtr, loHi, loLo, loHi, loLo, tag ));
+        if ( rangeStr[n] == '-' ) {
+            rangeStr = &rangeStr[n+1];
+            if ( 0 == (n = cidrParseIPv6( rangeStr, &hiHi, &hiLo )) || ( rangeStr[n] != 0 )) return 1;
+            return( _cidrPush6( cPtr, loHi, loLo, hiHi, hiLo, tag ));
+        }
+        if ( 0 > (prefix = _cidrPrefixLen( &rangeStr[n], 128 ))) return 1;
+        hiHi = ( prefix >= 64 ) ? 0 : ( (prefix == 0) ? ~0ULL : (~0ULL >> prefix) );
+        hiLo = ( prefix <= 64 ) ? ~0ULL : ( (prefix == 128) ? 0 : (~0ULL >> (prefix - 64)) );
+        return( _cidrPush6( cPtr, loHi & ~hiHi, loLo & ~hiLo, loHi | hiHi, loLo | hiLo, tag ));
+    }
+    return 1;
+}
+
+
+//  ==============================================================================================
+//  _cidrIsDecimal (local)
+//
+static int _cidrIsDecimal( char *strIn )
+{
+    return(( 0 != strlen( strIn )) && ( strlen( strIn ) == strspn( strIn, "0123456789" )) && ( strlen( strIn ) <= 10 ));
+}
+
+
+//  ==============================================================================================
+//  cidrLoadFile
+//
+//  Read ranges from a text or CSV file.  Returns the number of ranges read, or -1 if the
+//  file cannot be opened.  Call cidrFinalize() after the last file is loaded.
+//
+int cidrLoadFile( cidrObj *cPtr, char *fileName, uint32_t tag )
+{
+    FILE *fpr;
+    char line[CIDR_LINE_MAX], field1[CIDR_LINE_MAX], field2[CIDR_LINE_MAX], range[2*CIDR_LINE_MAX+2];
+    char *p;
+    size_t n;
+    unsigned long long lo, hi;
+    int count = 0;
+    uint32_t ip;
+    uint64_t ipHi, ipLo;
+
+    if ( NULL == (fpr = fopen( fileName, "rt" ))) return -1;
+
+    while ( NULL != fgets( line, CIDR_LINE_MAX, fpr )) {
+
+        p = line + strspn( line, CIDR_FIELD_DELIM );
+        if (( *p == '#' ) || ( 0 == strncmp( p, "//", 2 ))) continue;
+        p[ strcspn( p, "#" ) ] = 0;
+
+        n = strcspn( p, CIDR_FIELD_DELIM );
+        if ( n == 0 ) continue;
+        memcpy( field1, p, n );  field1[n] = 0;
+        p += n;
+        p += strspn( p, CIDR_FIELD_DELIM );
+        n = strcspn( p, CIDR_FIELD_DELIM );
+        memcpy( field2, p, n );  field2[n] = 0;
+
+        // CSV start,end forms: both fields addresses of the same family, or decimal IPv4
+        //
+        if ( _cidrIsDecimal( field1 ) && _cidrIsDecimal( field2 )) {
+            lo = strtoull( field1, NULL, 10 );
+            hi = strtoull( field2, NULL, 10 );
+            if (( hi <= 0xFFFFFFFFULL ) && ( 0 == _cidrPush4( cPtr, (uint32_t) lo, (uint32_t) hi, tag ))) count++;
+            continue;
+        }
+        if (( strlen( field2 ) != 0 ) && ( NULL == strchr( field1, '/' )) && ( NULL == strchr( field1, '-' )) &&
+            ((( strlen( field2 ) == (size_t) parseIPv4( field2, &ip )) && ( strlen( field1 ) == (size_t) parseIPv4( field1, &ip ))) ||
+             (( strlen( field2 ) == (size_t) cidrParseIPv6( field2, &ipHi, &ipLo )) && ( strlen( field1 ) == (size_t) cidrParseIPv6( field1, &ipHi, &ipLo ))))) {
+            snprintf( range, sizeof( range ), "%s-%s", field1, field2 );
+            if ( 0 == cidrAddStr( cPtr, range, tag )) count++;
+            continue;
+        }
+
+        if ( 0 == cidrAddStr( cPtr, field1, tag )) count++;
+    }
+    fclose( fpr );
+    return( count );
+}
+
+
+//  ==============================================================================================
+//  _cidrSort4 / _cidrSort6 (local)
+//
+static int _cidrSort4( const void *a, const void *b )
+{
+    uint32_t x = ((cidrRange4_t *) a)->lo, y = ((cidrRange4_t *) b)->lo;
+    return( (x < y) ? -1 : (x > y) );
+}
+
+static int _cidrSort6( const void *a, const void *b )
+{
+    return( _cidrCmp128( ((cidrRange6_t *) a)->loHi, ((cidrRange6_t *) a)->loLo,
+                         ((cidrRange6_t *) b)->loHi, ((cidrRange6_t *) b)->loLo ));
+}
+
+
+//  ==============================================================================================
+//  cidrFinalize
+//
+//  Sort the tables and merge overlapping or adjacent ranges (the first range's tag is kept),
+//  then release unused memory.  Must be called before lookups; may be called again after
+//  more ranges are added.
+//
+void cidrFinalize( cidrObj *cPtr )
+{
+    cidrRange4_t *p4;
+    cidrRange6_t *p6;
+    uint64_t nextHi, nextLo;
+    int i, j;
+
+    if ( cPtr->v4Count > 0 ) {
+        qsort( cPtr->v4, cPtr->v4Count, sizeof( cidrRange4_t ), _cidrSort4 );
+        for ( i=1, j=0; i<cPtr->v4Count; i++ ) {
+            if (( cPtr->v4[j].hi == 0xFFFFFFFFu ) || ( cPtr->v4[i].lo <= cPtr->v4[j].hi + 1 )) {
+                if ( cPtr->v4[i].hi > cPtr->v4[j].hi ) cPtr->v4[j].hi = cPtr->v4[i].hi;
+            }
+            else {
+                cPtr->v4[++j] = cPtr->v4[i];
+            }
+        }
+        cPtr->v4Count = j + 1;
+        if ( NULL != (p4 = (cidrRange4_t *) realloc( cPtr->v4, cPtr->v4Count * sizeof( cidrRange4_t )))) {
+            cPtr->v4 = p4;
+            cPtr->v4Size = cPtr->v4Count;
+        }
+
+        // bucket b holds the last range starting at or below b<<16, so the range holding any
+        // address of the bucket is between v4Bucket[b] and v4Bucket[b+1] - a few entries
+        //
+        if ( cPtr->v4Bucket == NULL )
+            cPtr->v4Bucket = (uint32_t *) malloc( (CIDR_BUCKETS + 1) * sizeof( uint32_t ));
+        if ( cPtr->v4Bucket != NULL ) {
+            for ( i=0, j=0; i<CIDR_BUCKETS; i++ ) {
+                while (( j+1 < cPtr->v4Count ) && ( cPtr->v4[j+1].lo <= ((uint32_t) i << 16) )) j++;
+                cPtr->v4Bucket[i] = j;
+            }
+            cPtr->v4Bucket[CIDR_BUCKETS] = cPtr->v4Count - 1;
+        }
+    }
+
+    if ( cPtr->v6Count > 0 ) {
+        qsort( cPtr->v6, cPtr->v6Count, sizeof( cidrRange6_t ), _cidrSort6 );
+        for ( i=1, j=0; i<cPtr->v6Count; i++ ) {
+            nextLo = cPtr->v6[j].hiLo + 1;
+            nextHi = cPtr->v6[j].hiHi + ( nextLo == 0 );
+            if ((( cPtr->v6[j].hiHi == ~0ULL ) && ( cPtr->v6[j].hiLo == ~0ULL )) ||
+                ( _cidrCmp128( cPtr->v6[i].loHi, cPtr->v6[i].loLo, nextHi, nextLo ) <= 0 )) {
+                if ( _cidrCmp128( cPtr->v6[i].hiHi, cPtr->v6[i].hiLo, cPtr->v6[j].hiHi, cPtr->v6[j].hiLo ) > 0 ) {
+                    cPtr->v6[j].hiHi = cPtr->v6[i].hiHi;
+                    cPtr->v6[j].hiLo = cPtr->v6[i].hiLo;
+                }
+            }
+            else {
+                cPtr->v6[++j] = cPtr->v6[i];
+            }
+        }
+        cPtr->v6Count = j + 1;
+        if ( NULL != (p6 = (cidrRange6_t *) realloc( cPtr->v6, cPtr->v6Count * sizeof( cidrRange6_t )))) {
+            cPtr->v6 = p6;
+            cPtr->v6Size = cPtr->v6Count;
+        }
+    }
+
+    cPtr->isSorted = 1;
+    return;
+}
+
+
+//  ==============================================================================================
+//  cidrLookup4
+//
+//  Returns 1 (and the range tag, if tag is not NULL) if the IPv4 address is in a listed
+//  range, else 0.
+//
+int cidrLookup4( cidrObj *cPtr, uint32_t ip, uint32_t *tag )
+{
+    int lo, hi, mid;
+
+    if (( cPtr == NULL ) || ( !cPtr->isSorted ) || ( cPtr->v4Count == 0 )) return 0;
+
+    // find the last range starting at or below ip
+    //
+    lo = 0;  hi = cPtr->v4Count - 1;
+    if ( cPtr->v4[0].lo > ip ) return 0;
+    if ( cPtr->v4Bucket != NULL ) {
+        lo = cPtr->v4Bucket[ ip >> 16 ];
+        hi = cPtr->v4Bucket[ (ip >> 16) + 1 ];
+    }
+    while ( lo < hi ) {
+        mid = lo + (hi - lo + 1) / 2;
+        if ( cPtr->v4[mid].lo <= ip ) lo = mid;
+        else                          hi = mid - 1;
+    }
+    if ( ip > cPtr->v4[lo].hi ) return 0;
+    if ( tag != NULL ) *tag = cPtr->v4[lo].tag;
+    return 1;
+}
+
+
+//  ==============================================================================================
+//  _cidrLookup6 (local)
+//
+static int _cidrLookup6( cidrObj *cPtr, uint64_t ipHi, uint64_t ipLo, uint32_t *tag )
+{
+    int lo, hi, mid;
+
+    if (( !cPtr->isSorted ) || ( cPtr->v6Count == 0 )) return 0;
+
+    lo = 0;  hi = cPtr->v6Count - 1;
+    if ( _cidrCmp128( cPtr->v6[0].loHi, cPtr->v6[0].loLo, ipHi, ipLo ) > 0 ) return 0;
+    while ( lo < hi ) {
+        mid = lo + (hi - lo + 1) / 2;
+        if ( _cidrCmp128( cPtr->v6[mid].loHi, cPtr->v6[mid].loLo, ipHi, ipLo ) <= 0 ) lo = mid;
+        else                                                                          hi = mid - 1;
+    }
+    if ( _cidrCmp128( ipHi, ipLo, cPtr->v6[lo].hiHi, cPtr->v6[lo].hiLo ) > 0 ) return 0;
+    if ( tag != NULL ) *tag = cPtr->v6[lo].tag;
+    return 1;
+}
+
+
+//  ==============================================================================================
+//  cidrLookup
+//
+//  Same as cidrLookup4 for an IPv4 or IPv6 address string.  IPv4-mapped IPv6 addresses
+//  (::ffff:a.b.c.d) are checked against the IPv4 table.
+//
+int cidrLookup( cidrObj *cPtr, char *ipStr, uint32_t *tag )
+{
+    uint32_t ip;
+    uint64_t ipHi, ipLo;
+
+    if ( cPtr == NULL ) return 0;
+    if ( 0 != parseIPv4( ipStr, &ip )) return( cidrLookup4( cPtr, ip, tag ));
+    if ( 0 != cidrParseIPv6( ipStr, &ipHi, &ipLo )) {
+        if (( ipHi == 0 ) && (( ipLo >> 32 ) == 0xFFFF )) return( cidrLookup4( cPtr, (uint32_t) ipLo, tag ));
+        return( _cidrLookup6( cPtr, ipHi, ipLo, tag ));
+    }
+    return 0;
+}
+
@@ -0,0 +1,51 @@
+//  ==============================================================================================
+//
+//  Module: CIDR
+//
+//  Description:
+//  IPv4/IPv6 address range block lists (sorted range table, binary search)
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdint.h>
+
+typedef struct {
+
+    uint32_t lo, hi;                                           // inclusive, host byte order
+    uint32_t tag;                                   // caller defined, e.g., list file number
+
+} cidrRange4_t;
+
+typedef struct {
+
+    uint64_t loHi, loLo;                                  // 128-bit inclusive bounds as
+    uint64_t hiHi, hiLo;                                  // (upper 64, lower 64) pairs
+    uint32_t tag;
+
+} cidrRange6_t;
+
+typedef struct {
+
+    cidrRange4_t *v4;
+    int           v4Count, v4Size;
+    uint32_t     *v4Bucket;                // [65537] search window start per top 16 bits
+    cidrRange6_t *v6;
+    int           v6Count, v6Size;
+    int           isSorted;                         // lookups require cidrFinalize() first
+
+} cidrObj, *cidrPtr;
+
+extern cidrObj *cidrCreate( void );
+extern void cidrDestroy( cidrObj *cPtr );
+extern int  cidrAddStr( cidrObj *cPtr, char *rangeStr, uint32_t tag );
+extern int  cidrLoadFile( cidrObj *cPtr, char *fileName, uint32_t tag );
+extern void cidrFinalize( cidrObj *cPtr );
+extern int  cidrLookup4( cidrObj *cPtr, uint32_t ip, uint32_t *tag );
+extern int  cidrLookup( cidrObj *cPtr, char *ipStr, uint32_t *tag );
+extern int  cidrParseIPv6( char *strIn, uint64_t *ipHi, uint64_t *ipLo );
@@ -0,0 +1,736 @@
+//  ==============================================================================================
+//
+//  Module: CTL
+//
+//  Description:
+//  Local control socket: admin commands, queries and event subscriptions for tools
+//
+//  sissm listens on a Unix domain socket (sissm.controlSocket) for local tools and scripts.
+//  Each request is one line, either plain text:
+//
+//      roster
+//      admin botfixed 30
+//
+//  answered by "OK <length>\n" followed by exactly <length> bytes of reply text, or by
+//  "ERR <message>\n".  A request line starting with '{' is JSON instead,
+//
+//      {"id":7,"cmd":"admin","args":"botfixed 30"}
+//
+//  answered by one line {"id":7,"ok":true,"output":"..."} or {"id":7,"ok":false,"error":"..."},
+//  so a tool may pipeline requests and match the answers by id.  Commands are registered by
+//  the modules that own the data (ctlRegister); this module only adds help, subscribe,
+//  unsubscribe and quit.  After "subscribe [event ...]" the connection also receives every
+//  matching event, as "EVENT <name> <log line>\n", or {"event":...,"data":...} if the
+//  subscribe request was JSON.
+//
+//  All sockets are non-blocking and driven by iopoll from the main loop, like the httpd
+//  module: a request is executed when its line is complete, and output that a client does
+//  not read is buffered up to CTL_OUT_MAX, after which the client is dropped.  Commands run
+//  on the main loop between log lines, so one that talks to RCON holds dispatch for as long
+//  as the in-game chat command would.  The socket file is created mode 0660: access is
+//  that of the sissm user and group.  Not available on Windows.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#define _GNU_SOURCE                                                        // required for accept4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "bsd.h"
+#include "log.h"
+#include "util.h"
+#include "events.h"
+#include "iopoll.h"
+#include "tmpl.h"
+#include "ctl.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+typedef struct ctlConn {
+
+    struct ctlConn *next, *prev;
+    int       fd;
+    char      in[CTL_LINE_MAX];                             // request bytes not yet executed
+    size_t    inLen;
+    strBuf_t  out;                                            // reply and event bytes queued
+    size_t    outSent;                                      // of which already written out
+    uint64_t  events;                       // subscribed event IDs (bit per ID), 0 if none
+    int       jsonEvents;                          // events as JSON (subscribed in JSON mode)
+    int       closeAfter;                                       // close once out is flushed
+
+} ctlConn_t;
+
+static struct {
+
+    char  cmdName[32];
+    char  cmdHelp[128];
+    int (*cmdFunction)( char *args, strBuf_t *bPtr );
+
+} ctlCmdTable[CTL_MAXCMDS];
+
+static int        ctlCmdCount = 0;
+static int        ctlListenFd = -1;
+static char       ctlSockPath[108] = "";
+static ctlConn_t *ctlConns = NULL;                                   // open connections list
+static int        ctlConnections = 0;
+static ctlConn_t *ctlServing = NULL;           // connection whose request is being executed
+
+static strBuf_t   ctlReplyBuf;                                    // command output, reused
+static strBuf_t   ctlEventBuf;                          // event formatted once, per format
+
+
+//  ==============================================================================================
+//  ctlRegister
+//
+//  Add a command, e.g., ("roster", "players online", _apiCtlRoster).  The function gets the
+//  rest of the request line (args, "" if none).  Returns non-zero if the table is full.
+//
+int ctlRegister( char *cmdName, char *cmdHelp, int (*cmdFunction)( char *args, strBuf_t *bPtr ) )
+{
+    if ( ctlCmdCount >= CTL_MAXCMDS ) return 1;
+
+    strlcpy( ctlCmdTable[ ctlCmdCount ].cmdName, cmdName, sizeof( ctlCmdTable[0].cmdName ));
+    strlcpy( ctlCmdTable[ ctlCmdCount ].cmdHelp, cmdHelp, sizeof( ctlCmdTable[0].cmdHelp ));
+    ctlCmdTable[ ctlCmdCount ].cmdFunction = cmdFunction;
+    ctlCmdCount++;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  ctlExecute
+//
+//  Run one registered command line ("name args..."), appending its reply to bPtr.  Returns
+//  the command's errCode, or 1 with a message if the command is unknown.
+//
+int ctlExecute( char *cmdLine, strBuf_t *bPtr )
+{
+    char cmdName[32], *args;
+    strView_t w;
+    int i;
+
+    if ( 0 == wordView( cmdLine, 0, " ", &w )) {
+        strBufPrintf( bPtr, "empty command" );
+        return 1;
+    }
+    strViewCopy( cmdName, sizeof( cmdName ), &w );
+    for ( args = (char *) w.ptr + w.len; *args == ' '; args++ ) ;
+
+    for ( i=0; i<ctlCmdCount; i++ ) {
+        if ( 0 == strcmp( ctlCmdTable[i].cmdName, cmdName ))
+            return( (*ctlCmdTable[i].cmdFunction)( args, bPtr ));
+    }
+    strBufPrintf( bPtr, "unknown command '%s', try 'help'", cmdName );
+    return 1;
+}
+
+
+//  ==============================================================================================
+//  ctlConnCount
+//
+//  Number of open client connections.
+//
+int ctlConnCount( void )
+{
+    return( ctlConnections );
+}
+
+
+#ifndef _WIN32
+
+//  ==============================================================================================
+//  _ctlJsonScan (local)
+//
+//  Find the extent of the JSON string or scalar (number, true, false, null) at *pp and
+//  advance past it.  Objects and arrays are not accepted as values.  Returns 1 if malformed.
+//
+static int _ctlJsonScan( const char **pp, const char **start, size_t *len )
+{
+    const char *p = *pp;
+
+    *start = p;
+    if ( *p == '"' ) {
+        for ( p++; *p != '"'; p++ ) {
+            if ( *p == 0 ) return 1;
+            if (( *p == '\\' ) && ( p[1] != 0 )) p++;
+        }
+        p++;
+    }
+    else {
+        while (( *p != 0 ) && ( NULL == strchr( ",}[{\" \t", *p ))) p++;
+        if ( p == *start ) return 1;
+    }
+    *len = (size_t) (p - *start);
+    *pp = p;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _ctlJsonDecode (local)
+//
+//  Copy a value found by _ctlJsonScan into strOut, unquoting and unescaping a string
+//  (\uXXXX as UTF-8; surrogate pairs become '?').  Scalars are copied as written.
+//
+static void _ctlJsonDecode( const char *s, size_t len, char *strOut, size_t outSize )
+{
+    size_t i, n = 0;
+    unsigned cp;
+    char c;
+
+    if (( len < 2 ) || ( s[0] != '"' )) {
+        if ( len >= outSize ) len = outSize - 1;
+        memcpy( strOut, s, len );
+        strOut[ len ] = 0;
+        return;
+    }
+    for ( i=1; ( i < len-1 ) && ( n + 4 < outSize ); i++ ) {
+        c = s[i];
+        if (( c == '\\' ) && ( i + 1 < len-1 )) {
+            switch ( c = s[++i] ) {
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'u':
+                if (( i + 4 < len-1 ) && ( 1 == sscanf( &s[i+1], "%4x", &cp ))) {
+                    i += 4;
+                    if (( cp >= 0xd800 ) && ( cp < 0xe000 )) cp = '?';
+                    if ( cp < 0x80 ) {
+                        strOut[n++] = (char) cp;
+                    }
+                    else if ( cp < 0x800 ) {
+                        strOut[n++] = (char) (0xc0 | (cp >> 6));
+                        strOut[n++] = (char) (0x80 | (cp & 0x3f));
+                    }
+                    else {
+                        strOut[n++] = (char) (0xe0 | (cp >> 12));
+                        strOut[n++] = (char) (0x80 | ((cp >> 6) & 0x3f));
+                        strOut[n++] = (char) (0x80 | (cp & 0x3f));
+                    }
+                    continue;
+                }
+                break;
+            default: break;                                          // \" \\ \/ as themselves
+            }
+        }
+        strOut[n++] = c;
+    }
+    strOut[n] = 0;
+    return;
+}
+
+
+//  ==============================================================================================
+//  _ctlJsonRequest (local)
+//
+//  Parse a JSON request object {"cmd":..., "args":..., "id":...} into a command line.  The
+//  id is kept as written, to be echoed in the reply.  Unknown members are ignored.
+//  Returns 1 if the request is not a flat JSON object with a "cmd".
+//
+static int _ctlJsonRequest( const char *json, char *cmdLine, size_t cmdSize, char *id, size_t idSize )
+{
+    char key[16], args[CTL_LINE_MAX];
+    const char *p = json, *kStart, *vStart;
+    size_t kLen, vLen;
+
+    strlcpy( cmdLine, "", cmdSize );
+    strlcpy( args, "", sizeof( args ));
+    strlcpy( id, "null", idSize );
+
+    while ( isspace( (unsigned char) *p )) p++;
+    if ( *p++ != '{' ) return 1;
+    while ( isspace( (unsigned char) *p )) p++;
+
+    while ( *p != '}' ) {
+        if (( *p != '"' ) || ( 0 != _ctlJsonScan( &p, &kStart, &kLen ))) return 1;
+        while ( isspace( (unsigned char) *p )) p++;
+        if ( *p++ != ':' ) return 1;
+        while ( isspace( (unsigned char) *p )) p++;
+        if ( 0 != _ctlJsonScan( &p, &vStart, &vLen )) return 1;
+
+        _ctlJsonDecode( kStart, kLen, key, sizeof( key ));
+        if ( 0 == strcmp( key, "cmd" ))  _ctlJsonDecode( vStart, vLen, cmdLine, cmdSize );
+        if ( 0 == strcmp( key, "args" )) _ctlJsonDecode( vStart, vLen, args, sizeof( args ));
+        if (( 0 == strcmp( key, "id" )) && ( vLen < idSize )) {
+            memcpy( id, vStart, vLen );
+            id[ vLen ] = 0;
+        }
+
+        while ( isspace( (unsigned char) *p )) p++;
+        if ( *p == ',' ) {
+            p++;
+            while ( isspace( (unsigned char) *p )) p++;
+        }
+        else if ( *p != '}' ) {
+            return 1;
+        }
+    }
+
+    if ( 0 == cmdLine[0] ) return 1;
+    if ( 0 != args[0] ) {
+        strlcat( cmdLine, " ", cmdSize );
+        strlcat( cmdLine, args, cmdSize );
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _ctlHelp (local)
+//
+static int _ctlHelp( char *args, strBuf_t *bPtr )
+{
+    int i;
+
+    strBufPrintf( bPtr, "help                 this list\n" );
+    for ( i=0; i<ctlCmdCount; i++ )
+        strBufPrintf( bPtr, "%-20s %s\n", ctlCmdTable[i].cmdName, ctlCmdTable[i].cmdHelp );
+    strBufPrintf( bPtr, "subscribe [event..]  stream events (default all but periodic, or 'all')\n" );
+    strBufPrintf( bPtr, "unsubscribe          stop streaming events\n" );
+    strBufPrintf( bPtr, "quit                 close the connection\n" );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _ctlSubscribe (local)
+//
+//  Parse a subscribe argument list into a bit mask of event IDs.
+//
+static int _ctlSubscribe( char *args, uint64_t *eventsOut, strBuf_t *bPtr )
+{
+    char eventName[64];
+    wordIter_t it;
+    strView_t w;
+    uint64_t events = 0;
+    int eventID;
+
+    wordIterInit( &it, args, " ," );
+    while ( wordIterNext( &it, &w )) {
+        strViewCopy( eventName, sizeof( eventName ), &w );
+        if ( 0 == strcmp( eventName, "all" )) {
+            events = ~ (uint64_t) 0;
+            continue;
+        }
+        if (( 0 > (eventID = eventsLookupName( eventName ))) || ( eventID >= 64 )) {
+            strBufPrintf( bPtr, "unknown event '%s'", eventName );
+            return 1;
+        }
+        events |= (uint64_t) 1 << eventID;
+    }
+    if ( events == 0 ) events = ~ ((uint64_t) 1 << SISSM_EV_PERIODIC);
+
+    *eventsOut = events;
+    strBufPrintf( bPtr, "subscribed\n" );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _ctlClose (local)
+//
+static void _ctlClose( ctlConn_t *cPtr )
+{
+    iopollDel( cPtr->fd );
+    close( cPtr->fd );
+
+    if ( cPtr->prev != NULL ) cPtr->prev->next = cPtr->next;
+    else ctlConns = cPtr->next;
+    if ( cPtr->next != NULL ) cPtr->next->prev = cPtr->prev;
+    ctlConnections--;
+
+    strBufFree( &cPtr->out );
+    free( cPtr );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _ctlFlush (local)
+//
+//  Write queued output.  Returns 0 if all was sent, 1 if the socket is full, -1 on error.
+//
+static int _ctlFlush( ctlConn_t *cPtr )
+{
+    ssize_t n;
+
+    while ( cPtr->outSent < cPtr->out.len ) {
+        n = send( cPtr->fd, cPtr->out.data + cPtr->outSent, cPtr->out.len - cPtr->outSent, MSG_NOSIGNAL );
+        if ( n > 0 ) {
+            cPtr->outSent += (size_t) n;
+        }
+        else if (( n < 0 ) && ( errno == EINTR )) {
+            continue;
+        }
+        else if (( n < 0 ) && (( errno == EAGAIN ) || ( errno == EWOULDBLOCK ))) {
+            return( 1 );
+        }
+        else {
+            return( -1 );
+        }
+    }
+    strBufFree( &cPtr->out );                                // idle clients hold no buffer
+    cPtr->outSent = 0;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _ctlRequest (local)
+//
+//  Execute one request line and queue its reply.
+//
+static void _ctlRequest( ctlConn_t *cPtr, char *line )
+{
+    char cmdLine[CTL_LINE_MAX], id[64], cmdName[32];
+    int errCode, isJson = ( line[0] == '{' );
+    size_t len;
+
+    strBufReset( &ctlReplyBuf );
+
+    if ( isJson ) {
+        if ( 0 != _ctlJsonRequest( line, cmdLine, sizeof( cmdLine ), id, sizeof( id ))) {
+            strBufPrintf( &cPtr->out, "{\"id\":%s,\"ok\":false,\"error\":\"malformed request\"}\n", id );
+            return;
+        }
+    }
+    else {
+        strlcpy( cmdLine, line, sizeof( cmdLine ));
+    }
+    strTrimInPlace( cmdLine );
+    getWord_r( cmdLine, 0, " ", cmdName, sizeof( cmdName ));
+    logPrintf( LOG_LEVEL_DEBUG, "ctl", "Request ::%s::", cmdLine );
+
+    // connection-level commands, then the registered ones
+    //
+    if ( 0 == strcmp( cmdName, "help" )) {
+        errCode = _ctlHelp( "", &ctlReplyBuf );
+    }
+    else if ( 0 == strcmp( cmdName, "subscribe" )) {
+        errCode = _ctlSubscribe( cmdLine + strlen( cmdName ), &cPtr->events, &ctlReplyBuf );
+        if ( errCode == 0 ) cPtr->jsonEvents = isJson;
+    }
+    else if ( 0 == strcmp( cmdName, "unsubscribe" )) {
+        cPtr->events = 0;
+        errCode = 0;
+    }
+    else if ( 0 == strcmp( cmdName, "quit" )) {
+        cPtr->closeAfter = 1;
+        errCode = 0;
+    }
+    else {
+        errCode = ctlExecute( cmdLine, &ctlReplyBuf );
+    }
+
+    // format the reply; for errors only the first line of the output is the message
+    //
+    if ( ctlReplyBuf.overflow ) {
+        strBufReset( &ctlReplyBuf );
+        strBufPrintf( &ctlReplyBuf, "out of memory" );
+        errCode = 1;
+    }
+    if ( errCode != 0 ) {
+        len = ( ctlReplyBuf.data == NULL ) ? 0 : strcspn( ctlReplyBuf.data, "\r\n" );
+        if ( len == 0 ) {
+            strBufReset( &ctlReplyBuf );
+            strBufPrintf( &ctlReplyBuf, "'%s' failed", cmdName );
+            len = ctlReplyBuf.len;
+        }
+    }
+    else {
+        len = ctlReplyBuf.len;
+    }
+
+    if ( isJson ) {
+        strBufPrintf( &cPtr->out, "{\"id\":%s,\"ok\":%s,\"%s\":\"", id, errCode ? "false" : "true", errCode ? "error" : "output" );
+        tmplAppendEscaped( &cPtr->out, ( len == 0 ) ? "" : ctlReplyBuf.data, len, TMPL_ESC_JSON );
+        strBufAppend( &cPtr->out, "\"}\n", 3 );
+    }
+    else if ( errCode != 0 ) {
+        strBufAppend( &cPtr->out, "ERR ", 4 );
+        strBufAppend( &cPtr->out, ctlReplyBuf.data, len );
+        strBufAppend( &cPtr->out, "\n", 1 );
+    }
+    else {
+        strBufPrintf( &cPtr->out, "OK %lu\n", (unsigned long) len );
+        if ( len != 0 ) strBufAppend( &cPtr->out, ctlReplyBuf.data, len );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _ctlArm (local)
+//
+//  Poll a connection for what it can take next: output while some is pending, and input
+//  unless the request buffer is full, the connection is closing, or output is backed up.
+//  The level-triggered poll would otherwise wake up for input that cannot be taken.
+//
+static void _ctlArm( ctlConn_t *cPtr, int pending )
+{
+    int wantIn = ( !cPtr->closeAfter ) && ( cPtr->inLen < CTL_LINE_MAX - 1 ) &&
+                 ( cPtr->out.len - cPtr->outSent < CTL_OUT_MAX );
+
+    iopollMod( cPtr->fd, (wantIn ? IOPOLL_IN : 0) | (pending ? IOPOLL_OUT : 0) );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _ctlConnCB (local)
+//
+//  Readiness callback of a client connection: read, execute every complete line, write
+//  what the socket takes, and wait for IOPOLL_OUT if anything is left over.
+//
+static int _ctlConnCB( int fd, int events, void *userData )
+{
+    ctlConn_t *cPtr = (ctlConn_t *) userData;
+    char *eol;
+    size_t lineLen;
+    ssize_t n;
+    int pending;
+
+    if ( events & IOPOLL_ERR ) {
+        _ctlClose( cPtr );
+        return 0;
+    }
+
+    if ( events & IOPOLL_IN ) {
+        while ( cPtr->inLen < CTL_LINE_MAX - 1 ) {
+            n = recv( fd, cPtr->in + cPtr->inLen, CTL_LINE_MAX - 1 - cPtr->inLen, 0 );
+            if ( n > 0 ) {
+                cPtr->inLen += (size_t) n;
+            }
+            else if (( n < 0 ) && ( errno == EINTR )) {
+                continue;
+            }
+            else if (( n < 0 ) && (( errno == EAGAIN ) || ( errno == EWOULDBLOCK ))) {
+                break;
+            }
+            else {                                                      // peer closed, or error
+                _ctlClose( cPtr );
+                return 0;
+            }
+        }
+        cPtr->in[ cPtr->inLen ] = 0;
+    }
+
+    for ( ;; ) {
+
+        // execute complete lines (pipelining is allowed) unless too much output is backed up
+        //
+        ctlServing = cPtr;
+        while (( !cPtr->closeAfter ) && ( cPtr->out.len - cPtr->outSent < CTL_OUT_MAX ) &&
+               ( NULL != (eol = strchr( cPtr->in, '\n' )))) {
+            *eol = 0;
+            lineLen = (size_t) (eol - cPtr->in) + 1;
+            if (( eol > cPtr->in ) && ( eol[-1] == '\r' )) eol[-1] = 0;
+            if ( 0 != cPtr->in[0] ) _ctlRequest( cPtr, cPtr->in );
+            memmove( cPtr->in, cPtr->in + lineLen, cPtr->inLen - lineLen + 1 );
+            cPtr->inLen -= lineLen;
+        }
+        ctlServing = NULL;
+        if (( !cPtr->closeAfter ) && ( cPtr->inLen >= CTL_LINE_MAX - 1 ) && ( NULL == strchr( cPtr->in, '\n' ))) {
+            cPtr->closeAfter = 1;                                     // line does not fit
+            strBufPrintf( &cPtr->out, "ERR request line too long\n" );
+        }
+
+        if ( 0 > (pending = _ctlFlush( cPtr ))) {
+            _ctlClose( cPtr );
+            return 0;
+        }
+
+        // all output went out: run the lines held back by it, if any
+        //
+        if (( pending ) || ( cPtr->closeAfter ) || ( NULL == strchr( cPtr->in, '\n' ))) break;
+    }
+
+    if (( pending == 0 ) && ( cPtr->closeAfter )) {
+        _ctlClose( cPtr );
+        return 0;
+    }
+    _ctlArm( cPtr, pending );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _ctlAcceptCB (local)
+//
+//  Readiness callback of the listening socket: accept every pending connection.
+//
+static int _ctlAcceptCB( int fd, int events, void *userData )
+{
+    ctlConn_t *cPtr;
+    int clientFd;
+
+    while ( 0 <= (clientFd = accept4( fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC ))) {
+
+        if (( ctlConnections >= CTL_MAXCONN ) ||
+            ( NULL == (cPtr = (ctlConn_t *) calloc( 1, sizeof( ctlConn_t ))))) {
+            close( clientFd );                                              // over the limit
+            continue;
+        }
+        cPtr->fd = clientFd;
+        if ( 0 != iopollAdd( clientFd, IOPOLL_IN, _ctlConnCB, cPtr )) {
+            close( clientFd );
+            free( cPtr );
+            continue;
+        }
+        cPtr->next = ctlConns;
+        if ( ctlConns != NULL ) ctlConns->prev = cPtr;
+        ctlConns = cPtr;
+        ctlConnections++;
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _ctlEventCB (local)
+//
+//  Events observer: queue the event to every subscriber and write it out.  A subscriber
+//  that has fallen CTL_OUT_MAX behind is dropped, except the one whose request is running
+//  (it is flushed, or dropped, when its request completes).
+//
+static void _ctlEventCB( int eventID, const char *eventName, const char *strBuffer )
+{
+    ctlConn_t *cPtr, *next;
+    size_t dataLen = strcspn( strBuffer, "\r\n" );
+    int pending, format;
+
+    for ( format = 0; format < 2; format++ ) {                    // 0 = text, 1 = JSON
+        strBufReset( &ctlEventBuf );
+        for ( cPtr = ctlConns; cPtr != NULL; cPtr = next ) {
+            next = cPtr->next;
+            if (( eventID >= 64 ) || ( 0 == (cPtr->events & ((uint64_t) 1 << eventID)))) continue;
+            if ( cPtr->jsonEvents != format ) continue;
+
+            if ( ctlEventBuf.len == 0 ) {
+                if ( format == 0 ) {
+                    strBufPrintf( &ctlEventBuf, "EVENT %s ", eventName );
+                    strBufAppend( &ctlEventBuf, strBuffer, dataLen );
+                    strBufAppend( &ctlEventBuf, "\n", 1 );
+                }
+                else {
+                    strBufPrintf( &ctlEventBuf, "{\"event\":\"%s\",\"data\":\"", eventName );
+                    tmplAppendEscaped( &ctlEventBuf, strBuffer, dataLen, TMPL_ESC_JSON );
+                    strBufAppend( &ctlEventBuf, "\"}\n", 3 );
+                }
+                if ( ctlEventBuf.overflow ) return;
+            }
+
+            strBufAppend( &cPtr->out, ctlEventBuf.data, ctlEventBuf.len );
+            if ( cPtr == ctlServing ) continue;
+
+            if (( 0 > (pending = _ctlFlush( cPtr ))) || ( cPtr->out.len - cPtr->outSent > CTL_OUT_MAX )) {
+                logPrintf( LOG_LEVEL_WARN, "ctl", "Dropping a control client that is not reading events" );
+                _ctlClose( cPtr );
+            }
+            else if ( pending ) {
+                _ctlArm( cPtr, pending );
+            }
+        }
+    }
+    return;
+}
+
+#endif
+
+
+//  ==============================================================================================
+//  ctlInit
+//
+//  Listen on the Unix domain socket sockPath, replacing a stale socket file left by a
+//  previous run.  An empty path disables the control socket.  Returns non-zero on failure
+//  (logged).
+//
+int ctlInit( char *sockPath )
+{
+    int errCode = 0;
+#ifdef _WIN32
+    if ( 0 != sockPath[0] )
+        logPrintf( LOG_LEVEL_CRITICAL, "ctl", "Control socket is not supported on this platform" );
+#else
+    struct sockaddr_un addr;
+    int fd;
+
+    if ( 0 == sockPath[0] ) return 0;
+
+    memset( &addr, 0, sizeof( addr ));
+    addr.sun_family = AF_UNIX;
+    if ( strlen( sockPath ) >= sizeof( addr.sun_path )) {
+        logPrintf( LOG_LEVEL_CRITICAL, "ctl", "Control socket path is too long ::%s::", sockPath );
+        return 1;
+    }
+    strlcpy( addr.sun_path, sockPath, sizeof( addr.sun_path ));
+
+    if ( 0 > (fd = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 ))) errCode = 1;
+    if ( !errCode ) {
+        unlink( sockPath );
+        if (( 0 != bind( fd, (struct sockaddr *) &addr, sizeof( addr ))) ||
+            ( 0 != chmod( sockPath, 0660 )) ||
+            ( 0 != listen( fd, 32 )) ||
+            ( 0 != iopollAdd( fd, IOPOLL_IN, _ctlAcceptCB, NULL ))) {
+            close( fd );
+            errCode = 1;
+        }
+    }
+    if ( errCode ) {
+        logPrintf( LOG_LEVEL_CRITICAL, "ctl", "Unable to listen on control socket ::%s::", sockPath );
+        return errCode;
+    }
+
+    ctlListenFd = fd;
+    strlcpy( ctlSockPath, sockPath, sizeof( ctlSockPath ));
+    eventsObserve( _ctlEventCB );
+    logPrintf( LOG_LEVEL_CRITICAL, "ctl", "Control socket on ::%s::", sockPath );
+#endif
+    return errCode;
+}
+
+
+//  ==============================================================================================
+//  ctlDestroy
+//
+//  Close all connections and remove the socket file.
+//
+void ctlDestroy( void )
+{
+#ifndef _WIN32
+    if ( ctlListenFd < 0 ) return;
+
+    eventsObserve( NULL );
+    while ( ctlConns != NULL ) _ctlClose( ctlConns );
+    iopollDel( ctlListenFd );
+    close( ctlListenFd );
+    unlink( ctlSockPath );
+    ctlListenFd = -1;
+#endif
+    return;
+}
+
@@ -0,0 +1,32 @@
+//  ==============================================================================================
+//
+//  Module: CTL
+//
+//  Description:
+//  Local control socket: admin commands, queries and event subscriptions for tools
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stddef.h>
+#include "util.h"
+
+#define CTL_MAXCMDS         (32)                                    // registered commands
+#define CTL_MAXCONN         (16)                             // simultaneous client connections
+#define CTL_LINE_MAX        (4096)                                 // longest request line
+#define CTL_OUT_MAX         (1024*1024)      // unsent reply and event bytes before a drop
+
+//  A command appends its reply text to bPtr and returns 0, or returns non-zero with an
+//  error message (or nothing) in bPtr.
+//
+extern int  ctlInit( char *sockPath );
+extern void ctlDestroy( void );
+extern int  ctlRegister( char *cmdName, char *cmdHelp, int (*cmdFunction)( char *args, strBuf_t *bPtr ) );
+extern int  ctlExecute( char *cmdLine, strBuf_t *bPtr );
+extern int  ctlConnCount( void );
+
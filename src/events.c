@@ -28,7 +28,12 @@
 // #include <netdb.h>
 // #include <fcntl.h>
 
+#include <stdint.h>
+
+#include "util.h"
+#include "metrics.h"
 #include "events.h"
+#include "journal.h"
 
 
 //  ==============================================================================================
@@ -42,35 +47,47 @@
 //
 static int (*eventsCallbackFunctions[SISSM_MAXPLUGINS][SISSM_MAXEVENTS])( char * );
 
+//  Metrics: events fired, and time spent in each callback (same indexing as above)
+//
+static metricsObj *eventsFiredMetric[SISSM_MAXEVENTS];
+static metricsObj *eventsCallbackMetric[SISSM_MAXPLUGINS][SISSM_MAXEVENTS];
+
+//  Single observer of every event (the control socket), called after the plugin callbacks
+//
+static void (*eventsObserver)( int eventID, const char *eventName, const char *strBuffer ) = NULL;
+
 
 //  Master events table, to associate:
 //  *  Event ID number - for API calls
 //  *  Even ID to callback array index map eventsCallbackFunctions[plugin#][*]
 //  *  String (game log file) that triggers the event 
+//  *  Short name, for metrics labels
 //
 struct {
     int        eventID;
     int        callBacktableIndex;
     const char *eventString;
+    const char *eventName;
 } eventTable[SISSM_MAXEVENTS] = {
 
-    { SISSM_EV_INIT,                 0, "~INIT~"              }, 
-    { SISSM_EV_RESTART,              1, "~RESTART~"           },
-    { SISSM_EV_CLIENT_ADD,           2, SS_SUBSTR_REGCLIENT   },
-    { SISSM_EV_CLIENT_DEL,           3, SS_SUBSTR_UNREGCLIENT },
-    { SISSM_EV_MAPCHANGE,            4, SS_SUBSTR_MAPCHANGE   },
-    { SISSM_EV_GAME_START,           5, SS_SUBSTR_GAME_START  },
-    { SISSM_EV_GAME_END,             6, SS_SUBSTR_GAME_END    },
-    { SISSM_EV_ROUND_START,          7, SS_SUBSTR_ROUND_START },
-    { SISSM_EV_ROUND_END,            8, SS_SUBSTR_ROUND_END   },
-    { SISSM_EV_OBJECTIVE_CAPTURED,   9, SS_SUBSTR_CAPTURE     },
-    { SISSM_EV_PERIODIC,            10, "~PERIODIC~"          },
-    { SISSM_EV_CLIENT_ADD_SYNTH,    11, "~SYNTHADD~"          },
-    { SISSM_EV_CLIENT_DEL_SYNTH,    12, "~SYNTHDEL~"          },
-    { SISSM_EV_SHUTDOWN,            13, SS_SUBSTR_SHUTDOWN    },
-    { SISSM_EV_CHAT,                14, SS_SUBSTR_CHAT        },
-    { SISSM_EV_SIGTERM,             15, "~SIGTERM~"           },
-    { -1,                           -1, "*"                   },
+    { SISSM_EV_INIT,                 0, "~INIT~",              "init"                },
+    { SISSM_EV_RESTART,              1, "~RESTART~",           "restart"             },
+    { SISSM_EV_CLIENT_ADD,           2, SS_SUBSTR_REGCLIENT,   "client_add"          },
+    { SISSM_EV_CLIENT_DEL,           3, SS_SUBSTR_UNREGCLIENT, "client_del"          },
+    { SISSM_EV_MAPCHANGE,            4, SS_SUBSTR_MAPCHANGE,   "mapchange"           },
+    { SISSM_EV_GAME_START,           5, SS_SUBSTR_GAME_START,  "game_start"          },
+    { SISSM_EV_GAME_END,             6, SS_SUBSTR_GAME_END,    "game_end"            },
+    { SISSM_EV_ROUND_START,          7, SS_SUBSTR_ROUND_START, "round_start"         },
+    { SISSM_EV_ROUND_END,            8, SS_SUBSTR_ROUND_END,   "round_end"           },
+    { SISSM_EV_OBJECTIVE_CAPTURED,   9, SS_SUBSTR_CAPTURE,     "objective_captured"  },
+    { SISSM_EV_PERIODIC,            10, "~PERIODIC~",          "periodic"            },
+    { SISSM_EV_CLIENT_ADD_SYNTH,    11, "~SYNTHADD~",          "client_add_synth"    },
+    { SISSM_EV_CLIENT_DEL_SYNTH,    12, "~SYNTHDEL~",          "client_del_synth"    },
+    { SISSM_EV_SHUTDOWN,            13, SS_SUBSTR_SHUTDOWN,    "shutdown"            },
+    { SISSM_EV_CHAT,                14, SS_SUBSTR_CHAT,        "chat"                },
+    { SISSM_EV_SIGTERM,             15, "~SIGTERM~",           "sigterm"             },
+    { SISSM_EV_RELOAD,              16, "~RELOAD~",            "reload"              },
+    { -1,                           -1, "*",                   "*"                   },
 
 };
 
@@ -84,6 +101,7 @@ int eventsInit( void )
 {
     int errCode = 0;
     int i, j;
+    char labels[128];
 
     // zero out the callback functions
     //
@@ -91,18 +109,26 @@ int eventsInit( void )
         for ( j=0; j<SISSM_MAXEVENTS; j++ )
             eventsCallbackFunctions[i][j] = NULL;
 
+    for ( i=0; i<SISSM_MAXEVENTS; i++ ) {
+        if ( eventTable[i].eventID == -1 ) break;
+        snprintf( labels, sizeof( labels ), "event=\"%s\"", eventTable[i].eventName );
+        eventsFiredMetric[i] = metricsCounter( "sissm_events_total", "Events dispatched, from the game log or synthetic", labels );
+    }
+
     return errCode;
 }
 
 
 //  ==============================================================================================
-//  eventsRegister
+//  eventsRegisterNamed
 //
 //  Called from a Plugin, this method associates and registers the plugin-specific callback routine 
-//  with the specific event.
+//  with the specific event.  Plugins use the eventsRegister() macro, which passes the name of
+//  the callback function for the dispatch time metric.
 //
-int eventsRegister( int eventID, int (*callBack)( char * ))
+int eventsRegisterNamed( int eventID, int (*callBack)( char * ), char *callBackName )
 {
+    char labels[128];
     int i, j, callBackIndex = -1, errCode = 1;
 
     // Translate the eventID to callBackTable index
@@ -124,6 +150,9 @@ int eventsRegister( int eventID, int (*callBack)( char * ))
         for ( j=0; j<SISSM_MAXPLUGINS ; j++ ) {
             if ( eventsCallbackFunctions[callBackIndex][j] == NULL) {
                 eventsCallbackFunctions[callBackIndex][j] = callBack;
+                snprintf( labels, sizeof( labels ), "event=\"%s\",callback=\"%s\"", eventTable[ i ].eventName, callBackName );
+                eventsCallbackMetric[callBackIndex][j] = metricsHistogram( "sissm_dispatch_seconds",
+                    "Time spent in a plugin event callback", labels, NULL, 0 );
                 errCode = 0;
                 break;
             }
@@ -134,6 +163,46 @@ int eventsRegister( int eventID, int (*callBack)( char * ))
 
 
 
+//  ==============================================================================================
+//  _eventsFire (local)
+//
+//  Journal and count the event, and call (and time) every callback registered for it.  Slots are filled in order
+//  and never released, so the first empty slot ends the list.
+//
+static void _eventsFire( int tableIndex, char *strBuffer )
+{
+    int j, activeCallBackIndex;
+    uint64_t startUs;
+
+    metricsInc( eventsFiredMetric[tableIndex] );
+
+    // journal the event; roster changes and map changes are journaled with their
+    // details by the api module, and the 1Hz tick is not worth keeping
+    //
+    switch ( eventTable[tableIndex].eventID ) {
+    case SISSM_EV_PERIODIC:  case SISSM_EV_MAPCHANGE:
+    case SISSM_EV_CLIENT_ADD_SYNTH:  case SISSM_EV_CLIENT_DEL_SYNTH:
+        break;
+    default:
+        journalEvent( eventTable[tableIndex].eventID, NULL );
+        break;
+    }
+
+    activeCallBackIndex = eventTable[tableIndex].callBacktableIndex;
+    if ( activeCallBackIndex >= 0 ) {
+        for (j=0; j<SISSM_MAXPLUGINS; j++) {
+            if ( NULL == eventsCallbackFunctions[activeCallBackIndex][j] ) break;
+            startUs = metricsNowUs();
+            (*eventsCallbackFunctions[activeCallBackIndex][j])( strBuffer );
+            metricsObserveUs( eventsCallbackMetric[activeCallBackIndex][j], metricsNowUs() - startUs );
+        }
+    }
+    if ( eventsObserver != NULL )
+        (*eventsObserver)( eventTable[tableIndex].eventID, eventTable[tableIndex].eventName, strBuffer );
+    return;
+}
+
+
 //  ==============================================================================================
 //  eventsDispatch
 //
@@ -143,7 +212,7 @@ int eventsRegister( int eventID, int (*callBack)( char * ))
 //
 int eventsDispatch( char *strBuffer )
 {
-    int i, j;
+    int i;
     int activeCallBackIndex = -1;
 
     for (i=0; i<SISSM_MAXEVENTS; i++) { 
@@ -155,13 +224,7 @@ int eventsDispatch( char *strBuffer )
 
         if ( NULL != strstr( strBuffer, eventTable[i].eventString ) ) {
             activeCallBackIndex = eventTable[i].callBacktableIndex;
-            if ( activeCallBackIndex >= 0 ) {
-                for (j=0; j<SISSM_MAXPLUGINS; j++) {
-                    if ( NULL != eventsCallbackFunctions[activeCallBackIndex][j] ) {
-                         (*eventsCallbackFunctions[activeCallBackIndex][j])( strBuffer );
-                    }
-                }
-            }
+            _eventsFire( i, strBuffer );
             break;
         }
         if (0==strcmp( "*", eventTable[i].eventString )) break;
@@ -170,3 +233,53 @@ int eventsDispatch( char *strBuffer )
 }
 
 
+//  ==============================================================================================
+//  eventsDispatchID
+//
+//  Dispatch a synthetic event by its ID, skipping the substring match against the trigger
+//  table.  strBuffer is passed to the callbacks as-is.  Returns -1 if the ID is unknown.
+//
+int eventsDispatchID( int eventID, char *strBuffer )
+{
+    int i;
+
+    for (i=0; i<SISSM_MAXEVENTS; i++) {
+        if ( eventTable[i].eventID == -1 ) break;
+        if ( eventTable[i].eventID == eventID ) {
+            _eventsFire( i, strBuffer );
+            return( eventTable[i].callBacktableIndex );
+        }
+    }
+    return -1;
+}
+
+
+//  ==============================================================================================
+//  eventsObserve
+//
+//  Install (or with NULL, remove) the observer that is shown every event after the plugin
+//  callbacks have run, with the short event name.  Used by the control socket to stream
+//  events to subscribers; plugins use eventsRegister() instead.
+//
+void eventsObserve( void (*observer)( int eventID, const char *eventName, const char *strBuffer ) )
+{
+    eventsObserver = observer;
+    return;
+}
+
+
+//  ==============================================================================================
+//  eventsLookupName
+//
+//  Returns the event ID of a short event name (e.g., "mapchange"), or -1 if unknown.
+//
+int eventsLookupName( const char *eventName )
+{
+    int i;
+
+    for (i=0; i<SISSM_MAXEVENTS; i++) {
+        if ( eventTable[i].eventID == -1 ) break;
+        if ( 0 == strcmp( eventTable[i].eventName, eventName )) return( eventTable[i].eventID );
+    }
+    return -1;
+}
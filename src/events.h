@@ -33,6 +33,7 @@
 #define SISSM_EV_SHUTDOWN                   (13)
 #define SISSM_EV_CHAT                       (14)
 #define SISSM_EV_SIGTERM                    (15)
+#define SISSM_EV_RELOAD                     (16)
 
 
 // Following substring in log file triggers an event
@@ -50,7 +51,11 @@
 #define SS_SUBSTR_CHAT         "LogChat: Display:"
 
 extern int eventsInit( void );
-extern int eventsRegister( int eventID, int (*callBack)( char * ));
+extern int eventsRegisterNamed( int eventID, int (*callBack)( char * ), char *callBackName );
+#define eventsRegister( eventID, callBack )   eventsRegisterNamed( (eventID), (callBack), #callBack )
 extern int eventsDispatch( char *strBuffer );
+extern int eventsDispatchID( int eventID, char *strBuffer );
+extern void eventsObserve( void (*observer)( int eventID, const char *eventName, const char *strBuffer ) );
+extern int eventsLookupName( const char *eventName );
 
 
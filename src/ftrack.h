@@ -16,6 +16,8 @@
 //
 //  ==============================================================================================
 
+#include <stdio.h>
+
 #define FTRACK_FILENAME_MAX   (1024)
 
 typedef struct {
@@ -0,0 +1,249 @@
+//  ==============================================================================================
+//
+//  Module: GZIP
+//
+//  Description:
+//  Small self-contained gzip (RFC 1952/1951) encoder for web responses and rotated logs
+//
+//  SISSM has no external library dependencies, so instead of linking zlib this module
+//  implements the simplest useful deflate: LZ77 with hash chains over a 32 KB window,
+//  coded as one block with the fixed Huffman tables.  Status pages and JSON compress to
+//  roughly a third, which is what matters when they are compressed once per change and
+//  then served to many clients.  Decompression is not provided (not needed).
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "gzip.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define GZIP_WSIZE        (32768)                                   // deflate window size
+#define GZIP_HASH_BITS    (14)
+#define GZIP_HASH_SIZE    (1 << GZIP_HASH_BITS)
+#define GZIP_MAX_CHAIN    (32)                         // match candidates tried per position
+#define GZIP_MIN_MATCH    (3)
+#define GZIP_MAX_MATCH    (258)
+
+static const unsigned short lenBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char lenExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short distBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char distExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+typedef struct {
+
+    unsigned char *out;
+    size_t         outLen, outMax;
+    uint32_t       bitBuf;
+    int            bitCount;
+    int            overflow;
+
+} gzipWriter_t;
+
+
+//  ==============================================================================================
+//  gzipCrc32
+//
+//  Standard CRC-32 (IEEE 802.3), as used by the gzip trailer.  Start with crc = 0.
+//
+uint32_t gzipCrc32( uint32_t crc, const unsigned char *buf, size_t len )
+{
+    size_t i;
+    int k;
+
+    crc = ~crc;
+    for ( i=0; i<len; i++ ) {
+        crc ^= buf[i];
+        for ( k=0; k<8; k++ ) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return( ~crc );
+}
+
+
+//  ==============================================================================================
+//  _gzipPutByte, _gzipPutBits, _gzipPutCode (local)
+//
+//  Deflate packs data elements LSB first, but Huffman codes MSB first.
+//
+static void _gzipPutByte( gzipWriter_t *w, unsigned char c )
+{
+    if ( w->outLen < w->outMax ) w->out[ w->outLen++ ] = c;
+    else w->overflow = 1;
+    return;
+}
+
+static void _gzipPutBits( gzipWriter_t *w, uint32_t value, int nBits )
+{
+    w->bitBuf |= value << w->bitCount;
+    w->bitCount += nBits;
+    while ( w->bitCount >= 8 ) {
+        _gzipPutByte( w, (unsigned char) w->bitBuf );
+        w->bitBuf >>= 8;
+        w->bitCount -= 8;
+    }
+    return;
+}
+
+static void _gzipPutCode( gzipWriter_t *w, uint32_t code, int nBits )
+{
+    uint32_t reversed = 0;
+    int i;
+
+    for ( i=0; i<nBits; i++ ) reversed |= ((code >> i) & 1u) << (nBits - 1 - i);
+    _gzipPutBits( w, reversed, nBits );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _gzipPutSymbol (local)
+//
+//  Emit a literal/length symbol (0..285) with the fixed Huffman code.
+//
+static void _gzipPutSymbol( gzipWriter_t *w, int sym )
+{
+    if      ( sym <= 143 ) _gzipPutCode( w, 0x30  + sym,         8 );
+    else if ( sym <= 255 ) _gzipPutCode( w, 0x190 + (sym - 144), 9 );
+    else if ( sym <= 279 ) _gzipPutCode( w, sym - 256,           7 );
+    else                   _gzipPutCode( w, 0xC0  + (sym - 280), 8 );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _gzipPutMatch (local)
+//
+static void _gzipPutMatch( gzipWriter_t *w, int length, int distance )
+{
+    int i;
+
+    for ( i=28; lenBase[i] > length; i-- ) ;
+    _gzipPutSymbol( w, 257 + i );
+    _gzipPutBits( w, length - lenBase[i], lenExtra[i] );
+
+    for ( i=29; distBase[i] > distance; i-- ) ;
+    _gzipPutCode( w, i, 5 );
+    _gzipPutBits( w, distance - distBase[i], distExtra[i] );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _gzipHash (local)
+//
+static unsigned int _gzipHash( const unsigned char *p )
+{
+    return( ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (GZIP_HASH_SIZE - 1) );
+}
+
+
+//  ==============================================================================================
+//  gzipEncode
+//
+//  Compress inLen bytes into a complete gzip stream (header, fixed-Huffman deflate data,
+//  CRC/size trailer) at 'out'.  Returns the stream length, or 0 if it does not fit in
+//  outMax bytes or memory is short -- serve the data uncompressed in that case.
+//
+size_t gzipEncode( const unsigned char *in, size_t inLen, unsigned char *out, size_t outMax )
+{
+    static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255 };
+    gzipWriter_t w;
+    int32_t *head, *prev;
+    size_t i, k, j;
+    uint32_t crc;
+    int32_t cand, next;
+    int chain, bestLen, bestDist, len, maxLen;
+
+    head = (int32_t *) malloc( GZIP_HASH_SIZE * sizeof( int32_t ));
+    prev = (int32_t *) malloc( GZIP_WSIZE * sizeof( int32_t ));
+    if (( head == NULL ) || ( prev == NULL )) {
+        free( head );
+        free( prev );
+        return( 0 );
+    }
+    for ( i=0; i<GZIP_HASH_SIZE; i++ ) head[i] = -1;
+
+    memset( &w, 0, sizeof( w ));
+    w.out = out;
+    w.outMax = outMax;
+
+    for ( i=0; i<sizeof( header ); i++ ) _gzipPutByte( &w, header[i] );
+    _gzipPutBits( &w, 1, 1 );                                            // BFINAL: last block
+    _gzipPutBits( &w, 1, 2 );                                       // BTYPE: fixed Huffman
+
+    i = 0;
+    while (( i < inLen ) && ( !w.overflow )) {
+
+        bestLen = 0;  bestDist = 0;
+        if ( i + GZIP_MIN_MATCH <= inLen ) {
+
+            // walk the hash chain of this position for the longest match in the window
+            //
+            maxLen = ( inLen - i < GZIP_MAX_MATCH ) ? (int) (inLen - i) : GZIP_MAX_MATCH;
+            cand = head[ _gzipHash( &in[i] ) ];
+            for ( chain = GZIP_MAX_CHAIN; ( cand >= 0 ) && ( chain > 0 ); chain-- ) {
+                if ( i - (size_t) cand > GZIP_WSIZE - 1 ) break;
+                for ( len = 0; ( len < maxLen ) && ( in[cand+len] == in[i+len] ); len++ ) ;
+                if ( len > bestLen ) {
+                    bestLen = len;
+                    bestDist = (int) (i - (size_t) cand);
+                    if ( len == maxLen ) break;
+                }
+                next = prev[ cand & (GZIP_WSIZE - 1) ];
+                if ( next >= cand ) break;                        // slot reused, chain ends
+                cand = next;
+            }
+        }
+
+        if ( bestLen >= GZIP_MIN_MATCH ) {
+            _gzipPutMatch( &w, bestLen, bestDist );
+            k = (size_t) bestLen;
+        }
+        else {
+            _gzipPutSymbol( &w, in[i] );
+            k = 1;
+        }
+
+        // index every position consumed, so later matches can refer to them
+        //
+        for ( j = i; j < i + k; j++ ) {
+            if ( j + GZIP_MIN_MATCH > inLen ) break;
+            prev[ j & (GZIP_WSIZE - 1) ] = head[ _gzipHash( &in[j] ) ];
+            head[ _gzipHash( &in[j] ) ] = (int32_t) j;
+        }
+        i += k;
+    }
+
+    _gzipPutSymbol( &w, 256 );                                                 // end of block
+    if ( w.bitCount > 0 ) _gzipPutBits( &w, 0, 8 - w.bitCount );                      // flush
+
+    crc = gzipCrc32( 0, in, inLen );
+    for ( k=0; k<4; k++ ) _gzipPutByte( &w, (unsigned char) (crc >> (8*k)) );
+    for ( k=0; k<4; k++ ) _gzipPutByte( &w, (unsigned char) ((uint32_t) inLen >> (8*k)) );
+
+    free( head );
+    free( prev );
+    return( w.overflow ? 0 : w.outLen );
+}
+
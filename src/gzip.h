@@ -0,0 +1,21 @@
+//  ==============================================================================================
+//
+//  Module: GZIP
+//
+//  Description:
+//  Small self-contained gzip (RFC 1952/1951) encoder for precompressed web responses
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern uint32_t gzipCrc32( uint32_t crc, const unsigned char *buf, size_t len );
+extern size_t   gzipEncode( const unsigned char *in, size_t inLen, unsigned char *out, size_t outMax );
+
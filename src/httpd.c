@@ -0,0 +1,862 @@
+//  ==============================================================================================
+//
+//  Module: HTTPD
+//
+//  Description:
+//  Embedded non-blocking HTTP/1.1 server for documents published from memory
+//
+//  A plugin creates a server on a port and publishes documents (path, content type, body,
+//  ETag) whenever its content changes; the server answers GET/HEAD for those paths from
+//  memory.  Publishing an unchanged ETag is a no-op, and each document is gzip-compressed
+//  once when published, not per request, so serving hundreds of viewers costs little more
+//  than the send() calls.  Conditional requests (If-None-Match) get 304, keep-alive and
+//  pipelined requests are supported, and idle connections are closed after HTTPD_IDLE_MS.
+//  A route (httpdRoute) is instead rendered by a callback on each request, for small
+//  content that changes all the time, such as metrics.  The server listens on a TCP port,
+//  or on a Unix domain socket if the bind address is a path.
+//
+//  Event streams (Server-Sent Events, text/event-stream) push updates instead: a GET on a
+//  registered stream path subscribes the connection, which first receives the current
+//  content of a snapshot document, then every httpdStreamSend().  Each event is formatted
+//  once and written straight to every subscriber's socket; only the part a socket does not
+//  take is buffered.  An idle subscriber holds no buffers at all, just its socket, and gets
+//  a comment line every HTTPD_PING_MS so that proxies keep it open.  A subscriber that
+//  falls HTTPD_STREAM_BACKLOG behind is dropped (browsers reconnect by themselves).
+//
+//  All sockets are non-blocking and are driven by iopoll from the main loop, so a slow
+//  or stalled client never holds up log dispatch: unsent output just waits for the next
+//  writable event.  Not available on Windows (httpdCreate returns NULL).
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#define _GNU_SOURCE                                                        // required for accept4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <ctype.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#endif
+
+#include "bsd.h"
+#include "log.h"
+#include "util.h"
+#include "alarm.h"
+#include "iopoll.h"
+#include "gzip.h"
+#include "httpd.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define HTTPD_OUT_MAX       (1024*1024)         // stop reading requests while this much is unsent
+
+typedef struct {
+
+    char           path[HTTPD_PATH_MAX];
+    char           contentType[64];
+    char           etag[80];                                     // quoted entity tag, or ""
+    char          *body;
+    size_t         bodyLen;
+    unsigned char *gz;                                     // gzip of body, NULL if not smaller
+    size_t         gzLen;
+    int          (*renderCB)( strBuf_t *bPtr );          // dynamic route: rendered per request
+
+} httpdDoc_t;
+
+typedef struct httpdConn {
+
+    struct httpdConn *next, *prev;
+    httpdObj  *hPtr;
+    int        fd;
+    char      *in;                 // request bytes not yet parsed, HTTPD_REQ_MAX, NULL if stream
+    size_t     inLen;
+    int        stream;                            // subscribed event stream index, -1 if none
+    strBuf_t   out;                                                  // response bytes queued
+    size_t     outSent;                                     // of which already written out
+    int        closeAfter;                         // close once out is flushed (no keep-alive)
+    uint64_t   lastActiveMs;
+
+} httpdConn_t;
+
+struct httpdObj {
+
+    int          listenFd;
+    int          port;
+    char         sockPath[108];                    // Unix domain socket path, "" if TCP
+    int          maxConn, connCount;
+    httpdConn_t *conns;                                              // open connections list
+    alarmObj    *idleAlarm;
+    httpdDoc_t   docs[HTTPD_MAXDOCS];
+    int          docCount;
+    struct {
+        char     path[HTTPD_PATH_MAX];
+        char     snapshotPath[HTTPD_PATH_MAX];           // document sent first to a new subscriber
+        int      subscribers;
+    }            streams[HTTPD_MAXSTREAMS];
+    int          streamCount;
+    unsigned long eventId;                                         // last event id sent
+    uint64_t     lastPingMs;
+
+};
+
+static strBuf_t httpdEventBuf;                          // event formatted once, for all subscribers
+static strBuf_t httpdRenderBuf;                                   // dynamic route response body
+
+
+//  ==============================================================================================
+//  _httpdFindDoc (local)
+//
+static httpdDoc_t *_httpdFindDoc( httpdObj *hPtr, const char *path )
+{
+    int i;
+
+    for ( i=0; i<hPtr->docCount; i++ )
+        if ( 0 == strcmp( hPtr->docs[i].path, path )) return( &hPtr->docs[i] );
+    return( NULL );
+}
+
+
+//  ==============================================================================================
+//  _httpdFindStream (local)
+//
+static int _httpdFindStream( httpdObj *hPtr, const char *path )
+{
+    int i;
+
+    for ( i=0; i<hPtr->streamCount; i++ )
+        if ( 0 == strcmp( hPtr->streams[i].path, path )) return( i );
+    return( -1 );
+}
+
+
+//  ==============================================================================================
+//  _httpdFormatEvent (local)
+//
+//  Format one Server-Sent Event into bPtr.  Each line of data becomes a "data:" line.
+//
+static void _httpdFormatEvent( strBuf_t *bPtr, unsigned long id, const char *eventName, const char *data, size_t dataLen )
+{
+    const char *p = data, *end = data + dataLen, *eol;
+
+    strBufPrintf( bPtr, "id: %lu\nevent: %s\n", id, eventName );
+    while ( p < end ) {
+        if ( NULL == (eol = memchr( p, '\n', end - p ))) eol = end;
+        strBufAppend( bPtr, "data: ", 6 );
+        strBufAppend( bPtr, p, eol - p );
+        strBufAppend( bPtr, "\n", 1 );
+        p = eol + 1;
+    }
+    if ( dataLen == 0 ) strBufAppend( bPtr, "data:\n", 6 );
+    strBufAppend( bPtr, "\n", 1 );
+    return;
+}
+
+
+#ifndef _WIN32
+
+//  ==============================================================================================
+//  _httpdClose (local)
+//
+static void _httpdClose( httpdConn_t *cPtr )
+{
+    httpdObj *hPtr = cPtr->hPtr;
+
+    iopollDel( cPtr->fd );
+    close( cPtr->fd );
+
+    if ( cPtr->prev != NULL ) cPtr->prev->next = cPtr->next;
+    else hPtr->conns = cPtr->next;
+    if ( cPtr->next != NULL ) cPtr->next->prev = cPtr->prev;
+    hPtr->connCount--;
+    if ( cPtr->stream >= 0 ) hPtr->streams[ cPtr->stream ].subscribers--;
+
+    strBufFree( &cPtr->out );
+    free( cPtr->in );
+    free( cPtr );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _httpdHeader (local)
+//
+//  Find header 'name' (case-insensitive) in the header lines of a request, copy its value
+//  lower-cased into valueOut.  Returns 1 if found.
+//
+static int _httpdHeader( const char *req, size_t reqLen, const char *name, char *valueOut, size_t outSize )
+{
+    const char *p, *end = req + reqLen, *eol, *v;
+    size_t nameLen = strlen( name ), i;
+
+    valueOut[0] = 0;
+    for ( p = req; p < end; p = eol + 1 ) {
+        if ( NULL == (eol = memchr( p, '\n', end - p ))) break;
+        if (( (size_t) (eol - p) > nameLen ) && ( p[nameLen] == ':' ) && ( 0 == strncasecmp( p, name, nameLen ))) {
+            for ( v = p + nameLen + 1; ( v < eol ) && (( *v == ' ' ) || ( *v == '\t' )); v++ ) ;
+            for ( i = 0; ( v < eol ) && ( *v != '\r' ) && ( i + 1 < outSize ); v++ ) valueOut[i++] = (char) tolower( *v );
+            valueOut[i] = 0;
+            return( 1 );
+        }
+    }
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _httpdStatus (local)
+//
+//  Queue a bodyless error/status response.
+//
+static void _httpdStatus( httpdConn_t *cPtr, char *status )
+{
+    strBufPrintf( &cPtr->out, "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+        status, cPtr->closeAfter ? "close" : "keep-alive" );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _httpdRequest (local)
+//
+//  Answer one complete request (request line + headers, reqLen bytes) by queueing the
+//  response on the connection.
+//
+static void _httpdRequest( httpdConn_t *cPtr, const char *req, size_t reqLen )
+{
+    char line[256], path[HTTPD_PATH_MAX], version[16], value[256], dateStr[64];
+    strView_t method, target, ver;
+    wordIter_t it;
+    httpdDoc_t *dPtr;
+    const char *eol;
+    struct tm tmNow;
+    time_t now;
+    int useGzip, isHead, stream;
+
+    eol = memchr( req, '\n', reqLen );
+    strlcpy( line, req, ( eol - req < (long) sizeof( line ) - 1 ) ? (size_t) (eol - req) + 1 : sizeof( line ));
+    wordIterInit( &it, line, " \r" );
+    if (( !wordIterNext( &it, &method )) || ( !wordIterNext( &it, &target )) || ( !wordIterNext( &it, &ver ))) {
+        cPtr->closeAfter = 1;
+        _httpdStatus( cPtr, "400 Bad Request" );
+        return;
+    }
+    strViewCopy( version, sizeof( version ), &ver );
+
+    // persistent connection: default on for HTTP/1.1, opt-in for HTTP/1.0
+    //
+    _httpdHeader( eol + 1, reqLen - (eol + 1 - req), "Connection", value, sizeof( value ));
+    if ( 0 == strcmp( version, "HTTP/1.1" ))
+        cPtr->closeAfter = ( NULL != strstr( value, "close" ));
+    else
+        cPtr->closeAfter = ( NULL == strstr( value, "keep-alive" ));
+
+    isHead = strViewEq( &method, "HEAD" );
+    if (( !isHead ) && ( !strViewEq( &method, "GET" ))) {
+        _httpdStatus( cPtr, "405 Method Not Allowed" );
+        return;
+    }
+
+    strViewCopy( path, sizeof( path ), &target );
+    path[ strcspn( path, "?#" ) ] = 0;                                    // ignore query string
+
+    // event stream: respond with open-ended text/event-stream, then the snapshot event
+    //
+    if (( !isHead ) && ( 0 <= (stream = _httpdFindStream( cPtr->hPtr, path )))) {
+        cPtr->stream = stream;
+        cPtr->hPtr->streams[ stream ].subscribers++;
+        strBufPrintf( &cPtr->out, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+            "Cache-Control: no-cache\r\nX-Accel-Buffering: no\r\nConnection: keep-alive\r\n\r\nretry: 5000\n\n" );
+        if ( NULL != (dPtr = _httpdFindDoc( cPtr->hPtr, cPtr->hPtr->streams[ stream ].snapshotPath )))
+            _httpdFormatEvent( &cPtr->out, cPtr->hPtr->eventId, "snapshot", dPtr->body, dPtr->bodyLen );
+        return;
+    }
+
+    if ( NULL == (dPtr = _httpdFindDoc( cPtr->hPtr, path ))) {
+        _httpdStatus( cPtr, "404 Not Found" );
+        return;
+    }
+
+    now = time( NULL );
+    gmtime_r( &now, &tmNow );
+    strftime( dateStr, sizeof( dateStr ), "%a, %d %b %Y %H:%M:%S GMT", &tmNow );
+
+    // dynamic route: rendered now, never cached or compressed
+    //
+    if ( dPtr->renderCB != NULL ) {
+        strBufReset( &httpdRenderBuf );
+        (*dPtr->renderCB)( &httpdRenderBuf );
+        strBufPrintf( &cPtr->out,
+            "HTTP/1.1 200 OK\r\nDate: %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n"
+            "Cache-Control: no-cache\r\nConnection: %s\r\n\r\n",
+            dateStr, dPtr->contentType, (unsigned long) httpdRenderBuf.len,
+            cPtr->closeAfter ? "close" : "keep-alive" );
+        if ( !isHead ) strBufAppend( &cPtr->out, httpdRenderBuf.data, httpdRenderBuf.len );
+        return;
+    }
+
+    // conditional GET: the client's copy is current
+    //
+    if (( 0 != dPtr->etag[0] ) &&
+        ( _httpdHeader( eol + 1, reqLen - (eol + 1 - req), "If-None-Match", value, sizeof( value ))) &&
+        (( NULL != strstr( value, dPtr->etag )) || ( 0 == strcmp( value, "*" )))) {
+        strBufPrintf( &cPtr->out, "HTTP/1.1 304 Not Modified\r\nDate: %s\r\nETag: %s\r\nConnection: %s\r\n\r\n",
+            dateStr, dPtr->etag, cPtr->closeAfter ? "close" : "keep-alive" );
+        return;
+    }
+
+    _httpdHeader( eol + 1, reqLen - (eol + 1 - req), "Accept-Encoding", value, sizeof( value ));
+    useGzip = ( dPtr->gz != NULL ) && ( NULL != strstr( value, "gzip" ));
+
+    strBufPrintf( &cPtr->out,
+        "HTTP/1.1 200 OK\r\nDate: %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n%s%s%s"
+        "Cache-Control: no-cache\r\nVary: Accept-Encoding\r\n%sConnection: %s\r\n\r\n",
+        dateStr, dPtr->contentType, (unsigned long) (useGzip ? dPtr->gzLen : dPtr->bodyLen),
+        dPtr->etag[0] ? "ETag: " : "", dPtr->etag, dPtr->etag[0] ? "\r\n" : "",
+        useGzip ? "Content-Encoding: gzip\r\n" : "",
+        cPtr->closeAfter ? "close" : "keep-alive" );
+    if ( !isHead ) {
+        if ( useGzip ) strBufAppend( &cPtr->out, (char *) dPtr->gz, dPtr->gzLen );
+        else           strBufAppend( &cPtr->out, dPtr->body, dPtr->bodyLen );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _httpdFlush (local)
+//
+//  Write as much queued output as the socket takes.  Returns -1 if the connection failed,
+//  0 if everything was written, 1 if output is still pending.
+//
+static int _httpdFlush( httpdConn_t *cPtr )
+{
+    ssize_t n;
+
+    while ( cPtr->outSent < cPtr->out.len ) {
+        n = send( cPtr->fd, cPtr->out.data + cPtr->outSent, cPtr->out.len - cPtr->outSent, MSG_NOSIGNAL );
+        if ( n > 0 ) {
+            cPtr->outSent += (size_t) n;
+            cPtr->lastActiveMs = alarmNowMs();
+        }
+        else if (( n < 0 ) && ( errno == EINTR )) {
+            continue;
+        }
+        else if (( n < 0 ) && (( errno == EAGAIN ) || ( errno == EWOULDBLOCK ))) {
+            return( 1 );
+        }
+        else {
+            return( -1 );
+        }
+    }
+    if ( cPtr->stream >= 0 ) strBufFree( &cPtr->out );       // idle subscribers hold no buffer
+    else strBufReset( &cPtr->out );
+    cPtr->outSent = 0;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _httpdConnCB (local)
+//
+//  Readiness callback of a client connection: read, answer every complete request,
+//  write what the socket takes, and wait for IOPOLL_OUT if anything is left over.
+//  Input is not polled while the request buffer is full, the connection is closing, or
+//  output is backed up: the level-triggered poll would otherwise wake up for data that
+//  cannot be taken.  Reading resumes once the output drains.  A connection is only
+//  counted active when bytes actually move, so a client that sends but never reads is
+//  closed after HTTPD_IDLE_MS.
+//
+static int _httpdConnCB( int fd, int events, void *userData )
+{
+    httpdConn_t *cPtr = (httpdConn_t *) userData;
+    char *hdrEnd, discard[256];
+    size_t reqLen;
+    ssize_t n;
+    int pending, wantIn;
+
+    if ( events & IOPOLL_ERR ) {
+        _httpdClose( cPtr );
+        return 0;
+    }
+
+    if (( events & IOPOLL_IN ) && ( cPtr->in == NULL )) {
+        for ( ;; ) {                             // subscriber: nothing more to read but a close
+            n = recv( fd, discard, sizeof( discard ), 0 );
+            if (( n > 0 ) || (( n < 0 ) && ( errno == EINTR ))) continue;
+            if (( n < 0 ) && (( errno == EAGAIN ) || ( errno == EWOULDBLOCK ))) break;
+            _httpdClose( cPtr );
+            return 0;
+        }
+    }
+    else if ( events & IOPOLL_IN ) {
+        while ( cPtr->inLen < HTTPD_REQ_MAX - 1 ) {
+            n = recv( fd, cPtr->in + cPtr->inLen, HTTPD_REQ_MAX - 1 - cPtr->inLen, 0 );
+            if ( n > 0 ) {
+                cPtr->inLen += (size_t) n;
+                cPtr->lastActiveMs = alarmNowMs();
+            }
+            else if (( n < 0 ) && ( errno == EINTR )) {
+                continue;
+            }
+            else if (( n < 0 ) && (( errno == EAGAIN ) || ( errno == EWOULDBLOCK ))) {
+                break;
+            }
+            else {                                                      // peer closed, or error
+                _httpdClose( cPtr );
+                return 0;
+            }
+        }
+        cPtr->in[ cPtr->inLen ] = 0;
+    }
+
+    for ( ;; ) {
+
+        // answer complete requests (pipelining is allowed) unless too much output is backed
+        // up or the connection became an event stream
+        //
+        while (( cPtr->in != NULL ) && ( !cPtr->closeAfter ) && ( cPtr->stream < 0 ) &&
+               ( cPtr->out.len - cPtr->outSent < HTTPD_OUT_MAX ) &&
+               ( NULL != (hdrEnd = strstr( cPtr->in, "\r\n\r\n" )))) {
+            reqLen = (size_t) (hdrEnd - cPtr->in) + 4;
+            _httpdRequest( cPtr, cPtr->in, reqLen );
+            memmove( cPtr->in, cPtr->in + reqLen, cPtr->inLen - reqLen + 1 );
+            cPtr->inLen -= reqLen;
+        }
+        if (( cPtr->in != NULL ) && ( cPtr->stream >= 0 )) {
+            free( cPtr->in );                                       // subscribers only listen
+            cPtr->in = NULL;
+            cPtr->inLen = 0;
+        }
+        if (( cPtr->in != NULL ) && ( !cPtr->closeAfter ) && ( cPtr->inLen >= HTTPD_REQ_MAX - 1 ) &&
+            ( NULL == strstr( cPtr->in, "\r\n\r\n" ))) {
+            cPtr->closeAfter = 1;                              // header block does not fit
+            _httpdStatus( cPtr, "431 Request Header Fields Too Large" );
+        }
+
+        if ( 0 > (pending = _httpdFlush( cPtr ))) {
+            _httpdClose( cPtr );
+            return 0;
+        }
+
+        // all output went out: answer the requests held back by it, if any
+        //
+        if (( pending ) || ( cPtr->closeAfter ) || ( cPtr->in == NULL ) ||
+            ( NULL == strstr( cPtr->in, "\r\n\r\n" ))) break;
+    }
+
+    if (( pending == 0 ) && ( cPtr->closeAfter )) {
+        _httpdClose( cPtr );
+        return 0;
+    }
+    wantIn = ( cPtr->in == NULL ) ||
+        (( !cPtr->closeAfter ) && ( cPtr->inLen < HTTPD_REQ_MAX - 1 ) && ( cPtr->out.len - cPtr->outSent < HTTPD_OUT_MAX ));
+    iopollMod( fd, (wantIn ? IOPOLL_IN : 0) | (pending ? IOPOLL_OUT : 0) );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _httpdAcceptCB (local)
+//
+//  Readiness callback of the listening socket: accept every pending connection.
+//
+static int _httpdAcceptCB( int fd, int events, void *userData )
+{
+    httpdObj *hPtr = (httpdObj *) userData;
+    httpdConn_t *cPtr;
+    int clientFd;
+
+    while ( 0 <= (clientFd = accept4( fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC ))) {
+
+        if (( hPtr->connCount >= hPtr->maxConn ) ||
+            ( NULL == (cPtr = (httpdConn_t *) calloc( 1, sizeof( httpdConn_t ))))) {
+            close( clientFd );                                              // over the limit
+            continue;
+        }
+        if ( NULL == (cPtr->in = (char *) malloc( HTTPD_REQ_MAX ))) {
+            close( clientFd );
+            free( cPtr );
+            continue;
+        }
+        cPtr->in[0] = 0;
+        cPtr->stream = -1;
+        cPtr->fd = clientFd;
+        cPtr->hPtr = hPtr;
+        cPtr->lastActiveMs = alarmNowMs();
+        if ( 0 != iopollAdd( clientFd, IOPOLL_IN, _httpdConnCB, cPtr )) {
+            close( clientFd );
+            free( cPtr->in );
+            free( cPtr );
+            continue;
+        }
+        cPtr->next = hPtr->conns;
+        if ( hPtr->conns != NULL ) hPtr->conns->prev = cPtr;
+        hPtr->conns = cPtr;
+        hPtr->connCount++;
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _httpdFanOut (local)
+//
+//  Write an already formatted event to every subscriber of a stream.  Sockets with nothing
+//  pending are written directly; only what a socket does not take is buffered.
+//
+static void _httpdFanOut( httpdObj *hPtr, int stream, const char *data, size_t len )
+{
+    httpdConn_t *cPtr, *next;
+    ssize_t n;
+
+    for ( cPtr = hPtr->conns; cPtr != NULL; cPtr = next ) {
+        next = cPtr->next;
+        if ( cPtr->stream != stream ) continue;
+
+        if ( cPtr->out.len == cPtr->outSent ) {                             // nothing pending
+            do {
+                n = send( cPtr->fd, data, len, MSG_NOSIGNAL );
+            } while (( n < 0 ) && ( errno == EINTR ));
+            if (( n < 0 ) && ( errno != EAGAIN ) && ( errno != EWOULDBLOCK )) {
+                _httpdClose( cPtr );
+                continue;
+            }
+            if ( n < 0 ) n = 0;
+            if ( (size_t) n == len ) continue;
+            strBufAppend( &cPtr->out, data + n, len - (size_t) n );
+            iopollMod( cPtr->fd, IOPOLL_IN | IOPOLL_OUT );
+        }
+        else if ( cPtr->out.len - cPtr->outSent + len > HTTPD_STREAM_BACKLOG ) {
+            _httpdClose( cPtr );                                     // too far behind, drop
+        }
+        else {
+            strBufAppend( &cPtr->out, data, len );
+        }
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _httpdIdleCB (local)
+//
+//  Once a second: close connections idle for longer than HTTPD_IDLE_MS, and every
+//  HTTPD_PING_MS send event stream subscribers a comment line to keep them open.
+//
+static int _httpdIdleCB( alarmObj *aPtr, void *userData )
+{
+    httpdObj *hPtr = (httpdObj *) userData;
+    httpdConn_t *cPtr, *next;
+    uint64_t now = alarmNowMs();
+    int i;
+
+    for ( cPtr = hPtr->conns; cPtr != NULL; cPtr = next ) {
+        next = cPtr->next;
+        if (( cPtr->stream < 0 ) && ( now - cPtr->lastActiveMs > HTTPD_IDLE_MS )) _httpdClose( cPtr );
+    }
+    if ( now - hPtr->lastPingMs >= HTTPD_PING_MS ) {
+        hPtr->lastPingMs = now;
+        for ( i=0; i<hPtr->streamCount; i++ ) _httpdFanOut( hPtr, i, ": ping\n\n", 8 );
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _httpdListenUnix (local)
+//
+//  Listen on a Unix domain socket at 'path', replacing a stale socket file left by a
+//  previous run.  Access is controlled by the permissions of the containing directory.
+//
+static int _httpdListenUnix( char *path )
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset( &addr, 0, sizeof( addr ));
+    addr.sun_family = AF_UNIX;
+    if ( strlen( path ) >= sizeof( addr.sun_path )) return( -1 );
+    strlcpy( addr.sun_path, path, sizeof( addr.sun_path ));
+
+    if ( 0 > (fd = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 ))) return( -1 );
+    unlink( path );
+    if (( 0 != bind( fd, (struct sockaddr *) &addr, sizeof( addr ))) || ( 0 != listen( fd, 128 ))) {
+        close( fd );
+        return( -1 );
+    }
+    return( fd );
+}
+
+#endif
+
+
+//  ==============================================================================================
+//  httpdCreate
+//
+//  Start a server listening on bindAddr:port (bindAddr "" = all interfaces), accepting at
+//  most maxConn simultaneous connections.  A bindAddr starting with '/' is the path of a
+//  Unix domain socket instead, and port is ignored.  Returns NULL on failure (logged).
+//
+httpdObj *httpdCreate( char *bindAddr, int port, int maxConn )
+{
+    httpdObj *hPtr = NULL;
+#ifdef _WIN32
+    logPrintf( LOG_LEVEL_CRITICAL, "httpd", "Embedded web server is not supported on this platform" );
+#else
+    struct addrinfo hints, *res = NULL, *ai;
+    char portStr[16];
+    int fd = -1, one = 1, isUnix = ( bindAddr[0] == '/' );
+
+    if ( isUnix ) {
+        fd = _httpdListenUnix( bindAddr );
+    }
+    else {
+        memset( &hints, 0, sizeof( hints ));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        snprintf( portStr, sizeof( portStr ), "%d", port );
+
+        if ( 0 != getaddrinfo( (0 == strlen( bindAddr )) ? NULL : bindAddr, portStr, &hints, &res )) {
+            logPrintf( LOG_LEVEL_CRITICAL, "httpd", "Invalid bind address ::%s::", bindAddr );
+            return( NULL );
+        }
+        for ( ai = res; ai != NULL; ai = ai->ai_next ) {
+            if ( 0 > (fd = socket( ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol ))) continue;
+            setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ));
+            if (( 0 == bind( fd, ai->ai_addr, ai->ai_addrlen )) && ( 0 == listen( fd, 128 ))) break;
+            close( fd );
+            fd = -1;
+        }
+        freeaddrinfo( res );
+    }
+
+    if ( fd < 0 ) {
+        logPrintf( LOG_LEVEL_CRITICAL, "httpd", "Unable to listen on ::%s:%d::", bindAddr, port );
+        return( NULL );
+    }
+    if ( NULL == (hPtr = (httpdObj *) calloc( 1, sizeof( httpdObj )))) {
+        close( fd );
+        return( NULL );
+    }
+    hPtr->listenFd = fd;
+    hPtr->port = port;
+    if ( isUnix ) strlcpy( hPtr->sockPath, bindAddr, sizeof( hPtr->sockPath ));
+    hPtr->maxConn = ( maxConn > 0 ) ? maxConn : 1;
+    hPtr->lastPingMs = alarmNowMs();
+
+    if ( 0 != iopollAdd( fd, IOPOLL_IN, _httpdAcceptCB, hPtr )) {
+        logPrintf( LOG_LEVEL_CRITICAL, "httpd", "Unable to poll port %d", port );
+        close( fd );
+        free( hPtr );
+        return( NULL );
+    }
+    hPtr->idleAlarm = alarmCreateUser( _httpdIdleCB, hPtr );
+    alarmRepeat( hPtr->idleAlarm, 1000 );
+
+    logPrintf( LOG_LEVEL_CRITICAL, "httpd", "Serving on ::%s:%d::", bindAddr, port );
+#endif
+    return( hPtr );
+}
+
+
+//  ==============================================================================================
+//  httpdDestroy
+//
+//  Close all connections and the listening socket, and free the published documents.
+//
+void httpdDestroy( httpdObj *hPtr )
+{
+    int i;
+
+    if ( hPtr == NULL ) return;
+#ifndef _WIN32
+    while ( hPtr->conns != NULL ) _httpdClose( hPtr->conns );
+    iopollDel( hPtr->listenFd );
+    close( hPtr->listenFd );
+    if ( 0 != hPtr->sockPath[0] ) unlink( hPtr->sockPath );
+    alarmDestroy( hPtr->idleAlarm );
+#endif
+    for ( i=0; i<hPtr->docCount; i++ ) {
+        free( hPtr->docs[i].body );
+        free( hPtr->docs[i].gz );
+    }
+    free( hPtr );
+    return;
+}
+
+
+//  ==============================================================================================
+//  httpdPublish
+//
+//  Make 'body' the current content of 'path'.  The body is copied (and compressed), so the
+//  caller may reuse its buffer.  etag identifies the content version, e.g., a roster
+//  version: if it is unchanged from the last publish of this path the call does nothing.
+//  Pass "" to publish without an ETag (always replaced, no 304 support).  A path that
+//  does not fit HTTPD_PATH_MAX is refused.
+//
+int httpdPublish( httpdObj *hPtr, char *path, char *contentType, const char *body, size_t bodyLen, char *etag )
+{
+    httpdDoc_t *dPtr;
+    char quoted[80];
+    char *newBody;
+    unsigned char *gz;
+    size_t gzMax;
+
+    if (( hPtr == NULL ) || ( strlen( path ) >= HTTPD_PATH_MAX )) return( 1 );
+
+    quoted[0] = 0;
+    if ( 0 != strlen( etag )) snprintf( quoted, sizeof( quoted ), "\"%s\"", etag );
+
+    if ( NULL == (dPtr = _httpdFindDoc( hPtr, path ))) {
+        if ( hPtr->docCount >= HTTPD_MAXDOCS ) return( 1 );
+        dPtr = &hPtr->docs[ hPtr->docCount++ ];
+        memset( dPtr, 0, sizeof( httpdDoc_t ));
+        strlcpy( dPtr->path, path, sizeof( dPtr->path ));
+    }
+    else if (( 0 != quoted[0] ) && ( 0 == strcmp( quoted, dPtr->etag ))) {
+        return( 0 );                                                   // same version, no-op
+    }
+
+    if ( NULL == (newBody = (char *) malloc( bodyLen + 1 ))) return( 1 );
+    memcpy( newBody, body, bodyLen );
+    newBody[ bodyLen ] = 0;
+
+    // precompress once here, instead of per request
+    //
+    gz = NULL;
+    if ( bodyLen >= HTTPD_GZIP_MIN ) {
+        gzMax = bodyLen + bodyLen / 8 + 64;
+        if ( NULL != (gz = (unsigned char *) malloc( gzMax ))) {
+            dPtr->gzLen = gzipEncode( (unsigned char *) body, bodyLen, gz, gzMax );
+            if (( dPtr->gzLen == 0 ) || ( dPtr->gzLen >= bodyLen )) {
+                free( gz );
+                gz = NULL;
+            }
+        }
+    }
+
+    free( dPtr->body );
+    free( dPtr->gz );
+    dPtr->body = newBody;
+    dPtr->bodyLen = bodyLen;
+    dPtr->gz = gz;
+    if ( gz == NULL ) dPtr->gzLen = 0;
+    strlcpy( dPtr->contentType, contentType, sizeof( dPtr->contentType ));
+    strlcpy( dPtr->etag, quoted, sizeof( dPtr->etag ));
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  httpdRoute
+//
+//  Serve 'path' by calling renderCB to produce a fresh body on every request, for content
+//  that is cheap to render but changes continuously (e.g., metrics).  renderCB appends to
+//  the buffer it is given.
+//
+int httpdRoute( httpdObj *hPtr, char *path, char *contentType, int (*renderCB)( strBuf_t *bPtr ) )
+{
+    httpdDoc_t *dPtr;
+
+    if (( hPtr == NULL ) || ( strlen( path ) >= HTTPD_PATH_MAX )) return( 1 );
+    if ( NULL == (dPtr = _httpdFindDoc( hPtr, path ))) {
+        if ( hPtr->docCount >= HTTPD_MAXDOCS ) return( 1 );
+        dPtr = &hPtr->docs[ hPtr->docCount++ ];
+        memset( dPtr, 0, sizeof( httpdDoc_t ));
+        strlcpy( dPtr->path, path, sizeof( dPtr->path ));
+    }
+    strlcpy( dPtr->contentType, contentType, sizeof( dPtr->contentType ));
+    dPtr->renderCB = renderCB;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  httpdConnCount
+//
+//  Number of open client connections.
+//
+int httpdConnCount( httpdObj *hPtr )
+{
+    return( (hPtr == NULL) ? 0 : hPtr->connCount );
+}
+
+
+//  ==============================================================================================
+//  httpdStreamRegister
+//
+//  Make 'path' an event stream.  New subscribers first get the current content of the
+//  published document snapshotPath (e.g., a JSON status) as a "snapshot" event, then every
+//  event sent with httpdStreamSend().
+//
+int httpdStreamRegister( httpdObj *hPtr, char *path, char *snapshotPath )
+{
+    if (( hPtr == NULL ) || ( hPtr->streamCount >= HTTPD_MAXSTREAMS )) return( 1 );
+
+    strlcpy( hPtr->streams[ hPtr->streamCount ].path, path, sizeof( hPtr->streams[0].path ));
+    strlcpy( hPtr->streams[ hPtr->streamCount ].snapshotPath, snapshotPath, sizeof( hPtr->streams[0].snapshotPath ));
+    hPtr->streams[ hPtr->streamCount ].subscribers = 0;
+    hPtr->streamCount++;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  httpdStreamSend
+//
+//  Push an event (name, and data -- e.g., one line of JSON) to every subscriber of 'path'.
+//  The event is formatted once regardless of the number of subscribers.
+//
+int httpdStreamSend( httpdObj *hPtr, char *path, char *eventName, const char *data )
+{
+    int stream;
+
+    if (( hPtr == NULL ) || ( 0 > (stream = _httpdFindStream( hPtr, path )))) return( 1 );
+
+    hPtr->eventId++;
+#ifndef _WIN32
+    if ( hPtr->streams[ stream ].subscribers > 0 ) {
+        strBufReset( &httpdEventBuf );
+        _httpdFormatEvent( &httpdEventBuf, hPtr->eventId, eventName, data, strlen( data ));
+        if ( !httpdEventBuf.overflow ) _httpdFanOut( hPtr, stream, httpdEventBuf.data, httpdEventBuf.len );
+    }
+#endif
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  httpdStreamCount
+//
+//  Number of subscribers of an event stream.
+//
+int httpdStreamCount( httpdObj *hPtr, char *path )
+{
+    int stream;
+
+    if (( hPtr == NULL ) || ( 0 > (stream = _httpdFindStream( hPtr, path )))) return( 0 );
+    return( hPtr->streams[ stream ].subscribers );
+}
+
@@ -0,0 +1,41 @@
+//  ==============================================================================================
+//
+//  Module: HTTPD
+//
+//  Description:
+//  Embedded non-blocking HTTP/1.1 server for documents published from memory
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stddef.h>
+#include "util.h"
+
+#define HTTPD_MAXDOCS       (16)                              // published paths per server
+#define HTTPD_PATH_MAX      (128)               // longest path, including the terminator
+#define HTTPD_MAXSTREAMS    (4)                           // event stream paths per server
+#define HTTPD_REQ_MAX       (4096)                       // largest request header accepted
+#define HTTPD_IDLE_MS       (15000)                       // keep-alive idle connection timeout
+#define HTTPD_GZIP_MIN      (256)                  // smaller documents are not compressed
+#define HTTPD_PING_MS       (15000)           // event stream keep-alive comment interval
+#define HTTPD_STREAM_BACKLOG (256*1024)     // unsent event bytes before a subscriber is dropped
+
+typedef struct httpdObj httpdObj;
+
+//  httpdRoute() takes a strBuf_t renderer: include util.h before this header
+//
+
+extern httpdObj *httpdCreate( char *bindAddr, int port, int maxConn );
+extern void httpdDestroy( httpdObj *hPtr );
+extern int httpdPublish( httpdObj *hPtr, char *path, char *contentType, const char *body, size_t bodyLen, char *etag );
+extern int httpdRoute( httpdObj *hPtr, char *path, char *contentType, int (*renderCB)( strBuf_t *bPtr ) );
+extern int httpdConnCount( httpdObj *hPtr );
+extern int httpdStreamRegister( httpdObj *hPtr, char *path, char *snapshotPath );
+extern int httpdStreamSend( httpdObj *hPtr, char *path, char *eventName, const char *data );
+extern int httpdStreamCount( httpdObj *hPtr, char *path );
+
@@ -0,0 +1,246 @@
+//  ==============================================================================================
+//
+//  Module: IOPOLL
+//
+//  Description:
+//  Non-blocking socket readiness dispatcher for the main loop (epoll)
+//
+//  Sockets served from inside sissm (e.g., the piwebgen status server) register here with
+//  a callback.  The main loop calls iopollWait() in place of a sleep: it blocks on one
+//  epoll set holding every registered fd plus the alarm timerfd, so it wakes up for
+//  whichever comes first -- socket activity, the next alarm, or the polling interval --
+//  and then calls the callbacks of the ready fds.  iopollWait(0) only dispatches what is
+//  already ready, and is called between log lines so that busy logs do not starve sockets.
+//
+//  Callbacks run on the main loop thread and must not block: use non-blocking sockets and
+//  leave partial work for the next readiness callback.  A callback may iopollDel() any fd,
+//  including its own.
+//
+//  On Windows there is no epoll; iopollAdd fails and iopollWait falls back to alarmWait.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include "winport.h"
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#endif
+
+#include "log.h"
+#include "alarm.h"
+#include "iopoll.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+typedef struct {
+
+    int (*ioCallback)( int fd, int events, void *userData );
+    void *userData;
+    uint32_t generation;                  // tags epoll events, so a reused fd# drops stale ones
+
+} iopollObj;
+
+static iopollObj *iopollTable = NULL;                                   // indexed by fd#
+static int        iopollTableSize = 0;
+static uint32_t   iopollGeneration = 0;
+static int        iopollFd = -1;                                    // epoll instance, -1 if none
+
+#define IOPOLL_ALARM_TAG   (0xffffffffu)                            // epoll tag of alarm timerfd
+
+
+#ifndef _WIN32
+
+//  ==============================================================================================
+//  _iopollEpollEvents (local)
+//
+static uint32_t _iopollEpollEvents( int events )
+{
+    uint32_t e = 0;
+
+    if ( events & IOPOLL_IN  ) e |= EPOLLIN | EPOLLRDHUP;
+    if ( events & IOPOLL_OUT ) e |= EPOLLOUT;
+    return( e );
+}
+
+#endif
+
+
+//  ==============================================================================================
+//  iopollInit
+//
+//  Module initialization, called once after alarmInit().
+//
+void iopollInit( void )
+{
+#ifndef _WIN32
+    struct epoll_event ev;
+
+    if ( iopollFd >= 0 ) return;
+    if ( 0 > (iopollFd = epoll_create1( EPOLL_CLOEXEC ))) {
+        logPrintf( LOG_LEVEL_CRITICAL, "iopoll", "epoll_create1 failed, socket services disabled" );
+        return;
+    }
+    if ( alarmFd() >= 0 ) {
+        memset( &ev, 0, sizeof( ev ));
+        ev.events = EPOLLIN;
+        ev.data.u64 = (uint64_t) IOPOLL_ALARM_TAG << 32;
+        epoll_ctl( iopollFd, EPOLL_CTL_ADD, alarmFd(), &ev );
+    }
+#endif
+    return;
+}
+
+
+//  ==============================================================================================
+//  iopollAdd
+//
+//  Register a non-blocking fd: ioCallback( fd, readyEvents, userData ) is called from
+//  iopollWait() whenever the fd is ready for any of 'events' (IOPOLL_IN | IOPOLL_OUT).
+//  Returns 0 on success.
+//
+int iopollAdd( int fd, int events, int (*ioCallback)( int fd, int events, void *userData ), void *userData )
+{
+    int errCode = 1;
+#ifndef _WIN32
+    struct epoll_event ev;
+    iopollObj *newTable;
+    int newSize;
+
+    if (( iopollFd < 0 ) || ( fd < 0 ) || ( ioCallback == NULL )) return( 1 );
+
+    if ( fd >= iopollTableSize ) {
+        newSize = ( iopollTableSize == 0 ) ? 64 : iopollTableSize;
+        while ( newSize <= fd ) newSize *= 2;
+        if ( NULL == (newTable = (iopollObj *) realloc( iopollTable, newSize * sizeof( iopollObj )))) return( 1 );
+        memset( &newTable[ iopollTableSize ], 0, (newSize - iopollTableSize) * sizeof( iopollObj ));
+        iopollTable = newTable;
+        iopollTableSize = newSize;
+    }
+
+    if ( ++iopollGeneration == IOPOLL_ALARM_TAG ) iopollGeneration = 1;
+    memset( &ev, 0, sizeof( ev ));
+    ev.events = _iopollEpollEvents( events );
+    ev.data.u64 = ((uint64_t) iopollGeneration << 32) | (uint32_t) fd;
+
+    if ( 0 == epoll_ctl( iopollFd, EPOLL_CTL_ADD, fd, &ev )) {
+        iopollTable[fd].ioCallback = ioCallback;
+        iopollTable[fd].userData   = userData;
+        iopollTable[fd].generation = iopollGeneration;
+        errCode = 0;
+    }
+#endif
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  iopollMod
+//
+//  Change the readiness set of a registered fd, e.g., add IOPOLL_OUT while output is pending.
+//
+int iopollMod( int fd, int events )
+{
+    int errCode = 1;
+#ifndef _WIN32
+    struct epoll_event ev;
+
+    if (( fd < 0 ) || ( fd >= iopollTableSize ) || ( iopollTable[fd].ioCallback == NULL )) return( 1 );
+
+    memset( &ev, 0, sizeof( ev ));
+    ev.events = _iopollEpollEvents( events );
+    ev.data.u64 = ((uint64_t) iopollTable[fd].generation << 32) | (uint32_t) fd;
+    if ( 0 == epoll_ctl( iopollFd, EPOLL_CTL_MOD, fd, &ev )) errCode = 0;
+#endif
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  iopollDel
+//
+//  Unregister an fd.  Call before close().  Pending events of this fd in the current
+//  iopollWait batch are dropped.
+//
+int iopollDel( int fd )
+{
+    int errCode = 1;
+#ifndef _WIN32
+    if (( fd < 0 ) || ( fd >= iopollTableSize ) || ( iopollTable[fd].ioCallback == NULL )) return( 1 );
+
+    epoll_ctl( iopollFd, EPOLL_CTL_DEL, fd, NULL );
+    memset( &iopollTable[fd], 0, sizeof( iopollObj ));
+    errCode = 0;
+#endif
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  iopollWait
+//
+//  Wait up to maxWaitMs, or less if an alarm is due sooner, for socket activity; then
+//  dispatch the ready fds.  Alarms themselves are fired by alarmDispatch(), not here.
+//
+void iopollWait( long maxWaitMs )
+{
+#ifdef _WIN32
+    alarmWait( maxWaitMs );
+#else
+    struct epoll_event events[ IOPOLL_MAXEVENTS ];
+    uint64_t expirations;
+    int64_t nextMs;
+    uint32_t tag;
+    int i, n, fd, ready;
+
+    if ( iopollFd < 0 ) {
+        alarmWait( maxWaitMs );
+        return;
+    }
+
+    nextMs = alarmNextMs();
+    if (( nextMs >= 0 ) && ( nextMs < maxWaitMs )) maxWaitMs = (long) nextMs;
+    if ( maxWaitMs < 0 ) maxWaitMs = 0;
+
+    n = epoll_wait( iopollFd, events, IOPOLL_MAXEVENTS, (int) maxWaitMs );
+
+    for ( i=0; i<n; i++ ) {
+        tag = (uint32_t) (events[i].data.u64 >> 32);
+        fd  = (int) (uint32_t) events[i].data.u64;
+
+        if ( tag == IOPOLL_ALARM_TAG ) {                             // drain the alarm timerfd
+            if ( sizeof( expirations ) != read( alarmFd(), &expirations, sizeof( expirations ))) {
+                // nothing to drain (non-blocking): the expirations were already read
+            }
+            continue;
+        }
+        if (( fd >= iopollTableSize ) || ( iopollTable[fd].ioCallback == NULL ) ||
+            ( iopollTable[fd].generation != tag ))
+            continue;                                         // deleted earlier in this batch
+
+        ready = 0;
+        if ( events[i].events & (EPOLLIN | EPOLLRDHUP) ) ready |= IOPOLL_IN;
+        if ( events[i].events & EPOLLOUT )               ready |= IOPOLL_OUT;
+        if ( events[i].events & (EPOLLERR | EPOLLHUP) )  ready |= IOPOLL_ERR | IOPOLL_IN;
+
+        (*iopollTable[fd].ioCallback)( fd, ready, iopollTable[fd].userData );
+    }
+#endif
+    return;
+}
+
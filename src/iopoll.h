@@ -0,0 +1,27 @@
+//  ==============================================================================================
+//
+//  Module: IOPOLL
+//
+//  Description:
+//  Non-blocking socket readiness dispatcher for the main loop (epoll)
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#define IOPOLL_IN        (0x01)                                       // readable / acceptable
+#define IOPOLL_OUT       (0x02)                                                    // writable
+#define IOPOLL_ERR       (0x04)                              // error or hangup (reported only)
+
+#define IOPOLL_MAXEVENTS (64)                          // ready fds handled per iopollWait call
+
+extern void iopollInit( void );
+extern int  iopollAdd( int fd, int events, int (*ioCallback)( int fd, int events, void *userData ), void *userData );
+extern int  iopollMod( int fd, int events );
+extern int  iopollDel( int fd );
+extern void iopollWait( long maxWaitMs );
+
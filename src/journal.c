@@ -0,0 +1,649 @@
+//  ==============================================================================================
+//
+//  Module: JOURNAL
+//
+//  Description:
+//  Append-only binary event journal (fixed records, interned strings, time index)
+//
+//  The journal complements the human readable sissm.log with a compact record of what
+//  happened, for after-the-fact queries such as "who was online when X happened".  It is
+//  made of three append-only files:
+//
+//  <name>.jrn   fixed-size journalRec_t records: time, kind, code, SteamID64, two strings
+//  <name>.jrs   string pool; each distinct string (player name, IP, command verb, map...)
+//               is stored once and referenced by its file offset
+//  <name>.jri   sparse time index, one { time, record# } entry every JOURNAL_INDEX_EVERY
+//               records, so a time range is found without touching the record file
+//
+//  Each file starts with a 16-byte header (magic, version, element size).  Records are in
+//  native byte order and may be memory-mapped as arrays for reading.  A partial record at
+//  the end of the file (crash) is dropped when the journal is reopened for writing.
+//
+//  Record writes are buffered and flushed once a second by the caller (journalFlush).  A new
+//  string and a new index entry are flushed as they are written, ahead of the record that
+//  refers to them, so a concurrent reader never sees a record whose string is not yet on
+//  disk.  Both are rare next to records (distinct strings, one index entry per
+//  JOURNAL_INDEX_EVERY records).
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include "winport.h"
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#include "bsd.h"
+#include "log.h"
+#include "sid.h"
+#include "journal.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define JOURNAL_FILENAME_MAX  (1024)
+#define JOURNAL_VERSION          (1)
+#define JOURNAL_HDR_SIZE        (16)
+#define JOURNAL_STR_MAX        (256)                          // longest string interned
+#define JOURNAL_POOL_MAX  (64*1024*1024)          // stop interning new strings beyond this
+
+static const char *_journalMagic[3] = { "SISSMJR", "SISSMJS", "SISSMJI" };
+static const char *_journalExt[3]   = { ".jrn", ".jrs", ".jri" };
+
+#define JOURNAL_F_REC   (0)
+#define JOURNAL_F_STR   (1)
+#define JOURNAL_F_IDX   (2)
+
+static FILE    *_jFp[3] = { NULL, NULL, NULL };
+static uint64_t _jRecCount = 0;
+
+//  In-memory copy of the string pool and an open-addressing hash over it for interning.
+//  The pool image includes the file header so that pool offsets are file offsets.
+//
+static char     *_jPool = NULL;
+static uint32_t  _jPoolSize = 0, _jPoolAlloc = 0;
+static uint32_t *_jSlots = NULL;                            // pool offset + 1, 0 = empty
+static uint32_t  _jSlotCount = 0, _jStrCount = 0;
+
+
+//  ==============================================================================================
+//  _journalTimeMs (local)
+//
+static uint64_t _journalTimeMs( void )
+{
+#ifdef _WIN32
+    return( (uint64_t) time( NULL ) * 1000 );
+#else
+    struct timespec ts;
+
+    clock_gettime( CLOCK_REALTIME, &ts );
+    return( (uint64_t) ts.tv_sec * 1000 + (uint64_t) (ts.tv_nsec / 1000000) );
+#endif
+}
+
+
+//  ==============================================================================================
+//  _journalHash (local)
+//
+static uint32_t _journalHash( const char *s )
+{
+    uint32_t h = 2166136261u;
+
+    while ( *s != 0 ) {
+        h ^= (unsigned char) *s++;
+        h *= 16777619u;
+    }
+    return( h );
+}
+
+
+//  ==============================================================================================
+//  _journalSlotPut (local)
+//
+static void _journalSlotPut( uint32_t *slots, uint32_t slotCount, char *pool, uint32_t ofs )
+{
+    uint32_t i, mask = slotCount - 1;
+
+    for ( i = _journalHash( &pool[ofs] ) & mask; slots[i] != 0; i = (i + 1) & mask ) ;
+    slots[i] = ofs + 1;
+    return;
+}
+
+
+//  ==============================================================================================
+//  _journalSlotsGrow (local)
+//
+//  Keep the intern hash at most half full.  Returns 0 on success.
+//
+static int _journalSlotsGrow( void )
+{
+    uint32_t *newSlots, newCount, i;
+
+    if ( (_jStrCount + 1) * 2 <= _jSlotCount ) return 0;
+    newCount = _jSlotCount ? _jSlotCount * 2 : 4096;
+    if ( NULL == (newSlots = (uint32_t *) calloc( newCount, sizeof( uint32_t )))) return 1;
+    for ( i=0; i<_jSlotCount; i++ )
+        if ( _jSlots[i] != 0 ) _journalSlotPut( newSlots, newCount, _jPool, _jSlots[i] - 1 );
+    free( _jSlots );
+    _jSlots = newSlots;
+    _jSlotCount = newCount;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _journalPoolAppend (local)
+//
+//  Append a NUL-terminated string to the in-memory pool image.  Returns its offset, or
+//  JOURNAL_STR_NONE on failure.
+//
+static uint32_t _journalPoolAppend( const char *s, uint32_t n )
+{
+    char *p;
+    uint32_t ofs;
+
+    if ( _jPoolSize + n + 1 > _jPoolAlloc ) {
+        if ( NULL == (p = (char *) realloc( _jPool, _jPoolAlloc * 2 + n + 65536 ))) return( JOURNAL_STR_NONE );
+        _jPool = p;
+        _jPoolAlloc = _jPoolAlloc * 2 + n + 65536;
+    }
+    ofs = _jPoolSize;
+    memcpy( &_jPool[ofs], s, n );
+    _jPool[ofs + n] = 0;
+    _jPoolSize += n + 1;
+    return( ofs );
+}
+
+
+//  ==============================================================================================
+//  _journalIntern (local)
+//
+//  Returns the string file offset of s, appending it to the string file if it is new.
+//  NULL and empty strings are JOURNAL_STR_NONE.
+//
+static uint32_t _journalIntern( char *s )
+{
+    char clean[JOURNAL_STR_MAX];
+    uint32_t i, mask, ofs;
+
+    if (( s == NULL ) || ( *s == 0 ) || ( _jFp[JOURNAL_F_STR] == NULL )) return( JOURNAL_STR_NONE );
+    strlcpy( clean, s, sizeof( clean ));
+
+    if ( _jSlotCount != 0 ) {
+        mask = _jSlotCount - 1;
+        for ( i = _journalHash( clean ) & mask; _jSlots[i] != 0; i = (i + 1) & mask )
+            if ( 0 == strcmp( &_jPool[ _jSlots[i] - 1 ], clean )) return( _jSlots[i] - 1 );
+    }
+
+    if (( _jPoolSize > JOURNAL_POOL_MAX ) || ( 0 != _journalSlotsGrow() )) return( JOURNAL_STR_NONE );
+    if ( JOURNAL_STR_NONE == (ofs = _journalPoolAppend( clean, (uint32_t) strlen( clean )))) return( JOURNAL_STR_NONE );
+    fwrite( &_jPool[ofs], 1, strlen( clean ) + 1, _jFp[JOURNAL_F_STR] );
+    fflush( _jFp[JOURNAL_F_STR] );                           // on disk before its first record
+    _journalSlotPut( _jSlots, _jSlotCount, _jPool, ofs );
+    _jStrCount++;
+    return( ofs );
+}
+
+
+//  ==============================================================================================
+//  _journalHdr (local)
+//
+static void _journalHdr( char *hdr, int fileNo )
+{
+    uint32_t v[2];
+
+    memset( hdr, 0, JOURNAL_HDR_SIZE );
+    memcpy( hdr, _journalMagic[fileNo], 7 );
+    v[0] = JOURNAL_VERSION;
+    v[1] = ( fileNo == JOURNAL_F_REC ) ? sizeof( journalRec_t ) :
+           ( fileNo == JOURNAL_F_IDX ) ? sizeof( journalIdx_t ) : 1;
+    memcpy( &hdr[8], v, sizeof( v ));
+    return;
+}
+
+
+//  ==============================================================================================
+//  _journalOpenFile (local)
+//
+//  Open one journal file for appending, writing the header if it is new, and returns the
+//  number of whole elements already in it (or -1 on error).  A partial trailing element is
+//  cut off.  For the string file the existing contents are loaded for interning.
+//
+static long long _journalOpenFile( char *baseName, int fileNo )
+{
+    char fileName[JOURNAL_FILENAME_MAX], hdr[JOURNAL_HDR_SIZE], want[JOURNAL_HDR_SIZE];
+    struct stat st;
+    long long elemSize, count = 0, ofs;
+    FILE *fp;
+
+    snprintf( fileName, sizeof( fileName ), "%s%s", baseName, _journalExt[fileNo] );
+    _journalHdr( want, fileNo );
+    elemSize = ( fileNo == JOURNAL_F_REC ) ? sizeof( journalRec_t ) : ( fileNo == JOURNAL_F_IDX ) ? sizeof( journalIdx_t ) : 1;
+
+    if (( 0 == stat( fileName, &st )) && ( st.st_size >= JOURNAL_HDR_SIZE )) {
+        if ( NULL == (fp = fopen( fileName, "rb" ))) return( -1 );
+        if (( 1 != fread( hdr, JOURNAL_HDR_SIZE, 1, fp )) || ( 0 != memcmp( hdr, want, JOURNAL_HDR_SIZE ))) {
+            fclose( fp );
+            logPrintf( LOG_LEVEL_CRITICAL, "journal", "Not a journal file or wrong version ::%s::", fileName );
+            return( -1 );
+        }
+        count = ((long long) st.st_size - JOURNAL_HDR_SIZE) / elemSize;
+        if ( fileNo == JOURNAL_F_STR ) {
+            _jPoolAlloc = (uint32_t) st.st_size + 65536;
+            if ( NULL == (_jPool = (char *) malloc( _jPoolAlloc ))) count = -1;
+            else if ( 1 != fread( &_jPool[JOURNAL_HDR_SIZE], count, 1, fp )) count = ( count == 0 ) ? 0 : -1;
+        }
+        fclose( fp );
+        if ( count < 0 ) return( -1 );
+
+#ifndef _WIN32
+        if ( JOURNAL_HDR_SIZE + count * elemSize != (long long) st.st_size ) {
+            logPrintf( LOG_LEVEL_WARN, "journal", "Dropping partial entry at end of ::%s::", fileName );
+            if ( 0 != truncate( fileName, JOURNAL_HDR_SIZE + count * elemSize )) return( -1 );
+        }
+#endif
+        if ( NULL == (_jFp[fileNo] = fopen( fileName, "ab" ))) return( -1 );
+    }
+    else {
+        if ( NULL == (_jFp[fileNo] = fopen( fileName, "wb" ))) return( -1 );
+        fwrite( want, JOURNAL_HDR_SIZE, 1, _jFp[fileNo] );
+        if ( fileNo == JOURNAL_F_STR ) {
+            _jPoolAlloc = 65536;
+            if ( NULL == (_jPool = (char *) malloc( _jPoolAlloc ))) return( -1 );
+        }
+    }
+
+    // rebuild the intern hash from the string pool image
+    //
+    if ( fileNo == JOURNAL_F_STR ) {
+        memcpy( _jPool, want, JOURNAL_HDR_SIZE );
+        _jPoolSize = (uint32_t) (JOURNAL_HDR_SIZE + count);
+        _jPool[_jPoolSize] = 0;                        // bounds a torn last string (room kept)
+        for ( ofs = JOURNAL_HDR_SIZE; ofs < _jPoolSize; ofs += strlen( &_jPool[ofs] ) + 1 ) {
+            if ( 0 != _journalSlotsGrow() ) return( -1 );
+            _journalSlotPut( _jSlots, _jSlotCount, _jPool, (uint32_t) ofs );
+            _jStrCount++;
+        }
+        if (( count > 0 ) && ( _jPool[_jPoolSize - 1] != 0 )) {         // torn last string
+            _jPool[_jPoolSize] = 0;
+            fputc( 0, _jFp[fileNo] );
+            _jPoolSize++;
+        }
+    }
+    return( count );
+}
+
+
+//  ==============================================================================================
+//  _journalPut (local)
+//
+static void _journalPut( int kind, int code, sid_t steamID, uint32_t str1, uint32_t str2 )
+{
+    journalRec_t rec;
+    journalIdx_t idx;
+
+    if ( _jFp[JOURNAL_F_REC] == NULL ) return;
+
+    memset( &rec, 0, sizeof( rec ));
+    rec.timeMs  = _journalTimeMs();
+    rec.steamID = steamID;
+    rec.kind    = (uint32_t) kind;
+    rec.code    = (int32_t) code;
+    rec.str1    = str1;
+    rec.str2    = str2;
+
+    if ( 0 == (_jRecCount % JOURNAL_INDEX_EVERY)) {
+        idx.timeMs = rec.timeMs;
+        idx.recNo  = _jRecCount;
+        fwrite( &idx, sizeof( idx ), 1, _jFp[JOURNAL_F_IDX] );
+        fflush( _jFp[JOURNAL_F_IDX] );
+    }
+    fwrite( &rec, sizeof( rec ), 1, _jFp[JOURNAL_F_REC] );
+    _jRecCount++;
+    return;
+}
+
+
+//  ==============================================================================================
+//  _journalIndexRebuild (local)
+//
+//  Rewrite the time index from the record file: one entry for the first record of every
+//  JOURNAL_INDEX_EVERY.  Used when the index is out of step with the records (crash
+//  between writes, or a partial record dropped).  Returns 0 on success.
+//
+static int _journalIndexRebuild( char *baseName, long long recCount )
+{
+    char fileName[JOURNAL_FILENAME_MAX], hdr[JOURNAL_HDR_SIZE];
+    journalRec_t rec;
+    journalIdx_t idx;
+    long long recNo;
+    FILE *fpr;
+    int errCode = 0;
+
+    snprintf( fileName, sizeof( fileName ), "%s%s", baseName, _journalExt[JOURNAL_F_REC] );
+    if ( NULL == (fpr = fopen( fileName, "rb" ))) return 1;
+
+    fclose( _jFp[JOURNAL_F_IDX] );
+    snprintf( fileName, sizeof( fileName ), "%s%s", baseName, _journalExt[JOURNAL_F_IDX] );
+    if ( NULL == (_jFp[JOURNAL_F_IDX] = fopen( fileName, "wb" ))) {
+        fclose( fpr );
+        return 1;
+    }
+    _journalHdr( hdr, JOURNAL_F_IDX );
+    fwrite( hdr, JOURNAL_HDR_SIZE, 1, _jFp[JOURNAL_F_IDX] );
+
+    for ( recNo = 0; recNo < recCount; recNo += JOURNAL_INDEX_EVERY ) {
+        if (( 0 != fseek( fpr, (long) (JOURNAL_HDR_SIZE + recNo * (long long) sizeof( rec )), SEEK_SET )) ||
+            ( 1 != fread( &rec, sizeof( rec ), 1, fpr ))) {
+            errCode = 1;
+            break;
+        }
+        idx.timeMs = rec.timeMs;
+        idx.recNo  = (uint64_t) recNo;
+        fwrite( &idx, sizeof( idx ), 1, _jFp[JOURNAL_F_IDX] );
+        fflush( _jFp[JOURNAL_F_IDX] );
+    }
+    fclose( fpr );
+    fflush( _jFp[JOURNAL_F_IDX] );
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  journalOpen
+//
+//  Open (or create) the journal <baseName>.jrn/.jrs/.jri for appending.  An empty baseName
+//  disables the journal; all record calls are then no-ops.  Returns 0 on success.
+//
+int journalOpen( char *baseName )
+{
+    long long recCount, idxCount;
+
+    journalClose();
+    if (( baseName == NULL ) || ( 0 == strlen( baseName ))) return 1;
+
+    recCount = _journalOpenFile( baseName, JOURNAL_F_REC );
+    idxCount = _journalOpenFile( baseName, JOURNAL_F_IDX );
+    if (( recCount < 0 ) || ( idxCount < 0 ) || ( 0 > _journalOpenFile( baseName, JOURNAL_F_STR ))) {
+        logPrintf( LOG_LEVEL_CRITICAL, "journal", "Unable to open journal ::%s::", baseName );
+        journalClose();
+        return 1;
+    }
+    _jRecCount = (uint64_t) recCount;
+
+    // the index must have exactly one entry per JOURNAL_INDEX_EVERY records; an index
+    // out of step (crash between writes) is rebuilt from the record file
+    //
+    if ( idxCount != (recCount + JOURNAL_INDEX_EVERY - 1) / JOURNAL_INDEX_EVERY ) {
+        logPrintf( LOG_LEVEL_WARN, "journal", "Time index out of step (%lld for %lld records), rebuilding",
+            idxCount, recCount );
+        if ( 0 != _journalIndexRebuild( baseName, recCount )) {
+            logPrintf( LOG_LEVEL_CRITICAL, "journal", "Unable to rebuild time index ::%s::", baseName );
+            journalClose();
+            return 1;
+        }
+    }
+
+    _journalPut( JOURNAL_KIND_START, 0, 0, JOURNAL_STR_NONE, JOURNAL_STR_NONE );
+    logPrintf( LOG_LEVEL_CRITICAL, "journal", "Journal %llu records, %u strings in ::%s::",
+        (unsigned long long) _jRecCount, _jStrCount, baseName );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  journalClose
+//
+void journalClose( void )
+{
+    int i;
+
+    journalFlush();
+    for ( i=0; i<3; i++ ) {
+        if ( _jFp[i] != NULL ) fclose( _jFp[i] );
+        _jFp[i] = NULL;
+    }
+    free( _jPool );   _jPool = NULL;   _jPoolSize = _jPoolAlloc = 0;
+    free( _jSlots );  _jSlots = NULL;  _jSlotCount = _jStrCount = 0;
+    _jRecCount = 0;
+    return;
+}
+
+
+//  ==============================================================================================
+//  journalFlush
+//
+//  Push buffered entries to disk - strings and index first, then records
+//
+void journalFlush( void )
+{
+    if ( _jFp[JOURNAL_F_REC] == NULL ) return;
+    fflush( _jFp[JOURNAL_F_STR] );
+    fflush( _jFp[JOURNAL_F_IDX] );
+    fflush( _jFp[JOURNAL_F_REC] );
+    return;
+}
+
+
+//  ==============================================================================================
+//  journalEvent
+//
+//  Record a dispatched event, with an optional detail string (e.g., map name)
+//
+void journalEvent( int eventID, char *detail )
+{
+    if ( _jFp[JOURNAL_F_REC] == NULL ) return;
+    _journalPut( JOURNAL_KIND_EVENT, eventID, 0, _journalIntern( detail ), JOURNAL_STR_NONE );
+    return;
+}
+
+
+//  ==============================================================================================
+//  journalRcon
+//
+//  Record an RCON command and its status.  Only the command verb is kept (not free text
+//  such as 'say' messages); a SteamID64 argument, if any, goes in the record.
+//
+void journalRcon( char *rconCmd, int status )
+{
+    char verb[32], word[SID_STRLEN+1];
+    sid_t steamID = 0;
+    size_t n;
+
+    if ( _jFp[JOURNAL_F_REC] == NULL ) return;
+
+    n = strcspn( rconCmd, " " );
+    if ( n >= sizeof( verb )) n = sizeof( verb ) - 1;
+    memcpy( verb, rconCmd, n );
+    verb[n] = 0;
+
+    rconCmd += strcspn( rconCmd, " " );
+    rconCmd += strspn( rconCmd, " " );
+    if ( SID_STRLEN == strcspn( rconCmd, " " )) {
+        memcpy( word, rconCmd, SID_STRLEN );
+        word[SID_STRLEN] = 0;
+        steamID = sidParse( word );
+    }
+    _journalPut( JOURNAL_KIND_RCON, status, steamID, _journalIntern( verb ), JOURNAL_STR_NONE );
+    return;
+}
+
+
+//  ==============================================================================================
+//  journalRoster
+//
+//  Record a player joining (JOURNAL_KIND_JOIN) or leaving (JOURNAL_KIND_LEAVE)
+//
+void journalRoster( int kind, char *playerGUID, char *playerName, char *playerIP )
+{
+    if ( _jFp[JOURNAL_F_REC] == NULL ) return;
+    _journalPut( kind, 0, sidParse( playerGUID ), _journalIntern( playerName ), _journalIntern( playerIP ));
+    return;
+}
+
+
+//  ==============================================================================================
+//  journalAction
+//
+//  Record an action taken by sissm or a plugin (kick, ban, say...).  playerGUID may be NULL.
+//
+void journalAction( char *action, char *playerGUID, char *detail )
+{
+    if ( _jFp[JOURNAL_F_REC] == NULL ) return;
+    _journalPut( JOURNAL_KIND_ACTION, 0, sidParse( playerGUID ), _journalIntern( action ), _journalIntern( detail ));
+    return;
+}
+
+
+//  ==============================================================================================
+//  _journalMap (local)
+//
+//  Map (Linux) or read (Windows) one whole journal file.  Returns NULL on error.
+//
+static void *_journalMap( char *baseName, int fileNo, size_t *size )
+{
+    char fileName[JOURNAL_FILENAME_MAX], want[JOURNAL_HDR_SIZE];
+    struct stat st;
+    void *p;
+
+    snprintf( fileName, sizeof( fileName ), "%s%s", baseName, _journalExt[fileNo] );
+    if (( 0 != stat( fileName, &st )) || ( st.st_size < JOURNAL_HDR_SIZE )) return( NULL );
+    *size = (size_t) st.st_size;
+
+#ifdef _WIN32
+    FILE *fpr;
+
+    if ( NULL == (p = malloc( *size ))) return( NULL );
+    if ( NULL == (fpr = fopen( fileName, "rb" ))) { free( p ); return( NULL ); }
+    if ( 1 != fread( p, *size, 1, fpr )) { free( p ); p = NULL; }
+    fclose( fpr );
+    if ( p == NULL ) return( NULL );
+#else
+    int fd;
+
+    if ( 0 > (fd = open( fileName, O_RDONLY ))) return( NULL );
+    p = mmap( NULL, *size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( p == MAP_FAILED ) return( NULL );
+#endif
+
+    _journalHdr( want, fileNo );
+    if ( 0 != memcmp( p, want, JOURNAL_HDR_SIZE )) {
+#ifdef _WIN32
+        free( p );
+#else
+        munmap( p, *size );
+#endif
+        return( NULL );
+    }
+    return( p );
+}
+
+
+//  ==============================================================================================
+//  journalReadOpen
+//
+//  Open a journal read-only.  May be used while sissm is appending to it; the view covers
+//  what was on disk at the time of the call.  Returns 0 on success.
+//
+int journalReadOpen( char *baseName, journalReader_t *jr )
+{
+    int i;
+
+    memset( jr, 0, sizeof( journalReader_t ));
+    for ( i=0; i<3; i++ ) {
+        if ( NULL == (jr->map[i] = _journalMap( baseName, i, &jr->mapSize[i] ))) {
+            journalReadClose( jr );
+            return 1;
+        }
+    }
+    jr->recs     = (journalRec_t *) ((char *) jr->map[JOURNAL_F_REC] + JOURNAL_HDR_SIZE);
+    jr->recCount = (jr->mapSize[JOURNAL_F_REC] - JOURNAL_HDR_SIZE) / sizeof( journalRec_t );
+    jr->strs     = (char *) jr->map[JOURNAL_F_STR];
+    jr->strSize  = jr->mapSize[JOURNAL_F_STR];
+    jr->idx      = (journalIdx_t *) ((char *) jr->map[JOURNAL_F_IDX] + JOURNAL_HDR_SIZE);
+    jr->idxCount = (jr->mapSize[JOURNAL_F_IDX] - JOURNAL_HDR_SIZE) / sizeof( journalIdx_t );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  journalReadClose
+//
+void journalReadClose( journalReader_t *jr )
+{
+    int i;
+
+    for ( i=0; i<3; i++ ) {
+        if ( jr->map[i] == NULL ) continue;
+#ifdef _WIN32
+        free( jr->map[i] );
+#else
+        munmap( jr->map[i], jr->mapSize[i] );
+#endif
+    }
+    memset( jr, 0, sizeof( journalReader_t ));
+    return;
+}
+
+
+//  ==============================================================================================
+//  journalReadSeek
+//
+//  Returns the number of the first record at or after timeMs (recCount if none).  The time
+//  index narrows the search to one block, which is then searched in the records.
+//
+uint64_t journalReadSeek( journalReader_t *jr, uint64_t timeMs )
+{
+    uint64_t lo = 0, hi = jr->idxCount, mid, recLo = 0, recHi = jr->recCount;
+
+    // last index entry before timeMs
+    //
+    while ( lo < hi ) {
+        mid = (lo + hi) / 2;
+        if ( jr->idx[mid].timeMs < timeMs ) lo = mid + 1;
+        else hi = mid;
+    }
+    if ( lo > 0 ) recLo = jr->idx[lo - 1].recNo;
+    if (( lo < jr->idxCount ) && ( jr->idx[lo].recNo < recHi )) recHi = jr->idx[lo].recNo;
+    if ( recLo > recHi ) recLo = recHi;
+
+    while ( recLo < recHi ) {
+        mid = (recLo + recHi) / 2;
+        if ( jr->recs[mid].timeMs < timeMs ) recLo = mid + 1;
+        else recHi = mid;
+    }
+    return( recLo );
+}
+
+
+//  ==============================================================================================
+//  journalReadStr
+//
+//  Returns the interned string at strOfs, or "" if none or out of range
+//
+char *journalReadStr( journalReader_t *jr, uint32_t strOfs )
+{
+    if (( strOfs == JOURNAL_STR_NONE ) || ( strOfs < JOURNAL_HDR_SIZE ) || ( strOfs >= jr->strSize )) return( "" );
+    if ( NULL == memchr( &jr->strs[strOfs], 0, jr->strSize - strOfs )) return( "" );
+    return( &jr->strs[strOfs] );
+}
+
@@ -0,0 +1,75 @@
+//  ==============================================================================================
+//
+//  Module: JOURNAL
+//
+//  Description:
+//  Append-only binary event journal (fixed records, interned strings, time index)
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JOURNAL_KIND_START      (0)                  // sissm started, online roster is empty
+#define JOURNAL_KIND_EVENT      (1)                       // code=SISSM_EV_*, str1=map (if any)
+#define JOURNAL_KIND_RCON       (2)                       // code=status, str1=command verb
+#define JOURNAL_KIND_JOIN       (3)                               // str1=name, str2=IP
+#define JOURNAL_KIND_LEAVE      (4)                               // str1=name, str2=IP
+#define JOURNAL_KIND_ACTION     (5)                           // str1=action, str2=detail
+
+#define JOURNAL_STR_NONE        (0xffffffffu)
+
+#define JOURNAL_INDEX_EVERY     (256)                 // records per time index entry
+
+//  On-disk record, native byte order
+//
+typedef struct {
+
+    uint64_t timeMs;                                             // epoch milliseconds
+    uint64_t steamID;                                                    // 0 if none
+    uint32_t kind;
+    int32_t  code;
+    uint32_t str1, str2;                                 // string file offsets or NONE
+
+} journalRec_t;
+
+typedef struct {
+
+    uint64_t timeMs;
+    uint64_t recNo;
+
+} journalIdx_t;
+
+//  Read-only view of a journal (mapped files)
+//
+typedef struct {
+
+    journalRec_t *recs;
+    uint64_t      recCount;
+    char         *strs;
+    uint64_t      strSize;
+    journalIdx_t *idx;
+    uint64_t      idxCount;
+    void         *map[3];
+    size_t        mapSize[3];
+
+} journalReader_t;
+
+extern int  journalOpen( char *baseName );
+extern void journalClose( void );
+extern void journalFlush( void );
+extern void journalEvent( int eventID, char *detail );
+extern void journalRcon( char *rconCmd, int status );
+extern void journalRoster( int kind, char *playerGUID, char *playerName, char *playerIP );
+extern void journalAction( char *action, char *playerGUID, char *detail );
+
+extern int  journalReadOpen( char *baseName, journalReader_t *jr );
+extern void journalReadClose( journalReader_t *jr );
+extern uint64_t journalReadSeek( journalReader_t *jr, uint64_t timeMs );
+extern char *journalReadStr( journalReader_t *jr, uint32_t strOfs );
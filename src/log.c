@@ -5,6 +5,24 @@
 //  Description:
 //  Generic file logger with adjustible severity level
 //
+//  Messages below the configured severity are rejected before any formatting is done.
+//  Accepted lines are stamped (the timestamp string is built once per second), formatted
+//  by the caller, and copied into a multi-producer/single-consumer byte ring.  A writer
+//  thread drains the ring to the log file in batches, so that disk latency never holds up
+//  event dispatch or RCON traffic.  logPrintf() may be called from any thread without a
+//  lock: each producer reserves its record with a compare-and-swap on the ring head, copies
+//  the line in, then publishes the record length in the record header; the writer stops at
+//  the first header not yet published.  The timestamp cache is per thread.  Only opening the
+//  file and the synchronous path (no writer thread) take a lock.
+//
+//  On Windows the lines are written synchronously, as before.
+//
+//  The log file can be rotated by size and/or age: the file is renamed with a timestamp
+//  suffix (sissm.log.20190814-120000) and a new one is opened, so no line is lost as with
+//  an external copytruncate.  On Linux, rotated files are compressed with the built-in gzip
+//  encoder (no gzip binary needed) and only the newest logRotateKeep of them are kept.  All
+//  of it is done by the writer thread; lines logged meanwhile wait in the ring.
+//
 //  Original Author:
 //  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
 //
@@ -13,26 +31,85 @@
 //
 //  ==============================================================================================
 
+#define _GNU_SOURCE                                          // required for statx file birth time
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <fcntl.h>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+#include "gzip.h"
 #include "log.h"
 
 //  ==============================================================================================
-//  Data definition 
+//  Data definition
 //
 
 #define LOG_MAXSTRINGSIZE    (4096)
 #define LOG_MAXFILENAMESTR   ( 255)
+#define LOG_RING_SIZE        (1024*1024)            // bytes of pending log text, power of 2
 
-static char _logFileName[LOG_MAXFILENAMESTR];
+static char _logFileName[LOG_MAXFILENAMESTR];                // guarded by _logPutLock on Linux
 static int  _logEchoToConsole = 0;
 static int  _logLevel = 0;
 
+static FILE  *_logFpw = NULL;
+static long long _logBytes = 0;                                  // current log file size
+static time_t _logOpenTime = 0;                           // creation time of the current file
+
+static struct {
+
+    long long maxBytes;                                           // rotate at size, 0 = off
+    long      maxAgeSec;                                           // rotate at age, 0 = off
+    int       keepCount;                               // rotated files kept, 0 = keep all
+    int       compress;                                         // 1 = gzip rotated files
+
+} _logRotate;
+
+#ifdef _WIN32
+#define LOG_THREAD_LOCAL                                           // synchronous: one thread
+#else
+#define LOG_THREAD_LOCAL     _Thread_local
+#endif
+
+static LOG_THREAD_LOCAL time_t _logTimeCached = 0;        // second of _logTimeBuffer content
+static LOG_THREAD_LOCAL char   _logTimeBuffer[26];
+
+#ifndef _WIN32
+//  Ring records: a 4-byte header holding the line length (0 = reserved but not yet written),
+//  then the line, padded to a multiple of 4 so that headers never straddle the ring end.
+//  Free ring space is all zeroes.
+//
+#define LOG_REC_SIZE( len )  ( 4 + (((len) + 3) & ~(size_t) 3) )
+
+static _Alignas( 4 ) char _logRing[LOG_RING_SIZE];
+static atomic_size_t _logHead = 0;         // free-running byte counts: reserved by producers
+static atomic_size_t _logTail = 0;                               // ... and freed by the writer
+static atomic_int    _logStop = 0;
+static atomic_ulong  _logDropped = 0;                  // lines lost to a full ring (callers)
+static sem_t         _logSem;
+static pthread_t     _logThread;
+static atomic_int    _logThreadRunning = 0;
+static pthread_mutex_t _logRotateLock = PTHREAD_MUTEX_INITIALIZER;     // _logRotate settings
+static pthread_mutex_t _logPutLock = PTHREAD_MUTEX_INITIALIZER; // file name, open, sync writes
+
+#define LOG_GZIP_CHUNK       (1024*1024)       // rotated file bytes per gzip member written
+#endif
+
 
 //  ==============================================================================================
 //  logPrintfInit
@@ -41,13 +118,422 @@ static int  _logLevel = 0;
 //
 void logPrintfInit( int logLevel, char *logFileName, int echoToConsole )
 {
+#ifndef _WIN32
+    pthread_mutex_lock( &_logPutLock );                   // the writer thread reads the name
+#endif
     strncpy( _logFileName, logFileName, sizeof( _logFileName) );
+    _logFileName[ sizeof( _logFileName ) - 1 ] = 0;
+#ifndef _WIN32
+    pthread_mutex_unlock( &_logPutLock );
+#endif
     _logEchoToConsole = echoToConsole;
     _logLevel = logLevel;
     return;
 }
 
 
+//  ==============================================================================================
+//  logRotateInit
+//
+//  Set the log rotation policy: rotate when the file reaches maxBytes or is maxAgeSec old
+//  (0 disables either), keep keepCount rotated files (0 = all), and gzip them if compress
+//  is set.  May be called again at any time to change the policy.
+//
+void logRotateInit( long long maxBytes, long maxAgeSec, int keepCount, int compress )
+{
+#ifndef _WIN32
+    pthread_mutex_lock( &_logRotateLock );
+#endif
+    _logRotate.maxBytes  = maxBytes;
+    _logRotate.maxAgeSec = maxAgeSec;
+    _logRotate.keepCount = keepCount;
+    _logRotate.compress  = compress;
+#ifndef _WIN32
+    pthread_mutex_unlock( &_logRotateLock );
+#endif
+    return;
+}
+
+
+#ifndef _WIN32
+//  ==============================================================================================
+//  _logGzip (local, writer thread)
+//
+//  Compress fileName to fileName.gz and delete it.  The file is read in LOG_GZIP_CHUNK pieces,
+//  each written as one gzip member: gunzip and zcat read consecutive members as one stream,
+//  so memory stays bounded whatever the log size.  On error the file is left uncompressed.
+//
+static void _logGzip( char *fileName )
+{
+    char gzName[LOG_MAXFILENAMESTR+48];
+    unsigned char *in, *out;
+    size_t n, outLen, outMax = LOG_GZIP_CHUNK + LOG_GZIP_CHUNK / 8 + 64;        // worst case
+    FILE *fpr = NULL, *fpw = NULL;
+    int ok = 0;
+
+    snprintf( gzName, sizeof( gzName ), "%s.gz", fileName );
+    in  = (unsigned char *) malloc( LOG_GZIP_CHUNK );
+    out = (unsigned char *) malloc( outMax );
+
+    if (( in != NULL ) && ( out != NULL ) && ( NULL != (fpr = fopen( fileName, "rb" ))) &&
+        ( NULL != (fpw = fopen( gzName, "wb" )))) {
+        ok = 1;
+        while ( ok && ( 0 < (n = fread( in, 1, LOG_GZIP_CHUNK, fpr )))) {
+            outLen = gzipEncode( in, n, out, outMax );
+            ok = ( outLen != 0 ) && ( outLen == fwrite( out, 1, outLen, fpw ));
+        }
+        if ( ferror( fpr )) ok = 0;
+    }
+    if ( fpr != NULL ) fclose( fpr );
+    if (( fpw != NULL ) && ( 0 != fclose( fpw ))) ok = 0;
+    free( in );
+    free( out );
+
+    if ( ok ) unlink( fileName );
+    else if ( fpw != NULL ) unlink( gzName );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _logNameCmp (local)
+//
+static int _logNameCmp( const void *a, const void *b )
+{
+    return( strcmp( *(char **) a, *(char **) b ));
+}
+
+
+//  ==============================================================================================
+//  _logPrune (local, writer thread)
+//
+//  Delete the oldest rotated files so that at most keepCount remain.  Rotated files are
+//  "<logfile>.YYYYmmdd-HHMMSS[.gz]", so name order is age order.  A file whose compression
+//  was cut short (sissm killed) is on disk both with and without ".gz" and is counted (and
+//  deleted) once.
+//
+static void _logPrune( int keepCount, char *logFileName )
+{
+    char dirName[LOG_MAXFILENAMESTR], path[2*LOG_MAXFILENAMESTR+5], *baseName, **names = NULL, **p;
+    size_t baseLen, n;
+    int i, j, count = 0, size = 0;
+    DIR *dir;
+    struct dirent *de;
+
+    strncpy( dirName, logFileName, sizeof( dirName ));
+    dirName[ sizeof( dirName ) - 1 ] = 0;
+    if ( NULL != (baseName = strrchr( dirName, '/' ))) {
+        *baseName++ = 0;
+    }
+    else {
+        baseName = dirName;
+    }
+    baseLen = strlen( baseName );
+    if ( NULL == (dir = opendir( (baseName == dirName) ? "." : dirName ))) return;
+
+    while ( NULL != (de = readdir( dir ))) {
+        if (( 0 != strncmp( de->d_name, baseName, baseLen )) || ( de->d_name[baseLen] != '.' ) ||
+            ( de->d_name[baseLen+1] < '0' ) || ( de->d_name[baseLen+1] > '9' )) continue;
+        if ( count == size ) {
+            size = size ? size * 2 : 64;
+            if ( NULL == (p = (char **) realloc( names, size * sizeof( char * )))) break;
+            names = p;
+        }
+        if ( NULL != (names[count] = strdup( de->d_name ))) {
+            if (( (n = strlen( names[count] )) > 3 ) && ( 0 == strcmp( &names[count][n-3], ".gz" )))
+                names[count][n-3] = 0;
+            count++;
+        }
+    }
+    closedir( dir );
+
+    // sort, then drop the duplicate base name of a file being compressed
+    //
+    qsort( names, count, sizeof( char * ), _logNameCmp );
+    for ( i=0, j=0; i<count; i++ ) {
+        if (( j > 0 ) && ( 0 == strcmp( names[j-1], names[i] ))) free( names[i] );
+        else names[j++] = names[i];
+    }
+    count = j;
+
+    for ( i=0; i<count; i++ ) {
+        if ( i < count - keepCount ) {
+            if ( baseName == dirName ) snprintf( path, sizeof( path ), "%s", names[i] );
+            else snprintf( path, sizeof( path ), "%s/%s", dirName, names[i] );
+            unlink( path );
+            strncat( path, ".gz", sizeof( path ) - strlen( path ) - 1 );
+            unlink( path );
+        }
+        free( names[i] );
+    }
+    free( names );
+    return;
+}
+#endif
+
+
+//  ==============================================================================================
+//  _logRotateCheck (local, writer)
+//
+//  Rotate the log file if it is due by size or age.  Called by whoever writes the file: the
+//  writer thread, or the caller on Windows.  logFileName is the caller's copy of the name,
+//  which a configuration reload may change meanwhile.
+//
+static void _logRotateCheck( char *logFileName )
+{
+    char stamp[32], rotName[LOG_MAXFILENAMESTR+40];
+    time_t timeNow;
+    struct tm tmNow;
+    struct stat st;
+    FILE *fpw;
+    long long maxBytes;
+    long maxAgeSec;
+    int i, keepCount, compress;
+
+#ifndef _WIN32
+    pthread_mutex_lock( &_logRotateLock );
+#endif
+    maxBytes = _logRotate.maxBytes;  maxAgeSec = _logRotate.maxAgeSec;
+    keepCount = _logRotate.keepCount;  compress = _logRotate.compress;
+#ifndef _WIN32
+    pthread_mutex_unlock( &_logRotateLock );
+#endif
+
+    timeNow = time( NULL );
+    if ((( maxBytes  == 0 ) || ( _logBytes < maxBytes )) &&
+        (( maxAgeSec == 0 ) || ( timeNow - _logOpenTime < maxAgeSec ))) return;
+
+    // pick a name not already taken (several rotations within one second)
+    //
+#ifdef _WIN32
+    tmNow = *localtime( &timeNow );
+#else
+    localtime_r( &timeNow, &tmNow );
+#endif
+    strftime( stamp, sizeof( stamp ), "%Y%m%d-%H%M%S", &tmNow );
+    snprintf( rotName, sizeof( rotName ), "%s.%s", logFileName, stamp );
+    for ( i=1; ( i<100 ) && ( 0 == stat( rotName, &st )); i++ )
+        snprintf( rotName, sizeof( rotName ), "%s.%s-%02d", logFileName, stamp, i );
+
+    fclose( _logFpw );
+    if ( 0 != rename( logFileName, rotName )) strncpy( rotName, "", sizeof( rotName ));
+    if ( NULL == (fpw = fopen( logFileName, "at" ))) {
+        fprintf( stderr, "Module log.c:  Logfile reopen error after rotate, filename '%s'\n", logFileName );
+        fpw = fopen( ( 0 != strlen( rotName )) ? rotName : logFileName, "at" );
+    }
+    _logFpw = ( fpw != NULL ) ? fpw : stderr;
+    _logBytes = 0;
+    _logOpenTime = timeNow;
+
+#ifndef _WIN32
+    if (( 0 != strlen( rotName )) && compress ) _logGzip( rotName );
+    if ( keepCount > 0 ) _logPrune( keepCount, logFileName );
+#endif
+    return;
+}
+
+
+#ifndef _WIN32
+//  ==============================================================================================
+//  _logDrain (local, writer thread)
+//
+//  Write everything currently in the ring to the log file with as few writes as possible
+//
+static void _logDrain( void )
+{
+    char logFileName[LOG_MAXFILENAMESTR];
+    uint32_t *hdr, len;
+    size_t tail, i, n;
+
+    tail = atomic_load_explicit( &_logTail, memory_order_relaxed );
+    hdr = (uint32_t *) &_logRing[ tail & (LOG_RING_SIZE - 1) ];
+    if ( 0 == __atomic_load_n( hdr, __ATOMIC_ACQUIRE )) return;
+
+    // write published records in order, up to the first one still being written
+    //
+    while ( 0 != (len = __atomic_load_n( hdr, __ATOMIC_ACQUIRE ))) {
+        i = (tail + 4) & (LOG_RING_SIZE - 1);
+        n = ( len > LOG_RING_SIZE - i ) ? LOG_RING_SIZE - i : len;           // up to the wrap
+        fwrite( &_logRing[i], 1, n, _logFpw );
+        fwrite( &_logRing[0], 1, len - n, _logFpw );
+        if ( _logEchoToConsole ) {
+            fwrite( &_logRing[i], 1, n, stdout );
+            fwrite( &_logRing[0], 1, len - n, stdout );
+        }
+        _logBytes += len;
+
+        // zero the whole record: a later header may land anywhere in it, and must read 0 until
+        // its producer publishes it.  The tail release makes the zeroes visible to producers.
+        //
+        i = tail & (LOG_RING_SIZE - 1);
+        n = LOG_REC_SIZE( len );
+        if ( n > LOG_RING_SIZE - i ) {
+            memset( &_logRing[i], 0, LOG_RING_SIZE - i );
+            memset( &_logRing[0], 0, n - (LOG_RING_SIZE - i) );
+        }
+        else {
+            memset( &_logRing[i], 0, n );
+        }
+        tail += n;
+        atomic_store_explicit( &_logTail, tail, memory_order_release );
+        hdr = (uint32_t *) &_logRing[ tail & (LOG_RING_SIZE - 1) ];
+    }
+    fflush( _logFpw );
+    if ( _logEchoToConsole ) fflush( stdout );
+
+    pthread_mutex_lock( &_logPutLock );
+    strncpy( logFileName, _logFileName, sizeof( logFileName ));
+    pthread_mutex_unlock( &_logPutLock );
+    _logRotateCheck( logFileName );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _logWriterThread (local)
+//
+static void *_logWriterThread( void *arg )
+{
+    while ( !atomic_load( &_logStop )) {
+        while ( 0 != sem_wait( &_logSem )) ;                                 // EINTR retries
+        _logDrain();
+    }
+    _logDrain();
+    return( NULL );
+}
+
+
+//  ==============================================================================================
+//  logFlush
+//
+//  Write out everything queued and stop the writer thread.  Registered with atexit() so that
+//  no lines are lost on a normal exit.  Later log lines are written synchronously.
+//
+void logFlush( void )
+{
+    if ( atomic_load( &_logThreadRunning )) {
+        atomic_store( &_logThreadRunning, 0 );
+        atomic_store( &_logStop, 1 );
+        sem_post( &_logSem );
+        pthread_join( _logThread, NULL );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _logPut (local)
+//
+//  Reserve a ring record for one line, copy it in and publish it.  Returns 1 if the ring
+//  is full (nothing written), else 0.
+//
+static int _logPut( const char *line, size_t len )
+{
+    size_t head, tail, need = LOG_REC_SIZE( len ), i, n;
+
+    head = atomic_load_explicit( &_logHead, memory_order_relaxed );
+    do {
+        tail = atomic_load_explicit( &_logTail, memory_order_acquire );
+        if ( LOG_RING_SIZE - (head - tail) < need ) return 1;
+    } while ( !atomic_compare_exchange_weak_explicit( &_logHead, &head, head + need,
+                  memory_order_relaxed, memory_order_relaxed ));
+
+    i = (head + 4) & (LOG_RING_SIZE - 1);
+    n = ( len > LOG_RING_SIZE - i ) ? LOG_RING_SIZE - i : len;
+    memcpy( &_logRing[i], line, n );
+    memcpy( &_logRing[0], line + n, len - n );
+
+    __atomic_store_n( (uint32_t *) &_logRing[ head & (LOG_RING_SIZE - 1) ], (uint32_t) len, __ATOMIC_RELEASE );
+    sem_post( &_logSem );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _logEnqueue (local)
+//
+//  Queue one formatted line for the writer.  Never blocks: if the writer has fallen this far
+//  behind, the line is dropped and counted, and the count is reported ahead of a later line
+//  that fits.
+//
+static void _logEnqueue( char *line, size_t len )
+{
+    char dropNotice[80];
+    unsigned long dropped;
+    size_t n;
+
+    if (( 0 != atomic_load_explicit( &_logDropped, memory_order_relaxed )) &&
+        ( 0 != (dropped = atomic_exchange( &_logDropped, 0 )))) {
+        n = snprintf( dropNotice, sizeof( dropNotice ), "%s::log::%lu lines dropped, writer behind\n",
+            _logTimeBuffer, dropped );
+        if ( 0 != _logPut( dropNotice, n )) atomic_fetch_add( &_logDropped, dropped );
+    }
+
+    if ( 0 != _logPut( line, len )) atomic_fetch_add( &_logDropped, 1 );
+    return;
+}
+#else
+void logFlush( void )
+{
+    return;
+}
+#endif
+
+
+//  ==============================================================================================
+//  _logCreated (local)
+//
+//  Returns when an open log file was created, so that its rotation age carries over sissm
+//  restarts.  Linux file systems that do not record a birth time report now.
+//
+static time_t _logCreated( FILE *fp )
+{
+    time_t created = time( NULL );
+#ifdef _WIN32
+    struct stat st;
+
+    if (( 0 == fstat( _fileno( fp ), &st )) && ( st.st_ctime < created ))     // creation time
+        created = st.st_ctime;
+#else
+    struct statx stx;
+
+    if (( 0 == statx( fileno( fp ), "", AT_EMPTY_PATH, STATX_BTIME, &stx )) &&
+        ( 0 != (stx.stx_mask & STATX_BTIME)) && ( stx.stx_btime.tv_sec < created ))
+        created = (time_t) stx.stx_btime.tv_sec;
+#endif
+    return( created );
+}
+
+
+//  ==============================================================================================
+//  _logOpen (local)
+//
+//  Open the log file on first use and start the writer.  Exits if the file cannot be created.
+//
+static void _logOpen( void )
+{
+    _logFpw = fopen( _logFileName, "at" );
+
+    if ( _logFpw == NULL ) {
+        printf( "Module log.c:  Logfile creation error, filename '%s'\n", _logFileName );
+        exit( 1 );
+    }
+    fseek( _logFpw, 0, SEEK_END );
+    _logBytes = (long long) ftell( _logFpw );
+    _logOpenTime = _logCreated( _logFpw );
+
+#ifndef _WIN32
+    if ( 0 == sem_init( &_logSem, 0, 0 )) {
+        if ( 0 == pthread_create( &_logThread, NULL, _logWriterThread, NULL )) {
+            atomic_store( &_logThreadRunning, 1 );
+            atexit( logFlush );
+        }
+    }
+#endif
+    return;
+}
+
+
 //  ==============================================================================================
 //  logPrintf
 //
@@ -58,34 +544,57 @@ void logPrintfInit( int logLevel, char *logFileName, int echoToConsole )
 void logPrintf( int logLevel, char *ident, const char * format, ... )
 {
     time_t timer;
-    char timeBuffer[26];
-    struct tm* tm_info;
-    static char buffer[LOG_MAXSTRINGSIZE];
-    static FILE *fpw = NULL;
-
-    time( &timer );
-    tm_info = localtime( &timer );
-    strftime( timeBuffer, 26, "%Y-%m-%d %H:%M:%S", tm_info );
+    struct tm tmLocal;
+    char buffer[LOG_MAXSTRINGSIZE];
+    int n, m;
+    va_list args;
 
-    if ( fpw == NULL ) 
-        fpw = fopen( _logFileName, "at" );
+    if ( logLevel > _logLevel ) return;                      // filtered: do no work at all
 
-    if ( fpw == NULL ) {
-        printf( "Module log.c:  Logfile creation error, filename '%s'\n", _logFileName ); 
-        exit( 1 );
+    time( &timer );
+    if ( timer != _logTimeCached ) {
+        _logTimeCached = timer;
+#ifdef _WIN32
+        localtime_s( &tmLocal, &timer );
+#else
+        localtime_r( &timer, &tmLocal );
+#endif
+        strftime( _logTimeBuffer, sizeof( _logTimeBuffer ), "%Y-%m-%d %H:%M:%S", &tmLocal );
     }
 
-    va_list args;
+    n = snprintf( buffer, LOG_MAXSTRINGSIZE, "%s::%s::", _logTimeBuffer, ident );
+    if ( n >= LOG_MAXSTRINGSIZE - 1 ) n = LOG_MAXSTRINGSIZE - 2;
     va_start( args, format );
-    vsnprintf( buffer, LOG_MAXSTRINGSIZE, format, args );
+    m = vsnprintf( &buffer[n], LOG_MAXSTRINGSIZE - n - 1, format, args );
+    va_end( args );
+    if (( m < 0 ) || ( m >= LOG_MAXSTRINGSIZE - n - 1 )) m = (int) strlen( &buffer[n] );
+    n += m;
+    buffer[n++] = '\n';
+    buffer[n] = 0;
 
-    if ( fpw != NULL ) {
-        if ( logLevel <= _logLevel ) { 
-            fprintf( fpw, "%s::%s::%s\n", timeBuffer, ident, buffer );
-            fflush( fpw );
-            if ( _logEchoToConsole ) printf( "%s::%s::%s\n", timeBuffer, ident, buffer );
-        }
+#ifndef _WIN32
+    if ( atomic_load_explicit( &_logThreadRunning, memory_order_acquire )) {
+        _logEnqueue( buffer, n );                                      // lock-free fast path
+        return;
     }
-    va_end (args);
+    pthread_mutex_lock( &_logPutLock );
+    if ( _logFpw == NULL ) _logOpen();
+    if ( atomic_load( &_logThreadRunning )) {                       // started by _logOpen
+        _logEnqueue( buffer, n );
+        pthread_mutex_unlock( &_logPutLock );
+        return;
+    }
+#else
+    if ( _logFpw == NULL ) _logOpen();
+#endif
+    fputs( buffer, _logFpw );
+    fflush( _logFpw );
+    if ( _logEchoToConsole ) fputs( buffer, stdout );
+    _logBytes += n;
+    _logRotateCheck( _logFileName );
+#ifndef _WIN32
+    pthread_mutex_unlock( &_logPutLock );
+#endif
+    return;
 }
 
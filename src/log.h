@@ -24,6 +24,8 @@
 
 extern void logPrintfInit( int logLevel, char *logFileName, int echoToConsole );
 extern void logPrintf( int logLevel, char *ident, const char * format, ... );
+extern void logFlush( void );
+extern void logRotateInit( long long maxBytes, long maxAgeSec, int keepCount, int compress );
 
 
 
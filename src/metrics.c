@@ -0,0 +1,253 @@
+//  ==============================================================================================
+//
+//  Module: METRICS
+//
+//  Description:
+//  Counters, gauges and histograms of sissm internals, rendered in Prometheus text format
+//
+//  Modules register their metrics once (at init, or the first time a label value is seen)
+//  and keep the returned pointer; recording is then a relaxed atomic add on that object,
+//  with no lookup and no lock (metricsInc/metricsAdd/metricsSet macros in metrics.h).  A
+//  histogram observation is a bucket search over a few bounds plus three atomic adds.
+//  Metrics are never unregistered.  Registration never fails: if out of memory, a shared
+//  scratch object is returned, so callers need not check.
+//
+//  metricsRender() produces the Prometheus text exposition format (version 0.0.4); sissm
+//  serves it on /metrics when sissm.metricsPort or a Unix socket sissm.metricsBind is set.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "bsd.h"
+#include "util.h"
+#include "metrics.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+static metricsObj *metricsFirst = NULL, *metricsLast = NULL;                    // registry
+static metricsObj  metricsScratch;                              // returned if out of memory
+
+#ifndef _WIN32
+static pthread_mutex_t metricsLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+//  Default latency buckets: 100us to 10s
+//
+static const uint64_t metricsDefaultBoundsUs[] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000, 10000000 };
+
+
+//  ==============================================================================================
+//  metricsNowUs
+//
+//  Monotonic clock in microseconds, for measuring durations.
+//
+uint64_t metricsNowUs( void )
+{
+#ifdef _WIN32
+    LARGE_INTEGER count, freq;
+
+    QueryPerformanceCounter( &count );
+    QueryPerformanceFrequency( &freq );
+    return( (uint64_t) (count.QuadPart / (freq.QuadPart / 1000000)) );
+#else
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000 );
+#endif
+}
+
+
+//  ==============================================================================================
+//  _metricsRegister (local)
+//
+static metricsObj *_metricsRegister( int type, char *name, char *help, char *labels )
+{
+    metricsObj *mPtr;
+
+    if ( NULL == (mPtr = (metricsObj *) calloc( 1, sizeof( metricsObj )))) return( &metricsScratch );
+
+    mPtr->type = type;
+    strlcpy( mPtr->name,   name,   sizeof( mPtr->name ));
+    strlcpy( mPtr->help,   help,   sizeof( mPtr->help ));
+    strlcpy( mPtr->labels, labels, sizeof( mPtr->labels ));
+
+#ifndef _WIN32
+    pthread_mutex_lock( &metricsLock );
+#endif
+    if ( metricsLast != NULL ) metricsLast->next = mPtr;
+    else metricsFirst = mPtr;
+    metricsLast = mPtr;
+#ifndef _WIN32
+    pthread_mutex_unlock( &metricsLock );
+#endif
+    return( mPtr );
+}
+
+
+//  ==============================================================================================
+//  metricsCounter, metricsGauge, metricsGaugeFn
+//
+//  Register a counter (only goes up), a gauge set by metricsSet(), or a gauge computed by
+//  gaugeFn() at render time (e.g., a value the owning module already keeps).  Series of the
+//  same name differ by labels, a comma separated list such as:  event="mapchange"
+//
+metricsObj *metricsCounter( char *name, char *help, char *labels )
+{
+    return( _metricsRegister( METRICS_COUNTER, name, help, labels ));
+}
+
+metricsObj *metricsGauge( char *name, char *help, char *labels )
+{
+    return( _metricsRegister( METRICS_GAUGE, name, help, labels ));
+}
+
+metricsObj *metricsGaugeFn( char *name, char *help, char *labels, double (*gaugeFn)( void ) )
+{
+    metricsObj *mPtr = _metricsRegister( METRICS_GAUGE, name, help, labels );
+
+    if ( mPtr != &metricsScratch ) mPtr->gaugeFn = gaugeFn;
+    return( mPtr );
+}
+
+
+//  ==============================================================================================
+//  metricsHistogram
+//
+//  Register a duration histogram with ascending bucket bounds in microseconds (rendered in
+//  seconds), or the default 100us..10s bounds if boundsUs is NULL.
+//
+metricsObj *metricsHistogram( char *name, char *help, char *labels, const uint64_t *boundsUs, int nBounds )
+{
+    metricsObj *mPtr;
+
+    if ( boundsUs == NULL ) {
+        boundsUs = metricsDefaultBoundsUs;
+        nBounds = sizeof( metricsDefaultBoundsUs ) / sizeof( metricsDefaultBoundsUs[0] );
+    }
+    if ( nBounds > METRICS_MAXBUCKETS ) nBounds = METRICS_MAXBUCKETS;
+
+    mPtr = _metricsRegister( METRICS_HISTOGRAM, name, help, labels );
+    if ( mPtr != &metricsScratch ) {
+        mPtr->nBounds = nBounds;
+        memcpy( mPtr->boundsUs, boundsUs, nBounds * sizeof( uint64_t ));
+    }
+    return( mPtr );
+}
+
+
+//  ==============================================================================================
+//  metricsObserveUs
+//
+//  Record one duration in a histogram.
+//
+void metricsObserveUs( metricsObj *mPtr, uint64_t us )
+{
+    int i;
+
+    for ( i=0; ( i < mPtr->nBounds ) && ( us > mPtr->boundsUs[i] ); i++ ) ;
+    METRICS_ATOMIC_ADD( &mPtr->buckets[i], (uint64_t) 1 );
+    METRICS_ATOMIC_ADD( &mPtr->sumUs, us );
+    METRICS_ATOMIC_ADD( &mPtr->count, (uint64_t) 1 );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _metricsRenderOne (local)
+//
+static void _metricsRenderOne( strBuf_t *bPtr, metricsObj *mPtr )
+{
+    const char *comma = ( 0 != mPtr->labels[0] ) ? "," : "";
+    uint64_t cumulative = 0;
+    int i;
+
+    switch ( mPtr->type ) {
+
+    case METRICS_COUNTER:
+        strBufPrintf( bPtr, "%s%s%s%s %llu\n", mPtr->name, mPtr->labels[0] ? "{" : "", mPtr->labels,
+            mPtr->labels[0] ? "}" : "", (unsigned long long) mPtr->value );
+        break;
+
+    case METRICS_GAUGE:
+        strBufPrintf( bPtr, "%s%s%s%s ", mPtr->name, mPtr->labels[0] ? "{" : "", mPtr->labels, mPtr->labels[0] ? "}" : "" );
+        if ( mPtr->gaugeFn != NULL ) strBufPrintf( bPtr, "%.17g\n", (*mPtr->gaugeFn)() );
+        else                         strBufPrintf( bPtr, "%lld\n", (long long) (int64_t) mPtr->value );
+        break;
+
+    case METRICS_HISTOGRAM:
+        for ( i=0; i<mPtr->nBounds; i++ ) {
+            cumulative += mPtr->buckets[i];
+            strBufPrintf( bPtr, "%s_bucket{%s%sle=\"%g\"} %llu\n", mPtr->name, mPtr->labels, comma,
+                (double) mPtr->boundsUs[i] / 1e6, (unsigned long long) cumulative );
+        }
+        cumulative += mPtr->buckets[ mPtr->nBounds ];
+        strBufPrintf( bPtr, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", mPtr->name, mPtr->labels, comma,
+            (unsigned long long) cumulative );
+        strBufPrintf( bPtr, "%s_sum%s%s%s %.6f\n", mPtr->name, mPtr->labels[0] ? "{" : "", mPtr->labels,
+            mPtr->labels[0] ? "}" : "", (double) mPtr->sumUs / 1e6 );
+        strBufPrintf( bPtr, "%s_count%s%s%s %llu\n", mPtr->name, mPtr->labels[0] ? "{" : "", mPtr->labels,
+            mPtr->labels[0] ? "}" : "", (unsigned long long) cumulative );
+        break;
+
+    default:
+        break;
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  metricsRender
+//
+//  Append all metrics in Prometheus text format, series grouped under one HELP/TYPE header
+//  per name.  The values of a histogram are read without a lock, so a scrape racing an
+//  observation may be off by one in a bucket, as is usual for this format.
+//
+int metricsRender( strBuf_t *bPtr )
+{
+    static const char *typeNames[] = { "", "counter", "gauge", "histogram" };
+    metricsObj *mPtr, *sPtr, *pPtr;
+
+#ifndef _WIN32
+    pthread_mutex_lock( &metricsLock );
+#endif
+    for ( mPtr = metricsFirst; mPtr != NULL; mPtr = mPtr->next ) {
+
+        // only the first series of each name starts a group
+        //
+        for ( pPtr = metricsFirst; pPtr != mPtr; pPtr = pPtr->next )
+            if ( 0 == strcmp( pPtr->name, mPtr->name )) break;
+        if ( pPtr != mPtr ) continue;
+
+        strBufPrintf( bPtr, "# HELP %s %s\n# TYPE %s %s\n", mPtr->name, mPtr->help, mPtr->name, typeNames[ mPtr->type ] );
+        for ( sPtr = mPtr; sPtr != NULL; sPtr = sPtr->next )
+            if ( 0 == strcmp( sPtr->name, mPtr->name )) _metricsRenderOne( bPtr, sPtr );
+    }
+#ifndef _WIN32
+    pthread_mutex_unlock( &metricsLock );
+#endif
+    return( bPtr->overflow );
+}
+
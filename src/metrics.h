@@ -0,0 +1,65 @@
+//  ==============================================================================================
+//
+//  Module: METRICS
+//
+//  Description:
+//  Counters, gauges and histograms of sissm internals, rendered in Prometheus text format
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdint.h>
+#include "util.h"
+
+#define METRICS_COUNTER     (1)
+#define METRICS_GAUGE       (2)
+#define METRICS_HISTOGRAM   (3)
+
+#define METRICS_MAXBUCKETS  (12)
+
+typedef struct metricsObj {
+
+    struct metricsObj *next;                                          // registry, in order
+    char     name[64];                                          // e.g., sissm_rcon_commands_total
+    char     help[128];
+    char     labels[128];                                  // e.g., verb="say", "" for none
+    int      type;
+
+    uint64_t value;                                            // counter, or gauge (int64)
+    double (*gaugeFn)( void );                              // computed gauge, NULL if none
+
+    int      nBounds;                                         // histogram bucket upper bounds
+    uint64_t boundsUs[METRICS_MAXBUCKETS];                                  // microseconds
+    uint64_t buckets[METRICS_MAXBUCKETS + 1];              // per bucket (not cumulative), +Inf
+    uint64_t sumUs, count;
+
+} metricsObj;
+
+//  Recording is a single relaxed atomic operation, safe from any thread
+//
+#ifdef _MSC_VER
+#include <intrin.h>
+#define METRICS_ATOMIC_ADD( p, n )     _InterlockedExchangeAdd64( (volatile __int64 *) (p), (__int64) (n) )
+#define METRICS_ATOMIC_STORE( p, v )   _InterlockedExchange64( (volatile __int64 *) (p), (__int64) (v) )
+#else
+#define METRICS_ATOMIC_ADD( p, n )     __atomic_fetch_add( (p), (n), __ATOMIC_RELAXED )
+#define METRICS_ATOMIC_STORE( p, v )   __atomic_store_n( (p), (v), __ATOMIC_RELAXED )
+#endif
+
+#define metricsInc( mPtr )       METRICS_ATOMIC_ADD( &(mPtr)->value, (uint64_t) 1 )
+#define metricsAdd( mPtr, n )    METRICS_ATOMIC_ADD( &(mPtr)->value, (uint64_t) (n) )
+#define metricsSet( mPtr, v )    METRICS_ATOMIC_STORE( &(mPtr)->value, (uint64_t) (int64_t) (v) )
+
+extern metricsObj *metricsCounter( char *name, char *help, char *labels );
+extern metricsObj *metricsGauge( char *name, char *help, char *labels );
+extern metricsObj *metricsGaugeFn( char *name, char *help, char *labels, double (*gaugeFn)( void ) );
+extern metricsObj *metricsHistogram( char *name, char *help, char *labels, const uint64_t *boundsUs, int nBounds );
+extern void metricsObserveUs( metricsObj *mPtr, uint64_t us );
+extern uint64_t metricsNowUs( void );
+extern int metricsRender( strBuf_t *bPtr );
+
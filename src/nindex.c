@@ -0,0 +1,397 @@
+//  ==============================================================================================
+//
+//  Module: NINDEX
+//
+//  Description:
+//  Case-folded trigram index for partial player name lookup
+//
+//  Names are case-folded (ASCII, Latin-1, Latin Extended-A, Greek and Cyrillic) and every
+//  3-byte sequence of the folded UTF-8 string is posted to a trigram hash.  A search only
+//  verifies the entries posted under the rarest trigram of the partial name, so the cost
+//  follows the number of candidates rather than the number of names indexed.  Every match
+//  is returned, ranked exact > prefix > word-start > substring, so that callers can tell
+//  a unique hit from an ambiguous one.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bsd.h"
+#include "nindex.h"
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define NINDEX_FOLD_MAX       (256)                              // max folded name size
+#define NINDEX_MINPOSTINGS    (256)                         // initial trigram slots (power of 2)
+
+
+//  ==============================================================================================
+//  _nindexFoldCodePoint (local)
+//
+//  Simple case folding of one Unicode code point for the scripts commonly seen in
+//  player names.  Anything not covered is returned unchanged.
+//
+static uint32_t _nindexFoldCodePoint( uint32_t c )
+{
+    if      (( c >= 'A' )    && ( c <= 'Z' ))    c += 0x20;
+    else if (( c >= 0x00C0 ) && ( c <= 0x00DE ) && ( c != 0x00D7 )) c += 0x20;     // Latin-1
+    else if (( c >= 0x0100 ) && ( c <= 0x0137 )) c |= 1;                    // Latin Ext-A
+    else if (( c >= 0x0139 ) && ( c <= 0x0148 ) && ( c & 1 )) c += 1;
+    else if (( c >= 0x014A ) && ( c <= 0x0177 )) c |= 1;
+    else if (( c >= 0x0179 ) && ( c <= 0x017E ) && ( c & 1 )) c += 1;
+    else if (( c >= 0x0391 ) && ( c <= 0x03A9 ) && ( c != 0x03A2 )) c += 0x20;        // Greek
+    else if (( c >= 0x0410 ) && ( c <= 0x042F )) c += 0x20;                      // Cyrillic
+    else if (( c >= 0x0400 ) && ( c <= 0x040F )) c += 0x50;
+    return( c );
+}
+
+
+//  ==============================================================================================
+//  nindexFold
+//
+//  Case-fold a UTF-8 string into strOut.  Malformed sequences are copied byte for byte.
+//  Returns the length of the folded string.
+//
+int nindexFold( char *strIn, char *strOut, int maxSize )
+{
+    unsigned char *s = (unsigned char *) strIn;
+    uint32_t c;
+    int n, i = 0;
+
+    while (( *s != 0 ) && ( i < maxSize - 4 )) {
+
+        // decode 1 or 2 byte sequences (all folded ranges are below U+0800)
+        //
+        if ( *s < 0x80 ) {
+            c = *s;  n = 1;
+        }
+        else if ((( *s & 0xE0 ) == 0xC0 ) && (( s[1] & 0xC0 ) == 0x80 )) {
+            c = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);  n = 2;
+        }
+        else {
+            strOut[i++] = *s++;                    // 3/4 byte or malformed: copy through
+            continue;
+        }
+        s += n;
+
+        c = _nindexFoldCodePoint( c );
+        if ( c < 0x80 ) {
+            strOut[i++] = (char) c;
+        }
+        else {
+            strOut[i++] = (char) (0xC0 | (c >> 6));
+            strOut[i++] = (char) (0x80 | (c & 0x3F));
+        }
+    }
+    strOut[i] = 0;
+    return( i );
+}
+
+
+//  ==============================================================================================
+//  _nindexTrigram (local)
+//
+//  Packs 3 bytes into a non-zero 32-bit value
+//
+static uint32_t _nindexTrigram( char *p )
+{
+    return( 0x01000000 | ((uint32_t)(unsigned char) p[0] << 16) |
+        ((uint32_t)(unsigned char) p[1] << 8) | (uint32_t)(unsigned char) p[2] );
+}
+
+
+//  ==============================================================================================
+//  _nindexFindPosting (local)
+//
+//  Linear-probe for the trigram.  Returns the slot holding it or the empty slot for it.
+//
+static nindexPosting_t *_nindexFindPosting( nindexObj *nPtr, uint32_t trigram )
+{
+    uint32_t mask, i;
+
+    mask = nPtr->postingSize - 1;
+    i = (trigram * 0x9E3779B1u) >> 8 & mask;
+    while (( nPtr->postings[i].trigram != 0 ) && ( nPtr->postings[i].trigram != trigram ))
+        i = (i + 1) & mask;
+    return( &nPtr->postings[i] );
+}
+
+
+//  ==============================================================================================
+//  _nindexGrowPostings (local)
+//
+//  Double the trigram hash table size, moving the posting lists over.
+//
+static int _nindexGrowPostings( nindexObj *nPtr )
+{
+    nindexPosting_t *oldPostings, *p;
+    int i, oldSize;
+
+    oldPostings = nPtr->postings;
+    oldSize = nPtr->postingSize;
+
+    p = (nindexPosting_t *) calloc( oldSize * 2, sizeof( nindexPosting_t ));
+    if ( p == NULL ) return 1;
+
+    nPtr->postings = p;
+    nPtr->postingSize = oldSize * 2;
+    for ( i=0; i<oldSize; i++ ) {
+        if ( oldPostings[i].trigram != 0 ) {
+            p = _nindexFindPosting( nPtr, oldPostings[i].trigram );
+            *p = oldPostings[i];
+        }
+    }
+    free( oldPostings );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _nindexPost (local)
+//
+//  Append entry number to the posting list of a trigram (skipping repeats within a name).
+//
+static int _nindexPost( nindexObj *nPtr, uint32_t trigram, int entryNo )
+{
+    nindexPosting_t *p;
+    int *e;
+
+    p = _nindexFindPosting( nPtr, trigram );
+    if ( p->trigram == 0 ) {
+        if ( (nPtr->postingCount + 1) * 2 > nPtr->postingSize ) {
+            if ( _nindexGrowPostings( nPtr )) return 1;
+            p = _nindexFindPosting( nPtr, trigram );
+        }
+        p->trigram = trigram;
+        nPtr->postingCount++;
+    }
+    if (( p->count > 0 ) && ( p->entries[ p->count-1 ] == entryNo )) return 0;
+
+    if ( p->count == p->size ) {
+        e = (int *) realloc( p->entries, (p->size ? p->size * 2 : 4) * sizeof( int ));
+        if ( e == NULL ) return 1;
+        p->entries = e;
+        p->size = p->size ? p->size * 2 : 4;
+    }
+    p->entries[ p->count++ ] = entryNo;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  nindexCreate
+//
+//  Create an empty name index
+//
+nindexObj *nindexCreate( void )
+{
+    nindexObj *nPtr;
+
+    nPtr = (nindexObj *) calloc( 1, sizeof( nindexObj ));
+    if ( nPtr != NULL ) {
+        nPtr->postings = (nindexPosting_t *) calloc( NINDEX_MINPOSTINGS, sizeof( nindexPosting_t ));
+        nPtr->postingSize = NINDEX_MINPOSTINGS;
+        if ( nPtr->postings == NULL ) {
+            free( nPtr );
+            nPtr = NULL;
+        }
+    }
+    return( nPtr );
+}
+
+
+//  ==============================================================================================
+//  nindexClear
+//
+//  Remove all names from the index, keeping allocated tables for reuse.
+//
+void nindexClear( nindexObj *nPtr )
+{
+    int i;
+
+    if ( nPtr == NULL ) return;
+    for ( i=0; i<nPtr->entryCount; i++ ) {
+        free( nPtr->entries[i].name );
+        free( nPtr->entries[i].folded );
+    }
+    nPtr->entryCount = 0;
+
+    for ( i=0; i<nPtr->postingSize; i++ ) {
+        if ( nPtr->postings[i].entries != NULL ) free( nPtr->postings[i].entries );
+    }
+    memset( nPtr->postings, 0, nPtr->postingSize * sizeof( nindexPosting_t ));
+    nPtr->postingCount = 0;
+    return;
+}
+
+
+//  ==============================================================================================
+//  nindexDestroy
+//
+//  Free the index.
+//
+void nindexDestroy( nindexObj *nPtr )
+{
+    if ( nPtr != NULL ) {
+        nindexClear( nPtr );
+        free( nPtr->entries );
+        free( nPtr->postings );
+        free( nPtr );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  nindexAdd
+//
+//  Add a name with an associated key.  The same key may be added under several names.
+//  Returns 0 on success.
+//
+int nindexAdd( nindexObj *nPtr, char *name, uint64_t key )
+{
+    char folded[NINDEX_FOLD_MAX];
+    nindexEntry_t *e;
+    int i, n, entryNo;
+
+    if (( nPtr == NULL ) || ( 0 == strlen( name ))) return 1;
+
+    if ( nPtr->entryCount == nPtr->entrySize ) {
+        e = (nindexEntry_t *) realloc( nPtr->entries,
+            (nPtr->entrySize ? nPtr->entrySize * 2 : 64) * sizeof( nindexEntry_t ));
+        if ( e == NULL ) return 1;
+        nPtr->entries = e;
+        nPtr->entrySize = nPtr->entrySize ? nPtr->entrySize * 2 : 64;
+    }
+
+    n = nindexFold( name, folded, NINDEX_FOLD_MAX );
+    entryNo = nPtr->entryCount;
+    e = &nPtr->entries[ entryNo ];
+    e->key = key;
+    e->name = strdup( name );
+    e->folded = strdup( folded );
+    e->foldedLen = n;
+    if (( e->name == NULL ) || ( e->folded == NULL )) {
+        free( e->name );  free( e->folded );
+        return 1;
+    }
+    nPtr->entryCount++;
+
+    for ( i=0; i+3<=n; i++ )
+        if ( _nindexPost( nPtr, _nindexTrigram( &folded[i] ), entryNo )) return 1;
+
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _nindexRank (local)
+//
+//  Rank how well the folded partial name matches an entry, -1 if not at all.
+//
+static int _nindexRank( nindexEntry_t *e, char *partial, int partialLen )
+{
+    char *p, *q;
+    int rank = -1;
+
+    p = strstr( e->folded, partial );
+    if ( p == e->folded ) {
+        rank = ( partialLen == e->foldedLen ) ? NINDEX_RANK_EXACT : NINDEX_RANK_PREFIX;
+    }
+    else {
+        while ( p != NULL ) {
+            rank = NINDEX_RANK_SUBSTR;
+            q = p - 1;
+            if ( ((unsigned char) *q < 0x80) && !((*q >= 'a' && *q <= 'z') || (*q >= '0' && *q <= '9')) ) {
+                rank = NINDEX_RANK_WORD;
+                break;
+            }
+            p = strstr( p + 1, partial );
+        }
+    }
+    return( rank );
+}
+
+
+//  ==============================================================================================
+//  _nindexKeep (local)
+//
+//  Insert a match into the best-first result array, dropping the worst if full.
+//
+static void _nindexKeep( nindexEntry_t *e, int rank, nindexMatch_t *matches, int *kept, int maxMatches )
+{
+    int i;
+    size_t len;
+
+    len = strlen( e->name );
+    for ( i = *kept; i > 0; i-- ) {
+        if ( matches[i-1].rank < rank ) break;
+        if (( matches[i-1].rank == rank ) && ( strlen( matches[i-1].name ) <= len )) break;
+        if ( i < maxMatches ) matches[i] = matches[i-1];
+    }
+    if ( i < maxMatches ) {
+        matches[i].key = e->key;
+        matches[i].rank = rank;
+        strlcpy( matches[i].name, e->name, NINDEX_NAME_MAX );
+        if ( *kept < maxMatches ) (*kept)++;
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  nindexSearch
+//
+//  Find all names containing partialName (case-insensitive).  Up to maxMatches best matches are
+//  returned in 'matches', best first.  The return value is the total number of names that
+//  matched, which may exceed maxMatches.
+//
+int nindexSearch( nindexObj *nPtr, char *partialName, nindexMatch_t *matches, int maxMatches )
+{
+    char partial[NINDEX_FOLD_MAX];
+    nindexPosting_t *p, *rarest = NULL;
+    int i, n, rank, kept = 0, total = 0;
+
+    if (( nPtr == NULL ) || ( 0 == (n = nindexFold( partialName, partial, NINDEX_FOLD_MAX )))) return 0;
+
+    if ( n >= 3 ) {
+        // candidates are the entries posted under the least common trigram of the query
+        //
+        for ( i=0; i+3<=n; i++ ) {
+            p = _nindexFindPosting( nPtr, _nindexTrigram( &partial[i] ));
+            if ( p->trigram == 0 ) return 0;                      // trigram in no name at all
+            if (( rarest == NULL ) || ( p->count < rarest->count )) rarest = p;
+        }
+        for ( i=0; i<rarest->count; i++ ) {
+            rank = _nindexRank( &nPtr->entries[ rarest->entries[i] ], partial, n );
+            if ( rank >= 0 ) {
+                total++;
+                _nindexKeep( &nPtr->entries[ rarest->entries[i] ], rank, matches, &kept, maxMatches );
+            }
+        }
+    }
+    else {
+        // one or two characters: no trigram to go by, verify every entry
+        //
+        for ( i=0; i<nPtr->entryCount; i++ ) {
+            rank = _nindexRank( &nPtr->entries[i], partial, n );
+            if ( rank >= 0 ) {
+                total++;
+                _nindexKeep( &nPtr->entries[i], rank, matches, &kept, maxMatches );
+            }
+        }
+    }
+    return( total );
+}
+
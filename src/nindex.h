@@ -0,0 +1,73 @@
+//  ==============================================================================================
+//
+//  Module: NINDEX
+//
+//  Description:
+//  Case-folded trigram index for partial player name lookup
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#ifndef _NINDEX_H
+#define _NINDEX_H
+
+#include <stdint.h>
+
+#define NINDEX_NAME_MAX        (80)                    // max name size returned in a match
+
+#define NINDEX_RANK_EXACT       (0)                // whole name matches (ignoring case)
+#define NINDEX_RANK_PREFIX      (1)                // name starts with the partial name
+#define NINDEX_RANK_WORD        (2)                // a word inside the name starts with it
+#define NINDEX_RANK_SUBSTR      (3)                // partial name is anywhere in the name
+
+typedef struct {
+
+    uint64_t key;                                    // caller key, typically the SteamID64
+    int      rank;                                            // NINDEX_RANK_*, lower is better
+    char     name[NINDEX_NAME_MAX];                                    // name as it was added
+
+} nindexMatch_t;
+
+typedef struct {
+
+    uint64_t key;
+    char    *name;                                                           // original name
+    char    *folded;                                                   // case-folded name
+    int      foldedLen;
+
+} nindexEntry_t;
+
+typedef struct {
+
+    uint32_t  trigram;                                             // 0 = empty hash slot
+    int       count;
+    int       size;
+    int      *entries;                                     // entry numbers, ascending order
+
+} nindexPosting_t;
+
+typedef struct {
+
+    nindexEntry_t   *entries;
+    int              entryCount;
+    int              entrySize;
+
+    nindexPosting_t *postings;                                    // open-addressing hash
+    int              postingCount;
+    int              postingSize;                                            // power of 2
+
+} nindexObj, *nindexPtr;
+
+extern nindexObj *nindexCreate( void );
+extern void nindexDestroy( nindexObj *nPtr );
+extern void nindexClear( nindexObj *nPtr );
+extern int  nindexAdd( nindexObj *nPtr, char *name, uint64_t key );
+extern int  nindexSearch( nindexObj *nPtr, char *partialName, nindexMatch_t *matches, int maxMatches );
+extern int  nindexFold( char *strIn, char *strOut, int maxSize );
+
+#endif
@@ -190,9 +190,6 @@ int piantirushInitConfig( void )
 
     cfsDestroy( cP );
 
-    aPtr  = alarmCreate( _normalSpeedAlarmCB );
-//    dPtr  = alarmCreate( _displayLockedStateCB );
-
     return 0;
 }
 
@@ -348,27 +345,32 @@ int piantirushCapturedCB( char *strIn )
 //  ...
 //  ...
 //
-int piantirushPeriodicCB( char *strIn )
+int piantirushSigKillCB( char *strIn )
 {
+    logPrintf( LOG_LEVEL_INFO, "piantirush", "Restoring Normal Capture Rate before shutdown" );
+
+    _captureSpeedForceNext();
+    _captureSpeed( 0 );
+
     return 0;
 }
 
 //  ==============================================================================================
-//  ...
+//  piantirushReloadConfigCB
 //
-//  ...
-//  ...
+//  Re-reads the player thresholds, the fast/slow/lock prompts and capture timings and the
+//  prompt intervals.  pluginState is kept.
 //
-int piantirushSigKillCB( char *strIn )
+int piantirushReloadConfigCB( char *strIn )
 {
-    logPrintf( LOG_LEVEL_INFO, "piantirush", "Restoring Normal Capture Rate before shutdown" );
-
-    _captureSpeedForceNext();
-    _captureSpeed( 0 );
+    int pluginState = piantirushConfig.pluginState;
 
+    piantirushInitConfig();
+    piantirushConfig.pluginState = pluginState;
     return 0;
 }
 
+
 //  ==============================================================================================
 //  piantirushInstallPlugins
 //
@@ -380,6 +382,9 @@ int piantirushInstallPlugin( void )
     // 
     piantirushInitConfig();
 
+    aPtr  = alarmCreate( _normalSpeedAlarmCB );
+//    dPtr  = alarmCreate( _displayLockedStateCB );
+
     // if plugin is disabled in the .cfg file then do not activate
     //
     if ( piantirushConfig.pluginState == 0 ) return 0;
@@ -398,8 +403,8 @@ int piantirushInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          piantirushRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            piantirushRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   piantirushCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             piantirushPeriodicCB );
     eventsRegister( SISSM_EV_SIGTERM,              piantirushSigKillCB );
+    eventsRegister( SISSM_EV_RELOAD,               piantirushReloadConfigCB );
 
     return 0;
 }
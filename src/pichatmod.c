@@ -0,0 +1,243 @@
+//  ==============================================================================================
+//
+//  Module: PICHATMOD
+//
+//  Description:
+//  Chat moderation: bad words in chat draw warnings, then a kick
+//
+//  Every chat line is run through the compiled bad words matcher of the api module (the
+//  sissm.BadWordsFilePath list, one pass per line).  A player gets 'warnings' in-game
+//  warnings, and the next offense triggers the action.  Offenses are forgotten after
+//  'forgetMinutes' without one.
+//
+//  Sandstorm RCON has no command to mute a player, so action "mute" is accepted but only
+//  warns (and logs that it could not mute); use "kick" to remove repeat offenders.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bsd.h"
+#include "log.h"
+#include "events.h"
+#include "cfs.h"
+#include "util.h"
+#include "alarm.h"
+#include "journal.h"
+
+#include "roster.h"
+#include "api.h"
+#include "sissm.h"
+
+#include "pichatmod.h"
+
+#define PICHATMOD_ACT_WARN    (0)                               // warnings only, never removes
+#define PICHATMOD_ACT_KICK    (1)
+#define PICHATMOD_ACT_MUTE    (2)                        // not supported by RCON: warns instead
+
+#define PICHATMOD_MAXTRACK    (ROSTER_MAX)                    // players with offenses on record
+
+#define LOGCHATPREFIX  "LogChat: Display: "
+#define LOGCHATMIDDLE  "Chat: "
+#define LOGSTEAMPREFIX "(76561"
+#define LOGSTEAMIDSIZE  (17)
+
+
+//  ==============================================================================================
+//  Data definition
+//
+static struct {
+
+    int  pluginState;                      // always have this in .cfg file:  0=disabled 1=enabled
+
+    int  action;                                                          // PICHATMOD_ACT_*
+    int  warnings;                                    // warnings given before the action is taken
+    int  forgetMinutes;                       // offenses expire after this long without another
+    int  exemptAdmins;                                          // 1=admins are never moderated
+    char warnMessage[CFS_FETCH_MAX];
+    char kickMessage[CFS_FETCH_MAX];
+
+} pichatmodConfig;
+
+static struct {
+
+    char playerGUID[ LOGSTEAMIDSIZE + 1 ];                                   // "" = free entry
+    int  offenses;
+    unsigned int lastTime;
+
+} pichatmodTrack[ PICHATMOD_MAXTRACK ];
+
+
+//  ==============================================================================================
+//  pichatmodInitConfig
+//
+//  Read parameters from the .cfg file
+//
+int pichatmodInitConfig( void )
+{
+    cfsPtr cP;
+    char actionName[CFS_FETCH_MAX];
+
+    cP = cfsCreate( sissmGetConfigPath() );
+
+    pichatmodConfig.pluginState   = (int) cfsFetchNum( cP, "pichatmod.pluginState", 0.0 );  // disabled by default
+    pichatmodConfig.warnings      = (int) cfsFetchNum( cP, "pichatmod.warnings", 2.0 );
+    pichatmodConfig.forgetMinutes = (int) cfsFetchNum( cP, "pichatmod.forgetMinutes", 30.0 );
+    pichatmodConfig.exemptAdmins  = (int) cfsFetchNum( cP, "pichatmod.exemptAdmins", 1.0 );
+    strlcpy( actionName, cfsFetchStr( cP, "pichatmod.action", "kick" ), CFS_FETCH_MAX );
+    strlcpy( pichatmodConfig.warnMessage, cfsFetchStr( cP, "pichatmod.warnMessage", "please keep the chat clean" ), CFS_FETCH_MAX );
+    strlcpy( pichatmodConfig.kickMessage, cfsFetchStr( cP, "pichatmod.kickMessage", "Kicked for language" ), CFS_FETCH_MAX );
+
+    cfsDestroy( cP );
+
+    strToLowerInPlace( actionName );
+    if      ( 0 == strcmp( actionName, "kick" )) pichatmodConfig.action = PICHATMOD_ACT_KICK;
+    else if ( 0 == strcmp( actionName, "mute" )) pichatmodConfig.action = PICHATMOD_ACT_MUTE;
+    else                                         pichatmodConfig.action = PICHATMOD_ACT_WARN;
+
+    if ( pichatmodConfig.warnings < 0 ) pichatmodConfig.warnings = 0;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _chatParse (local)
+//
+//  Parse a chat log line into the speaker's name, GUID and the said text:
+//  [2019.08.30-23.39.33:262][176]LogChat: Display: name(76561198000000001) Global Chat: hello
+//  Returns 0 if parsed, 1 if not a player chat line.
+//
+static int _chatParse( char *strIn, char *playerName, int nameSize, char *playerGUID, char **chatText )
+{
+    char *t, *s, *v;
+    int nameLen;
+
+    if ( NULL == (t = strstr( strIn, LOGCHATPREFIX ))) return 1;
+    t += strlen( LOGCHATPREFIX );
+    if ( NULL == (s = strstr( t, LOGSTEAMPREFIX ))) return 1;
+    if ( NULL == (v = strstr( s, LOGCHATMIDDLE ))) return 1;
+
+    nameLen = (int) (s - t) + 1;
+    strlcpy( playerName, t, (nameLen < nameSize) ? nameLen : nameSize );
+    strlcpy( playerGUID, s + 1, LOGSTEAMIDSIZE + 1 );
+    *chatText = v + strlen( LOGCHATMIDDLE );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _offenseCount (local)
+//
+//  Records an offense by a player and returns the player's offense count, including this
+//  one.  Expired records are reused; if the table is full the stalest record is dropped.
+//
+static int _offenseCount( char *playerGUID )
+{
+    unsigned int now = apiTimeGet(), expiry = 60 * (unsigned int) pichatmodConfig.forgetMinutes;
+    int i, slot = -1, freeSlot = -1, oldest = 0;
+
+    for ( i = 0; i < PICHATMOD_MAXTRACK; i++ ) {
+        if (( pichatmodTrack[i].playerGUID[0] != 0 ) && ( pichatmodTrack[i].lastTime + expiry < now ))
+            pichatmodTrack[i].playerGUID[0] = 0;
+        if ( pichatmodTrack[i].playerGUID[0] == 0 ) {
+            if ( freeSlot < 0 ) freeSlot = i;
+        }
+        else if ( 0 == strcmp( pichatmodTrack[i].playerGUID, playerGUID )) {
+            slot = i;
+            break;
+        }
+        else if ( pichatmodTrack[i].lastTime < pichatmodTrack[ oldest ].lastTime ) {
+            oldest = i;
+        }
+    }
+    if ( slot < 0 ) {
+        slot = ( freeSlot >= 0 ) ? freeSlot : oldest;
+        strlcpy( pichatmodTrack[ slot ].playerGUID, playerGUID, LOGSTEAMIDSIZE + 1 );
+        pichatmodTrack[ slot ].offenses = 0;
+    }
+    pichatmodTrack[ slot ].lastTime = now;
+    return( ++pichatmodTrack[ slot ].offenses );
+}
+
+
+//  ==============================================================================================
+//  pichatmodChatCB
+//
+//  Checks each chat line against the bad words list and warns or acts on the speaker.
+//
+int pichatmodChatCB( char *strIn )
+{
+    char playerName[256], playerGUID[ LOGSTEAMIDSIZE + 1 ], *chatText, *badWord;
+    int offenses;
+
+    if ( 0 != _chatParse( strIn, playerName, sizeof( playerName ), playerGUID, &chatText )) return 0;
+    if ( NULL == (badWord = apiBadWordFind( chatText ))) return 0;
+    if ( pichatmodConfig.exemptAdmins && apiIsAdmin( playerGUID )) return 0;
+
+    offenses = _offenseCount( playerGUID );
+    logPrintf( LOG_LEVEL_INFO, "pichatmod", "Bad word '%s' offense %d ::%s::%s::",
+        badWord, offenses, playerName, playerGUID );
+
+    if (( pichatmodConfig.action == PICHATMOD_ACT_KICK ) && ( offenses > pichatmodConfig.warnings )) {
+        apiKickOrBan( 0, playerGUID, pichatmodConfig.kickMessage );
+        apiSay( "Player %s auto-kicked by server", playerName );
+        logPrintf( LOG_LEVEL_CRITICAL, "pichatmod", "Chat Auto-kick ::%s::%s::", playerName, playerGUID );
+        return 0;
+    }
+    if (( pichatmodConfig.action == PICHATMOD_ACT_MUTE ) && ( offenses > pichatmodConfig.warnings ))
+        logPrintf( LOG_LEVEL_WARN, "pichatmod", "Mute is not available over RCON, warning instead ::%s::%s::", playerName, playerGUID );
+
+    if (( pichatmodConfig.action == PICHATMOD_ACT_WARN ) || ( offenses > pichatmodConfig.warnings ))
+        apiSay( "%s: %s", playerName, pichatmodConfig.warnMessage );
+    else
+        apiSay( "%s: %s (warning %d of %d)", playerName, pichatmodConfig.warnMessage, offenses, pichatmodConfig.warnings );
+    journalAction( "warn", playerGUID, badWord );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  pichatmodReloadConfigCB
+//
+//  Re-reads the warning count, forget time, admin exemption, action and messages.  Warnings
+//  already counted against players are kept.  pluginState is kept.
+//
+int pichatmodReloadConfigCB( char *strIn )
+{
+    int pluginState = pichatmodConfig.pluginState;
+
+    pichatmodInitConfig();
+    pichatmodConfig.pluginState = pluginState;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  pichatmodInstallPlugin
+//
+//  This method is exported and is called from the main sissm module.
+//
+int pichatmodInstallPlugin( void )
+{
+    // Read the plugin-specific variables from the .cfg file
+    //
+    pichatmodInitConfig();
+    memset( pichatmodTrack, 0, sizeof( pichatmodTrack ));
+
+    // if plugin is disabled in the .cfg file then do not activate
+    //
+    if ( pichatmodConfig.pluginState == 0 ) return 0;
+
+    eventsRegister( SISSM_EV_CHAT,                 pichatmodChatCB );
+    eventsRegister( SISSM_EV_RELOAD,               pichatmodReloadConfigCB );
+    return 0;
+}
+
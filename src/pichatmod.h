@@ -0,0 +1,22 @@
+//  ==============================================================================================
+//
+//  Module: PICHATMOD
+//
+//  Description:
+//  Chat moderation: bad words in chat draw warnings, then a kick
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+//
+//  Plugin Exports: Only one method is exported (.h) 
+//
+//  ==============================================================================================
+
+extern int pichatmodInstallPlugin( void );
+
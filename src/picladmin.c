@@ -34,10 +34,16 @@
 #include "cfs.h"
 #include "util.h"
 #include "alarm.h"
+#include "arena.h"
 
+#include "nindex.h"
 #include "roster.h"
+#include "pstore.h"
+#include "banlist.h"
+#include "sid.h"
 #include "api.h"
 #include "sissm.h"
+#include "ctl.h"
 
 #include "picladmin.h"
 
@@ -49,6 +55,19 @@
 
 #define NUM_RESPONSES  (5)
 #define NUM_MACROS     (10)
+#define MACRO_MAXSTEPS (16)                         // RCON commands per macro, after the label
+
+//  A macro "label::cmd1::cmd2..." is split once when the .cfg file is read: the separators
+//  in text[] are replaced by NULs and label/steps point into it.
+//
+typedef struct {
+
+    char  text[CFS_FETCH_MAX];
+    char *label;                                                     // NULL if not defined
+    char *steps[MACRO_MAXSTEPS];
+    int   stepCount;
+
+} picladminMacro_t;
 
 static struct {
 
@@ -60,7 +79,7 @@ static struct {
 
     char cmdPrefix[CFS_FETCH_MAX];
 
-    char macros[NUM_MACROS][CFS_FETCH_MAX];
+    picladminMacro_t macros[NUM_MACROS];
 
 } picladminConfig;
 
@@ -76,6 +95,8 @@ int _cmdRestart(), _cmdEnd(), _cmdReboot();
 int _cmdBan(), _cmdKick();
 int _cmdBanId(), _cmdKickId();
 int _cmdGameModeProperty(), _cmdRcon();
+int _cmdLastSeen(), _cmdWhois();
+int _cmdLocalBan();
 
 struct {
 
@@ -110,11 +131,25 @@ struct {
 
     { "bi",     "banid",         "banid [steamid64]",      _cmdBanId },
     { "ki",     "kickid",        "kickid [steamid64]",     _cmdKickId },
+    { "lb",     "localban",      "localban [name|steamid64] {days}", _cmdLocalBan },
+
+    { "ls",     "lastseen",      "lastseen [partial name|steamid64]", _cmdLastSeen },
+    { "wi",     "whois",         "whois [partial name|steamid64]",    _cmdWhois },
 
     { "*",      "*",             "*",                      NULL }
 
 };
 
+//  Perfect hash of the short and long command names, built once at install: a seed is
+//  searched so that no two commands share a slot, so a lookup is one hash and one compare.
+//  cmdHashMask is 0 (linear search of cmdTable[]) if no seed was found.
+//
+#define CMD_HASH_MAXSLOTS   (1024)
+
+static short    cmdHashSlots[CMD_HASH_MAXSLOTS];            // cmdTable[] index, -1 = empty
+static unsigned cmdHashMask = 0;
+static unsigned cmdHashSeed = 0;
+
 // ===== write ok, error, or unauthorized status to in-game chat
 //
 static int _respSay( char msgArray[NUM_RESPONSES][CFS_FETCH_MAX] )
@@ -155,6 +190,95 @@ static char *_int2str( int numOut )
 }
 
 
+//  ==============================================================================================
+//  _duration2str
+//
+//  Humanized elapsed time e.g., "3d 4h", "2h 10m", "45s"
+//
+static char *_duration2str( unsigned long sec )
+{
+    static char strOut[256];
+
+    if      ( sec >= 86400L ) snprintf( strOut, 256, "%lud %luh", sec / 86400L, (sec % 86400L) / 3600L );
+    else if ( sec >= 3600L )  snprintf( strOut, 256, "%luh %lum", sec / 3600L, (sec % 3600L) / 60L );
+    else if ( sec >= 60L )    snprintf( strOut, 256, "%lum", sec / 60L );
+    else                      snprintf( strOut, 256, "%lus", sec );
+    return( strOut );
+}
+
+//  ==============================================================================================
+//  _pickMatch
+//
+//  Chooses the target among ranked partial name matches.  The target is unique if every
+//  match is the same player, or if exactly one player's name matches in full.  If several
+//  players qualify, the candidates are listed in game so the admin can be more specific.
+//  Returns 0 and the SteamID64 string if unique.
+//
+#define PICLADMIN_MATCH_MAX   (8)
+
+static int _pickMatch( char *arg, nindexMatch_t *matches, int matchCount, char *steamID )
+{
+    int i, kept, sameKey = 1;
+    char candidates[256];
+
+    strlcpy( steamID, "", 256 );
+    if ( matchCount == 0 ) return 1;
+
+    kept = ( matchCount < PICLADMIN_MATCH_MAX ) ? matchCount : PICLADMIN_MATCH_MAX;
+    for ( i=1; i<kept; i++ )
+        if ( matches[i].key != matches[0].key ) sameKey = 0;
+
+    if (( sameKey && ( matchCount == kept )) ||
+        (( matches[0].rank == NINDEX_RANK_EXACT ) && ( matches[1].rank != NINDEX_RANK_EXACT ))) {
+        sidToStr( matches[0].key, steamID );
+        return 0;
+    }
+
+    strlcpy( candidates, "", 256 );
+    for ( i=0; i<kept; i++ ) {
+        if ( i != 0 ) strlcat( candidates, ", ", 256 );
+        strlcat( candidates, matches[i].name, 256 );
+    }
+    apiSay( "Ambiguous '%s' (%d): %s%s", arg, matchCount, candidates, (matchCount > kept) ? ", ..." : "" );
+    return 1;
+}
+
+//  ==============================================================================================
+//  _onlineLookup
+//
+//  Translate partial name of a player currently in game to SteamID64.  Returns 0 if unique.
+//
+static int _onlineLookup( char *arg, char *steamID )
+{
+    nindexMatch_t matches[PICLADMIN_MATCH_MAX];
+
+    return( _pickMatch( arg, matches, rosterLookupPartialName( arg, matches, PICLADMIN_MATCH_MAX ), steamID ));
+}
+
+//  ==============================================================================================
+//  _historyLookup
+//
+//  Fetch player history by SteamID64, or by partial name of a player currently in game,
+//  or by partial name of any player on file if the store name index is enabled.
+//  Returns 0 if found.
+//
+static int _historyLookup( char *arg, pstoreRec_t *rec )
+{
+    char steamID[256];
+    nindexMatch_t matches[PICLADMIN_MATCH_MAX];
+    int matchCount;
+
+    if ( 0 == strlen( arg ) ) return 1;
+    if ( 0 == pstoreLookupStr( arg, rec ) ) return 0;
+
+    matchCount = rosterLookupPartialName( arg, matches, PICLADMIN_MATCH_MAX );
+    if ( matchCount == 0 ) 
+        matchCount = pstoreSearchName( arg, matches, PICLADMIN_MATCH_MAX );
+    if ( 0 != _pickMatch( arg, matches, matchCount, steamID )) return 1;
+    return( pstoreLookupStr( steamID, rec ) );
+}
+
+
 //  ==============================================================================================
 //  Individual Micro-Command Executors
 //
@@ -163,22 +287,27 @@ static char *_int2str( int numOut )
 
 // ===== "macros [alias]"
 //
+//  All steps go out in one pipelined RCON batch; the reply is ok only if every step was
+//  answered, else how many were not.
+//
 int _cmdMacros( char *arg, char *arg2, char *passThru ) 
 {
-    int i, j = 1, errCode = 1;
-    char *w;
-    char statusIn[ 1024 ];
+    int i, j, failCount, errCode = 1;
+    int stepOk[MACRO_MAXSTEPS];
+    picladminMacro_t *mPtr;
 
     for (i = 0; i<NUM_MACROS; i++) {
-        w = getWord( picladminConfig.macros[i], 0, "::");   // get the macro label
-        if ( w != NULL ) {                                  // skip blank entries (possible)
-            if ( 0 == strcmp( arg, w ) ) {                  // check if operator cmd match
-                while ( NULL != ( w = getWord( picladminConfig.macros[i], j++, "::" )) ) {
-                    errCode = (0 == apiRcon( w, statusIn ));
-                    if ( errCode ) break;
-                } 
-                break;
+        mPtr = &picladminConfig.macros[i];
+        if (( mPtr->label != NULL ) && ( 0 == strcmp( mPtr->label, arg ))) {
+            if ( mPtr->stepCount == 0 ) break;
+            failCount = mPtr->stepCount - apiRconBatch( mPtr->steps, mPtr->stepCount, stepOk );
+            if ( failCount != 0 ) {
+                for ( j=0; ( j<mPtr->stepCount ) && stepOk[j]; j++ ) ;
+                apiSay( "Macro %s: %d of %d steps failed, first '%s'", arg, failCount, mPtr->stepCount, mPtr->steps[j] );
+                return 1;                                   // not logged as executed
             }
+            errCode = 0;
+            break;
         }
     }
     _stddResp( errCode );   // ok or error message to game
@@ -191,14 +320,13 @@ int _cmdMacros( char *arg, char *arg2, char *passThru )
 int _cmdMacrosList( char *arg, char *arg2, char *passThru ) 
 {
     int i, errCode = 1;
-    char *w;
     char listOut[ 1024 ];
 
     strlcpy( listOut, "Macros: ", 1024 ); 
 
     for (i = 0; i<NUM_MACROS; i++) {
-        if ( 0 != strlen( picladminConfig.macros[i] )) {    // skip blank entries (possible)
-            strlcat( listOut, getWord( picladminConfig.macros[i], 0, "::" ), 1024 );
+        if ( picladminConfig.macros[i].label != NULL ) {               // skip blank entries (possible)
+            strlcat( listOut, picladminConfig.macros[i].label, 1024 );
             strlcat( listOut, " ",                       1024 );
             errCode = 0;
         }
@@ -413,12 +541,10 @@ int _cmdBanId( char *arg, char *arg2, char *passThru  )
     int errCode = 1;
     char cmdOut[256], statusIn[256];
 
-    if ( 17==strlen( arg ) ) {
-        if (NULL != strstr( arg, "765611" )) {
-            snprintf( cmdOut, 256, "banid %s", arg );
-            apiRcon( cmdOut, statusIn );
-            errCode = 0;
-        }
+    if ( sidIsValid( arg ) ) {
+        snprintf( cmdOut, 256, "banid %s", arg );
+        apiRcon( cmdOut, statusIn );
+        errCode = 0;
     }
 
     _stddResp( errCode );   // ok or error message to game
@@ -434,17 +560,56 @@ int _cmdKickId( char *arg, char *arg2, char *passThru  )
     int errCode = 1;
     char cmdOut[256], statusIn[256];
 
-    if ( IDSTEAMID64LEN == strlen( arg ) ) {
-        if (NULL != strstr( arg, "765611" )) {
-            snprintf( cmdOut, 256, "kick %s", arg );
-            apiRcon( cmdOut, statusIn );
+    if ( sidIsValid( arg ) ) {
+        snprintf( cmdOut, 256, "kick %s", arg );
+        apiRcon( cmdOut, statusIn );
+        errCode = 0;
+    }
+
+    _stddResp( errCode );   // ok or error message to game
+
+    return errCode;
+}
+
+// ===== "localban [partial-name|steamid] {days} {reason}"
+// add to the local ban list - target may be offline if specified by steamid.
+// days omitted or 0 is permanent
+//
+int _cmdLocalBan( char *arg, char *arg2, char *passThru  ) 
+{ 
+    int i, words = 2, errCode = 1;
+    unsigned long days = 0;
+    char steamID[256], *reason;
+
+    if ( sidIsValid( arg ) ) 
+        strlcpy( steamID, arg, 256 );
+    else if ( 0 != _onlineLookup( arg, steamID ) ) 
+        strlcpy( steamID, "", 256 );
+
+    if ( 0 != strlen( steamID ) ) {
+        if (( 0 != strlen( arg2 )) && ( strlen( arg2 ) == strspn( arg2, "0123456789" ))) {
+            days = strtoul( arg2, NULL, 10 );
+            words = 3;
+        }
+
+        // reason is whatever follows the command, target and days
+        //
+        reason = passThru;
+        for ( i=0; i<words; i++ ) {
+            reason += strspn( reason, " " );
+            reason += strcspn( reason, " " );
+        }
+        reason += strspn( reason, " " );
+
+        if ( 0 == banlistAdd( steamID, days * 86400L, (0 != strlen( reason )) ? reason : "picladmin" )) {
+            apiKickOrBan( 0, steamID, "Banned" );
             errCode = 0;
         }
     }
 
     _stddResp( errCode );   // ok or error message to game
 
-    return errCode;
+    return errCode; 
 }
 
 // ===== "ban [partial-name]"
@@ -454,8 +619,7 @@ int _cmdBan( char *arg, char *arg2, char *passThru  )
 { 
     int errCode = 1;
     char cmdOut[256], statusIn[256], steamID[256];
-    strlcpy( steamID, rosterLookupSteamIDFromPartialName( arg ), 256 );
-    if ( 0 != strlen( steamID ) ) {
+    if ( 0 == _onlineLookup( arg, steamID ) ) {
         snprintf( cmdOut, 256, "ban %s", steamID );
         apiRcon( cmdOut, statusIn );
         errCode = 0;
@@ -473,8 +637,7 @@ int _cmdKick( char *arg, char *arg2, char *passThru )
 { 
     int errCode = 1;
     char cmdOut[256], statusIn[256], steamID[256];
-    strlcpy( steamID, rosterLookupSteamIDFromPartialName( arg ), 256 );
-    if ( 0 != strlen( steamID ) ) {
+    if ( 0 == _onlineLookup( arg, steamID ) ) {
         snprintf( cmdOut, 256, "kick %s", steamID );
         apiRcon( cmdOut, statusIn );
         errCode = 0;
@@ -486,6 +649,60 @@ int _cmdKick( char *arg, char *arg2, char *passThru )
 }
 
 
+// ===== "lastseen [partial-name|steamid]"
+// target may be offline if specified by steamid
+//
+int _cmdLastSeen( char *arg, char *arg2, char *passThru ) 
+{ 
+    int errCode = 1;
+    pstoreRec_t rec;
+    unsigned long timeNow;
+
+    if ( 0 == _historyLookup( arg, &rec ) ) {
+        timeNow = apiTimeGet();
+        if ( rec.sessionStart != 0 ) 
+            apiSay( "%s [%llu] online for %s", rec.nameList[0], (unsigned long long) rec.steamID, 
+                _duration2str( timeNow - rec.sessionStart ));
+        else 
+            apiSay( "%s [%llu] last seen %s ago", rec.nameList[0], (unsigned long long) rec.steamID, 
+                _duration2str( timeNow - rec.lastSeen ));
+        errCode = 0;
+    }
+    else {
+        apiSay( "No history for '%s'", arg );
+    }
+    return errCode; 
+}
+
+// ===== "whois [partial-name|steamid]"
+// target may be offline if specified by steamid
+//
+int _cmdWhois( char *arg, char *arg2, char *passThru ) 
+{ 
+    int i, errCode = 1;
+    pstoreRec_t rec;
+    char akaList[256], playTime[256];
+
+    if ( 0 == _historyLookup( arg, &rec ) ) {
+        strlcpy( akaList, "", 256 );
+        for ( i=1; i<PSTORE_NAMES_MAX; i++ ) {
+            if ( 0 == strlen( rec.nameList[i] )) break;
+            strlcat( akaList, (i == 1) ? " aka " : ", ", 256 );
+            strlcat( akaList, rec.nameList[i], 256 );
+        }
+        strlcpy( playTime, _duration2str( rec.totalPlaySec ), 256 );
+        apiSay( "%s [%llu] %u sessions, played %s, first seen %s ago%s", 
+            rec.nameList[0], (unsigned long long) rec.steamID, rec.sessionCount, 
+            playTime, _duration2str( apiTimeGet() - rec.firstSeen ), akaList );
+        errCode = 0;
+    }
+    else {
+        apiSay( "No history for '%s'", arg );
+    }
+    return errCode; 
+}
+
+
 // ===== "gamemodeproperty [cvar] [value]"
 // Change or read gamemodeproperty
 //
@@ -549,6 +766,36 @@ int _cmdRcon( char *arg, char *arg2, char *passThru )
 }
 
 
+//  ==============================================================================================
+//  _macroCompile (local)
+//
+//  Split a macro definition "label::step::step..." into its label and RCON command steps.
+//  Steps past MACRO_MAXSTEPS are dropped (logged).
+//
+static void _macroCompile( picladminMacro_t *mPtr, char *definition )
+{
+    wordIter_t it;
+    strView_t w[ MACRO_MAXSTEPS + 1 ], extra;
+    int i, n = 0;
+
+    strlcpy( mPtr->text, definition, sizeof( mPtr->text ));
+    mPtr->label = NULL;
+    mPtr->stepCount = 0;
+
+    // find all the words first, then terminate them in place
+    //
+    wordIterInit( &it, mPtr->text, "::" );
+    while (( n <= MACRO_MAXSTEPS ) && ( wordIterNext( &it, &w[n] ))) n++;
+    if (( n > MACRO_MAXSTEPS ) && ( wordIterNext( &it, &extra )))
+        logPrintf( LOG_LEVEL_WARN, "picladmin", "Macro has more than %d steps, rest ignored ::%s::", MACRO_MAXSTEPS, definition );
+    for ( i=0; i<n; i++ ) ((char *) w[i].ptr)[ w[i].len ] = 0;
+
+    if ( n > 0 ) mPtr->label = (char *) w[0].ptr;
+    for ( i=1; i<n; i++ ) mPtr->steps[ mPtr->stepCount++ ] = (char *) w[i].ptr;
+    return;
+}
+
+
 //  ==============================================================================================
 //  picladminInitConfig
 //
@@ -557,6 +804,7 @@ int _cmdRcon( char *arg, char *arg2, char *passThru )
 int picladminInitConfig( void )
 {
     cfsPtr cP;
+    int i;
 
     cP = cfsCreate( sissmGetConfigPath() );
 
@@ -565,40 +813,23 @@ int picladminInitConfig( void )
 
     // Read the humanized responses for when a command is issued can was successfully executed
     //
-    strlcpy( picladminConfig.msgOk[0],       cfsFetchStr( cP, "picladmin.msgOk[0]",      "Ok!" ),             CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgOk[1],       cfsFetchStr( cP, "picladmin.msgOk[1]",      "Ok!" ),             CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgOk[2],       cfsFetchStr( cP, "picladmin.msgOk[2]",      "Ok!" ),             CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgOk[3],       cfsFetchStr( cP, "picladmin.msgOk[3]",      "Ok!" ),             CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgOk[4],       cfsFetchStr( cP, "picladmin.msgOk[4]",      "Ok!" ),             CFS_FETCH_MAX);
+    for ( i=0; i<NUM_RESPONSES; i++ )
+        strlcpy( picladminConfig.msgOk[i], cfsFetchStrIndex( cP, "picladmin.msgOk", i, "Ok!" ), CFS_FETCH_MAX );
 
     // Read the humanized responses for when a command has an error
     //
-    strlcpy( picladminConfig.msgErr[0],      cfsFetchStr( cP, "picladmin.msgErr[0]",     "Invalid Syntax!" ), CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgErr[1],      cfsFetchStr( cP, "picladmin.msgErr[1]",     "Invalid Syntax!" ), CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgErr[2],      cfsFetchStr( cP, "picladmin.msgErr[2]",     "Invalid Syntax!" ), CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgErr[3],      cfsFetchStr( cP, "picladmin.msgErr[3]",     "Invalid Syntax!" ), CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgErr[4],      cfsFetchStr( cP, "picladmin.msgErr[4]",     "Invalid Syntax!" ), CFS_FETCH_MAX);
+    for ( i=0; i<NUM_RESPONSES; i++ )
+        strlcpy( picladminConfig.msgErr[i], cfsFetchStrIndex( cP, "picladmin.msgErr", i, "Invalid Syntax!" ), CFS_FETCH_MAX );
 
     // Read the humanized responses for when a non-admin tries to use a command
     //
-    strlcpy( picladminConfig.msgInvalid[0], cfsFetchStr( cP, "picladmin.msgInvalid[0]",  "Unauthorized!" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgInvalid[1], cfsFetchStr( cP, "picladmin.msgInvalid[1]",  "Unauthroized!" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgInvalid[2], cfsFetchStr( cP, "picladmin.msgInvalid[2]",  "Unauthroized!" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgInvalid[3], cfsFetchStr( cP, "picladmin.msgInvalid[3]",  "Unauthroized!" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.msgInvalid[4], cfsFetchStr( cP, "picladmin.msgInvalid[4]",  "Unauthorized!" ),   CFS_FETCH_MAX);
+    for ( i=0; i<NUM_RESPONSES; i++ )
+        strlcpy( picladminConfig.msgInvalid[i], cfsFetchStrIndex( cP, "picladmin.msgInvalid", i, "Unauthorized!" ), CFS_FETCH_MAX );
 
     // Read the operator-specified "macro" (alias) sequence
     //
-    strlcpy( picladminConfig.macros[0],     cfsFetchStr( cP, "picladmin.macros[0]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[1],     cfsFetchStr( cP, "picladmin.macros[1]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[2],     cfsFetchStr( cP, "picladmin.macros[2]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[3],     cfsFetchStr( cP, "picladmin.macros[3]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[4],     cfsFetchStr( cP, "picladmin.macros[4]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[5],     cfsFetchStr( cP, "picladmin.macros[5]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[6],     cfsFetchStr( cP, "picladmin.macros[6]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[7],     cfsFetchStr( cP, "picladmin.macros[7]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[8],     cfsFetchStr( cP, "picladmin.macros[8]",  "" ),   CFS_FETCH_MAX);
-    strlcpy( picladminConfig.macros[9],     cfsFetchStr( cP, "picladmin.macros[9]",  "" ),   CFS_FETCH_MAX);
+    for ( i=0; i<NUM_MACROS; i++ )
+        _macroCompile( &picladminConfig.macros[i], cfsFetchStrIndex( cP, "picladmin.macros", i, "" ));
 
     strlcpy( picladminConfig.cmdPrefix,      cfsFetchStr( cP, "picladmin.cmdPrefix",      "!" ),              CFS_FETCH_MAX);
 
@@ -627,12 +858,91 @@ int picladminGameEndCB( char *strIn ) { return 0; }
 int picladminRoundStartCB( char *strIn ) { return 0; }
 int picladminRoundEndCB( char *strIn ) { return 0; }
 int picladminCapturedCB( char *strIn ) { return 0; }
-int picladminPeriodicCB( char *strIn ) { return 0; }
 int picladminShutdownCB( char *strIn ) { return 0; }
 int picladminClientSynthDelCB( char *strIn ) { return 0; }
 int picladminClientSynthAddCB( char *strIn ) { return 0; }
 
 
+//  ==============================================================================================
+//  _cmdHash (local)
+//
+//  FNV-1a with a seed mixed into the offset basis
+//
+static unsigned _cmdHash( const char *name, unsigned seed )
+{
+    unsigned h = 2166136261u ^ (seed * 0x9e3779b9u);
+
+    while ( *name ) {
+        h ^= (unsigned char) *name++;
+        h *= 16777619u;
+    }
+    return( h ^ (h >> 15) );
+}
+
+
+//  ==============================================================================================
+//  _cmdHashBuild (local)
+//
+//  Build the perfect hash of cmdTable[]: for table sizes from twice the number of names
+//  up, try seeds until every name lands in a slot not used by another command (the short
+//  and long name of one command may share).  Called once at install.
+//
+static void _cmdHashBuild( void )
+{
+    unsigned size, seed, slot, mask;
+    int i, k, names = 0, collision = 1;
+    char *name;
+
+    for ( i=0; 0 != strcmp( cmdTable[i].cmdShort, "*" ); i++ ) names += 2;
+
+    for ( size = 16; size < (unsigned) (2 * names); size *= 2 ) ;
+    for ( ; collision && ( size <= CMD_HASH_MAXSLOTS ); size *= 2 ) {
+        mask = size - 1;
+        for ( seed = 1; collision && ( seed <= 5000 ); seed++ ) {
+            collision = 0;
+            for ( slot = 0; slot < size; slot++ ) cmdHashSlots[slot] = -1;
+            for ( i=0; ( !collision ) && ( 0 != strcmp( cmdTable[i].cmdShort, "*" )); i++ ) {
+                for ( k=0; k<2; k++ ) {
+                    name = ( k == 0 ) ? cmdTable[i].cmdShort : cmdTable[i].cmdLong;
+                    slot = _cmdHash( name, seed ) & mask;
+                    if (( cmdHashSlots[slot] != -1 ) && ( cmdHashSlots[slot] != i )) collision = 1;
+                    cmdHashSlots[slot] = (short) i;
+                }
+            }
+            if ( !collision ) {
+                cmdHashSeed = seed;
+                cmdHashMask = mask;
+            }
+        }
+    }
+    if ( collision ) logPrintf( LOG_LEVEL_WARN, "picladmin", "No perfect hash for the command table, using linear search" );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _cmdLookup (local)
+//
+//  Returns the cmdTable[] index of a short or long command name, or -1 if unknown.
+//
+static int _cmdLookup( char *cmdName )
+{
+    int i;
+
+    if ( cmdHashMask != 0 ) {
+        i = cmdHashSlots[ _cmdHash( cmdName, cmdHashSeed ) & cmdHashMask ];
+        if (( i >= 0 ) && (( 0 == strcmp( cmdTable[i].cmdShort, cmdName )) || ( 0 == strcmp( cmdTable[i].cmdLong, cmdName ))))
+            return( i );
+        return( -1 );
+    }
+    for ( i=0; 0 != strcmp( cmdTable[i].cmdShort, "*" ); i++ ) {
+        if (( 0 == strcmp( cmdTable[i].cmdShort, cmdName )) || ( 0 == strcmp( cmdTable[i].cmdLong, cmdName )))
+            return( i );
+    }
+    return( -1 );
+}
+
+
 //  ==============================================================================================
 //  _commandExecute
 //
@@ -641,8 +951,10 @@ int picladminClientSynthAddCB( char *strIn ) { return 0; }
 //
 int _commandExecute( char *cmdString, char *originID ) 
 {   
-    char *p, cmdOut[256], arg1Out[256], arg2Out[256];
+    char cmdOut[256], arg1Out[256], arg2Out[256];
     int i, errCode = 1;
+    wordIter_t it;
+    strView_t w;
 
     // zero the physical stores
     //
@@ -651,9 +963,10 @@ int _commandExecute( char *cmdString, char *originID )
     // The input string cmdString will be in the format, e.g., "botfixed 30"
     // parse command vs arguments and invoke the string-matched function 
     //
-    if ( NULL != (p = getWord( cmdString, 0, " " ) )) strlcpy( cmdOut,  p, 256);
-    if ( NULL != (p = getWord( cmdString, 1, " " ) )) strlcpy( arg1Out, p, 256);
-    if ( NULL != (p = getWord( cmdString, 2, " " ) )) strlcpy( arg2Out, p, 256);
+    wordIterInit( &it, cmdString, " " );
+    if ( wordIterNext( &it, &w )) strViewCopy( cmdOut,  256, &w );
+    if ( wordIterNext( &it, &w )) strViewCopy( arg1Out, 256, &w );
+    if ( wordIterNext( &it, &w )) strViewCopy( arg2Out, 256, &w );
 
     // Handle special 'help' case for when no argument is specified
     // 
@@ -662,20 +975,13 @@ int _commandExecute( char *cmdString, char *originID )
         strlcpy( cmdOut, "help",  256 );
     } 
 
-    // loop through the command table
+    // look up the command and invoke it
     //
-    i = 0;
-    while ( 1==1 ) {
-        if ( (0 == strcmp( cmdTable[i].cmdShort, cmdOut )) || (0 == strcmp( cmdTable[i].cmdLong, cmdOut )) ) {
-            errCode = (*cmdTable[i].cmdFunction)( arg1Out, arg2Out, cmdString );
-            if ( errCode == 0 ) {
-                logPrintf( LOG_LEVEL_INFO, "picladmin", "Admin [%s] executed: %s", originID, cmdString );
-            }
-            break;
+    if ( 0 <= (i = _cmdLookup( cmdOut ))) {
+        errCode = (*cmdTable[i].cmdFunction)( arg1Out, arg2Out, cmdString );
+        if ( errCode == 0 ) {
+            logPrintf( LOG_LEVEL_INFO, "picladmin", "Admin [%s] executed: %s", originID, cmdString );
         }
-        i++;
-        if ( 0==strcmp( cmdTable[i].cmdShort, "*") )
-            break;
     }
     return errCode; 
 }
@@ -737,7 +1043,11 @@ int _commandParse( char *strIn, int maxStringSize, char *clientGUID, char *cmdSt
 //
 int picladminChatCB( char *strIn )
 {
-    char clientGUID[1024], cmdString[1024];
+    char *clientGUID, *cmdString;
+
+    clientGUID = (char *) arenaAlloc( 1024 );
+    cmdString  = (char *) arenaAlloc( 1024 );
+    if (( clientGUID == NULL ) || ( cmdString == NULL )) return 0;
 
     if ( 0 == _commandParse( strIn, 1024, clientGUID, cmdString )) {    // parse for valid format
         if (apiIsAdmin( clientGUID )) {                                    // check if authorized
@@ -751,6 +1061,47 @@ int picladminChatCB( char *strIn )
 }
 
 
+//  ==============================================================================================
+//  picladminCtlCB (local)
+//
+//  Control socket 'admin' command: execute a chat admin command (without the prefix) from
+//  a local tool.  The socket is trusted as an admin, and the replies normally said in game
+//  are returned to the tool instead.
+//
+static int picladminCtlCB( char *args, strBuf_t *bPtr )
+{
+    char cmdString[1024];
+    int errCode;
+
+    strlcpy( cmdString, args, sizeof( cmdString ));
+    strTrimInPlace( cmdString );
+
+    apiSayCapture( bPtr );
+    errCode = _commandExecute( cmdString, "control" );
+    apiSayCapture( NULL );
+
+    if (( errCode != 0 ) && ( bPtr->len == 0 ))
+        strBufPrintf( bPtr, "unknown admin command, try 'admin help'" );
+    return errCode;
+}
+
+
+//  ==============================================================================================
+//  picladminReloadConfigCB
+//
+//  Re-reads the command prefix and reply messages and recompiles the macros.  The command
+//  table and the ctl "admin" hook are set up once at install.  pluginState is kept.
+//
+int picladminReloadConfigCB( char *strIn )
+{
+    int pluginState = picladminConfig.pluginState;
+
+    picladminInitConfig();
+    picladminConfig.pluginState = pluginState;
+    return 0;
+}
+
+
 //  ==============================================================================================
 //  picladminInstallPlugin
 //
@@ -767,6 +1118,8 @@ int picladminInstallPlugin( void )
     //
     if ( picladminConfig.pluginState == 0 ) return 0;
 
+    _cmdHashBuild();
+
     // Install Event-driven CallBack hooks so the plugin gets
     // notified for various happenings.  A complete list is here,
     // but comment out what is not needed for your plug-in.
@@ -781,11 +1134,13 @@ int picladminInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          picladminRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            picladminRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   picladminCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             picladminPeriodicCB );
     eventsRegister( SISSM_EV_SHUTDOWN,             picladminShutdownCB );
     eventsRegister( SISSM_EV_CLIENT_ADD_SYNTH,     picladminClientSynthAddCB );
     eventsRegister( SISSM_EV_CLIENT_DEL_SYNTH,     picladminClientSynthDelCB );
     eventsRegister( SISSM_EV_CHAT,                 picladminChatCB );
+    eventsRegister( SISSM_EV_RELOAD,               picladminReloadConfigCB );
+
+    ctlRegister( "admin", "admin <command>: any in-game admin command", picladminCtlCB );
     return 0;
 }
 
@@ -34,8 +34,12 @@
 #include "cfs.h"
 #include "util.h"
 #include "alarm.h"
+#include "metrics.h"
 
 #include "roster.h"
+#include "pstore.h"
+#include "banlist.h"
+#include "cidr.h"
 #include "api.h"
 #include "sissm.h"
 
@@ -45,8 +49,15 @@
 //  Data definition 
 //
 //
-#define PRILISTMAX (100)
 #define PIGATEWAY_RESTART_LOCKOUT_SEC  (60)      // #secs to exempt full-server kick after restart
+#define PIGATEWAY_IPBLOCK_FILES         (4)                   // max number of IP block list files
+
+#define PIGATEWAY_ADMIT_OK              (0)                  // admission verdicts, for metrics
+#define PIGATEWAY_ADMIT_BANNED          (1)
+#define PIGATEWAY_ADMIT_BLOCKED         (2)
+#define PIGATEWAY_ADMIT_FULL            (3)
+#define PIGATEWAY_ADMIT_BADNAME         (4)
+#define PIGATEWAY_ADMIT_VERDICTS        (5)
 
 static struct {
 
@@ -56,16 +67,26 @@ static struct {
     char adminListFilePath[CFS_FETCH_MAX];
     int  gameChangeLockoutSec;
     int  enableBadNameFilter;
+    unsigned long tenurePrioritySec;      // play time on file to qualify for reserved slots, 0=off
+    char ipBlockFile[PIGATEWAY_IPBLOCK_FILES][CFS_FETCH_MAX];     // IP/CIDR block lists, "" unused
 
     int  adminPortDisable;                   // for disable admin port blocking during game change
     alarmObj *aPtr;                                 // create a 'lockout' alarm druing game change
 
 } pigatewayConfig;
 
-static char prioritySteamID[PRILISTMAX][80];
-
 static unsigned long timeRestarted = 0L;
 
+static cidrObj *ipBlockList = NULL;                    // merged IP block lists, NULL if none
+
+static const char *admitVerdictNames[ PIGATEWAY_ADMIT_VERDICTS ] = {
+    "admitted", "banned", "blocked_network", "server_full", "bad_name" };
+static const uint64_t admitLatencyBoundsUs[] = {
+    10000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000 };
+
+static metricsObj *admitVerdictMetric[ PIGATEWAY_ADMIT_VERDICTS ];
+static metricsObj *admitLatencyMetric = NULL;
+
 
 //  ==============================================================================================
 //  _isPriority
@@ -74,24 +95,60 @@ static unsigned long timeRestarted = 0L;
 //
 static int _isPriority( char *connectID )
 {
-    int i;
     int isMatch = 0;
+    pstoreRec_t rec;
 
     // check if system admin
     //
     isMatch = apiIsAdmin( connectID );
 
-    // Reserved for future expansion - can be expanded to admit players from 
-    // 2nd or even 3rd list to access reserved slots.
+    // check if a regular with enough accumulated play time (player history store)
     //
-    ;; 
-    ;;
-    ;;
+    if ( !isMatch && ( 0 != pigatewayConfig.tenurePrioritySec )) {
+        if ( 0 == pstoreLookupStr( connectID, &rec )) 
+            isMatch = ( rec.totalPlaySec >= pigatewayConfig.tenurePrioritySec );
+    }
 
     return( isMatch );
 }
 
 
+//  ==============================================================================================
+//  _ipBlockLoad
+//
+//  Load all configured IP block list files into one range table.  Range tag is the list
+//  number, for logging.
+//
+static void _ipBlockLoad( void )
+{
+    int i, n, total = 0;
+    cidrObj *newList = NULL;
+
+    // build the new table aside and swap it in, so a reload never exposes a partial list
+    //
+    for ( i=0; i<PIGATEWAY_IPBLOCK_FILES; i++ ) {
+        if ( 0 == strlen( pigatewayConfig.ipBlockFile[i] )) continue;
+        if ( newList == NULL ) newList = cidrCreate();
+        if ( 0 > (n = cidrLoadFile( newList, pigatewayConfig.ipBlockFile[i], i ))) {
+            logPrintf( LOG_LEVEL_CRITICAL, "pigateway", "Unable to read IP block list ::%s::", pigatewayConfig.ipBlockFile[i] );
+        }
+        else {
+            logPrintf( LOG_LEVEL_CRITICAL, "pigateway", "IP block list %d ranges from file %s", n, pigatewayConfig.ipBlockFile[i] );
+            total += n;
+        }
+    }
+    if ( newList != NULL ) cidrFinalize( newList );
+    cidrDestroy( ipBlockList );
+    ipBlockList = newList;
+
+    if ( ipBlockList != NULL ) {
+        logPrintf( LOG_LEVEL_INFO, "pigateway", "IP block list %d ranges total, %d IPv4 + %d IPv6 after merge", 
+            total, ipBlockList->v4Count, ipBlockList->v6Count );
+    }
+    return;
+}
+
+
 //  ==============================================================================================
 //  _isBadName
 //
@@ -128,6 +185,7 @@ int pigatewayGameChangeAlarmCB( char *str )
 int pigatewayInitConfig( void )
 {
     cfsPtr cP;
+    int i;
 
     cP = cfsCreate( sissmGetConfigPath() );
 
@@ -138,20 +196,36 @@ int pigatewayInitConfig( void )
     pigatewayConfig.firstAdminSlotNo = (int) cfsFetchNum( cP, "pigateway.firstAdminSlotNo", 11 );
     pigatewayConfig.enableBadNameFilter = (int) cfsFetchNum( cP, "pigateway.enableBadNameFilter", 1 );
     pigatewayConfig.gameChangeLockoutSec = (int) cfsFetchNum( cP, "pigateway.gameChangeLockoutSec", 120 );
+    pigatewayConfig.tenurePrioritySec = (unsigned long) cfsFetchNum( cP, "pigateway.tenurePrioritySec", 0 );
     strlcpy( pigatewayConfig.adminListFilePath,  
         cfsFetchStr( cP, "pigateway.adminListFilePath",  "admins.txt" ), CFS_FETCH_MAX);
+    for ( i=0; i<PIGATEWAY_IPBLOCK_FILES; i++ )
+        strlcpy( pigatewayConfig.ipBlockFile[i], cfsFetchStrIndex( cP, "pigateway.ipBlockFile", i, "" ), CFS_FETCH_MAX );
 
     cfsDestroy( cP );
 
     // _priSlots_init( pigatewayConfig.adminListFilePath, 0 );
 
-    pigatewayConfig.adminPortDisable = 0;
-    pigatewayConfig.aPtr = alarmCreate( pigatewayGameChangeAlarmCB );
-    logPrintf( LOG_LEVEL_DEBUG, "pigateway", "Created lockout alarm" );
+    _ipBlockLoad();
 
     return 0;
 }
 
+//  ==============================================================================================
+//  _admitDecided (local)
+//
+//  Counts an admission verdict and, if the game log reported the join, observes the time
+//  from the join line to the decision (kick sent, or admitted).
+//
+static void _admitDecided( char *playerName, int verdict )
+{
+    uint64_t joinUs = apiJoinTimeUs( playerName );
+
+    metricsInc( admitVerdictMetric[ verdict ] );
+    if ( joinUs != 0 ) metricsObserveUs( admitLatencyMetric, metricsNowUs() - joinUs );
+    return;
+}
+
 //  ==============================================================================================
 //  pigatewayClientSynthAddCB
 //
@@ -160,17 +234,42 @@ int pigatewayInitConfig( void )
 int pigatewayClientSynthAddCB( char *strIn )
 {
     static char playerName[256], playerGUID[256], playerIP[256];
+    char banReason[BANLIST_REASON_MAX];
+    uint32_t blockListNo;
     int alreadyKicked = 0;
 
     rosterParsePlayerSynthConn( strIn, 256, playerName, playerGUID, playerIP );
     logPrintf( LOG_LEVEL_INFO, "pigateway", "Synthetic ADD Callback Name ::%s:: IP ::%s:: GUID ::%s::", 
         playerName, playerIP, playerGUID );
 
+    // local ban list is checked first - no other admission rule applies to a banned player
+    //
+    if ( banlistCheck( playerGUID, banReason, BANLIST_REASON_MAX ) ) {
+        apiKickOrBanNow( 0, playerGUID, "Banned" );
+        _admitDecided( playerName, PIGATEWAY_ADMIT_BANNED );
+        apiSay ( "Player %s kicked - banned", playerName );
+        logPrintf( LOG_LEVEL_CRITICAL, "pigateway", "Local Ban List Kick ::%s::%s::%s:: reason ::%s::", 
+            playerName, playerGUID, playerIP, banReason );
+        return 0;
+    }
+
+    // IP block lists (VPN, hosting ranges) - admins are exempt
+    //
+    if ( cidrLookup( ipBlockList, playerIP, &blockListNo ) && !apiIsAdmin( playerGUID ) ) {
+        apiKickOrBanNow( 0, playerGUID, "Blocked_Network" );
+        _admitDecided( playerName, PIGATEWAY_ADMIT_BLOCKED );
+        apiSay ( "Player %s kicked - network blocked", playerName );
+        logPrintf( LOG_LEVEL_CRITICAL, "pigateway", "IP Block List %d Kick ::%s::%s::%s::", 
+            (int) blockListNo, playerName, playerGUID, playerIP );
+        return 0;
+    }
+
     if (apiPlayersGetCount() >= pigatewayConfig.firstAdminSlotNo ) {         // check if these are admin-only slots
         if ( !_isPriority( playerGUID ) && (pigatewayConfig.adminPortDisable == 0) ) {     // check if this is an admin
 
             if ( (apiTimeGet() - timeRestarted) > PIGATEWAY_RESTART_LOCKOUT_SEC ) {  // check if we are restarting
-                apiKickOrBan( 0, playerGUID, "Server_Full" );
+                apiKickOrBanNow( 0, playerGUID, "Server_Full" );
+                _admitDecided( playerName, PIGATEWAY_ADMIT_FULL );
                 apiSay ( "Player %s kicked Server Full", playerName );
                 logPrintf( LOG_LEVEL_CRITICAL, "pigateway", "Full Server Kick ::%s::%s::%s::", 
                     playerName, playerGUID, playerIP );
@@ -188,12 +287,15 @@ int pigatewayClientSynthAddCB( char *strIn )
     //
     if ( (0 == alreadyKicked) && (pigatewayConfig.enableBadNameFilter) ) {
         if ( _isBadName( playerName ) ) {
-            apiKickOrBan( 0, playerGUID, "" );
+            apiKickOrBanNow( 0, playerGUID, "" );
+            _admitDecided( playerName, PIGATEWAY_ADMIT_BADNAME );
             apiSay ( "Player %s auto-kicked by server", playerName );
             logPrintf( LOG_LEVEL_INFO, "pigateway", "Bad Name Auto-kick ::%s::%s::%s::", 
                 playerName, playerGUID, playerIP );
+            alreadyKicked = 1;
         }
     }
+    if ( 0 == alreadyKicked ) _admitDecided( playerName, PIGATEWAY_ADMIT_OK );
     return 0;
 }
 
@@ -334,13 +436,17 @@ int pigatewayCapturedCB( char *strIn )
 }
 
 //  ==============================================================================================
-//  ...
+//  pigatewayReloadConfigCB
 //
-//  ...
-//  ...
+//  Re-reads the admin slot, name filter, lockout and tenure settings and reloads the IP
+//  block lists.  The running lockout alarm and metrics are kept.  pluginState is kept.
 //
-int pigatewayPeriodicCB( char *strIn )
+int pigatewayReloadConfigCB( char *strIn )
 {
+    int pluginState = pigatewayConfig.pluginState;
+
+    pigatewayInitConfig();
+    pigatewayConfig.pluginState = pluginState;
     return 0;
 }
 
@@ -352,14 +458,28 @@ int pigatewayPeriodicCB( char *strIn )
 //
 int pigatewayInstallPlugin( void )
 {
+    char labels[64];
+    int i;
+
     // Read the plugin-specific variables from the .cfg file 
     // 
     pigatewayInitConfig();
 
+    pigatewayConfig.adminPortDisable = 0;
+    pigatewayConfig.aPtr = alarmCreate( pigatewayGameChangeAlarmCB );
+    logPrintf( LOG_LEVEL_DEBUG, "pigateway", "Created lockout alarm" );
+
     // if plugin is disabled in the .cfg file then do not activate
     //
     if ( pigatewayConfig.pluginState == 0 ) return 0;
 
+    for ( i=0; i<PIGATEWAY_ADMIT_VERDICTS; i++ ) {
+        snprintf( labels, sizeof( labels ), "verdict=\"%s\"", admitVerdictNames[i] );
+        admitVerdictMetric[i] = metricsCounter( "sissm_admission_total", "Admission decisions on joining players", labels );
+    }
+    admitLatencyMetric = metricsHistogram( "sissm_admission_seconds", "Join log line to admission decision (kick sent, or admitted)",
+        "", admitLatencyBoundsUs, sizeof( admitLatencyBoundsUs ) / sizeof( admitLatencyBoundsUs[0] ));
+
     // Install Event-driven CallBack hooks so the plugin gets
     // notified for various happenings.  A complete list is here,
     // but comment out what is not needed for your plug-in.
@@ -374,9 +494,9 @@ int pigatewayInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          pigatewayRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            pigatewayRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   pigatewayCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             pigatewayPeriodicCB );
     eventsRegister( SISSM_EV_CLIENT_ADD_SYNTH,     pigatewayClientSynthAddCB );
     eventsRegister( SISSM_EV_CLIENT_DEL_SYNTH,     pigatewayClientSynthDelCB );
+    eventsRegister( SISSM_EV_RELOAD,               pigatewayReloadConfigCB );
 
     timeRestarted = apiTimeGet();
     return 0;
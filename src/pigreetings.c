@@ -34,8 +34,10 @@
 #include "cfs.h"
 #include "util.h"
 #include "alarm.h"
+#include "arena.h"
 
 #include "roster.h"
+#include "sid.h"
 #include "api.h"
 #include "sissm.h"
 
@@ -58,7 +60,7 @@ static struct {
     char serverGreetings[2][CFS_FETCH_MAX];
     char serverRules[10][CFS_FETCH_MAX];
 
-    char incognitoGUID[CFS_FETCH_MAX];
+    sidSet_t incognitoSet;                                      // SteamID64s not announced
 
     char connected[CFS_FETCH_MAX];
     char connectedAsAdmin[CFS_FETCH_MAX];
@@ -78,10 +80,25 @@ static int _isIncognito( char *playerGUID )
 {
     int isIncognito = 0;
 
-    if ( NULL != strstr( pigreetingsConfig.incognitoGUID, playerGUID )) isIncognito = 1;
+    if ( sidSetHas( &pigreetingsConfig.incognitoSet, sidParse( playerGUID ))) isIncognito = 1;
     return isIncognito;
 }
 
+//  ==============================================================================================
+//  _allocPlayerFields
+//
+//  Per-tick arena storage for the 256-byte name/GUID/IP fields of a connect/disconnect event.
+//  Released by the main loop after dispatch.  Returns non-zero if out of memory.
+//
+static int _allocPlayerFields( char **playerName, char **playerGUID, char **playerIP )
+{
+    *playerName = (char *) arenaAlloc( 256 );
+    *playerGUID = (char *) arenaAlloc( 256 );
+    *playerIP   = (char *) arenaAlloc( 256 );
+
+    return ( (*playerName == NULL) || (*playerGUID == NULL) || (*playerIP == NULL) );
+}
+
 
 
 //  ==============================================================================================
@@ -92,6 +109,7 @@ static int _isIncognito( char *playerGUID )
 int pigreetingsInitConfig( void )
 {
     cfsPtr cP;
+    int i;
 
     cP = cfsCreate( sissmGetConfigPath() );
 
@@ -105,8 +123,8 @@ int pigreetingsInitConfig( void )
 
     // read the 2-line greeting messages
     // 
-    strlcpy( pigreetingsConfig.serverGreetings[0], cfsFetchStr( cP, "pigreetings.servergreetings[0]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverGreetings[1], cfsFetchStr( cP, "pigreetings.servergreetings[1]", "" ), CFS_FETCH_MAX );
+    for ( i=0; i<2; i++ )
+        strlcpy( pigreetingsConfig.serverGreetings[i], cfsFetchStrIndex( cP, "pigreetings.servergreetings", i, "" ), CFS_FETCH_MAX );
 
     // read the rules display enabler
     //
@@ -114,20 +132,13 @@ int pigreetingsInitConfig( void )
 
     // read the 10 rule lines
     // 
-    strlcpy( pigreetingsConfig.serverRules[0], cfsFetchStr( cP, "pigreetings.serverrules[0]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[1], cfsFetchStr( cP, "pigreetings.serverrules[1]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[2], cfsFetchStr( cP, "pigreetings.serverrules[2]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[3], cfsFetchStr( cP, "pigreetings.serverrules[3]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[4], cfsFetchStr( cP, "pigreetings.serverrules[4]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[5], cfsFetchStr( cP, "pigreetings.serverrules[5]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[6], cfsFetchStr( cP, "pigreetings.serverrules[6]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[7], cfsFetchStr( cP, "pigreetings.serverrules[7]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[8], cfsFetchStr( cP, "pigreetings.serverrules[8]", "" ), CFS_FETCH_MAX );
-    strlcpy( pigreetingsConfig.serverRules[9], cfsFetchStr( cP, "pigreetings.serverrules[9]", "" ), CFS_FETCH_MAX );
+    for ( i=0; i<10; i++ )
+        strlcpy( pigreetingsConfig.serverRules[i], cfsFetchStrIndex( cP, "pigreetings.serverrules", i, "" ), CFS_FETCH_MAX );
 
     // read the list of incognito GUIDs
     //
-    strlcpy( pigreetingsConfig.incognitoGUID, cfsFetchStr( cP, "pigreetings.incognitoGUID", "" ), CFS_FETCH_MAX );
+    sidSetClear( &pigreetingsConfig.incognitoSet );
+    sidSetParseList( &pigreetingsConfig.incognitoSet, cfsFetchStr( cP, "pigreetings.incognitoGUID", "" ));
 
     // read 'connected' and 'disconnected' (as in 'ZZZZ connected' for localization)
     // 
@@ -149,7 +160,9 @@ int pigreetingsInitConfig( void )
 //
 int pigreetingsClientAddCB( char *strIn )
 {
-    char playerName[256], playerGUID[256], playerIP[256];
+    char *playerName, *playerGUID, *playerIP;
+
+    if ( 0 != _allocPlayerFields( &playerName, &playerGUID, &playerIP )) return 0;
 
     rosterParsePlayerConn( strIn, 256, playerName, playerGUID, playerIP );
     logPrintf( LOG_LEVEL_CRITICAL, "pigreetings", "Add Client ::%s::%s::%s::", playerName, playerGUID, playerIP );
@@ -169,7 +182,9 @@ int pigreetingsClientAddCB( char *strIn )
 //
 int pigreetingsClientDelCB( char *strIn )
 {
-    char playerName[256], playerGUID[256], playerIP[256];
+    char *playerName, *playerGUID, *playerIP;
+
+    if ( 0 != _allocPlayerFields( &playerName, &playerGUID, &playerIP )) return 0;
 
     rosterParsePlayerDisConn( strIn, 256, playerName, playerGUID, playerIP );
     // logPrintf( LOG_LEVEL_DEBUG, "pigreetings", "Del Client ::%s::%s::%s::", playerName, playerGUID, playerIP );
@@ -190,7 +205,9 @@ int pigreetingsClientDelCB( char *strIn )
 //
 int pigreetingsClientSynthDelCB( char *strIn )
 {
-    char playerName[256], playerGUID[256], playerIP[256];
+    char *playerName, *playerGUID, *playerIP;
+
+    if ( 0 != _allocPlayerFields( &playerName, &playerGUID, &playerIP )) return 0;
 
     rosterParsePlayerSynthDisConn( strIn, 256, playerName, playerGUID, playerIP );
     // rosterParsePlayerDisConn( strIn, playerName, playerGUID, playerIP );
@@ -216,7 +233,9 @@ int pigreetingsClientSynthDelCB( char *strIn )
 //
 int pigreetingsClientSynthAddCB( char *strIn )
 {
-    char playerName[256], playerGUID[256], playerIP[256];
+    char *playerName, *playerGUID, *playerIP;
+
+    if ( 0 != _allocPlayerFields( &playerName, &playerGUID, &playerIP )) return 0;
 
     rosterParsePlayerSynthConn( strIn, 256, playerName, playerGUID, playerIP );
     if (!_isIncognito( playerGUID )) {
@@ -349,18 +368,21 @@ int pigreetingsCapturedCB( char *strIn )
 }
 
 //  ==============================================================================================
-//  ...
+//  pigreetingsReloadConfigCB
 //
-//  ...
-//  ...
+//  Re-reads the greeting, rules and connect/disconnect messages and the incognito GUID;
+//  used for the next greeting sent.  pluginState is kept.
 //
-int pigreetingsPeriodicCB( char *strIn )
+int pigreetingsReloadConfigCB( char *strIn )
 {
+    int pluginState = pigreetingsConfig.pluginState;
+
+    pigreetingsInitConfig();
+    pigreetingsConfig.pluginState = pluginState;
     return 0;
 }
 
 
-
 //  ==============================================================================================
 //  ...
 //
@@ -390,13 +412,13 @@ int pigreetingsInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          pigreetingsRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            pigreetingsRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   pigreetingsCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             pigreetingsPeriodicCB );
 
     // Synthetic Delete - this one is generated by RCON roster
     // poller, since player ident from logfile informatino is non-deterministic.
     //
     eventsRegister( SISSM_EV_CLIENT_DEL_SYNTH,     pigreetingsClientSynthDelCB );
     eventsRegister( SISSM_EV_CLIENT_ADD_SYNTH,     pigreetingsClientSynthAddCB );
+    eventsRegister( SISSM_EV_RELOAD,               pigreetingsReloadConfigCB );
 
     // Remember restart time
     //
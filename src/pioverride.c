@@ -62,6 +62,7 @@ static struct {
 int pioverrideInitConfig( void )
 {
     cfsPtr cP;
+    int i;
 
     cP = cfsCreate( sissmGetConfigPath() );
 
@@ -70,16 +71,8 @@ int pioverrideInitConfig( void )
 
     // array of 10 [<gamemodeproperty> <value>] pairs
     //
-    strlcpy( pioverrideConfig.cvar[0],  cfsFetchStr( cP, "pioverride.cvar[0]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[1],  cfsFetchStr( cP, "pioverride.cvar[1]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[2],  cfsFetchStr( cP, "pioverride.cvar[2]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[3],  cfsFetchStr( cP, "pioverride.cvar[3]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[4],  cfsFetchStr( cP, "pioverride.cvar[4]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[5],  cfsFetchStr( cP, "pioverride.cvar[5]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[6],  cfsFetchStr( cP, "pioverride.cvar[6]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[7],  cfsFetchStr( cP, "pioverride.cvar[7]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[8],  cfsFetchStr( cP, "pioverride.cvar[8]",  "" ), CFS_FETCH_MAX );
-    strlcpy( pioverrideConfig.cvar[9],  cfsFetchStr( cP, "pioverride.cvar[9]",  "" ), CFS_FETCH_MAX );
+    for ( i=0; i<10; i++ ) 
+        strlcpy( pioverrideConfig.cvar[i], cfsFetchStrIndex( cP, "pioverride.cvar", i, "" ), CFS_FETCH_MAX );
 
     // if pokeEveryRound = 1, then this plugin will program the gamemodeproperty to 
     // the server at start of every round.  Otherwise, it is only programmed at start of 
@@ -104,16 +97,15 @@ static void _pokeCvar( void )
 {
     int i;
     char cvarStr[256], cvarVal[256];
-    char *w1, *w2;
+    wordIter_t it;
+    strView_t w1, w2;
 
     for (i=0; i<10; i++) {
 
-        w1 = getWord( pioverrideConfig.cvar[i], 0, " " );
-        w2 = getWord( pioverrideConfig.cvar[i], 1, " " );
-
-	if (( w1 != NULL ) && ( w2 != NULL )) {
-            strlcpy( cvarStr, w1, 256);
-            strlcpy( cvarVal, w2, 256);
+        wordIterInit( &it, pioverrideConfig.cvar[i], " " );
+	if ( wordIterNext( &it, &w1 ) && wordIterNext( &it, &w2 )) {
+            strViewCopy( cvarStr, 256, &w1 );
+            strViewCopy( cvarVal, 256, &w2 );
 
 	    if ( (0 != strlen(cvarStr)) && (0 != strlen(cvarVal)) ) {
                 apiGameModePropertySet( cvarStr, cvarVal );
@@ -238,18 +230,22 @@ int pioverrideCapturedCB( char *strIn )
 }
 
 //  ==============================================================================================
-//  ...
+//  pioverrideReloadConfigCB
 //
-//  ...
-//  ...
+//  Re-reads the cvar overrides and pokeEveryRound; the new values are written to the game
+//  server at the next game start (or round start with pokeEveryRound), not immediately.
+//  pluginState is kept.
 //
-int pioverridePeriodicCB( char *strIn )
+int pioverrideReloadConfigCB( char *strIn )
 {
+    int pluginState = pioverrideConfig.pluginState;
+
+    pioverrideInitConfig();
+    pioverrideConfig.pluginState = pluginState;
     return 0;
 }
 
 
-
 //  ==============================================================================================
 //  pioverrideInstallPlugins
 //
@@ -279,7 +275,7 @@ int pioverrideInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          pioverrideRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            pioverrideRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   pioverrideCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             pioverridePeriodicCB );
+    eventsRegister( SISSM_EV_RELOAD,               pioverrideReloadConfigCB );
     return 0;
 }
 
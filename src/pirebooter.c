@@ -7,6 +7,9 @@
 //  1.  Idle > N seconds (default 20) by looking for 0 players in game
 //  2.  Busy > M minutes (default 6 hours) cumulative time since last restart (including idle)
 //  3.  Dead > L minutes (default 5 minutes) by checking RCON message loopback to logfile
+//  4.  Worn: the game server process (found by pid file or command line) is over its memory,
+//      CPU or thread limits, or its memory growth will cross the limit within the forecast
+//      window.  The restart is queued and done at the next empty moment or round end.
 //
 //  Original Author:
 //  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
@@ -38,6 +41,8 @@
 #include "cfs.h"
 #include "util.h"
 #include "alarm.h"
+#include "metrics.h"
+#include "procmon.h"
 
 #include "roster.h"
 #include "api.h"
@@ -45,6 +50,9 @@
 
 #include "pirebooter.h"
 
+#define PIREBOOTER_PROC_GRACE_SEC  (120)    // no process limit checks this long after a restart
+#define PIREBOOTER_PROC_IDLE_SEC    (60)    // queued restart: empty this long (map travel, rejoins)
+
 
 //  ==============================================================================================
 //  Data definition 
@@ -63,8 +71,25 @@ static struct {
 
     char rebootWarning[ CFS_FETCH_MAX ];  // warning message 
 
+    char procPidFile[ CFS_FETCH_MAX ];    // server process by pid file, or...
+    char procMatch[ CFS_FETCH_MAX ];      // ...by command line substring; both "" = no monitor
+    int  procSampleSec;                   // process sample interval
+    int  procWindowSec;                   // trend window
+    int  procRssMaxMB;                    // resident memory limit, 0=none
+    int  procForecastMin;                 // restart if a limit is forecast within, 0=no forecast
+    int  procCpuMaxPct;                   // window CPU average limit, % of one core, 0=none
+    int  procThreadsMax;                  // thread count limit, 0=none
+
+    int  procRebootPending;               // limit crossed: restart when empty or at round end
+    char procRebootReason[ 256 ];
+
 } pirebooterConfig;
 
+static alarmObj *checkAlarmPtr  = NULL;                    // reboot checks, every second
+static alarmObj *statusAlarmPtr = NULL;             // status logging, every logUpdateSec
+static alarmObj *procAlarmPtr   = NULL;           // server process samples, every procSampleSec
+static procmonObj *procmonPtr   = NULL;                  // NULL if process monitor not configured
+
 
 //  ==============================================================================================
 //  pirebooterInitConfig
@@ -88,16 +113,58 @@ int pirebooterInitConfig( void )
     strlcpy( pirebooterConfig.rebootWarning, 
         cfsFetchStr( cP, "pirebooter.rebootWarning", "Server restart at end of game - up in 60sec" ), CFS_FETCH_MAX);
 
+    strlcpy( pirebooterConfig.procPidFile, cfsFetchStr( cP, "pirebooter.procPidFile", "" ), CFS_FETCH_MAX );
+    strlcpy( pirebooterConfig.procMatch,   cfsFetchStr( cP, "pirebooter.procMatch",   "" ), CFS_FETCH_MAX );
+    pirebooterConfig.procSampleSec   = (int) cfsFetchNum( cP, "pirebooter.procSampleSec",     10.0 );
+    pirebooterConfig.procWindowSec   = (int) cfsFetchNum( cP, "pirebooter.procWindowSec",   1800.0 );
+    pirebooterConfig.procRssMaxMB    = (int) cfsFetchNum( cP, "pirebooter.procRssMaxMB",       0.0 );
+    pirebooterConfig.procForecastMin = (int) cfsFetchNum( cP, "pirebooter.procForecastMin",    0.0 );
+    pirebooterConfig.procCpuMaxPct   = (int) cfsFetchNum( cP, "pirebooter.procCpuMaxPct",      0.0 );
+    pirebooterConfig.procThreadsMax  = (int) cfsFetchNum( cP, "pirebooter.procThreadsMax",     0.0 );
+    if ( pirebooterConfig.procSampleSec < 1 ) pirebooterConfig.procSampleSec = 1;
+    if ( pirebooterConfig.procWindowSec < 2 * pirebooterConfig.procSampleSec ) 
+        pirebooterConfig.procWindowSec = 2 * pirebooterConfig.procSampleSec;
+    if ( pirebooterConfig.procWindowSec > (PROCMON_MAXSAMPLES - 1) * pirebooterConfig.procSampleSec ) {
+        logPrintf( LOG_LEVEL_WARN, "pirebooter", "procWindowSec %d exceeds %d samples of %d sec, reduced to %d", 
+            pirebooterConfig.procWindowSec, PROCMON_MAXSAMPLES, pirebooterConfig.procSampleSec, 
+            (PROCMON_MAXSAMPLES - 1) * pirebooterConfig.procSampleSec );
+        pirebooterConfig.procWindowSec = (PROCMON_MAXSAMPLES - 1) * pirebooterConfig.procSampleSec;
+    }
 
     cfsDestroy( cP );
-    
-    pirebooterConfig.timeLastReboot = apiTimeGet();
-    pirebooterConfig.timeFirstIdle  = 0;
 
     return 0;
 }
 
 
+//  ==============================================================================================
+//  _rebootDue (local)
+//
+//  Returns 1 if a restart is queued: the busy timer has expired, or the process monitor 
+//  found the server over a limit.
+//
+static int _rebootDue( void )
+{
+    if ( pirebooterConfig.procRebootPending ) return 1;
+    return (( pirebooterConfig.timeLastReboot + pirebooterConfig.rebootBusySec ) < apiTimeGet() );
+}
+
+
+//  ==============================================================================================
+//  _rebootNow (local)
+//
+//  Restarts the game server and resets the timers and any queued restart.
+//
+static void _rebootNow( char *why )
+{
+    logPrintf( LOG_LEVEL_CRITICAL, "pirebooter", "Restarting server: %s", why );
+    pirebooterConfig.timeLastReboot    = apiTimeGet();
+    pirebooterConfig.timeFirstIdle     = 0L;
+    pirebooterConfig.procRebootPending = 0;
+    apiServerRestart();
+}
+
+
 //  ==============================================================================================
 //  pirebooterClientAddCB
 //
@@ -131,6 +198,7 @@ int pirebooterInitCB( char *strIn )
 {
     pirebooterConfig.timeLastReboot = apiTimeGet();
     pirebooterConfig.timeFirstIdle  = 0;
+    pirebooterConfig.procRebootPending = 0;
 
     return 0;
 }
@@ -172,11 +240,8 @@ int pirebooterGameStartCB( char *strIn )
     // This is a duplicate code (see pirebooterGameEndCB) as a 2nd trap
     // to make sure server gets rebooted.
     // 
-    if (( pirebooterConfig.timeLastReboot + pirebooterConfig.rebootBusySec ) < apiTimeGet() ) {
-        pirebooterConfig.timeLastReboot = apiTimeGet();
-        pirebooterConfig.timeFirstIdle  = 0L;
-        apiServerRestart();     // since the server is empty, reboot right away
-    }
+    if ( _rebootDue() ) 
+        _rebootNow( "queued restart at game start" );
     return 0;
 }
 
@@ -193,11 +258,8 @@ int pirebooterGameEndCB( char *strIn )
     // Check if the server has been running long, and reboot only at
     // end-of-game to be least intrusive.
     // 
-    if (( pirebooterConfig.timeLastReboot + pirebooterConfig.rebootBusySec ) < apiTimeGet() ) {
-        pirebooterConfig.timeLastReboot = apiTimeGet();
-        pirebooterConfig.timeFirstIdle  = 0L;
-        apiServerRestart();     // since the server is empty, reboot right away
-    }
+    if ( _rebootDue() ) 
+        _rebootNow( "queued restart at game end" );
     return 0;
 }
 
@@ -213,7 +275,7 @@ int pirebooterRoundStartCB( char *strIn )
 {
     pirebooterConfig.timeFirstIdle  = 0L;
 
-    if (( pirebooterConfig.timeLastReboot + pirebooterConfig.rebootBusySec ) < apiTimeGet() )
+    if ( _rebootDue() )
 	apiSay( pirebooterConfig.rebootWarning );
 
     return 0;
@@ -222,11 +284,15 @@ int pirebooterRoundStartCB( char *strIn )
 //  ==============================================================================================
 //  pirebooterRoundEndCB
 //
-//  End of Round event constitutes 'activity' -- reset the idle timer.
+//  End of Round event constitutes 'activity' -- reset the idle timer.  A restart queued by
+//  the process monitor is not held to the end of the game: a leaking or saturated server
+//  is restarted at the end of the round.
 //
 int pirebooterRoundEndCB( char *strIn )
 {
     pirebooterConfig.timeFirstIdle  = 0L;
+    if ( pirebooterConfig.procRebootPending ) 
+        _rebootNow( pirebooterConfig.procRebootReason );
     return 0;
 }
 
@@ -245,7 +311,7 @@ int pirebooterCapturedCB( char *strIn )
 
     pirebooterConfig.timeFirstIdle  = 0L;
     
-    if (( pirebooterConfig.timeLastReboot + pirebooterConfig.rebootBusySec ) < apiTimeGet() ) {
+    if ( _rebootDue() ) {
 	if ( (lastTime + 10) < apiTimeGet() ) {
 	    lastTime = apiTimeGet();
 	    apiSay( pirebooterConfig.rebootWarning );
@@ -263,19 +329,19 @@ int pirebooterShutdownCB( char *strIn )
 {
     pirebooterConfig.timeLastReboot = apiTimeGet();
     pirebooterConfig.timeFirstIdle  = 0;
+    pirebooterConfig.procRebootPending = 0;
     return 0;
 }
 
 //  ==============================================================================================
 //  pirebooterPeriodicCB
 //
-//  Periodic processing, called at 1.0 Hz rate (approximately).  This is the main algo 
+//  Periodic processing, called every second by a repeating alarm.  This is the main algo 
 //  for determining if the server requires a restart. 
 //  
 //
 int pirebooterPeriodicCB( char *strIn )
 {
-    static int skipTime = 0;
     unsigned long lastValidTimeListPlayers;
     // if currently in IDLE
     //
@@ -287,12 +353,21 @@ int pirebooterPeriodicCB( char *strIn )
 	     pirebooterConfig.timeFirstIdle = apiTimeGet();
 	}
 
+        // a restart queued by the process monitor is done once the server has stayed empty
+        // briefly, not on a roster that reads empty for a moment
+        //
+        else if ( pirebooterConfig.procRebootPending ) {
+            if ( (pirebooterConfig.timeFirstIdle + PIREBOOTER_PROC_IDLE_SEC) < apiTimeGet() ) 
+                _rebootNow( pirebooterConfig.procRebootReason );
+        }
+
 	// if this is not the first idle, check range if reboot is required
 	//
 	else {
             if ( (pirebooterConfig.timeFirstIdle + pirebooterConfig.rebootIdleSec ) < apiTimeGet() ) {
                 pirebooterConfig.timeLastReboot = apiTimeGet();
                 pirebooterConfig.timeFirstIdle = 0L;
+                pirebooterConfig.procRebootPending = 0;
                 apiServerRestart();     // since the server is empty, reboot right away
 	    }
 	}
@@ -313,25 +388,185 @@ int pirebooterPeriodicCB( char *strIn )
         }
     }
 
-    // Log some status for debug and monitoring 
-    // 
-    if ( (++skipTime) > pirebooterConfig.logUpdateSec ) {
-	skipTime = 0;
-        if ( 0 == pirebooterConfig.timeFirstIdle ) {
-            logPrintf( LOG_LEVEL_INFO, "pirebooter", "nPlayers %d; Reboot timers: idle n/a, busy %ld, dead %ld", 
-                apiPlayersGetCount(),
-                apiTimeGet() - pirebooterConfig.timeLastReboot,
-                apiTimeGet() - apiGetLastRosterTime() );
-	}
-	else {
-            logPrintf( LOG_LEVEL_INFO, "pirebooter", "nPlayers %d; Reboot timers: idle %ld, busy %ld, dead %ld", 
-                apiPlayersGetCount(),
-                apiTimeGet() - pirebooterConfig.timeFirstIdle, 
-		apiTimeGet() - pirebooterConfig.timeLastReboot, 
-                apiTimeGet() - apiGetLastRosterTime() );
-	}
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  pirebooterStatusCB
+//
+//  Log some status for debug and monitoring, called every logUpdateSec by a repeating alarm.
+//
+int pirebooterStatusCB( char *strIn )
+{
+    const procmonSample_t *sPtr;
+    char procStatus[ 256 ];
+
+    procStatus[0] = 0;
+    if ( NULL != (sPtr = procmonLast( procmonPtr ))) {
+        snprintf( procStatus, sizeof( procStatus ), "; Server pid %d: rss %lluMB (%+.1fMB/h), cpu %.0f%%, threads %d%s",
+            procmonPid( procmonPtr ),
+            (unsigned long long) (sPtr->rssBytes >> 20),
+            procmonRssSlope( procmonPtr ) * 3600.0 / 1048576.0,
+            procmonCpuAverage( procmonPtr ),
+            sPtr->threads,
+            pirebooterConfig.procRebootPending ? ", restart queued" : "" );
+    }
+
+    if ( 0 == pirebooterConfig.timeFirstIdle ) {
+        logPrintf( LOG_LEVEL_INFO, "pirebooter", "nPlayers %d; Reboot timers: idle n/a, busy %ld, dead %ld%s", 
+            apiPlayersGetCount(),
+            apiTimeGet() - pirebooterConfig.timeLastReboot,
+            apiTimeGet() - apiGetLastRosterTime(),
+            procStatus );
+    }
+    else {
+        logPrintf( LOG_LEVEL_INFO, "pirebooter", "nPlayers %d; Reboot timers: idle %ld, busy %ld, dead %ld%s", 
+            apiPlayersGetCount(),
+            apiTimeGet() - pirebooterConfig.timeFirstIdle, 
+            apiTimeGet() - pirebooterConfig.timeLastReboot, 
+            apiTimeGet() - apiGetLastRosterTime(),
+            procStatus );
+    }
+
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  pirebooterProcSampleCB
+//
+//  Samples the game server process, called every procSampleSec by a repeating alarm, and
+//  queues a restart when a limit is crossed.  No checks are made for a grace period after
+//  a restart, so a server that failed to restart is not restarted again every sample; the
+//  CPU and forecast checks also wait for a quarter of the trend window so that a fresh
+//  server (loading a map) does not look worn.
+//
+int pirebooterProcSampleCB( char *strIn )
+{
+    const procmonSample_t *sPtr;
+    double span, slope, secLeft;
+    uint64_t rssMax = (uint64_t) pirebooterConfig.procRssMaxMB << 20;
+    char reason[ 256 ];
+
+    if ( 0 != procmonUpdate( procmonPtr )) return 0;
+    if ( pirebooterConfig.procRebootPending ) return 0;
+    if (( pirebooterConfig.timeLastReboot + PIREBOOTER_PROC_GRACE_SEC ) > apiTimeGet() ) return 0;
+
+    sPtr = procmonLast( procmonPtr );
+    span = procmonSpanSec( procmonPtr );
+    reason[0] = 0;
+
+    if (( rssMax != 0 ) && ( sPtr->rssBytes >= rssMax )) {
+        snprintf( reason, sizeof( reason ), "memory %lluMB over limit %dMB", 
+            (unsigned long long) (sPtr->rssBytes >> 20), pirebooterConfig.procRssMaxMB );
+    }
+    else if (( pirebooterConfig.procThreadsMax != 0 ) && ( sPtr->threads >= pirebooterConfig.procThreadsMax )) {
+        snprintf( reason, sizeof( reason ), "%d threads over limit %d", 
+            sPtr->threads, pirebooterConfig.procThreadsMax );
+    }
+    else if ( span >= pirebooterConfig.procWindowSec / 4 ) {
+        if (( pirebooterConfig.procCpuMaxPct != 0 ) && ( procmonCpuAverage( procmonPtr ) >= pirebooterConfig.procCpuMaxPct )) {
+            snprintf( reason, sizeof( reason ), "cpu %.0f%% over %.0f min, limit %d%%", 
+                procmonCpuAverage( procmonPtr ), span / 60.0, pirebooterConfig.procCpuMaxPct );
+        }
+        else if (( rssMax != 0 ) && ( pirebooterConfig.procForecastMin != 0 ) && ( 0.0 < (slope = procmonRssSlope( procmonPtr ))) && 
+            (( secLeft = (double) (rssMax - sPtr->rssBytes) / slope ) < 60.0 * pirebooterConfig.procForecastMin )) {
+            snprintf( reason, sizeof( reason ), "memory %lluMB growing %.1fMB/h, limit %dMB in %.0f min", 
+                (unsigned long long) (sPtr->rssBytes >> 20), slope * 3600.0 / 1048576.0, pirebooterConfig.procRssMaxMB, secLeft / 60.0 );
+        }
+        else if (( pirebooterConfig.procThreadsMax != 0 ) && ( pirebooterConfig.procForecastMin != 0 ) && ( 0.0 < (slope = procmonThreadSlope( procmonPtr ))) &&
+            (( secLeft = (double) (pirebooterConfig.procThreadsMax - sPtr->threads) / slope ) < 60.0 * pirebooterConfig.procForecastMin )) {
+            snprintf( reason, sizeof( reason ), "%d threads growing %.1f/h, limit %d in %.0f min", 
+                sPtr->threads, slope * 3600.0, pirebooterConfig.procThreadsMax, secLeft / 60.0 );
+        }
     }
 
+    if ( reason[0] != 0 ) {
+        pirebooterConfig.procRebootPending = 1;
+        strlcpy( pirebooterConfig.procRebootReason, reason, sizeof( pirebooterConfig.procRebootReason ));
+        logPrintf( LOG_LEVEL_WARN, "pirebooter", "Server restart queued for next empty server or round end: %s", reason );
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _procmonStart (local)
+//
+//  (Re)creates the process monitor from the configuration.  The monitor stays off unless a
+//  pid file or a command line match is configured.
+//
+static void _procmonStart( void )
+{
+    procmonDestroy( procmonPtr );
+    procmonPtr = NULL;
+    alarmCancel( procAlarmPtr );
+
+    if (( 0 == pirebooterConfig.procPidFile[0] ) && ( 0 == pirebooterConfig.procMatch[0] )) return;
+
+    procmonPtr = procmonCreate( pirebooterConfig.procPidFile, pirebooterConfig.procMatch,
+        pirebooterConfig.procWindowSec / pirebooterConfig.procSampleSec + 1 );
+    alarmRepeat( procAlarmPtr, 1000 * (uint64_t) pirebooterConfig.procSampleSec );
+}
+
+
+//  ==============================================================================================
+//  _procMetric* (local)
+//
+//  Gauges of the latest server process sample; 0 when the process is not monitored.
+//
+static double _procMetricRss( void )
+{
+    const procmonSample_t *sPtr = procmonLast( procmonPtr );
+    return( sPtr == NULL ? 0.0 : (double) sPtr->rssBytes );
+}
+
+static double _procMetricCpu( void )
+{
+    const procmonSample_t *sPtr = procmonLast( procmonPtr );
+    return( (sPtr == NULL || sPtr->cpuPercent < 0.0) ? 0.0 : sPtr->cpuPercent );
+}
+
+static double _procMetricThreads( void )
+{
+    const procmonSample_t *sPtr = procmonLast( procmonPtr );
+    return( sPtr == NULL ? 0.0 : (double) sPtr->threads );
+}
+
+static double _procMetricRssGrowth( void )
+{
+    return( procmonRssSlope( procmonPtr ) * 3600.0 );
+}
+
+
+//  ==============================================================================================
+//  pirebooterReloadConfigCB
+//
+//  Re-reads the reboot schedule and thresholds and re-arms the status alarm at logUpdateSec.
+//  The process monitor is restarted (dropping its trend and any pending reboot) only if the
+//  pid file, match, sample or window settings changed.  pluginState is kept.
+//
+int pirebooterReloadConfigCB( char *strIn )
+{
+    int pluginState = pirebooterConfig.pluginState;
+    char procPidFile[ CFS_FETCH_MAX ], procMatch[ CFS_FETCH_MAX ];
+    int  procSampleSec = pirebooterConfig.procSampleSec, procWindowSec = pirebooterConfig.procWindowSec;
+
+    strlcpy( procPidFile, pirebooterConfig.procPidFile, CFS_FETCH_MAX );
+    strlcpy( procMatch,   pirebooterConfig.procMatch,   CFS_FETCH_MAX );
+
+    pirebooterInitConfig();
+    pirebooterConfig.pluginState = pluginState;
+    if ( statusAlarmPtr != NULL ) 
+        alarmRepeat( statusAlarmPtr, 1000 * (uint64_t) (pirebooterConfig.logUpdateSec > 0 ? pirebooterConfig.logUpdateSec : 1) );
+
+    if (( procAlarmPtr != NULL ) && 
+        (( 0 != strcmp( procPidFile, pirebooterConfig.procPidFile )) || ( 0 != strcmp( procMatch, pirebooterConfig.procMatch )) ||
+         ( procSampleSec != pirebooterConfig.procSampleSec ) || ( procWindowSec != pirebooterConfig.procWindowSec ))) {
+        pirebooterConfig.procRebootPending = 0;
+        _procmonStart();
+    }
     return 0;
 }
 
@@ -347,6 +582,10 @@ int pirebooterInstallPlugin( void )
     // 
     pirebooterInitConfig();
 
+    pirebooterConfig.timeLastReboot = apiTimeGet();
+    pirebooterConfig.timeFirstIdle  = 0;
+    pirebooterConfig.procRebootPending = 0;
+
     // if plugin is disabled in the .cfg file then do not activate
     //
     if ( pirebooterConfig.pluginState == 0 ) return 0;
@@ -365,8 +604,25 @@ int pirebooterInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          pirebooterRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            pirebooterRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   pirebooterCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             pirebooterPeriodicCB );
     eventsRegister( SISSM_EV_SHUTDOWN,             pirebooterShutdownCB );
+    eventsRegister( SISSM_EV_RELOAD,               pirebooterReloadConfigCB );
+
+    // Periodic processing runs on its own alarms: reboot checks every second, 
+    // status logging every logUpdateSec
+    //
+    checkAlarmPtr = alarmCreate( pirebooterPeriodicCB );
+    alarmRepeat( checkAlarmPtr, 1000 );
+    statusAlarmPtr = alarmCreate( pirebooterStatusCB );
+    alarmRepeat( statusAlarmPtr, 1000 * (uint64_t) (pirebooterConfig.logUpdateSec > 0 ? pirebooterConfig.logUpdateSec : 1) );
+
+    // Game server process monitor, every procSampleSec if configured
+    //
+    procAlarmPtr = alarmCreate( pirebooterProcSampleCB );
+    _procmonStart();
+    metricsGaugeFn( "sissm_server_rss_bytes", "Game server resident memory", "", _procMetricRss );
+    metricsGaugeFn( "sissm_server_cpu_percent", "Game server CPU use since the previous sample, percent of one core", "", _procMetricCpu );
+    metricsGaugeFn( "sissm_server_threads", "Game server thread count", "", _procMetricThreads );
+    metricsGaugeFn( "sissm_server_rss_growth_bytes_per_hour", "Game server resident memory trend over the window", "", _procMetricRssGrowth );
 
     return 0;
 }
@@ -106,8 +106,8 @@ static int _singlePlayerNoCounter( void )
 //  ==============================================================================================
 //  pisoloplayerClientAddCB
 //
-//  Check for solo/multi-player status when player is added.
-//  
+//  Check for solo/multi-player status when player is added.  Registered for the synthetic
+//  add event, dispatched after the roster update, so that the new player is counted.
 //
 int pisoloplayerClientAddCB( char *strIn )
 {
@@ -221,18 +221,20 @@ int pisoloplayerCapturedCB( char *strIn )
 }
 
 //  ==============================================================================================
-//  ...
+//  pisoloplayerReloadConfigCB
 //
-//  ...
-//  ...
+//  Re-reads the solo and multi-player warning messages.  pluginState is kept.
 //
-int pisoloplayerPeriodicCB( char *strIn )
+int pisoloplayerReloadConfigCB( char *strIn )
 {
+    int pluginState = pisoloplayerConfig.pluginState;
+
+    pisoloplayerInitConfig();
+    pisoloplayerConfig.pluginState = pluginState;
     return 0;
 }
 
 
-
 //  ==============================================================================================
 //  ...
 //
@@ -252,7 +254,7 @@ int pisoloplayerInstallPlugin( void )
     // notified for various happenings.  A complete list is here,
     // but comment out what is not needed for your plug-in.
     // 
-    eventsRegister( SISSM_EV_CLIENT_ADD,           pisoloplayerClientAddCB );
+    eventsRegister( SISSM_EV_CLIENT_ADD_SYNTH,     pisoloplayerClientAddCB );
     eventsRegister( SISSM_EV_CLIENT_DEL,           pisoloplayerClientDelCB );
     eventsRegister( SISSM_EV_INIT,                 pisoloplayerInitCB );
     eventsRegister( SISSM_EV_RESTART,              pisoloplayerRestartCB );
@@ -262,7 +264,7 @@ int pisoloplayerInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          pisoloplayerRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            pisoloplayerRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   pisoloplayerCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             pisoloplayerPeriodicCB );
+    eventsRegister( SISSM_EV_RELOAD,               pisoloplayerReloadConfigCB );
 
     return 0;
 }
@@ -97,17 +97,6 @@ int pit001ClientAddCB( char *strIn )
     rosterParsePlayerConn( strIn, 256, playerName, playerGUID, playerIP );
     logPrintf( LOG_LEVEL_INFO, "pit001", "Add Client ::%s::%s::%s::", playerName, playerGUID, playerIP );
 
-    if ( apiPlayersGetCount() >= 8 ) {   // if the last connect player is #8 (last slot if 8 port server)
-        if ( 0 != strcmp(playerGUID, "76561000000000000" )) {    // check if this is the server owner 
-	    apiKickOrBan( 0, playerGUID, "Sorry the last port reserved for server owner only" );
-            apiSay ( "pit001: Player %s kicked server full", playerName );
-	}
-        apiSay ( "pit001: Welcome server owner %s", playerName );
-    }
-    else {
-        apiSay ( "pit001: Welcome %s", playerName );
-    }
-
     return 0;
 }
 
@@ -254,8 +243,9 @@ int pit001CapturedCB( char *strIn )
 //  ==============================================================================================
 //  pit001PeriodicCB
 //
-//  This callback is invoked at 1.0Hz rate (once a second).  Due to serial processing,
-//  exact timing cannot be guaranteed.
+//  This callback is invoked by a repeating alarm, at the rate set in pit001InstallPlugin 
+//  (once a second here).  Pick the slowest rate that does the job, and don't install one
+//  at all if the plugin has no periodic work.
 //
 int pit001PeriodicCB( char *strIn )
 {
@@ -304,6 +294,8 @@ int pit001ClientSynthDelCB( char *strIn )
 //
 //  strIn:  in the format: "~SYNTHADD~ 76561000000000000 001.002.003.004 NameOfPlayer"
 //
+//  The roster is updated before this event, so the player count includes the new player.
+//
 int pit001ClientSynthAddCB( char *strIn )
 {
     static char playerName[256], playerGUID[256], playerIP[256];
@@ -311,6 +303,17 @@ int pit001ClientSynthAddCB( char *strIn )
     rosterParsePlayerSynthConn( strIn, 256, playerName, playerGUID, playerIP );
     logPrintf( LOG_LEVEL_INFO, "pit001", "Synthetic ADD Callback Name ::%s:: IP ::%s:: GUID ::%s::", playerName, playerIP, playerGUID );
 
+    if ( apiPlayersGetCount() >= 8 ) {   // if the last connect player is #8 (last slot if 8 port server)
+        if ( 0 != strcmp(playerGUID, "76561000000000000" )) {    // check if this is the server owner 
+	    apiKickOrBan( 0, playerGUID, "Sorry the last port reserved for server owner only" );
+            apiSay ( "pit001: Player %s kicked server full", playerName );
+	}
+        apiSay ( "pit001: Welcome server owner %s", playerName );
+    }
+    else {
+        apiSay ( "pit001: Welcome %s", playerName );
+    }
+
     return 0;
 }
 
@@ -338,6 +341,22 @@ int pit001SigtermCB( char *strIn )
     return 0;
 }
 
+//  ==============================================================================================
+//  pit001ReloadConfigCB
+//
+//  Re-reads the example string and numeric parameters.  The periodic alarm armed at install
+//  is kept.  pluginState is kept.
+//
+int pit001ReloadConfigCB( char *strIn )
+{
+    int pluginState = pit001Config.pluginState;
+
+    pit001InitConfig();
+    pit001Config.pluginState = pluginState;
+    return 0;
+}
+
+
 //  ==============================================================================================
 //  ...
 //
@@ -368,12 +387,16 @@ int pit001InstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          pit001RoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            pit001RoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   pit001CapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             pit001PeriodicCB );
     eventsRegister( SISSM_EV_SHUTDOWN,             pit001ShutdownCB );
     eventsRegister( SISSM_EV_CLIENT_ADD_SYNTH,     pit001ClientSynthAddCB );
     eventsRegister( SISSM_EV_CLIENT_DEL_SYNTH,     pit001ClientSynthDelCB );
     eventsRegister( SISSM_EV_CHAT,                 pit001ChatCB     );
     eventsRegister( SISSM_EV_SIGTERM,              pit001SigtermCB  );
+    eventsRegister( SISSM_EV_RELOAD,               pit001ReloadConfigCB );
+
+    // Periodic processing is a repeating alarm with a plugin-chosen period in ms
+    //
+    alarmRepeat( alarmCreate( pit001PeriodicCB ), 1000 );
 
     return 0;
 }
@@ -5,6 +5,22 @@
 //  Description:
 //  Generates server status html file - periodic and/or change event driven
 //
+//  HTML, JSON and CSV are rendered together from one roster snapshot.  The HTML layout is
+//  a template (tmpl.c), built-in or piwebgen.htmlTemplate, and up to PIWEBGEN_MAXTEMPLATES
+//  more template outputs are rendered in the same pass.  Status files are
+//  replaced atomically (temporary file + rename), and on roster or map events only when
+//  their content changed; the periodic update rewrites them to refresh the time stamp.
+//
+//  Optionally (piwebgen.httpPort) the status is also served directly from memory by the
+//  embedded HTTP server as HTML (/), JSON (/status.json), CSV (/status.csv) and plain
+//  text (/status.txt).
+//  Served pages are re-rendered only when the roster version or the up/down status changes,
+//  or the .cfg file was reloaded.  Their ETag is made of these and of the sissm start time,
+//  so that pages of an earlier sissm process are never taken as current.  Live updates are pushed on /events (Server-Sent Events): a
+//  "snapshot" (the JSON status) on subscribe, then "join", "leave", "map", "game_start",
+//  "game_end", "round_start", "round_end", "captured" and "status" (up/down) events, each
+//  one line of JSON.
+//
 //  Original Author:
 //  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
 //
@@ -16,6 +32,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <stdint.h>
 // #include <unistd.h>
 // #include <time.h>
 // #include <stdarg.h>
@@ -27,6 +45,10 @@
 // #include <netdb.h>
 // #include <fcntl.h>
 
+#ifdef _WIN32
+#include <windows.h>                                          // MoveFileExA for atomic replace
+#endif
+
 #include "bsd.h"
 
 #include "log.h"
@@ -34,8 +56,11 @@
 #include "cfs.h"
 #include "util.h"
 #include "alarm.h"
+#include "httpd.h"
+#include "tmpl.h"
 
 #include "roster.h"
+#include "sid.h"
 #include "api.h"
 #include "sissm.h"
 
@@ -45,11 +70,15 @@
 //  ==============================================================================================
 //  Data definition 
 //
+#define PIWEBGEN_MAXTEMPLATES     (4)                   // piwebgen.template1 .. template4
+
 static struct {
 
     int  pluginState;                      // always have this in .cfg file:  0=disabled 1=enabled
 
     char webFileName[CFS_FETCH_MAX];       // name of HTML output
+    char jsonFileName[CFS_FETCH_MAX];      // name of JSON output, ""=none
+    char csvFileName[CFS_FETCH_MAX];       // name of CSV output, ""=none
     unsigned int  updateIntervalSec;       // forced periodic update rate (even if same data)
     int  updateOnChange;                   // update only when changed
     char webminURL[128];                   // webmin instruction e.g., www.mysite.com/webmin
@@ -58,9 +87,87 @@ static struct {
     int  hyperlinkFormat;                  // 0=simple output, 1=player names as hyperlinks
     int  autoRefreshHeader;                // 1=create html page autorefresh header, 0=none
     int  commTimeoutSec;                   // # sec of RCON failure to indicate "fail" on web
+    int  httpPort;                         // embedded web server port, 0=disabled
+    char httpBindAddr[CFS_FETCH_MAX];      // embedded web server address, ""=all interfaces
+    int  httpMaxConn;                      // embedded web server max simultaneous connections
+    char htmlTemplate[CFS_FETCH_MAX];      // HTML page layout template, ""=built-in layout
+    char templateFile[PIWEBGEN_MAXTEMPLATES][CFS_FETCH_MAX];     // extra outputs: template
+    char templateOutput[PIWEBGEN_MAXTEMPLATES][CFS_FETCH_MAX];          // ... and its file
 
 } piwebgenConfig;
 
+//  Template variables (tmpl.c syntax), e.g. {{server}}, {{#roster}}{{name}}{{/roster}}.
+//  Index order must match the PIWEBGEN_VAR_* numbers.
+//
+#define PIWEBGEN_VAR_SERVER       ( 0)
+#define PIWEBGEN_VAR_LINE2        ( 1)
+#define PIWEBGEN_VAR_MAP          ( 2)
+#define PIWEBGEN_VAR_PLAYERS      ( 3)
+#define PIWEBGEN_VAR_STATUS       ( 4)                                         // ok, down
+#define PIWEBGEN_VAR_UP           ( 5)                                              // 1, 0
+#define PIWEBGEN_VAR_TIME         ( 6)                                   // human readable
+#define PIWEBGEN_VAR_EPOCH        ( 7)
+#define PIWEBGEN_VAR_VERSION      ( 8)                                   // roster version
+#define PIWEBGEN_VAR_CONNECT      ( 9)
+#define PIWEBGEN_VAR_WEBMIN       (10)
+#define PIWEBGEN_VAR_AUTOREFRESH  (11)
+#define PIWEBGEN_VAR_HYPERLINKS   (12)
+#define PIWEBGEN_VAR_NAME         (13)                           // roster row variables
+#define PIWEBGEN_VAR_STEAMID      (14)
+#define PIWEBGEN_VAR_SCORE        (15)
+#define PIWEBGEN_VAR_PROFILE      (16)                               // Steam profile URL
+
+static const char *const piwebgenVarNames[] = {
+    "server", "line2", "map", "players", "status", "up", "time", "epoch", "version",
+    "connect", "webmin", "autorefresh", "hyperlinks",
+    "name", "steamid", "score", "profile", NULL };
+static const char *const piwebgenListNames[] = { "roster", NULL };
+
+//  Built-in page layout, used if piwebgen.htmlTemplate is not set
+//
+static const char piwebgenDefaultHtml[] =
+    "{{#autorefresh}}<meta http-equiv=\"refresh\" content=\"14\" /> \n{{/autorefresh}}"
+    "<b>{{&server}}</b>\n"
+    "{{#line2}}<br>{{&line2}}\n{{/line2}}"
+    "<br>Map: &nbsp;&nbsp;&nbsp;&nbsp;&nbsp {{map}}\n"
+    "<br>Players: &nbsp; {{players}}\n"
+    "<br>Time: &nbsp;&nbsp;&nbsp;&nbsp;   {{time}}\n"
+    "<br>Status: &nbsp;&nbsp;   {{#up}}[OK]{{/up}}{{^up}}<font color=\"red\">[SERVER DOWN]</font> {{/up}}\n"
+    "{{#connect}}<br>Connect: {{&connect}}\n{{/connect}}"
+    "{{#webmin}}<br>Admin: &nbsp;&nbsp; <a href=\"{{&webmin}}\" target=\"_blank\">link</a>\n{{/webmin}}"
+    "<br>Names: &nbsp;&nbsp; "
+    "{{#hyperlinks}}{{#roster}}<a href=\"{{profile}}\" target=\"_blank\">{{name}}</a> {{/roster}}{{/hyperlinks}}"
+    "{{^hyperlinks}}<font color=\"blue\">{{#roster}}{{name}} : {{/roster}}</font> {{/hyperlinks}}"
+    "\n<br><br>\n";
+
+//  What a render sees: one roster snapshot, and the rows of it that are listed
+//
+typedef struct {
+
+    rosterSnap_t *snap;
+    int           rows[ROSTER_MAX];                              // listed snap->players[]
+    int           rowCount;
+    char          scratch[128];                                  // formatted number or URL
+
+} piwebgenView_t;
+
+static alarmObj *updateAlarmPtr = NULL;              // forced update, every updateIntervalSec
+static alarmObj *serveAlarmPtr  = NULL;           // served pages change check, every second
+static httpdObj *httpdPtr = NULL;                                  // embedded web server
+static char      servedVersion[64] = "";               // ETag of the pages now being served
+static unsigned long servedStart = 0;                    // sissm start time, ETag nonce
+static unsigned long servedReloads = 0;                    // .cfg reload count, ETag part
+static int       servedUp = -1;                  // up/down status last pushed, -1 = none yet
+static strBuf_t  renderBuf;                                  // reused for every page render
+static strBuf_t  htmlBuf, jsonBuf, csvBuf;               // rendered together, see _renderAll()
+static uint64_t  writtenHash = 0;                  // content hash of the status files on disk
+static int       writtenValid = 0;                 // 1 if writtenHash matches the files
+static strBuf_t  eventBuf;                                      // reused for every push event
+static tmplObj  *htmlTmpl = NULL;                                    // page layout, compiled
+static tmplObj  *extraTmpl[PIWEBGEN_MAXTEMPLATES];              // extra outputs, NULL if none
+static strBuf_t  extraBuf[PIWEBGEN_MAXTEMPLATES];
+static piwebgenView_t renderView;
+
 
 //  ==============================================================================================
 //  piwebgenInitConfig
@@ -71,6 +178,8 @@ static struct {
 int piwebgenInitConfig( void )
 {
     cfsPtr cP;
+    char varName[64];
+    int i;
 
     cP = cfsCreate( sissmGetConfigPath() );
 
@@ -79,6 +188,8 @@ int piwebgenInitConfig( void )
 
     // read "piwebgen.StringParameterExample" variable from the .cfg file
     strlcpy( piwebgenConfig.webFileName,  cfsFetchStr( cP, "piwebgen.webFileName",  "sissm.html" ), CFS_FETCH_MAX );
+    strlcpy( piwebgenConfig.jsonFileName, cfsFetchStr( cP, "piwebgen.jsonFileName", "" ), CFS_FETCH_MAX );
+    strlcpy( piwebgenConfig.csvFileName,  cfsFetchStr( cP, "piwebgen.csvFileName",  "" ), CFS_FETCH_MAX );
     piwebgenConfig.updateIntervalSec = (int) cfsFetchNum( cP, "piwebgen.updateIntervalSec", 60 );
     piwebgenConfig.updateOnChange = (int) cfsFetchNum( cP, "piwebgen.updateOnChange", 1 );
     piwebgenConfig.autoRefreshHeader = (int) cfsFetchNum( cP, "piwebgen.autoRefreshHeader", 0 );
@@ -87,6 +198,16 @@ int piwebgenInitConfig( void )
     strlcpy( piwebgenConfig.line2, cfsFetchStr( cP, "piwebgen.line2", ""), CFS_FETCH_MAX );
     piwebgenConfig.hyperlinkFormat = (int) cfsFetchNum( cP, "piwebgen.hyperlinkFormat", 1 );
     piwebgenConfig.commTimeoutSec = (int) cfsFetchNum( cP, "piwebgen.commTimeoutSec", 120 );
+    piwebgenConfig.httpPort = (int) cfsFetchNum( cP, "piwebgen.httpPort", 0 );
+    strlcpy( piwebgenConfig.httpBindAddr, cfsFetchStr( cP, "piwebgen.httpBindAddr", "" ), CFS_FETCH_MAX );
+    piwebgenConfig.httpMaxConn = (int) cfsFetchNum( cP, "piwebgen.httpMaxConn", 512 );
+    strlcpy( piwebgenConfig.htmlTemplate, cfsFetchStr( cP, "piwebgen.htmlTemplate", "" ), CFS_FETCH_MAX );
+    for ( i=0; i<PIWEBGEN_MAXTEMPLATES; i++ ) {
+        snprintf( varName, sizeof( varName ), "piwebgen.template%d", i+1 );
+        strlcpy( piwebgenConfig.templateFile[i], cfsFetchStr( cP, varName, "" ), CFS_FETCH_MAX );
+        snprintf( varName, sizeof( varName ), "piwebgen.templateOutput%d", i+1 );
+        strlcpy( piwebgenConfig.templateOutput[i], cfsFetchStr( cP, varName, "" ), CFS_FETCH_MAX );
+    }
 
     cfsDestroy( cP );
     return 0;
@@ -94,107 +215,454 @@ int piwebgenInitConfig( void )
 
 
 //  ==============================================================================================
-//  _convertNameToHyperlink
+//  _isListed (local)
 //
-//  This routine converrts: "76560000000000001 111.001.034.025 Random Person "
-//  To: <a href="http://steamcommunity.com/profiles/76560000000000001/">Random Person</a>
-//  To: <a href="http://steamcommunity.com/profiles/76560000000000001/" target="_blank">Random Person</a>
-// <a href="xyz.html" target="_blank"> Link </a>
+//  Roster rows shown on the status pages: connected humans (valid SteamID and IP#), the
+//  same rows apiPlayersRoster() lists.
 //
-#define STEAM_PROFILE  "<a href=\"http://steamcommunity.com/profiles/76560000000000001/\" target=\"_blank\">"
+static int _isListed( rconRoster_t *p )
+{
+    return(( 0 != p->netID[0] ) && ( sidIsValid( p->steamID )) && ( 0 != p->IPaddress[0] ));
+}
+
+
+//  ==============================================================================================
+//  _isServerUp (local)
+//
+static int _isServerUp( void )
+{
+    return( apiTimeGet() < (piwebgenConfig.commTimeoutSec + apiGetLastRosterTime()) );
+}
 
-static char *_convertNameToHyperlink( char *identString )
+
+//  ==============================================================================================
+//  _tmplValue, _tmplRows (local)
+//
+//  Template binding: values of {{name}} variables, and the rows of {{#roster}}, from the
+//  current renderView.
+//
+static const char *_tmplValue( int varIndex, int row, void *userData )
 {
-    static char retStr[256];
+    piwebgenView_t *v = (piwebgenView_t *) userData;
+    rconRoster_t *p = ( row >= 0 ) && ( row < v->rowCount ) ? &v->snap->players[ v->rows[row] ] : NULL;
+
+    switch ( varIndex ) {
+    case PIWEBGEN_VAR_SERVER:      return( apiGetServerName() );
+    case PIWEBGEN_VAR_LINE2:       return( piwebgenConfig.line2 );
+    case PIWEBGEN_VAR_MAP:         return( v->snap->mapName );
+    case PIWEBGEN_VAR_PLAYERS:     snprintf( v->scratch, sizeof( v->scratch ), "%d", apiPlayersGetCount() );
+                                   return( v->scratch );
+    case PIWEBGEN_VAR_STATUS:      return( _isServerUp() ? "ok" : "down" );
+    case PIWEBGEN_VAR_UP:          return( _isServerUp() ? "1" : "0" );
+    case PIWEBGEN_VAR_TIME:        return( apiTimeGetHuman() );
+    case PIWEBGEN_VAR_EPOCH:       snprintf( v->scratch, sizeof( v->scratch ), "%lu", (unsigned long) time( NULL ));
+                                   return( v->scratch );
+    case PIWEBGEN_VAR_VERSION:     snprintf( v->scratch, sizeof( v->scratch ), "%lu", v->snap->version );
+                                   return( v->scratch );
+    case PIWEBGEN_VAR_CONNECT:     return( piwebgenConfig.directConnect );
+    case PIWEBGEN_VAR_WEBMIN:      return( piwebgenConfig.webminURL );
+    case PIWEBGEN_VAR_AUTOREFRESH: return( piwebgenConfig.autoRefreshHeader ? "1" : "0" );
+    case PIWEBGEN_VAR_HYPERLINKS:  return( piwebgenConfig.hyperlinkFormat ? "1" : "0" );
+    case PIWEBGEN_VAR_NAME:        return( p ? p->playerName : "" );
+    case PIWEBGEN_VAR_STEAMID:     return( p ? p->steamID : "" );
+    case PIWEBGEN_VAR_SCORE:       return( p ? p->score : "" );
+    case PIWEBGEN_VAR_PROFILE:
+        if ( p == NULL ) return( "" );
+        snprintf( v->scratch, sizeof( v->scratch ), "http://steamcommunity.com/profiles/%s/", p->steamID );
+        return( v->scratch );
+    default:                       return( "" );
+    }
+}
 
-    strlcpy( retStr, STEAM_PROFILE, 256 );                                    // copy the template
-    strncpy( &retStr[44], identString, 17 );                        // insert/substitute SteamID64
-    strcat( retStr, &identString[34 ] );                                // append name (text part)
-    strcat( retStr, "</a>" );                                                   // close with </a>
-    return( retStr );
+static int _tmplRows( int listIndex, void *userData )
+{
+    return( ((piwebgenView_t *) userData)->rowCount );
 }
 
+static const tmplBinding_t piwebgenBinding = { piwebgenVarNames, piwebgenListNames, _tmplValue, _tmplRows };
+
 
 //  ==============================================================================================
-//  _genWebFile
+//  _renderJson (local)
 //
-//  Generates a HTML status file using current server state
-//  
+//  Machine-readable status, e.g.:
+//  {"server":"..","map":"..","players":2,"status":"ok","version":7,"time":1568000000,
+//   "roster":[{"steamid":"76560000000000001","name":"Random Person","score":"120"},...]}
 //
-#define PIWEBGEN_MAXROSTER   (16*1024)
+static void _renderJson( strBuf_t *bPtr, rosterSnap_t *snap )
+{
+    rconRoster_t *p;
+    char *str;
+    int   i, first = 1;
+
+    strBufPrintf( bPtr, "{\"server\":\"" );
+    str = apiGetServerName();  tmplAppendEscaped( bPtr, str, strlen( str ), TMPL_ESC_JSON );
+    strBufPrintf( bPtr, "\",\"map\":\"" );
+    tmplAppendEscaped( bPtr, snap->mapName, strlen( snap->mapName ), TMPL_ESC_JSON );
+    strBufPrintf( bPtr, "\",\"players\":%d,\"status\":\"%s\",\"version\":%lu,\"time\":%lu,\"roster\":[",
+        apiPlayersGetCount(), _isServerUp() ? "ok" : "down", snap->version, (unsigned long) time( NULL ) );
+
+    for ( i=0; i<snap->count; i++ ) {
+        p = &snap->players[i];
+        if ( !_isListed( p )) continue;
+        strBufPrintf( bPtr, "%s{\"steamid\":\"%s\",\"name\":\"", first ? "" : ",", p->steamID );
+        tmplAppendEscaped( bPtr, p->playerName, strlen( p->playerName ), TMPL_ESC_JSON );
+        strBufPrintf( bPtr, "\",\"score\":\"" );
+        tmplAppendEscaped( bPtr, p->score, strlen( p->score ), TMPL_ESC_JSON );
+        strBufPrintf( bPtr, "\"}" );
+        first = 0;
+    }
+    strBufPrintf( bPtr, "]}\n" );
+    return;
+}
 
-static int _genWebFile( void )
+
+//  ==============================================================================================
+//  _renderCsv (local)
+//
+//  Player table for spreadsheets and scripts, a header line then one row per player:
+//  steamid,name,score
+//
+static void _renderCsv( strBuf_t *bPtr, rosterSnap_t *snap )
 {
+    rconRoster_t *p;
+    int i;
+
+    strBufPrintf( bPtr, "steamid,name,score\r\n" );
+    for ( i=0; i<snap->count; i++ ) {
+        p = &snap->players[i];
+        if ( !_isListed( p )) continue;
+        strBufPrintf( bPtr, "%s,", p->steamID );
+        tmplAppendEscaped( bPtr, p->playerName, strlen( p->playerName ), TMPL_ESC_CSV );
+        strBufPrintf( bPtr, "," );
+        tmplAppendEscaped( bPtr, p->score, strlen( p->score ), TMPL_ESC_CSV );
+        strBufPrintf( bPtr, "\r\n" );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _renderText (local)
+//
+//  Plain text status, one "key: value" per line, then one "player: steamid name" per player.
+//
+static void _renderText( strBuf_t *bPtr, rosterSnap_t *snap )
+{
+    rconRoster_t *p;
+    int i;
+
+    strBufPrintf( bPtr, "server: %s\nmap: %s\nplayers: %d\nstatus: %s\ntime: %s\n",
+        apiGetServerName(), snap->mapName, apiPlayersGetCount(), _isServerUp() ? "ok" : "down",
+        apiTimeGetHuman() );
+
+    for ( i=0; i<snap->count; i++ ) {
+        p = &snap->players[i];
+        if ( _isListed( p )) strBufPrintf( bPtr, "player: %s %s\n", p->steamID, p->playerName );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _hashAppend (local)
+//
+//  64-bit FNV-1a, continued from 'hash' (start with PIWEBGEN_HASH_INIT)
+//
+#define PIWEBGEN_HASH_INIT  (0xcbf29ce484222325ULL)
+
+static uint64_t _hashAppend( uint64_t hash, const char *data, size_t len )
+{
+    size_t i;
+
+    for ( i=0; i<len; i++ ) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return( hash );
+}
+
+
+//  ==============================================================================================
+//  _renderAll (local)
+//
+//  Render HTML (page template), JSON, CSV and the extra templates into their buffers from
+//  one roster snapshot, so that all agree.  Returns a hash of what they show, except the
+//  clock: the CSV rows plus the header fields.  Equal hashes mean the outputs differ at
+//  most in their time stamp.
+//
+static uint64_t _renderAll( void )
+{
+    rosterSnap_t *snap;
+    char header[512];
+    uint64_t hash;
+    int i;
+
+    if ( NULL == (snap = rosterSnapAcquire())) return( 0 );
+
+    renderView.snap = snap;
+    renderView.rowCount = 0;
+    for ( i=0; i<snap->count; i++ )
+        if ( _isListed( &snap->players[i] )) renderView.rows[ renderView.rowCount++ ] = i;
+
+    strBufReset( &htmlBuf );  tmplRender( htmlTmpl, &htmlBuf, &renderView );
+    strBufReset( &jsonBuf );  _renderJson( &jsonBuf, snap );
+    strBufReset( &csvBuf );   _renderCsv( &csvBuf, snap );
+    for ( i=0; i<PIWEBGEN_MAXTEMPLATES; i++ ) {
+        strBufReset( &extraBuf[i] );
+        if ( extraTmpl[i] != NULL ) tmplRender( extraTmpl[i], &extraBuf[i], &renderView );
+    }
+
+    snprintf( header, sizeof( header ), "%s|%s|%d|%d", apiGetServerName(), snap->mapName,
+        apiPlayersGetCount(), _isServerUp() );
+    hash = _hashAppend( PIWEBGEN_HASH_INIT, header, strlen( header ));
+    hash = _hashAppend( hash, csvBuf.data, csvBuf.len );
+
+    renderView.snap = NULL;
+    rosterSnapRelease( snap );
+    return( hash );
+}
+
+
+//  ==============================================================================================
+//  _writeAtomic (local)
+//
+//  Replace fileName with data by writing a temporary file next to it and renaming it over
+//  the original, so a reader (web server, script) sees either the old or the new content,
+//  never a partial file.  "" fileName is a no-op.
+//
+static int _writeAtomic( char *fileName, const char *data, size_t len )
+{
+    char  tmpName[CFS_FETCH_MAX + 8];
     FILE *fpw;
     int   errCode = 1;
-    int   i;
-    char  *printWordOut, *rosterElem;
-    char  rosterWork[PIWEBGEN_MAXROSTER];
-    char  hyperLinkCode[256];
-    char  timeoutStatus[256];
 
-    if (NULL != (fpw = fopen( piwebgenConfig.webFileName, "wt" ))) {
+    if ( 0 == strlen( fileName )) return 0;
+
+    snprintf( tmpName, sizeof( tmpName ), "%s.tmp", fileName );
+    if ( NULL != (fpw = fopen( tmpName, "wb" ))) {
+        errCode = ( len != fwrite( data, 1, len, fpw ));
+        if ( 0 != fclose( fpw )) errCode = 1;
+#ifdef _WIN32
+        if ( !errCode ) errCode = !MoveFileExA( tmpName, fileName, MOVEFILE_REPLACE_EXISTING );
+#else
+        if ( !errCode ) errCode = ( 0 != rename( tmpName, fileName ));
+#endif
+        if ( errCode ) remove( tmpName );
+    }
+    if ( errCode ) {
+        logPrintf( LOG_LEVEL_CRITICAL, "piwebstat", "Unable to write the status file ::%s::", fileName );
+    }
+    return errCode;
+}
 
-        if ( apiTimeGet() < (piwebgenConfig.commTimeoutSec + apiGetLastRosterTime()) )  
-            strlcpy( timeoutStatus, "[OK]", 256 );
-        else
-            strlcpy( timeoutStatus, "<font color=\"red\">[SERVER DOWN]</font> ", 256 );
 
-	if ( 0 != piwebgenConfig.autoRefreshHeader ) {
-            fprintf( fpw, "<meta http-equiv=\"refresh\" content=\"14\" /> \n" );
-        }
+//  ==============================================================================================
+//  _genWebFile
+//
+//  Generates the HTML, JSON and CSV status files using current server state.  Unless forced
+//  (periodic update, which refreshes the time stamp) files are written only when their
+//  content changed since the last write.
+//
+static int _genWebFile( int force )
+{
+    uint64_t hash;
+    int errCode = 0, i, anyFile;
+
+    anyFile = ( 0 != strlen( piwebgenConfig.webFileName )) || ( 0 != strlen( piwebgenConfig.jsonFileName )) ||
+              ( 0 != strlen( piwebgenConfig.csvFileName ));
+    for ( i=0; i<PIWEBGEN_MAXTEMPLATES; i++ ) if ( extraTmpl[i] != NULL ) anyFile = 1;
+    if ( !anyFile ) return 0;                                        // serving from memory only
+
+    hash = _renderAll();
+    if (( !force ) && ( writtenValid ) && ( hash == writtenHash )) return 0;
+    if ( htmlBuf.overflow || jsonBuf.overflow || csvBuf.overflow ) return 1;
+
+    errCode |= _writeAtomic( piwebgenConfig.webFileName,  htmlBuf.data, htmlBuf.len );
+    errCode |= _writeAtomic( piwebgenConfig.jsonFileName, jsonBuf.data, jsonBuf.len );
+    errCode |= _writeAtomic( piwebgenConfig.csvFileName,  csvBuf.data,  csvBuf.len );
+    for ( i=0; i<PIWEBGEN_MAXTEMPLATES; i++ )
+        if (( extraTmpl[i] != NULL ) && ( !extraBuf[i].overflow ))
+            errCode |= _writeAtomic( piwebgenConfig.templateOutput[i], extraBuf[i].data, extraBuf[i].len );
+
+    writtenValid = ( 0 == errCode );
+    writtenHash = hash;
+    return errCode;
+}
 
-        fprintf( fpw, "<b>%s</b>\n", apiGetServerName() );
-        if ( 0 != strlen( piwebgenConfig.line2 ) )
-            fprintf( fpw, "<br>%s\n", piwebgenConfig.line2 );
-        fprintf( fpw, "<br>Map: &nbsp;&nbsp;&nbsp;&nbsp;&nbsp %s\n", apiGetMapName() );
-        fprintf( fpw, "<br>Players: &nbsp; %d\n", apiPlayersGetCount());
-        fprintf( fpw, "<br>Time: &nbsp;&nbsp;&nbsp;&nbsp;   %s\n", apiTimeGetHuman() );
-        fprintf( fpw, "<br>Status: &nbsp;&nbsp;   %s\n", timeoutStatus );
-        if ( 0 != strlen( piwebgenConfig.directConnect ) )
-            fprintf( fpw, "<br>Connect: %s\n", piwebgenConfig.directConnect );
-        if ( 0 != strlen( piwebgenConfig.webminURL ) )  {
-            // <a href="url">link text</a>
-            // old - snprintf( hyperLinkCode, 256, "<a href=\"http://%s\" target=\"_blank\">link</a>", piwebgenConfig.webminURL );
-            snprintf( hyperLinkCode, 256, "<a href=\"%s\" target=\"_blank\">link</a>", piwebgenConfig.webminURL );
-            fprintf( fpw, "<br>Admin: &nbsp;&nbsp; %s\n", hyperLinkCode );
-        }
-        fprintf( fpw, "<br>Names: &nbsp;&nbsp; ");
-
-	if ( 0 == piwebgenConfig.hyperlinkFormat ) {
-            fprintf( fpw, "<font color=\"blue\">%s</font> ", apiPlayersRoster( 0, " : " ) );
-	}
-	else {
-	    strlcpy( rosterWork, apiPlayersRoster( 4, "\011" ), PIWEBGEN_MAXROSTER);  // get roster with tab for delimiter
-	    if (  0 != strlen( rosterWork )) {                   // if not an empty list then
- 	        for ( i=0 ;; i++ ) {
-
-		    // walk through each player
-		    //
-		    rosterElem = getWord( rosterWork, i, "\011" );  
-		    if (NULL == rosterElem)        break;    // end of list?
-		    if (strlen( rosterElem) < 35 ) break;    // element is invalid if <35 chars
-
-		    // convert each player record to hyperlink html format
-		    //
-                    printWordOut = _convertNameToHyperlink( rosterElem );
-
-		    // write out this player info  to the html file
-		    //
-                    fprintf( fpw, "%s ", printWordOut );
-                }
-	    }
-	}
-        fprintf( fpw, "\n<br><br>\n");
-        fclose( fpw );
-        errCode = 0;
+
+//  ==============================================================================================
+//  _contentType (local)
+//
+static char *_contentType( char *fileName )
+{
+    switch ( tmplEscapeForFile( fileName )) {
+    case TMPL_ESC_JSON:  return( "application/json" );
+    case TMPL_ESC_CSV:   return( "text/csv; charset=utf-8" );
+    case TMPL_ESC_NONE:  return( "text/plain; charset=utf-8" );
+    default:             return( "text/html; charset=utf-8" );
     }
-    else {
-        logPrintf( LOG_LEVEL_CRITICAL,
-            "piwebstat", "Unable to create the html output file ::%s::",
-            piwebgenConfig.webFileName );
+}
+
+
+//  ==============================================================================================
+//  _routeName (local)
+//
+//  Web path of extra template output i: "/" and the base name of its output file.  Returns
+//  1 if the name does not fit, so the output is written to file but not served.
+//
+static int _routeName( int i, char *path, size_t pathSize )
+{
+    char *baseName;
+
+    if ( NULL == (baseName = strrchr( piwebgenConfig.templateOutput[i], '/' ))) baseName = piwebgenConfig.templateOutput[i];
+    else baseName++;
+    if ( strlen( baseName ) + 2 > pathSize ) return 1;
+    path[0] = '/';
+    strlcpy( path + 1, baseName, pathSize - 1 );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _loadTemplates (local)
+//
+//  Compile the page layout and the extra output templates.  A template that fails to load
+//  is logged and skipped (the page layout falls back to the built-in one), so a typo in a
+//  template never takes the status page down.
+//
+static void _loadTemplates( void )
+{
+    char errMsg[256], routePath[HTTPD_PATH_MAX];
+    int i;
+
+    tmplDestroy( htmlTmpl );
+    htmlTmpl = NULL;
+    if ( 0 != strlen( piwebgenConfig.htmlTemplate )) {
+        if ( NULL == (htmlTmpl = tmplLoad( piwebgenConfig.htmlTemplate, &piwebgenBinding, TMPL_ESC_HTML, errMsg, sizeof( errMsg ))))
+            logPrintf( LOG_LEVEL_CRITICAL, "piwebgen", "Template ::%s:: not used, %s", piwebgenConfig.htmlTemplate, errMsg );
     }
-    return errCode;
+    if ( htmlTmpl == NULL )
+        htmlTmpl = tmplCompile( piwebgenDefaultHtml, strlen( piwebgenDefaultHtml ), &piwebgenBinding, TMPL_ESC_HTML, errMsg, sizeof( errMsg ));
+
+    for ( i=0; i<PIWEBGEN_MAXTEMPLATES; i++ ) {
+        tmplDestroy( extraTmpl[i] );
+        extraTmpl[i] = NULL;
+        if (( 0 == strlen( piwebgenConfig.templateFile[i] )) || ( 0 == strlen( piwebgenConfig.templateOutput[i] ))) continue;
+        extraTmpl[i] = tmplLoad( piwebgenConfig.templateFile[i], &piwebgenBinding,
+            tmplEscapeForFile( piwebgenConfig.templateOutput[i] ), errMsg, sizeof( errMsg ));
+        if ( extraTmpl[i] == NULL )
+            logPrintf( LOG_LEVEL_CRITICAL, "piwebgen", "Template ::%s:: not used, %s", piwebgenConfig.templateFile[i], errMsg );
+        else if (( 0 != piwebgenConfig.httpPort ) && ( 0 != _routeName( i, routePath, sizeof( routePath ))))
+            logPrintf( LOG_LEVEL_WARN, "piwebgen", "Output name ::%s:: too long to be served, written to file only", 
+                piwebgenConfig.templateOutput[i] );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _servePages
+//
+//  Re-render and publish the served pages if the roster version, server up/down status or
+//  configuration changed since they were last published.  Cheap otherwise, so it is checked every second.
+//
+static int _servePages( void )
+{
+    rosterSnap_t *snap;
+    char version[64], path[HTTPD_PATH_MAX];
+    int i;
+
+    if ( httpdPtr == NULL ) return 0;
+
+    snprintf( version, sizeof( version ), "%lx-c%lu-r%lu-%s", servedStart, servedReloads, 
+        apiGetRosterVersion(), _isServerUp() ? "up" : "down" );
+    if ( 0 == strcmp( version, servedVersion )) return 0;
+
+    _renderAll();
+    httpdPublish( httpdPtr, "/",            "text/html; charset=utf-8", htmlBuf.data, htmlBuf.len, version );
+    httpdPublish( httpdPtr, "/index.html",  "text/html; charset=utf-8", htmlBuf.data, htmlBuf.len, version );
+    httpdPublish( httpdPtr, "/status.json", "application/json", jsonBuf.data, jsonBuf.len, version );
+    httpdPublish( httpdPtr, "/status.csv",  "text/csv; charset=utf-8", csvBuf.data, csvBuf.len, version );
+    for ( i=0; i<PIWEBGEN_MAXTEMPLATES; i++ ) {
+        if (( extraTmpl[i] == NULL ) || ( 0 != _routeName( i, path, sizeof( path )))) continue;
+        httpdPublish( httpdPtr, path, _contentType( piwebgenConfig.templateOutput[i] ), extraBuf[i].data, extraBuf[i].len, version );
+    }
+
+    strBufReset( &renderBuf );
+    if ( NULL != (snap = rosterSnapAcquire())) {
+        _renderText( &renderBuf, snap );
+        rosterSnapRelease( snap );
+    }
+    httpdPublish( httpdPtr, "/status.txt",  "text/plain; charset=utf-8", renderBuf.data, renderBuf.len, version );
+
+    if ( !renderBuf.overflow && !htmlBuf.overflow && !jsonBuf.overflow && !csvBuf.overflow )
+        strlcpy( servedVersion, version, sizeof( servedVersion ));
+
+    if ( servedUp != _isServerUp() ) {
+        if ( servedUp != -1 ) 
+            httpdStreamSend( httpdPtr, "/events", "status", _isServerUp() ? "{\"status\":\"ok\"}" : "{\"status\":\"down\"}" );
+        servedUp = _isServerUp();
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  _pushEvent
+//
+//  Push a live update to /events subscribers: {"time":...<,fields>}.  The served pages are
+//  refreshed first, so that a viewer subscribing right after sees them include the change.
+//  Fields come from the caller already in JSON form; fieldName/fieldValue, if not NULL, is
+//  one more string field, escaped here (player names and such).
+//
+static void _pushEvent( char *eventName, char *fields, char *fieldName, char *fieldValue )
+{
+    if (( httpdPtr == NULL ) || ( 0 == httpdStreamCount( httpdPtr, "/events" ))) return;
+
+    _servePages();
+
+    strBufReset( &eventBuf );
+    strBufPrintf( &eventBuf, "{\"time\":%lu%s%s", (unsigned long) time( NULL ), (0 != strlen( fields )) ? "," : "", fields );
+    if ( fieldName != NULL ) {
+        strBufPrintf( &eventBuf, ",\"%s\":\"", fieldName );
+        tmplAppendEscaped( &eventBuf, fieldValue, strlen( fieldValue ), TMPL_ESC_JSON );
+        strBufPrintf( &eventBuf, "\"" );
+    }
+    strBufPrintf( &eventBuf, "}" );
+    if ( !eventBuf.overflow ) httpdStreamSend( httpdPtr, "/events", eventName, eventBuf.data );
+    return;
+}
+
+
+//  ==============================================================================================
+//  _pushPlayerEvent
+//
+//  Push "join" or "leave" from a synthetic add/delete: "~SYNTHADD~ 76561000000000000 1.2.3.4 Name"
+//
+static void _pushPlayerEvent( char *eventName, char *strIn, int isAdd )
+{
+    char playerName[256], playerGUID[256], playerIP[256], fields[256];
+
+    if (( httpdPtr == NULL ) || ( 0 == httpdStreamCount( httpdPtr, "/events" ))) return;
+
+    if ( isAdd ) rosterParsePlayerSynthConn( strIn, 256, playerName, playerGUID, playerIP );
+    else         rosterParsePlayerSynthDisConn( strIn, 256, playerName, playerGUID, playerIP );
+    snprintf( fields, sizeof( fields ), "\"steamid\":\"%.17s\",\"players\":%d", playerGUID, apiPlayersGetCount() );
+    _pushEvent( eventName, fields, "name", playerName );
+    return;
+}
+
+
+//  ==============================================================================================
+//  piwebgenServeCB
+//
+//  Once a second: refresh the served pages if anything changed.
+//
+int piwebgenServeCB( char *strIn )
+{
+    _servePages();
+    return 0;
 }
 
 //  ==============================================================================================
@@ -205,7 +673,7 @@ static int _genWebFile( void )
 //
 int piwebgenClientAddCB( char *strIn )
 {
-    if ( piwebgenConfig.updateOnChange ) _genWebFile();
+    if ( piwebgenConfig.updateOnChange ) _genWebFile( 0 );
     return 0;
 }
 
@@ -217,7 +685,7 @@ int piwebgenClientAddCB( char *strIn )
 //
 int piwebgenClientDelCB( char *strIn )
 {
-    if ( piwebgenConfig.updateOnChange ) _genWebFile();
+    if ( piwebgenConfig.updateOnChange ) _genWebFile( 0 );
     return 0;
 }
 
@@ -229,7 +697,7 @@ int piwebgenClientDelCB( char *strIn )
 //
 int piwebgenInitCB( char *strIn )
 {
-    if ( piwebgenConfig.updateOnChange ) _genWebFile();
+    if ( piwebgenConfig.updateOnChange ) _genWebFile( 0 );
     return 0;
 }
 
@@ -244,70 +712,107 @@ int piwebgenRestartCB( char *strIn )
     return 0;
 }
 
+//  ==============================================================================================
+//  piwebgenClientSynthAddCB
+//
+//  The roster poll found a new player: update the status files (if so configured, and if
+//  the content changed), and push a "join" event to live viewers
+//
+int piwebgenClientSynthAddCB( char *strIn )
+{
+    if ( piwebgenConfig.updateOnChange ) _genWebFile( 0 );
+    _pushPlayerEvent( "join", strIn, 1 );
+    return 0;
+}
+
+//  ==============================================================================================
+//  piwebgenClientSynthDelCB
+//
+//  The roster poll found a player gone: update the status files (if so configured, and if
+//  the content changed), and push a "leave" event to live viewers
+//
+int piwebgenClientSynthDelCB( char *strIn )
+{
+    if ( piwebgenConfig.updateOnChange ) _genWebFile( 0 );
+    _pushPlayerEvent( "leave", strIn, 0 );
+    return 0;
+}
+
 //  ==============================================================================================
 //  piwebgenMapChangeCB
 //
-//  Update the web on map change (if so configured)
+//  Update the web on map change (if so configured), and push a "map" event to live viewers
 // 
 //
 int piwebgenMapChangeCB( char *strIn )
 {
-    if ( piwebgenConfig.updateOnChange ) _genWebFile();
+    char mapName[256];
+
+    if ( piwebgenConfig.updateOnChange ) _genWebFile( 0 );
+
+    rosterParseMapname( strIn, 256, mapName );
+    _pushEvent( "map", "", "map", mapName );
     return 0;
 }
 
 //  ==============================================================================================
-//  ...
+//  piwebgenGameStartCB
 //
-//  ...
-//  ...
+//  Push a "game_start" event to live viewers
 //
 int piwebgenGameStartCB( char *strIn )
 {
+    _pushEvent( "game_start", "", NULL, NULL );
     return 0;
 }
 
 //  ==============================================================================================
-//  ...
+//  piwebgenGameEndCB
 //
-//  ...
-//  ...
+//  Push a "game_end" event to live viewers
 //
 int piwebgenGameEndCB( char *strIn )
 {
+    _pushEvent( "game_end", "", NULL, NULL );
     return 0;
 }
 
 //  ==============================================================================================
-//  ...
+//  piwebgenRoundStartCB
 //
-//  ...
-//  ...
+//  Push a "round_start" event to live viewers
 //
 int piwebgenRoundStartCB( char *strIn )
 {
+    _pushEvent( "round_start", "", NULL, NULL );
     return 0;
 }
 
 //  ==============================================================================================
-//  ...
+//  piwebgenRoundEndCB
 //
-//  ...
-//  ...
+//  Push a "round_end" event to live viewers
 //
 int piwebgenRoundEndCB( char *strIn )
 {
+    _pushEvent( "round_end", "", NULL, NULL );
     return 0;
 }
 
 //  ==============================================================================================
-//  ...
+//  piwebgenCapturedCB
 //
-//  ...
-//  ...
+//  Push a "captured" event to live viewers.  The game logs several lines per capture, so
+//  only the first within a 10-second window is pushed.
 //
 int piwebgenCapturedCB( char *strIn )
 {
+    static unsigned long lastTimeCaptured = 0L;
+
+    if ( lastTimeCaptured + 10L < apiTimeGet() ) {
+        lastTimeCaptured = apiTimeGet();
+        _pushEvent( "captured", "", NULL, NULL );
+    }
     return 0;
 }
 
@@ -315,21 +820,26 @@ int piwebgenCapturedCB( char *strIn )
 //  piwebgenPeriodicCB
 //
 //  This option updates the web page by time.  The update rate can be modified from the
-//  configuration file.
+//  configuration file; the callback is a repeating alarm, not armed if the rate is 0.
 //  
 //
 int piwebgenPeriodicCB( char *strIn )
 {
-    static int intervalCount = 0;
+    _genWebFile( 1 );
+    return 0;
+}
 
-    if ( 0 != piwebgenConfig.updateIntervalSec ) {
 
-        if ( (++intervalCount) > piwebgenConfig.updateIntervalSec ) {
-            _genWebFile();
-           intervalCount = 0;
-        }
-    }
-    return 0;
+//  ==============================================================================================
+//  _piwebgenArmUpdate (local)
+//
+static void _piwebgenArmUpdate( void )
+{
+    if ( 0 != piwebgenConfig.updateIntervalSec ) 
+        alarmRepeat( updateAlarmPtr, 1000 * (uint64_t) piwebgenConfig.updateIntervalSec );
+    else
+        alarmCancel( updateAlarmPtr );
+    return;
 }
 
 //  ==============================================================================================
@@ -340,17 +850,40 @@ int piwebgenPeriodicCB( char *strIn )
 //
 int piwebgenSigtermCB( char *strIn )
 {
-    FILE *fpw;
-
-    if (NULL != (fpw = fopen( piwebgenConfig.webFileName, "wt" ))) {
+    strBufReset( &renderBuf );
+    if ( 0 != piwebgenConfig.autoRefreshHeader ) 
+        strBufPrintf( &renderBuf, "<meta http-equiv=\"refresh\" content=\"14\" /> \n" );
+    strBufPrintf( &renderBuf, "<br><br>SISSM shut down at: &nbsp; %s\n", apiTimeGetHuman() );
+    if ( !renderBuf.overflow ) _writeAtomic( piwebgenConfig.webFileName, renderBuf.data, renderBuf.len );
+
+    strBufReset( &renderBuf );
+    strBufPrintf( &renderBuf, "{\"status\":\"shutdown\",\"time\":%lu,\"roster\":[]}\n", (unsigned long) time( NULL ));
+    if ( !renderBuf.overflow ) _writeAtomic( piwebgenConfig.jsonFileName, renderBuf.data, renderBuf.len );
+    _writeAtomic( piwebgenConfig.csvFileName, "steamid,name,score\r\n", 20 );
+
+    httpdDestroy( httpdPtr );                                  // viewers see connection refused
+    httpdPtr = NULL;
+    return 0;
+}
 
-	if ( 0 != piwebgenConfig.autoRefreshHeader ) 
-            fprintf( fpw, "<meta http-equiv=\"refresh\" content=\"14\" /> \n" );
 
-        fprintf( fpw, "<br><br>SISSM shut down at: &nbsp; %s\n", apiTimeGetHuman() );
-        fclose( fpw );
-    }
+//  ==============================================================================================
+//  piwebgenReloadConfigCB
+//
+//  Re-reads the output paths and update interval, re-arms the update alarm and reloads the
+//  templates; the reload count bumps the served ETag so clients re-fetch.  The embedded web
+//  server keeps its address/port until restart.  pluginState is kept.
+//
+int piwebgenReloadConfigCB( char *strIn )
+{
+    int pluginState = piwebgenConfig.pluginState;
 
+    piwebgenInitConfig();
+    piwebgenConfig.pluginState = pluginState;
+    if ( updateAlarmPtr != NULL ) _piwebgenArmUpdate();
+    servedReloads++;                                          // re-render with new settings
+    writtenValid = 0;
+    _loadTemplates();
     return 0;
 }
 
@@ -366,6 +899,7 @@ int piwebgenInstallPlugin( void )
     // Read the plugin-specific variables from the .cfg file 
     // 
     piwebgenInitConfig();
+    servedStart = (unsigned long) time( NULL );
 
     // if plugin is disabled in the .cfg file then do not activate
     //
@@ -385,8 +919,27 @@ int piwebgenInstallPlugin( void )
     eventsRegister( SISSM_EV_ROUND_START,          piwebgenRoundStartCB );
     eventsRegister( SISSM_EV_ROUND_END,            piwebgenRoundEndCB );
     eventsRegister( SISSM_EV_OBJECTIVE_CAPTURED,   piwebgenCapturedCB );
-    eventsRegister( SISSM_EV_PERIODIC,             piwebgenPeriodicCB );
+    eventsRegister( SISSM_EV_CLIENT_ADD_SYNTH,     piwebgenClientSynthAddCB );
+    eventsRegister( SISSM_EV_CLIENT_DEL_SYNTH,     piwebgenClientSynthDelCB );
     eventsRegister( SISSM_EV_SIGTERM,              piwebgenSigtermCB );
+    eventsRegister( SISSM_EV_RELOAD,               piwebgenReloadConfigCB );
+
+    _loadTemplates();
+
+    updateAlarmPtr = alarmCreate( piwebgenPeriodicCB );
+    _piwebgenArmUpdate();
+
+    // Optional embedded web server, serving the status from memory
+    //
+    if ( 0 != piwebgenConfig.httpPort ) {
+        httpdPtr = httpdCreate( piwebgenConfig.httpBindAddr, piwebgenConfig.httpPort, piwebgenConfig.httpMaxConn );
+        if ( httpdPtr != NULL ) {
+            httpdStreamRegister( httpdPtr, "/events", "/status.json" );
+            serveAlarmPtr = alarmCreate( piwebgenServeCB );
+            alarmRepeat( serveAlarmPtr, 1000 );
+            _servePages();
+        }
+    }
 
     return 0;
 }
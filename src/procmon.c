@@ -0,0 +1,390 @@
+//  ==============================================================================================
+//
+//  Module: PROCMON
+//
+//  Description:
+//  Game server process monitor: memory, CPU, thread and I/O samples from /proc, with trends
+//
+//  The server process is found by a pid file, or else by a substring of its command line
+//  (the largest match by resident memory, so that a wrapper script naming the binary does
+//  not win).  Each update reads /proc/<pid>/stat, statm and io - three small reads, no
+//  process scan - and appends a sample to a ring covering the trend window.  A pid that
+//  disappears or is reused by another process (start time changed) clears the window and
+//  the process is looked up again on the next update, so a server restart starts a fresh
+//  trend.  Not available on Windows: updates fail and no samples are kept.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#endif
+
+#include "bsd.h"
+#include "log.h"
+#include "metrics.h"
+#include "procmon.h"
+
+#define PROCMON_READ_MAX    (4096)                    // stat, statm, io and cmdline reads
+
+
+//  ==============================================================================================
+//  Data definition
+//
+struct procmonObj {
+
+    char pidFile[ 256 ];                                                       // "" = unused
+    char cmdMatch[ 256 ];                                                      // "" = unused
+
+    int  pid;                                                              // 0 = not located
+    uint64_t startTicks;                     // process start time, to detect a reused pid
+
+    long clockTicks;                                            // sysconf(): ticks per second
+    long pageSize;
+
+    int  windowSamples;
+    int  head;                                                       // oldest sample in ring
+    int  count;
+    procmonSample_t samples[ PROCMON_MAXSAMPLES ];
+
+};
+
+
+#ifndef _WIN32
+
+//  ==============================================================================================
+//  _procmonRead (local)
+//
+//  Reads a small /proc file into buf, NUL terminated.  Returns the byte count, -1 on error.
+//
+static int _procmonRead( char *path, char *buf, int bufSize )
+{
+    int fd, n;
+
+    if ( 0 > (fd = open( path, O_RDONLY | O_CLOEXEC ))) return( -1 );
+    n = (int) read( fd, buf, bufSize - 1 );
+    close( fd );
+    if ( n < 0 ) return( -1 );
+    buf[ n ] = 0;
+    return( n );
+}
+
+
+//  ==============================================================================================
+//  _procmonStatmRss (local)
+//
+//  Returns the resident memory of a process in pages, 0 if it cannot be read.
+//
+static uint64_t _procmonStatmRss( int pid )
+{
+    char path[ 64 ], buf[ 256 ];
+    unsigned long long vmPages = 0, rssPages = 0;
+
+    snprintf( path, sizeof( path ), "/proc/%d/statm", pid );
+    if ( 0 >= _procmonRead( path, buf, sizeof( buf ))) return( 0 );
+    if ( 2 != sscanf( buf, "%llu %llu", &vmPages, &rssPages )) return( 0 );
+    return( (uint64_t) rssPages );
+}
+
+
+//  ==============================================================================================
+//  _procmonLocate (local)
+//
+//  Finds the server process: the pid file if set, else the command line match using the
+//  most resident memory.  Returns the pid, 0 if not found.
+//
+static int _procmonLocate( procmonObj *pPtr )
+{
+    char path[ 64 ], buf[ PROCMON_READ_MAX ];
+    DIR *dirP;
+    struct dirent *entP;
+    int pid, n, i, bestPid = 0;
+    uint64_t rss, bestRss = 0;
+
+    if ( 0 != pPtr->pidFile[0] ) {
+        if ( 0 < _procmonRead( pPtr->pidFile, buf, sizeof( buf ))) {
+            pid = atoi( buf );
+            snprintf( path, sizeof( path ), "/proc/%d/stat", pid );
+            if (( pid > 0 ) && ( 0 < _procmonRead( path, buf, sizeof( buf )))) return( pid );
+        }
+        return( 0 );
+    }
+    if ( 0 == pPtr->cmdMatch[0] ) return( 0 );
+
+    if ( NULL == (dirP = opendir( "/proc" ))) return( 0 );
+    while ( NULL != (entP = readdir( dirP ))) {
+        if (( entP->d_name[0] < '1' ) || ( entP->d_name[0] > '9' )) continue;
+        if ((( pid = atoi( entP->d_name )) <= 0 ) || ( pid == (int) getpid() )) continue;
+
+        snprintf( path, sizeof( path ), "/proc/%d/cmdline", pid );
+        if ( 0 >= (n = _procmonRead( path, buf, sizeof( buf )))) continue;
+        for ( i=0; i<n; i++ ) if ( buf[i] == 0 ) buf[i] = ' ';              // argv to one line
+        if ( NULL == strstr( buf, pPtr->cmdMatch )) continue;
+
+        rss = _procmonStatmRss( pid );
+        if (( bestPid == 0 ) || ( rss > bestRss )) {
+            bestPid = pid;
+            bestRss = rss;
+        }
+    }
+    closedir( dirP );
+    return( bestPid );
+}
+
+
+//  ==============================================================================================
+//  _procmonSample (local)
+//
+//  Reads one sample of a process.  Returns 0 on success, 1 if the process is gone.
+//
+static int _procmonSample( procmonObj *pPtr, int pid, uint64_t *startTicks, procmonSample_t *sPtr )
+{
+    char path[ 64 ], buf[ PROCMON_READ_MAX ], *p, *q;
+    long long field[ 25 ];
+    unsigned long long vmPages, rssPages;
+    int i;
+
+    // /proc/<pid>/stat: the command name (2) is in parentheses and may hold spaces, so the
+    // numeric fields are counted from the last ')'.  3 is the state letter.
+    //
+    snprintf( path, sizeof( path ), "/proc/%d/stat", pid );
+    if ( 0 >= _procmonRead( path, buf, sizeof( buf ))) return( 1 );
+    if (( NULL == (p = strrchr( buf, ')' ))) || ( p[1] == 0 ) || ( p[2] == 0 )) return( 1 );
+    p += 3;
+    for ( i=4; i<=24; i++ ) {
+        field[i] = strtoll( p, &q, 10 );
+        if ( q == p ) return( 1 );
+        p = q;
+    }
+    *startTicks     = (uint64_t) field[22];
+    sPtr->cpuTicks  = (uint64_t) (field[14] + field[15]);                     // utime + stime
+    sPtr->threads   = (int) field[20];
+
+    snprintf( path, sizeof( path ), "/proc/%d/statm", pid );
+    if ( 0 >= _procmonRead( path, buf, sizeof( buf ))) return( 1 );
+    if ( 2 != sscanf( buf, "%llu %llu", &vmPages, &rssPages )) return( 1 );
+    sPtr->vmBytes  = (uint64_t) vmPages  * (uint64_t) pPtr->pageSize;
+    sPtr->rssBytes = (uint64_t) rssPages * (uint64_t) pPtr->pageSize;
+
+    // /proc/<pid>/io is only readable by the owner (or root); leave the counters at 0 if not
+    //
+    sPtr->readBytes = sPtr->writeBytes = 0;
+    snprintf( path, sizeof( path ), "/proc/%d/io", pid );
+    if ( 0 < _procmonRead( path, buf, sizeof( buf ))) {
+        if ( NULL != (p = strstr( buf, "\nread_bytes: " )))  sPtr->readBytes  = strtoull( p + 13, NULL, 10 );
+        if ( NULL != (p = strstr( buf, "\nwrite_bytes: " ))) sPtr->writeBytes = strtoull( p + 14, NULL, 10 );
+    }
+
+    sPtr->timeUs = metricsNowUs();
+    return( 0 );
+}
+
+#endif
+
+
+//  ==============================================================================================
+//  _procmonAt (local)
+//
+//  Returns the i-th sample of the window, 0 = oldest.
+//
+static procmonSample_t *_procmonAt( procmonObj *pPtr, int i )
+{
+    return( &pPtr->samples[ (pPtr->head + i) % pPtr->windowSamples ] );
+}
+
+
+//  ==============================================================================================
+//  procmonCreate
+//
+//  Creates a monitor for the process named by pidFile (if not "") or else the process with
+//  the largest resident memory whose command line contains cmdMatch.  windowSamples sets the trend window, at most
+//  PROCMON_MAXSAMPLES.  The process is located on the first update.
+//
+procmonObj *procmonCreate( char *pidFile, char *cmdMatch, int windowSamples )
+{
+    procmonObj *pPtr;
+
+    if ( NULL == (pPtr = (procmonObj *) calloc( 1, sizeof( procmonObj )))) return( NULL );
+    strlcpy( pPtr->pidFile,  pidFile,  sizeof( pPtr->pidFile ));
+    strlcpy( pPtr->cmdMatch, cmdMatch, sizeof( pPtr->cmdMatch ));
+    if ( windowSamples < 2 ) windowSamples = 2;
+    if ( windowSamples > PROCMON_MAXSAMPLES ) windowSamples = PROCMON_MAXSAMPLES;
+    pPtr->windowSamples = windowSamples;
+#ifndef _WIN32
+    pPtr->clockTicks = sysconf( _SC_CLK_TCK );
+    pPtr->pageSize   = sysconf( _SC_PAGESIZE );
+#endif
+    if ( pPtr->clockTicks <= 0 ) pPtr->clockTicks = 100;
+    if ( pPtr->pageSize   <= 0 ) pPtr->pageSize   = 4096;
+    return( pPtr );
+}
+
+
+//  ==============================================================================================
+//  procmonDestroy
+//
+void procmonDestroy( procmonObj *pPtr )
+{
+    free( pPtr );
+}
+
+
+//  ==============================================================================================
+//  procmonUpdate
+//
+//  Takes a sample, locating the process first if needed.  Returns 0 if sampled, 1 if the
+//  process is not found (the window is then cleared).
+//
+int procmonUpdate( procmonObj *pPtr )
+{
+#ifdef _WIN32
+    return( 1 );
+#else
+    procmonSample_t s, *prev;
+    uint64_t startTicks = 0;
+    int errCode = 1;
+
+    if ( pPtr == NULL ) return( 1 );
+
+    if ( pPtr->pid != 0 ) errCode = _procmonSample( pPtr, pPtr->pid, &startTicks, &s );
+    if (( errCode != 0 ) || ( startTicks != pPtr->startTicks )) {
+        if ( pPtr->pid != 0 )
+            logPrintf( LOG_LEVEL_INFO, "procmon", "Server process %d is gone", pPtr->pid );
+        pPtr->pid = 0;
+        pPtr->count = pPtr->head = 0;
+        if ( 0 != (pPtr->pid = _procmonLocate( pPtr ))) {
+            if ( 0 == (errCode = _procmonSample( pPtr, pPtr->pid, &startTicks, &s ))) {
+                pPtr->startTicks = startTicks;
+                logPrintf( LOG_LEVEL_INFO, "procmon", "Server process located, pid %d", pPtr->pid );
+            }
+            else {
+                pPtr->pid = 0;
+            }
+        }
+    }
+    if ( errCode != 0 ) return( 1 );
+
+    s.cpuPercent = -1.0;
+    if ( pPtr->count > 0 ) {
+        prev = _procmonAt( pPtr, pPtr->count - 1 );
+        if ( s.timeUs > prev->timeUs )
+            s.cpuPercent = 100.0 * 1000000.0 * (double) (s.cpuTicks - prev->cpuTicks) /
+                (double) pPtr->clockTicks / (double) (s.timeUs - prev->timeUs);
+    }
+
+    if ( pPtr->count < pPtr->windowSamples ) {
+        *_procmonAt( pPtr, pPtr->count++ ) = s;
+    }
+    else {
+        pPtr->samples[ pPtr->head ] = s;
+        pPtr->head = (pPtr->head + 1) % pPtr->windowSamples;
+    }
+    return( 0 );
+#endif
+}
+
+
+//  ==============================================================================================
+//  procmonPid, procmonCount, procmonLast
+//
+//  The monitored pid (0 if not located), the number of samples in the window, and the
+//  latest sample (NULL if none).
+//
+int procmonPid( procmonObj *pPtr )
+{
+    return( pPtr == NULL ? 0 : pPtr->pid );
+}
+
+int procmonCount( procmonObj *pPtr )
+{
+    return( pPtr == NULL ? 0 : pPtr->count );
+}
+
+const procmonSample_t *procmonLast( procmonObj *pPtr )
+{
+    if (( pPtr == NULL ) || ( pPtr->count == 0 )) return( NULL );
+    return( _procmonAt( pPtr, pPtr->count - 1 ));
+}
+
+
+//  ==============================================================================================
+//  procmonSpanSec
+//
+//  Seconds between the oldest and the latest sample of the window.
+//
+double procmonSpanSec( procmonObj *pPtr )
+{
+    if (( pPtr == NULL ) || ( pPtr->count < 2 )) return( 0.0 );
+    return( (double) (_procmonAt( pPtr, pPtr->count - 1 )->timeUs - _procmonAt( pPtr, 0 )->timeUs) / 1000000.0 );
+}
+
+
+//  ==============================================================================================
+//  _procmonSlope (local)
+//
+//  Least squares slope, per second, of resident memory (whichValue 0) or thread count (1)
+//  over the window.  0 with fewer than 2 samples.
+//
+static double _procmonSlope( procmonObj *pPtr, int whichValue )
+{
+    double x, y, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, n, d;
+    procmonSample_t *sPtr;
+    int i;
+
+    if (( pPtr == NULL ) || ( pPtr->count < 2 )) return( 0.0 );
+
+    for ( i=0; i<pPtr->count; i++ ) {
+        sPtr = _procmonAt( pPtr, i );
+        x = (double) (sPtr->timeUs - _procmonAt( pPtr, 0 )->timeUs) / 1000000.0;
+        y = ( whichValue == 0 ) ? (double) sPtr->rssBytes : (double) sPtr->threads;
+        sx += x;  sy += y;  sxx += x * x;  sxy += x * y;
+    }
+    n = (double) pPtr->count;
+    d = n * sxx - sx * sx;
+    return( ( d > 0.0 ) ? (n * sxy - sx * sy) / d : 0.0 );
+}
+
+
+//  ==============================================================================================
+//  procmonRssSlope, procmonThreadSlope
+//
+//  Resident memory growth in bytes per second, and thread count growth per second, fitted
+//  over the window.
+//
+double procmonRssSlope( procmonObj *pPtr )
+{
+    return( _procmonSlope( pPtr, 0 ));
+}
+
+double procmonThreadSlope( procmonObj *pPtr )
+{
+    return( _procmonSlope( pPtr, 1 ));
+}
+
+
+//  ==============================================================================================
+//  procmonCpuAverage
+//
+//  CPU use over the window in percent of one core (a saturated game thread shows ~100).
+//
+double procmonCpuAverage( procmonObj *pPtr )
+{
+    double span = procmonSpanSec( pPtr );
+
+    if ( span <= 0.0 ) return( 0.0 );
+    return( 100.0 * (double) (_procmonAt( pPtr, pPtr->count - 1 )->cpuTicks - _procmonAt( pPtr, 0 )->cpuTicks) /
+        (double) pPtr->clockTicks / span );
+}
+
@@ -0,0 +1,45 @@
+//  ==============================================================================================
+//
+//  Module: PROCMON
+//
+//  Description:
+//  Game server process monitor: memory, CPU, thread and I/O samples from /proc, with trends
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdint.h>
+
+#define PROCMON_MAXSAMPLES  (720)                 // trend window, e.g., 2 hours of 10s samples
+
+typedef struct {
+
+    uint64_t timeUs;                                                  // metricsNowUs() clock
+    uint64_t rssBytes;                                                   // resident memory
+    uint64_t vmBytes;                                                     // virtual memory
+    uint64_t cpuTicks;                                          // user + system, clock ticks
+    double   cpuPercent;            // of one core since the previous sample, -1 on the first
+    int      threads;
+    uint64_t readBytes;                  // storage I/O, 0 if /proc/<pid>/io is not readable
+    uint64_t writeBytes;
+
+} procmonSample_t;
+
+typedef struct procmonObj procmonObj;
+
+extern procmonObj *procmonCreate( char *pidFile, char *cmdMatch, int windowSamples );
+extern void procmonDestroy( procmonObj *pPtr );
+extern int  procmonUpdate( procmonObj *pPtr );
+extern int  procmonPid( procmonObj *pPtr );
+extern int  procmonCount( procmonObj *pPtr );
+extern const procmonSample_t *procmonLast( procmonObj *pPtr );
+extern double procmonSpanSec( procmonObj *pPtr );
+extern double procmonRssSlope( procmonObj *pPtr );
+extern double procmonThreadSlope( procmonObj *pPtr );
+extern double procmonCpuAverage( procmonObj *pPtr );
+
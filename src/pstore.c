@@ -0,0 +1,648 @@
+//  ==============================================================================================
+//
+//  Module: PSTORE
+//
+//  Description:
+//  Persistent player session history store keyed by SteamID64
+//
+//  The store is made of two files:
+//
+//  <name>       append-only data file of fixed-size pstoreRec_t records.  Every update appends
+//               a complete new version of the player record; the newest one wins.
+//  <name>.idx   open-addressing hash index { steamID -> record# } that is memory-mapped on
+//               Linux, so that lookup is a hash probe plus one record read regardless of how
+//               many historical players are on file.  The index is disposable: if it is
+//               missing or does not cover the whole data file (crash, copy, Windows), it is
+//               rebuilt by replaying the data file at startup.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include "winport.h"
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#include "bsd.h"
+#include "log.h"
+#include "util.h"
+#include "nindex.h"
+#include "sid.h"
+#include "pstore.h"
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define PSTORE_REC_MAGIC     (0x31525350)                                        // "PSR1"
+#define PSTORE_IDX_MAGIC     (0x31495350)                                        // "PSI1"
+#define PSTORE_IDX_MINCAP    (1024)                        // minimum index slots (power of 2)
+#define PSTORE_FILENAME_MAX  (1024)
+#define PSTORE_REPLAY_BLOCK  (1024)                 // records per read block on index rebuild
+#define PSTORE_TOUCH_SEC     (900)        // lastSeen of an open session is refreshed this often
+
+typedef struct {
+
+    uint32_t magic;
+    uint32_t capacity;                                         // number of slots, power of 2
+    uint32_t count;                                                 // number of occupied slots
+    uint32_t reserved;
+    uint64_t dataRecords;               // number of data records reflected in this index
+    uint64_t reserved2;
+
+} pstoreIdxHdr_t;
+
+typedef struct {
+
+    uint64_t steamID;                                                        // 0 = empty slot
+    uint32_t recNo;                                      // record# of the newest data record
+    uint32_t reserved;
+
+} pstoreSlot_t;
+
+static FILE           *_dataFp = NULL;                                   // append-only data file
+static uint64_t        _dataRecords = 0L;                          // number of records on file
+static char            _idxFileName[PSTORE_FILENAME_MAX];
+
+static pstoreIdxHdr_t *_idxHdr   = NULL;                  // index header (mapped or allocated)
+static pstoreSlot_t   *_idxSlots = NULL;                              // slot table follows header
+static size_t          _idxSize  = 0;
+#ifndef _WIN32
+static int             _idxFd    = -1;
+#endif
+static nindexObj      *_nameIndex = NULL;               // optional partial name index, or NULL
+
+
+//  ==============================================================================================
+//  _pstoreParseIP (local)
+//
+//  Convert "111.022.003.004" (or unpadded) IPv4 string to host-order number, 0 on error.
+//
+static uint32_t _pstoreParseIP( char *playerIP )
+{
+    uint32_t retValue = 0;
+
+    parseIPv4( playerIP, &retValue );
+    return( retValue );
+}
+
+
+//  ==============================================================================================
+//  _pstoreIdxUnmap (local)
+//
+//  Release the index memory (and the backing file handle on Linux).
+//
+static void _pstoreIdxUnmap( void )
+{
+    if ( _idxHdr != NULL ) {
+#ifdef _WIN32
+        free( _idxHdr );
+#else
+        munmap( _idxHdr, _idxSize );
+        close( _idxFd );
+        _idxFd = -1;
+#endif
+    }
+    _idxHdr = NULL;
+    _idxSlots = NULL;
+    _idxSize = 0;
+    return;
+}
+
+
+//  ==============================================================================================
+//  _pstoreIdxMap (local)
+//
+//  Map the index.  If 'capacity' is non-zero a fresh zeroed index of that many slots is
+//  created, else the existing index file is mapped as-is.  Returns 0 on success.
+//
+static int _pstoreIdxMap( uint32_t capacity )
+{
+    int errCode = 1;
+
+#ifdef _WIN32
+    // No memory-mapped index on Windows: always a fresh in-memory table, rebuilt on start
+    //
+    if ( capacity != 0 ) {
+        _idxSize = sizeof( pstoreIdxHdr_t ) + (size_t) capacity * sizeof( pstoreSlot_t );
+        if ( NULL != (_idxHdr = (pstoreIdxHdr_t *) calloc( 1, _idxSize ))) errCode = 0;
+    }
+#else
+    struct stat st;
+    void *p;
+
+    if ( capacity != 0 ) {
+        _idxSize = sizeof( pstoreIdxHdr_t ) + (size_t) capacity * sizeof( pstoreSlot_t );
+        _idxFd = open( _idxFileName, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        if ( _idxFd >= 0 )
+            if ( 0 != ftruncate( _idxFd, _idxSize )) { close( _idxFd ); _idxFd = -1; }
+    }
+    else {
+        _idxFd = open( _idxFileName, O_RDWR );
+        if ( _idxFd >= 0 ) {
+            if ( (0 == fstat( _idxFd, &st )) && (st.st_size > (off_t) sizeof( pstoreIdxHdr_t )) ) {
+                _idxSize = st.st_size;
+            }
+            else {
+                close( _idxFd );
+                _idxFd = -1;
+            }
+        }
+    }
+
+    if ( _idxFd >= 0 ) {
+        p = mmap( NULL, _idxSize, PROT_READ | PROT_WRITE, MAP_SHARED, _idxFd, 0 );
+        if ( p != MAP_FAILED ) {
+            _idxHdr = (pstoreIdxHdr_t *) p;
+            errCode = 0;
+        }
+        else {
+            close( _idxFd );
+            _idxFd = -1;
+        }
+    }
+#endif
+
+    if ( 0 == errCode ) {
+        _idxSlots = (pstoreSlot_t *) &_idxHdr[1];
+        if ( capacity != 0 ) {
+            _idxHdr->magic = PSTORE_IDX_MAGIC;
+            _idxHdr->capacity = capacity;
+            _idxHdr->count = 0;
+            _idxHdr->dataRecords = 0;
+        }
+    }
+    else {
+        _idxSize = 0;
+    }
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  _pstoreIdxFind (local)
+//
+//  Linear-probe for steamID.  Returns the slot holding it, or the empty slot where it
+//  would be inserted.
+//
+static pstoreSlot_t *_pstoreIdxFind( uint64_t steamID )
+{
+    uint32_t mask, i;
+
+    mask = _idxHdr->capacity - 1;
+    i = sidHash( steamID ) & mask;
+    while (( _idxSlots[i].steamID != 0 ) && ( _idxSlots[i].steamID != steamID ))
+        i = (i + 1) & mask;
+    return( &_idxSlots[i] );
+}
+
+
+//  ==============================================================================================
+//  _pstoreIdxGrow (local)
+//
+//  Double the index capacity when it gets more than half full, and re-insert all keys.
+//
+static int _pstoreIdxGrow( void )
+{
+    pstoreSlot_t *oldSlots, *s;
+    uint32_t oldCapacity, i;
+    uint64_t dataRecords;
+    int errCode = 1;
+
+    oldCapacity = _idxHdr->capacity;
+    dataRecords = _idxHdr->dataRecords;
+    oldSlots = (pstoreSlot_t *) malloc( (size_t) oldCapacity * sizeof( pstoreSlot_t ));
+
+    if ( oldSlots != NULL ) {
+        memcpy( oldSlots, _idxSlots, (size_t) oldCapacity * sizeof( pstoreSlot_t ));
+        _pstoreIdxUnmap();
+        if ( 0 == (errCode = _pstoreIdxMap( oldCapacity * 2 ))) {
+            for ( i=0; i<oldCapacity; i++ ) {
+                if ( oldSlots[i].steamID != 0 ) {
+                    s = _pstoreIdxFind( oldSlots[i].steamID );
+                    *s = oldSlots[i];
+                    _idxHdr->count++;
+                }
+            }
+            _idxHdr->dataRecords = dataRecords;
+        }
+        free( oldSlots );
+    }
+    if ( errCode ) logPrintf( LOG_LEVEL_CRITICAL, "pstore", "Unable to grow index ::%s::", _idxFileName );
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  _pstoreIdxInsert (local)
+//
+//  Point steamID at record# recNo, adding the key if new.
+//
+static int _pstoreIdxInsert( uint64_t steamID, uint32_t recNo )
+{
+    pstoreSlot_t *s;
+    int errCode = 0;
+
+    s = _pstoreIdxFind( steamID );
+    if ( s->steamID == 0 ) {
+        if ( (_idxHdr->count + 1) * 2 > _idxHdr->capacity ) {
+            if ( 0 != (errCode = _pstoreIdxGrow()) ) return( errCode );
+            s = _pstoreIdxFind( steamID );
+        }
+        s->steamID = steamID;
+        _idxHdr->count++;
+    }
+    s->recNo = recNo;
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  _pstoreIdxRebuild (local)
+//
+//  Re-create the index by replaying the whole data file, oldest to newest.
+//
+static int _pstoreIdxRebuild( void )
+{
+    pstoreRec_t *block;
+    uint64_t recNo = 0;
+    size_t i, n;
+    int errCode = 1;
+
+    _pstoreIdxUnmap();
+    if ( 0 != _pstoreIdxMap( PSTORE_IDX_MINCAP )) return( 1 );
+
+    if ( NULL != (block = (pstoreRec_t *) malloc( PSTORE_REPLAY_BLOCK * sizeof( pstoreRec_t )))) {
+        errCode = 0;
+        fseek( _dataFp, 0L, SEEK_SET );
+        while ( recNo < _dataRecords ) {
+            n = fread( block, sizeof( pstoreRec_t ), PSTORE_REPLAY_BLOCK, _dataFp );
+            if ( n == 0 ) break;
+            for ( i=0; i<n; i++, recNo++ ) {
+                if (( block[i].magic == PSTORE_REC_MAGIC ) && ( block[i].steamID != 0 ))
+                    if ( 0 != ( errCode = _pstoreIdxInsert( block[i].steamID, (uint32_t) recNo ))) break;
+            }
+            if ( errCode ) break;
+        }
+        free( block );
+        _idxHdr->dataRecords = _dataRecords;
+    }
+    logPrintf( LOG_LEVEL_INFO, "pstore", "Rebuilt index of %u players from %lu records",
+        _idxHdr->count, (unsigned long) _dataRecords );
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  _pstoreAppend (local)
+//
+//  Append a new version of the player record and point the index at it.
+//
+static int _pstoreAppend( pstoreRec_t *rec )
+{
+    int errCode = 1;
+
+    rec->magic = PSTORE_REC_MAGIC;
+    fseek( _dataFp, 0L, SEEK_END );
+    if ( 1 == fwrite( rec, sizeof( pstoreRec_t ), 1, _dataFp )) {
+        fflush( _dataFp );
+        if ( 0 == (errCode = _pstoreIdxInsert( rec->steamID, (uint32_t) _dataRecords ))) {
+            _dataRecords++;
+            _idxHdr->dataRecords = _dataRecords;
+        }
+    }
+    else {
+        logPrintf( LOG_LEVEL_CRITICAL, "pstore", "Player store write error" );
+    }
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  _pstoreRemember (local)
+//
+//  Insert a name or address at the head of a most-recent-first list, dropping the oldest.
+//  A name not already on the list is also added to the partial name index.
+//
+static void _pstoreRememberName( pstoreRec_t *rec, char *playerName )
+{
+    int i;
+
+    if ( 0 == strlen( playerName )) return;
+    for ( i=0; i<PSTORE_NAMES_MAX-1; i++ )
+        if ( 0 == strncmp( rec->nameList[i], playerName, PSTORE_NAME_MAX-1 )) break;
+    if (( _nameIndex != NULL ) && ( 0 != strncmp( rec->nameList[i], playerName, PSTORE_NAME_MAX-1 )))
+        nindexAdd( _nameIndex, playerName, rec->steamID );
+    memmove( rec->nameList[1], rec->nameList[0], i * PSTORE_NAME_MAX );
+    strlcpy( rec->nameList[0], playerName, PSTORE_NAME_MAX );
+    return;
+}
+
+static void _pstoreRememberIP( pstoreRec_t *rec, uint32_t ip )
+{
+    int i;
+
+    if ( ip == 0 ) return;
+    for ( i=0; i<PSTORE_IPS_MAX-1; i++ )
+        if ( rec->ipList[i] == ip ) break;
+    memmove( &rec->ipList[1], &rec->ipList[0], i * sizeof( uint32_t ));
+    rec->ipList[0] = ip;
+    return;
+}
+
+
+//  ==============================================================================================
+//  _pstoreNameIndexBuild (local)
+//
+//  Index every remembered name of every player on file for partial name search.
+//
+static int _pstoreNameIndexBuild( void )
+{
+    pstoreRec_t rec;
+    uint32_t i;
+    int j;
+
+    if ( NULL == (_nameIndex = nindexCreate() )) return 1;
+    for ( i=0; i<_idxHdr->capacity; i++ ) {
+        if ( _idxSlots[i].steamID == 0 ) continue;
+        if ( 0 != pstoreLookup( _idxSlots[i].steamID, &rec )) continue;
+        for ( j=0; j<PSTORE_NAMES_MAX; j++ )
+            if ( 0 != strlen( rec.nameList[j] )) nindexAdd( _nameIndex, rec.nameList[j], rec.steamID );
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  pstoreInit
+//
+//  Open (or create) the player store.  A missing or stale index is rebuilt from the data file.
+//  If nameIndexFlag is set, known names are also indexed for pstoreSearchName().
+//  Returns 0 on success.  If the store cannot be opened, all other calls become no-ops.
+//
+int pstoreInit( char *fileName, int nameIndexFlag )
+{
+    long fileSize;
+
+    pstoreDestroy();
+    if ( 0 == strlen( fileName )) return 1;
+
+    if ( NULL == (_dataFp = fopen( fileName, "ab+" ))) {
+        logPrintf( LOG_LEVEL_CRITICAL, "pstore", "Unable to open player store ::%s::", fileName );
+        return 1;
+    }
+    snprintf( _idxFileName, PSTORE_FILENAME_MAX, "%s.idx", fileName );
+
+    // drop any partially written record at the tail (crash during write)
+    //
+    fseek( _dataFp, 0L, SEEK_END );
+    fileSize = ftell( _dataFp );
+    _dataRecords = (uint64_t) fileSize / sizeof( pstoreRec_t );
+    if ( (uint64_t) fileSize != _dataRecords * sizeof( pstoreRec_t )) {
+        logPrintf( LOG_LEVEL_WARN, "pstore", "Truncating partial record in ::%s::", fileName );
+        fflush( _dataFp );
+#ifdef _WIN32
+        _chsize( _fileno( _dataFp ), (long) (_dataRecords * sizeof( pstoreRec_t )));
+#else
+        if ( 0 != ftruncate( fileno( _dataFp ), _dataRecords * sizeof( pstoreRec_t )))
+            logPrintf( LOG_LEVEL_CRITICAL, "pstore", "Truncate failed ::%s::", fileName );
+#endif
+    }
+
+    // use the existing index only if it is sane and covers every record on file
+    //
+    if ( 0 == _pstoreIdxMap( 0 )) {
+        if (( _idxHdr->magic != PSTORE_IDX_MAGIC ) ||
+            ( _idxHdr->capacity < PSTORE_IDX_MINCAP ) ||
+            ( 0 != (_idxHdr->capacity & (_idxHdr->capacity - 1))) ||
+            ( _idxSize != sizeof( pstoreIdxHdr_t ) + (size_t) _idxHdr->capacity * sizeof( pstoreSlot_t )) ||
+            ( _idxHdr->dataRecords != _dataRecords ))
+            _pstoreIdxUnmap();
+    }
+    if ( _idxHdr == NULL ) {
+        if ( 0 != _pstoreIdxRebuild() ) {
+            logPrintf( LOG_LEVEL_CRITICAL, "pstore", "Unable to build index ::%s::", _idxFileName );
+            pstoreDestroy();
+            return 1;
+        }
+    }
+
+    if ( nameIndexFlag ) {
+        if ( 0 != _pstoreNameIndexBuild() )
+            logPrintf( LOG_LEVEL_CRITICAL, "pstore", "Unable to build name index, name search disabled" );
+    }
+
+    logPrintf( LOG_LEVEL_CRITICAL, "pstore", "Player store %u players from file %s", _idxHdr->count, fileName );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  pstoreDestroy
+//
+//  Close the player store.
+//
+void pstoreDestroy( void )
+{
+    _pstoreIdxUnmap();
+    nindexDestroy( _nameIndex );
+    _nameIndex = NULL;
+    if ( _dataFp != NULL ) fclose( _dataFp );
+    _dataFp = NULL;
+    _dataRecords = 0;
+    return;
+}
+
+
+//  ==============================================================================================
+//  pstoreLookup
+//
+//  Fetch the newest record of a player.  Returns 0 if found, non-zero if never seen.
+//
+int pstoreLookup( uint64_t steamID, pstoreRec_t *rec )
+{
+    pstoreSlot_t *s;
+    int errCode = 1;
+
+    if (( _idxHdr != NULL ) && ( steamID != 0 )) {
+        s = _pstoreIdxFind( steamID );
+        if ( s->steamID == steamID ) {
+            fseek( _dataFp, (long) (s->recNo * sizeof( pstoreRec_t )), SEEK_SET );
+            if ( 1 == fread( rec, sizeof( pstoreRec_t ), 1, _dataFp ))
+                if (( rec->magic == PSTORE_REC_MAGIC ) && ( rec->steamID == steamID )) errCode = 0;
+        }
+    }
+    return( errCode );
+}
+
+
+//  ==============================================================================================
+//  pstoreLookupStr
+//
+//  Same as pstoreLookup with SteamID64 in the string form.
+//
+int pstoreLookupStr( char *steamID, pstoreRec_t *rec )
+{
+    return( pstoreLookup( sidParse( steamID ), rec ));
+}
+
+
+//  ==============================================================================================
+//  pstoreSearchName
+//
+//  Finds players who were ever seen under a name containing partialName.  Returns the
+//  number of matching names (a player may match under several), up to maxMatches of them
+//  best first in 'matches'.  Returns 0 if the name index is not enabled.
+//
+int pstoreSearchName( char *partialName, nindexMatch_t *matches, int maxMatches )
+{
+    return( nindexSearch( _nameIndex, partialName, matches, maxMatches ));
+}
+
+
+//  ==============================================================================================
+//  pstoreSessionOpen
+//
+//  Record a player connection (synthetic add).  Argument order matches the synthetic event
+//  generator callbacks so this can be passed to rosterSyntheticChangeEvent() directly.
+//
+//  A player whose session is still open on file was in game when sissm stopped.  If that
+//  session was refreshed (pstoreSessionTouch) recently enough, sissm was only restarted
+//  under the player and the session simply continues.  Otherwise it is closed at its last
+//  refresh and a new session is started.
+//
+int pstoreSessionOpen( char *playerName, char *playerIP, char *playerGUID )
+{
+    pstoreRec_t rec;
+    uint64_t steamID;
+    uint32_t timeNow;
+
+    if ( _idxHdr == NULL ) return 1;
+    if ( 0 == (steamID = sidParse( playerGUID ))) return 1;
+
+    timeNow = (uint32_t) time( NULL );
+    if ( 0 != pstoreLookup( steamID, &rec )) {
+        memset( &rec, 0, sizeof( rec ));
+        rec.steamID = steamID;
+        rec.firstSeen = timeNow;
+    }
+
+    if (( rec.sessionStart != 0 ) && ( timeNow <= rec.lastSeen + 2 * PSTORE_TOUCH_SEC )) {
+        rec.lastSeen = timeNow;                                  // continuing open session
+    }
+    else {
+        // a stale open session is credited up to its last refresh
+        //
+        if (( rec.sessionStart != 0 ) && ( rec.lastSeen > rec.sessionStart ))
+            rec.totalPlaySec += rec.lastSeen - rec.sessionStart;
+
+        rec.sessionStart = timeNow;
+        rec.lastSeen = timeNow;
+        rec.sessionCount++;
+    }
+    _pstoreRememberName( &rec, playerName );
+    _pstoreRememberIP( &rec, _pstoreParseIP( playerIP ));
+
+    return( _pstoreAppend( &rec ));
+}
+
+
+//  ==============================================================================================
+//  _pstoreTouch (local)
+//
+//  Set lastSeen of an open session to now, writing a new record version only if the stored
+//  lastSeen is at least minAgeSec old.
+//
+static int _pstoreTouch( char *playerGUID, uint32_t minAgeSec )
+{
+    pstoreRec_t rec;
+    uint32_t timeNow;
+
+    if ( _idxHdr == NULL ) return 1;
+    if ( 0 != pstoreLookupStr( playerGUID, &rec )) return 1;
+    if ( rec.sessionStart == 0 ) return 1;
+
+    timeNow = (uint32_t) time( NULL );
+    if ( timeNow < rec.lastSeen + minAgeSec ) return 0;
+    rec.lastSeen = timeNow;
+    return( _pstoreAppend( &rec ));
+}
+
+
+//  ==============================================================================================
+//  pstoreSessionTouch
+//
+//  Refresh lastSeen of a player in game, called for every player on each roster poll.  A new
+//  record version is written only every PSTORE_TOUCH_SEC, so that an open session left by a
+//  killed sissm is credited to within that time and the data file grows slowly.
+//
+int pstoreSessionTouch( char *playerName, char *playerIP, char *playerGUID )
+{
+    return( _pstoreTouch( playerGUID, PSTORE_TOUCH_SEC ));
+}
+
+
+//  ==============================================================================================
+//  pstoreSessionFlush
+//
+//  Refresh lastSeen of a player in game unconditionally, called for every player when sissm
+//  shuts down.  The session stays open so that a restart soon after continues it (see
+//  pstoreSessionOpen) instead of counting a new one.
+//
+int pstoreSessionFlush( char *playerName, char *playerIP, char *playerGUID )
+{
+    return( _pstoreTouch( playerGUID, 0 ));
+}
+
+
+//  ==============================================================================================
+//  pstoreSessionClose
+//
+//  Record a player disconnection (synthetic del), crediting the session play time.
+//
+int pstoreSessionClose( char *playerName, char *playerIP, char *playerGUID )
+{
+    pstoreRec_t rec;
+    uint32_t timeNow;
+
+    if ( _idxHdr == NULL ) return 1;
+    if ( 0 != pstoreLookupStr( playerGUID, &rec )) return 1;         // never saw the connect
+
+    timeNow = (uint32_t) time( NULL );
+    if (( rec.sessionStart != 0 ) && ( timeNow > rec.sessionStart ))
+        rec.totalPlaySec += timeNow - rec.sessionStart;
+    rec.sessionStart = 0;
+    rec.lastSeen = timeNow;
+    _pstoreRememberName( &rec, playerName );
+
+    return( _pstoreAppend( &rec ));
+}
+
+
+//  ==============================================================================================
+//  pstoreCount
+//
+//  Returns the number of distinct players on file.
+//
+unsigned long pstoreCount( void )
+{
+    return( (_idxHdr == NULL) ? 0 : _idxHdr->count );
+}
+
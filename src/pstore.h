@@ -0,0 +1,51 @@
+//  ==============================================================================================
+//
+//  Module: PSTORE
+//
+//  Description:
+//  Persistent player session history store keyed by SteamID64
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdint.h>
+#include "nindex.h"
+
+#define PSTORE_NAMES_MAX      (4)           // number of known names remembered, most recent first
+#define PSTORE_IPS_MAX        (4)           // number of known IP#s remembered, most recent first
+#define PSTORE_NAME_MAX      (48)           // max size of a remembered name, including terminator
+
+//  On-disk (and in-memory) player record.  The data file is an append-only sequence of these
+//  fixed-size records; the newest record of a given steamID supersedes all older ones.
+//  Size is exactly 256 bytes -- do not reorder fields.
+//
+typedef struct {
+
+    uint32_t magic;                                           // PSTORE_REC_MAGIC, torn write check
+    uint32_t firstSeen;                                     // epoch time of very first connection
+    uint32_t lastSeen;                                         // last connect/disconn/refresh
+    uint32_t totalPlaySec;                                       // accumulated closed session time
+    uint32_t sessionCount;                                              // number of sessions opened
+    uint32_t sessionStart;                             // epoch start of open session, 0 if offline
+    uint64_t steamID;                                                         // SteamID64 (key)
+    uint32_t ipList[PSTORE_IPS_MAX];                              // IPv4 host-order, 0 if unused
+    char     nameList[PSTORE_NAMES_MAX][PSTORE_NAME_MAX];                 // "" if unused
+    uint32_t reserved[4];
+
+} pstoreRec_t;
+
+extern int  pstoreInit( char *fileName, int nameIndexFlag );
+extern void pstoreDestroy( void );
+extern int  pstoreLookup( uint64_t steamID, pstoreRec_t *rec );
+extern int  pstoreLookupStr( char *steamID, pstoreRec_t *rec );
+extern int  pstoreSearchName( char *partialName, nindexMatch_t *matches, int maxMatches );
+extern int  pstoreSessionOpen( char *playerName, char *playerIP, char *playerGUID );
+extern int  pstoreSessionTouch( char *playerName, char *playerIP, char *playerGUID );
+extern int  pstoreSessionFlush( char *playerName, char *playerIP, char *playerGUID );
+extern int  pstoreSessionClose( char *playerName, char *playerIP, char *playerGUID );
+extern unsigned long pstoreCount( void );
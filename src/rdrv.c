@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/types.h>
 #include <fcntl.h>
 
@@ -35,6 +36,8 @@
 #include "log.h"
 #include "rdrv.h"
 #include "util.h"
+#include "metrics.h"
+#include "journal.h"
 
 #if 1      // optimized
 #define RDRV_DELAY_PASSWORD         (1000000)     // delay between password send and response
@@ -56,6 +59,27 @@
 #define RDRV_DELAY_RCVPOLL20         (100000)     // receive polling interval per iteration (retried 10x)
 #endif
 
+#define RDRV_BATCH_TIMEOUT          (2000000)     // wait for all answers of a pipelined batch
+#define RDRV_BATCH_POLL               (5000)     // receive polling interval of a batch
+#define RDRV_BATCH_DRAIN             (50000)     // wait for the end marker once all are answered
+#define RDRV_BATCH_ID0             (0x10000)     // request id of the first command of a batch
+
+
+//  ==============================================================================================
+//  Metrics: per command verb (first word of the command: "listplayers", "say", ...), plus
+//  connection events.  Verbs past RDRV_MAXVERBS share the "other" series.
+//
+
+#define RDRV_MAXVERBS       (24)
+
+static struct {
+    char        verb[32];
+    metricsObj *commands, *failures, *latency;
+} rdrvVerbs[RDRV_MAXVERBS + 1];
+static int rdrvVerbCount = 0;
+
+static metricsObj *rdrvConnectsMetric = NULL, *rdrvConnectFailsMetric = NULL, *rdrvReconnectsMetric = NULL;
+
 
 //  ==============================================================================================
 //  SetSocketBlockingEnabled
@@ -100,6 +124,32 @@ void rdrvLogFile( char *buf, int n, char *fileName )
 }
 
 
+//  ==============================================================================================
+//  _rdrvEncode (local)
+//
+//  Format one RCON packet (size, request id, type, command, two NULs; integers little
+//  endian) into buf.  Returns the packet length.  The command is truncated to fit BUFSIZE_T.
+//
+static int _rdrvEncode( char *buf, unsigned long requestID, int msgType, char *rconCmd )
+{
+    int i, cmdLen, outLen;
+
+    cmdLen = (int) strlen( rconCmd );
+    if ( cmdLen > BUFSIZE_T - 14 ) cmdLen = BUFSIZE_T - 14;
+    outLen = cmdLen + 14;
+
+    for ( i=0; i<4; i++ ) {
+        buf[i]   = (char) (((unsigned long) (outLen - 4) >> (8*i)) & 0xff);
+        buf[4+i] = (char) ((requestID >> (8*i)) & 0xff);
+        buf[8+i] = (char) ((((unsigned long) msgType) >> (8*i)) & 0xff);
+    }
+    memcpy( &buf[12], rconCmd, cmdLen );
+    buf[ 12 + cmdLen ] = 0;
+    buf[ 13 + cmdLen ] = 0;
+    return( outLen );
+}
+
+
 //  ==============================================================================================
 //  rdrvSend
 //
@@ -108,17 +158,12 @@ void rdrvLogFile( char *buf, int n, char *fileName )
 int rdrvSend( rdrvObj *rPtr, int msgtype, char *rconcmd )
 {
     char buf[BUFSIZE_T];
-    int  errCode, i, outlen;
-
-    // bzero( buf, BUFSIZE_T );
-    memset( buf, 0, BUFSIZE_T );
-    buf[8] = msgtype;
-    strlcpy( &buf[12], rconcmd, BUFSIZE_T-12 );
-    buf[ strlen( rconcmd ) + 13 ] = 0 ;
-    buf[ strlen( rconcmd ) + 14 ] = 0 ;
-    outlen = strlen( rconcmd ) + 14;
-    buf[0] = outlen - 4;
-    buf[4] = 1; buf[5] = 2; buf[6] = 3; buf[7] = 4;
+    int  errCode, outlen;
+#if RDRV_DEBUGPRINT
+    int  i;
+#endif
+
+    outlen = _rdrvEncode( buf, 0x04030201, msgtype, rconcmd );
 
     rPtr->serverlen = sizeof( rPtr->serveraddr );
     // sendto(fd, buf, outlen, 0, (const struct sockaddr *) &serveraddr, serverlen);
@@ -249,6 +294,8 @@ int rdrvConnect( rdrvObj *rPtr )
         }
     }
 
+    metricsInc( errCode ? rdrvConnectFailsMetric : rdrvConnectsMetric );
+
     // Send RCON Password to the server
     //
     if (0 == errCode ) {
@@ -280,6 +327,11 @@ rdrvObj *rdrvInit( char *hostName, int portNo, char *rconPassword )
         strlcpy(rPtr->rconPassword, rconPassword, RCONPASSMAX);
         rPtr->portNo = portNo;
         strlcpy(rPtr->hostName, hostName, RCONHOSTMAX);
+        if ( rdrvConnectsMetric == NULL ) {
+            rdrvConnectsMetric     = metricsCounter( "sissm_rcon_connects_total", "RCON connections opened", "" );
+            rdrvConnectFailsMetric = metricsCounter( "sissm_rcon_connect_failures_total", "RCON connection attempts failed", "" );
+            rdrvReconnectsMetric   = metricsCounter( "sissm_rcon_reconnects_total", "RCON connections re-opened after lost comms", "" );
+        }
 #ifdef _WIN32
         WSAStartup(MAKEWORD(2,2), &wsaData);
 #endif
@@ -387,6 +439,7 @@ static int _rdrvCommand( rdrvObj *rPtr, int msgType, char *rconCmd, char *rconRe
                 // disconnect and reconnect
                 //
                 logPrintf( LOG_LEVEL_CRITICAL, "rdrv", "Warning: RCON comms lost - re-opening with new channel");
+                metricsInc( rdrvReconnectsMetric );
                 rdrvDisconnect( rPtr );  // ignore this error
                 usleep( RDRV_DELAY_RETRY_DISC2CONN );
                 rdrvConnect( rPtr );     // ignore this error
@@ -403,9 +456,46 @@ static int _rdrvCommand( rdrvObj *rPtr, int msgType, char *rconCmd, char *rconRe
     return( errCode );
 }
 
+//  ==============================================================================================
+//  _rdrvVerbMetrics (local)
+//
+//  Find or create the metrics slot of the verb of rconCmd.  Verbs are sanitized to
+//  [a-z0-9_] for use as a label value.
+//
+static int _rdrvVerbMetrics( char *rconCmd )
+{
+    char verb[32], labels[64];
+    int i;
+
+    for ( i=0; ( i < (int) sizeof( verb ) - 1 ) && ( rconCmd[i] != 0 ) && ( rconCmd[i] != ' ' ); i++ )
+        verb[i] = ( isalnum( (unsigned char) rconCmd[i] )) ? (char) tolower( (unsigned char) rconCmd[i] ) : '_';
+    verb[i] = 0;
+    if ( i == 0 ) strlcpy( verb, "none", sizeof( verb ));
+
+    for ( i=0; i<rdrvVerbCount; i++ )
+        if ( 0 == strcmp( rdrvVerbs[i].verb, verb )) return( i );
+    if ( rdrvVerbCount >= RDRV_MAXVERBS ) {
+        i = RDRV_MAXVERBS;
+        if ( 0 != rdrvVerbs[i].verb[0] ) return( i );
+        strlcpy( verb, "other", sizeof( verb ));
+    }
+    else {
+        i = rdrvVerbCount++;
+    }
+
+    strlcpy( rdrvVerbs[i].verb, verb, sizeof( rdrvVerbs[i].verb ));
+    snprintf( labels, sizeof( labels ), "verb=\"%s\"", verb );
+    rdrvVerbs[i].commands = metricsCounter( "sissm_rcon_commands_total", "RCON commands sent", labels );
+    rdrvVerbs[i].failures = metricsCounter( "sissm_rcon_failures_total", "RCON commands failed after retries", labels );
+    rdrvVerbs[i].latency  = metricsHistogram( "sissm_rcon_latency_seconds", "RCON command round trip, including retries", labels, NULL, 0 );
+    return( i );
+}
+
+
 int rdrvCommand( rdrvObj *rPtr, int msgType, char *rconCmd, char *rconResp, int *bytesRead )
 {
-    int         bytesRead2, errCode;
+    int         bytesRead2, errCode, verbIndex;
+    uint64_t    startUs = metricsNowUs();
     static char rconRespCont[BUFSIZE_R];                // for receiving continuation buffer
     static char *rconCmdBlank = "";                               // for sending null string  
 
@@ -431,7 +521,144 @@ int rdrvCommand( rdrvObj *rPtr, int msgType, char *rconCmd, char *rconResp, int
         
     }
 
+    verbIndex = _rdrvVerbMetrics( rconCmd );
+    metricsInc( rdrvVerbs[verbIndex].commands );
+    if ( errCode ) metricsInc( rdrvVerbs[verbIndex].failures );
+    metricsObserveUs( rdrvVerbs[verbIndex].latency, metricsNowUs() - startUs );
+
+    journalRcon( rconCmd, errCode );
     return( errCode );
 }
 
 
+//  ==============================================================================================
+//  _rdrvLE32 (local)
+//
+static unsigned long _rdrvLE32( const char *p )
+{
+    return( (unsigned long) (unsigned char) p[0]         | ((unsigned long) (unsigned char) p[1] << 8) |
+            ((unsigned long) (unsigned char) p[2] << 16) | ((unsigned long) (unsigned char) p[3] << 24) );
+}
+
+
+//  ==============================================================================================
+//  rdrvBatch
+//
+//  Pipelined RCON: send 'count' commands back to back in one write, each with its own
+//  request id, followed by an empty SERVERDATA_RESPONSE_VALUE packet as an end marker, then
+//  collect the answers by request id.  The server answers in order, so when the marker's
+//  answer arrives every command has been answered, multi-packet responses included.  This
+//  costs one round trip instead of one (plus fixed delays) per command.  The response
+//  text is not kept: okOut[i] is set to 1 if command i was answered, else 0.
+//
+//  The marker only serves to collect the tail of multi-packet responses.  If it is not answered
+//  within RDRV_BATCH_DRAIN of the last command, the batch still succeeds, but the connection
+//  is closed: rdrvCommand does not check request ids and would take a late marker answer for
+//  its own.  (The continuation probe of rdrvCommand relies on the same empty packet being
+//  answered, so this should not happen with a sane server.)
+//
+//  If the commands are not all answered within RDRV_BATCH_TIMEOUT the connection is closed,
+//  so that late answers cannot be mistaken for those of the next command (the next command
+//  reconnects).  Returns the number of commands answered.
+//
+int rdrvBatch( rdrvObj *rPtr, int msgType, char **rconCmds, int count, int *okOut )
+{
+    static char xmtBuf[(RDRV_BATCH_MAX + 1) * BUFSIZE_T];
+    static char rcvBuf[BUFSIZE_R];
+    uint64_t    startUs, allUs = 0, doneUs[RDRV_BATCH_MAX];
+    unsigned long requestID;
+    size_t      xmtLen = 0, xmtSent = 0, rcvLen = 0, pktLen;
+    int         i, n, verbIndex, answered = 0, markerSeen = 0;
+
+    if ( count > RDRV_BATCH_MAX ) count = RDRV_BATCH_MAX;
+    for ( i=0; i<count; i++ ) okOut[i] = 0;
+    if ( count <= 0 ) return 0;
+
+    if ( rPtr->isConnected == 0 ) {
+        rdrvConnect( rPtr );             // ignore the return error
+        usleep( RDRV_DELAY_CONN2XMT );
+    }
+
+    startUs = metricsNowUs();
+    if ( rPtr->isConnected ) {
+
+        for ( i=0; i<count; i++ )
+            xmtLen += _rdrvEncode( &xmtBuf[ xmtLen ], RDRV_BATCH_ID0 + i, msgType, rconCmds[i] );
+        xmtLen += _rdrvEncode( &xmtBuf[ xmtLen ], RDRV_BATCH_ID0 + count, 0, "" );
+
+        // write it all (the socket is non-blocking), then read until the marker is answered,
+        // or shortly after the last command is
+        //
+        while (( !markerSeen ) && ( metricsNowUs() - startUs < RDRV_BATCH_TIMEOUT )) {
+
+            if (( answered == count ) && ( metricsNowUs() - allUs >= RDRV_BATCH_DRAIN )) break;
+
+            if ( xmtSent < xmtLen ) {
+#ifdef _WIN32
+                n = send( rPtr->sockfd, &xmtBuf[ xmtSent ], (int) (xmtLen - xmtSent), 0 );
+#else
+                n = write( rPtr->sockfd, &xmtBuf[ xmtSent ], xmtLen - xmtSent );
+#endif
+                if ( n > 0 ) xmtSent += (size_t) n;
+            }
+
+#ifdef _WIN32
+            n = recv( rPtr->sockfd, &rcvBuf[ rcvLen ], (int) (sizeof( rcvBuf ) - rcvLen), 0 );
+#else
+            n = read( rPtr->sockfd, &rcvBuf[ rcvLen ], sizeof( rcvBuf ) - rcvLen );
+#endif
+            if ( n == 0 ) break;                                           // connection closed
+            if ( n < 0 ) {
+                usleep( RDRV_BATCH_POLL );
+                continue;
+            }
+            rcvLen += (size_t) n;
+
+            // consume complete packets
+            //
+            while ( rcvLen >= RCVHDRSIZE ) {
+                pktLen = (size_t) _rdrvLE32( rcvBuf ) + 4;
+                if (( pktLen < RCVHDRSIZE ) || ( pktLen > sizeof( rcvBuf ))) {
+                    rcvLen = 0;                                            // out of sync, give up
+                    break;
+                }
+                if ( rcvLen < pktLen ) break;
+
+                requestID = _rdrvLE32( &rcvBuf[4] );
+                if (( requestID >= RDRV_BATCH_ID0 ) && ( requestID < (unsigned long) RDRV_BATCH_ID0 + count )) {
+                    i = (int) (requestID - RDRV_BATCH_ID0);
+                    if ( !okOut[i] ) {
+                        okOut[i] = 1;
+                        doneUs[i] = metricsNowUs();
+                        if ( ++answered == count ) allUs = doneUs[i];
+                    }
+                }
+                else if ( requestID == (unsigned long) RDRV_BATCH_ID0 + count ) {
+                    markerSeen = 1;
+                }
+                memmove( rcvBuf, &rcvBuf[ pktLen ], rcvLen - pktLen );
+                rcvLen -= pktLen;
+            }
+        }
+
+        if ( answered < count ) {
+            logPrintf( LOG_LEVEL_CRITICAL, "rdrv", "Warning: RCON batch answered %d of %d - re-opening channel", answered, count );
+            metricsInc( rdrvReconnectsMetric );
+            rdrvDisconnect( rPtr );
+        }
+        else if ( !markerSeen ) {
+            logPrintf( LOG_LEVEL_DEBUG, "rdrv", "RCON batch end marker not answered - re-opening channel" );
+            metricsInc( rdrvReconnectsMetric );
+            rdrvDisconnect( rPtr );
+        }
+    }
+
+    for ( i=0; i<count; i++ ) {
+        verbIndex = _rdrvVerbMetrics( rconCmds[i] );
+        metricsInc( rdrvVerbs[verbIndex].commands );
+        if ( !okOut[i] ) metricsInc( rdrvVerbs[verbIndex].failures );
+        else metricsObserveUs( rdrvVerbs[verbIndex].latency, doneUs[i] - startUs );
+        journalRcon( rconCmds[i], !okOut[i] );
+    }
+    return( answered );
+}
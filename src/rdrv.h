@@ -32,6 +32,8 @@
 #define  RCONHOSTMAX  (256)
 #define  RCVHDRSIZE   (12)             // 26
 
+#define  RDRV_BATCH_MAX      (32)               // commands per pipelined rdrvBatch() call
+
 typedef struct {
     // set by init
     char               hostName[RCONHOSTMAX];
@@ -54,4 +56,5 @@ extern int rdrvDisconnect( rdrvObj *cPtr );
 extern int rdrvDestroy( rdrvObj *cPtr );
 extern int rdrvXmtRcv( rdrvObj *cPtr, int msgType, char *rconCmd, char *rconResp );
 extern int rdrvCommand( rdrvObj *cPtr, int msgType, char *rconCmd, char *rconResp, int *bytesRead );
+extern int rdrvBatch( rdrvObj *cPtr, int msgType, char **rconCmds, int count, int *okOut );
 
@@ -5,6 +5,12 @@
 //  Description:
 //  Game state extraction, player information parsing
 //
+//  The parser works on a private table owned by the main loop.  Each successful parse (and
+//  each map change) publishes a new immutable snapshot of the roster: players, map name and
+//  partial name index.  Every lookup reads the current snapshot, so the _r functions, which
+//  write to caller buffers, may be called from any thread.  A snapshot held with 
+//  rosterSnapAcquire() stays valid, and unchanged, until it is released.
+//
 //  Original Author:
 //  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
 //
@@ -21,42 +27,175 @@
 #include <string.h>
 #include <ctype.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 #include "bsd.h"
 #include "log.h"
 #include "util.h"
+#include "arena.h"
+#include "nindex.h"
+#include "sid.h"
 #include "roster.h"
 
 #include "winport.h"   // strcasestr
 
-static rconRoster_t masterRoster[ROSTER_MAX];
+static rconRoster_t masterRoster[ROSTER_MAX];        // parser work table, main loop only
+static int          masterCount = 0;                          // rows of the last good parse
 static char rosterServerName[256], rosterMapName[256];
 
+static rosterSnap_t *rosterCurrent = NULL;                         // published snapshot
+#ifndef _WIN32
+static pthread_mutex_t rosterSnapLock = PTHREAD_MUTEX_INITIALIZER;  // rosterCurrent & refCounts
+#endif
 
 
 //  ==============================================================================================
 //  rosterIsValidGUID
 //
-//  Returns non-zero if string is a valid 17-character SteamGUID
+//  Returns non-zero if string is a valid 17-character SteamGUID (SteamID64)
 //
 int rosterIsValidGUID( char *testGUID )
 {
-    int i, isValid = 1;
+    return( sidIsValid( testGUID ));
+}
+
+
+//  ==============================================================================================
+//  rosterSnapAcquire
+//
+//  Returns the current roster snapshot, which the caller must rosterSnapRelease().  Never
+//  NULL after rosterInit().  The snapshot must not be modified.
+//
+rosterSnap_t *rosterSnapAcquire( void )
+{
+    rosterSnap_t *snap;
+
+#ifndef _WIN32
+    pthread_mutex_lock( &rosterSnapLock );
+#endif
+    if ( NULL != (snap = rosterCurrent)) snap->refCount++;
+#ifndef _WIN32
+    pthread_mutex_unlock( &rosterSnapLock );
+#endif
+    return( snap );
+}
+
+
+//  ==============================================================================================
+//  rosterGetVersion
+//
+//  Roster content version: changes whenever a player joins, leaves or is renamed, or the map
+//  changes.  Useful as a cache validator (e.g., web ETag).
+//
+unsigned long rosterGetVersion( void )
+{
+    rosterSnap_t *snap;
+    unsigned long version = 0;
 
-    if (17 != strlen( testGUID )) {
-        isValid = 0;
+    if ( NULL != (snap = rosterSnapAcquire() )) {
+        version = snap->version;
+        rosterSnapRelease( snap );
     }
-    else {
-        for (i=0; i<17; i++) {
-            if ( !isdigit( testGUID[i] )) {
-                isValid = 0;
-                break;
-            }
-        }
+    return( version );
+}
+
+
+//  ==============================================================================================
+//  rosterSnapRelease
+//
+void rosterSnapRelease( rosterSnap_t *snap )
+{
+    int refCount;
+
+    if ( snap == NULL ) return;
+#ifndef _WIN32
+    pthread_mutex_lock( &rosterSnapLock );
+#endif
+    refCount = --snap->refCount;
+#ifndef _WIN32
+    pthread_mutex_unlock( &rosterSnapLock );
+#endif
+    if ( refCount == 0 ) {
+        nindexDestroy( snap->nameIndex );
+        free( snap );
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _rosterSameContent (local)
+//
+//  Compare two snapshots on what the version tracks: map, and player identity (score is
+//  ignored, it changes on nearly every poll).
+//
+static int _rosterSameContent( rosterSnap_t *a, rosterSnap_t *b )
+{
+    int i;
+
+    if (( a->count != b->count ) || ( 0 != strcmp( a->mapName, b->mapName ))) return( 0 );
+    for ( i=0; i<a->count; i++ ) {
+        if (( 0 != strcmp( a->players[i].playerName, b->players[i].playerName )) ||
+            ( 0 != strcmp( a->players[i].steamID,    b->players[i].steamID ))    ||
+            ( 0 != strcmp( a->players[i].IPaddress,  b->players[i].IPaddress ))  ||
+            ( 0 != strcmp( a->players[i].netID,      b->players[i].netID )))
+            return( 0 );
+    }
+    return( 1 );
+}
+
+
+//  ==============================================================================================
+//  _rosterPublish (local)
+//
+//  Build a snapshot of the first 'count' rows of masterRoster and the current map name, and
+//  make it current.  On allocation failure the previous snapshot stays current.
+//
+static void _rosterPublish( int count )
+{
+    rosterSnap_t *snap, *old;
+    sid_t steamID;
+    int i;
+
+    if ( NULL == (snap = (rosterSnap_t *) calloc( 1, sizeof( rosterSnap_t )))) return;
+    if ( NULL == (snap->nameIndex = nindexCreate() )) {
+        free( snap );
+        return;
     }
-    return( isValid );
+    snap->refCount = 1;                                                 // the publisher's own
+    snap->count = count;
+    memcpy( snap->players, masterRoster, count * sizeof( rconRoster_t ));
+    strlcpy( snap->mapName, rosterMapName, sizeof( snap->mapName ));
+
+    for ( i=0; i<count; i++ ) {
+        if (( 0 != strlen( snap->players[i].netID )) && 
+            ( rosterIsValidGUID( snap->players[i].steamID )) && ( 0 != strlen( snap->players[i].IPaddress )) )
+            snap->humanCount++;
+        if ( 0 != (steamID = sidParse( snap->players[i].steamID )))         // bots have none
+            nindexAdd( snap->nameIndex, snap->players[i].playerName, steamID );
+    }
+
+    // rosterCurrent is only replaced here, so the publisher may read it without the lock
+    //
+    if ( rosterCurrent != NULL )
+        snap->version = rosterCurrent->version + ( _rosterSameContent( snap, rosterCurrent ) ? 0 : 1 );
+
+#ifndef _WIN32
+    pthread_mutex_lock( &rosterSnapLock );
+#endif
+    old = rosterCurrent;
+    rosterCurrent = snap;
+#ifndef _WIN32
+    pthread_mutex_unlock( &rosterSnapLock );
+#endif
+    rosterSnapRelease( old );
+    return;
 }
 
 
+
 //  ==============================================================================================
 //  rosterSetMapName
 //
@@ -65,19 +204,34 @@ int rosterIsValidGUID( char *testGUID )
 void rosterSetMapName( char *mapName )
 {
     strlcpy( rosterMapName, mapName, 256 );     
+    _rosterPublish( masterCount );
     return;
 }
 
 //  ==============================================================================================
 //  rosterGetMapName
 //
-//  Get current map name
+//  Get current map name (main loop only; see rosterGetMapName_r)
 //
 char *rosterGetMapName( void )
 {
     return( rosterMapName );
 }
 
+//  ==============================================================================================
+//  rosterGetMapName_r
+//
+//  Reentrant:  copy the current map name to mapOut
+//
+char *rosterGetMapName_r( char *mapOut, size_t outSize )
+{
+    rosterSnap_t *snap = rosterSnapAcquire();
+
+    strlcpy( mapOut, ( snap != NULL ) ? snap->mapName : "", outSize );
+    rosterSnapRelease( snap );
+    return( mapOut );
+}
+
 
 //  ==============================================================================================
 //  rosterSetServerName
@@ -103,21 +257,23 @@ char *rosterGetServerName( void )
 //  ==============================================================================================
 //  _copy3 (internal)
 //
-//  Special strcpy variant that checks for " | " prefix and bypass if present.  This is 
-//  a shortcut method for parsing player roster obtained from RCON listplayer command.
+//  Special strcpy variant that takes the next word from the iterator, checks for " | " 
+//  prefix and bypass if present.  This is a shortcut method for parsing player roster 
+//  obtained from RCON listplayer command.  Returns 0 at the end of the roster.
 //
-static int _copy3( char *dst, char *src, int maxChars )
+static int _copy3( char *dst, wordIter_t *it, int maxChars )
 {
     int validFlag = 0;
+    strView_t src;
 
-    if ((src != NULL) && (dst != NULL)) {
+    if ((dst != NULL) && wordIterNext( it, &src )) {
         validFlag = 1;
-        if      (0 == strncmp( src, " | ", 3)) strlcpy( dst, &src[3], maxChars );
+        if      ((src.len >= 3) && (0 == strncmp( src.ptr, " | ", 3))) { src.ptr += 3; src.len -= 3; }
 #if 1
-        else if (0 == strncmp( src, "| ",  2)) strlcpy( dst, &src[2], maxChars );
-        else if (0 == strncmp( src, " |",  2)) strlcpy( dst, &src[2], maxChars );
+        else if ((src.len >= 2) && (0 == strncmp( src.ptr, "| ",  2))) { src.ptr += 2; src.len -= 2; }
+        else if ((src.len >= 2) && (0 == strncmp( src.ptr, " |",  2))) { src.ptr += 2; src.len -= 2; }
 #endif
-        else                                   strlcpy( dst,  src,    maxChars );  
+        strViewCopy( dst, maxChars, &src );
     }
     return( validFlag );
 }
@@ -151,6 +307,8 @@ void rosterInit( void )
     strcpy( rosterServerName, "" );
     strcpy( rosterMapName,    "" );
     rosterReset();
+    masterCount = 0;
+    _rosterPublish( 0 );
     return;
 }
 
@@ -165,16 +323,17 @@ void rosterInit( void )
 //
 static int _tabDumpDebug( unsigned char *buf, int n )
 {
-    int i, j, validFlag;
-    char *w, *headStr, *recdStr;
+    int i;
+    char *headStr, *recdStr;
+    wordIter_t it;
+    strView_t w;
 
     headStr = strstr( &buf[32], "========================" );    // look for start of separator
     recdStr = &headStr[80];                                      // look for start of first record
 
-    i = 0;
-    while ( 1 == 1 ) {
-        printf("::%s::\n", getWord( recdStr, i++, "\011"));
-        if (i > 500) break;
+    wordIterInit( &it, recdStr, "\011" );
+    for ( i = 0; ( i <= 500 ) && wordIterNext( &it, &w ); i++ ) {
+        printf("::%.*s::\n", (int) w.len, w.ptr );
     }
     return 0;
 }
@@ -193,10 +352,11 @@ static int _tabDumpDebug( unsigned char *buf, int n )
 //
 int rosterParse( unsigned char *buf, int n )
 {
-    int i, j, validFlag;
-    char *w, *headStr, *recdStr, *atLeastOne;
+    int j, validFlag;
+    char *headStr, *recdStr, *atLeastOne;
+    wordIter_t it;
 
-    validFlag = 1;  i = 0;  j = -1;
+    validFlag = 1;  j = -1;
     
     headStr = strstr( &buf[32], "========================" );    // look for start of separator == valid input
     if ( headStr != NULL ) {
@@ -207,18 +367,19 @@ int rosterParse( unsigned char *buf, int n )
         rosterReset();
 
         if ( NULL != atLeastOne ) {
+            wordIterInit( &it, recdStr, "\011" );
             while ( 1 == 1 ) {
 
-                // parse through data fields that are tab-delimited
-                // _copy3 routine eliminates some field artifacts and checks if getWord return a NULL.
+                // parse through data fields that are tab-delimited, in a single pass
+                // _copy3 routine eliminates some field artifacts and checks for end of data.
                 //
-                if (validFlag) validFlag = _copy3( masterRoster[j].netID,      getWord( recdStr, i++, "\011"), ROSTER_FIELD_MAX); 
-                if (validFlag) validFlag = _copy3( masterRoster[j].playerName, getWord( recdStr, i++, "\011"), ROSTER_FIELD_MAX); 
-                if (validFlag) validFlag = _copy3( masterRoster[j].steamID,    getWord( recdStr, i++, "\011"), ROSTER_FIELD_MAX); 
-                if (validFlag) validFlag = _copy3( masterRoster[j].IPaddress,  getWord( recdStr, i++, "\011"), ROSTER_FIELD_MAX); 
-                if (validFlag) validFlag = _copy3( masterRoster[j].score,      getWord( recdStr, i++, "\011"), ROSTER_FIELD_MAX); 
+                if (validFlag) validFlag = _copy3( masterRoster[j].netID,      &it, ROSTER_FIELD_MAX); 
+                if (validFlag) validFlag = _copy3( masterRoster[j].playerName, &it, ROSTER_FIELD_MAX); 
+                if (validFlag) validFlag = _copy3( masterRoster[j].steamID,    &it, ROSTER_FIELD_MAX); 
+                if (validFlag) validFlag = _copy3( masterRoster[j].IPaddress,  &it, ROSTER_FIELD_MAX); 
+                if (validFlag) validFlag = _copy3( masterRoster[j].score,      &it, ROSTER_FIELD_MAX); 
 
-                // getWord returning a NULL indicates end of buffer, resulting in validFlag being cleared.. Exit the loop.
+                // running out of fields indicates end of buffer, resulting in validFlag being cleared.. Exit the loop.
                 //
                 if (!validFlag) break;
 
@@ -240,6 +401,11 @@ int rosterParse( unsigned char *buf, int n )
         strcpy( masterRoster[j].IPaddress,   "" );
         strcpy( masterRoster[j].score,       "" );
 
+        // publish the new snapshot (with its partial name index) to readers
+        //
+        masterCount = j;
+        _rosterPublish( j );
+
     }
     else {
         logPrintf( LOG_LEVEL_WARN, "roster", "Received non-divider listplayer rcon response size %d", n );
@@ -255,36 +421,52 @@ int rosterParse( unsigned char *buf, int n )
 //
 int rosterCount( void )
 {
-    int i, count = 0;
+    rosterSnap_t *snap = rosterSnapAcquire();
+    int count = 0;
 
-    for (i=0; i<ROSTER_MAX; i++) {
-        if ( strlen( masterRoster[i].netID ) ) {
-            if (( rosterIsValidGUID(  masterRoster[i].steamID)) && ( 0 != strlen( masterRoster[i].IPaddress )) )  { 
-                count++;
-            }
+    if ( snap != NULL ) count = snap->humanCount;
+    rosterSnapRelease( snap );
+    return count;
+}
+
+//  ==============================================================================================
+//  _rosterFindField (local)
+//
+//  Looks up the row whose field at offset 'keyOfs' equals 'key', and copies its field at 
+//  'valueOfs' to strOut.  Empty string (not NULL) is returned if data is not found.
+//
+static char *_rosterFindField( size_t keyOfs, char *key, size_t valueOfs, char *strOut, size_t outSize )
+{
+    rosterSnap_t *snap = rosterSnapAcquire();
+    int i;
+
+    strlcpy( strOut, "", outSize );
+    for (i=0; ( snap != NULL ) && ( i<snap->count ); i++) {
+        if ( 0 == strcmp( (char *) &snap->players[i] + keyOfs, key )) {
+            strlcpy( strOut, (char *) &snap->players[i] + valueOfs, outSize ); 
+            break;
         }
     }
-    return count;
+    rosterSnapRelease( snap );
+    return( strOut );
 }
 
 //  ==============================================================================================
 //  rosterLookupNameFromIP
 //
 //  Uses the database to translate player IP# and returns player name string.  Empty string
-//  (not NULL) is returned if data is not found.
+//  (not NULL) is returned if data is not found.  The _r variant writes to the caller's buffer.
 //
+char *rosterLookupNameFromIP_r( char *playerIP, char *nameOut, size_t outSize )
+{
+    return( _rosterFindField( offsetof( rconRoster_t, IPaddress ), playerIP, 
+        offsetof( rconRoster_t, playerName ), nameOut, outSize ));
+}
+
 char *rosterLookupNameFromIP( char *playerIP )
 {
     static char playerName[256];
-    int i;
-    strcpy( playerName, "" );
-    for (i=0; i<ROSTER_MAX; i++) {
-        if ( 0 == strcmp( masterRoster[i].IPaddress, playerIP )) {
-            strlcpy( playerName, masterRoster[i].playerName, 256 ); 
-            break;
-        }
-    }
-    return( playerName );
+    return( rosterLookupNameFromIP_r( playerIP, playerName, sizeof( playerName )));
 }
 
 
@@ -294,42 +476,62 @@ char *rosterLookupNameFromIP( char *playerIP )
 //  Uses the database to translate player name to SteamID.  Empty string (not NULL)
 //  is returned if data is not found.
 //
+char *rosterLookupSteamIDFromName_r( char *playerName, char *steamIDOut, size_t outSize )
+{
+    return( _rosterFindField( offsetof( rconRoster_t, playerName ), playerName, 
+        offsetof( rconRoster_t, steamID ), steamIDOut, outSize ));
+}
+
 char *rosterLookupSteamIDFromName( char *playerName )
 {
     static char steamID[256];
-    int i;
-    strcpy( steamID, "" );
-    for (i=0; i<ROSTER_MAX; i++) {
-        if ( 0 == strcmp( masterRoster[i].playerName, playerName )) {
-            strlcpy( steamID, masterRoster[i].steamID, 256 ); 
-            break;
-        }
-    }
-    return( steamID );
+    return( rosterLookupSteamIDFromName_r( playerName, steamID, sizeof( steamID )));
+}
+
+//  ==============================================================================================
+//  rosterLookupPartialName
+//
+//  Finds every player whose name contains partialName (case-insensitive, Unicode aware).
+//  Up to maxMatches candidates are returned best match first; the return value is the total
+//  number of candidates.
+//
+int rosterLookupPartialName( char *partialName, nindexMatch_t *matches, int maxMatches )
+{
+    rosterSnap_t *snap = rosterSnapAcquire();
+    int matchCount = 0;
+
+    if ( snap != NULL ) matchCount = nindexSearch( snap->nameIndex, partialName, matches, maxMatches );
+    rosterSnapRelease( snap );
+    return( matchCount );
 }
 
+
 //  ==============================================================================================
 //  rosterLookupSteamIDFromPartialName
 //
 //  Uses the database to translate player partial name to SteamID.  Empty string (not NULL)
-//  is returned if data is not found OR target cannot be uniquely identified.
+//  is returned if data is not found OR target cannot be uniquely identified.  A name that
+//  matches exactly wins over players whose names merely contain it.
 //
-char *rosterLookupSteamIDFromPartialName( char *partialName )
+char *rosterLookupSteamIDFromPartialName_r( char *partialName, char *steamIDOut, size_t outSize )
 {
-    static char steamID[256];
-    int i, matchCount = 0;
+    char steamID[SID_STRLEN+1];
+    nindexMatch_t matches[2];
+    int matchCount;
 
-    strcpy( steamID, "" );
-    for (i=0; i<ROSTER_MAX; i++) {
-        if ( NULL != strcasestr( masterRoster[i].playerName, partialName )) {
-            strlcpy( steamID, masterRoster[i].steamID, 256 ); 
-            matchCount++;
-            break;
-        }
-    }
-    if ( matchCount != 1 ) strcpy( steamID, "" );
+    strlcpy( steamIDOut, "", outSize );
+    matchCount = rosterLookupPartialName( partialName, matches, 2 );
+    if (( matchCount == 1 ) ||
+        (( matchCount > 1 ) && ( matches[0].rank == NINDEX_RANK_EXACT ) && ( matches[1].rank != NINDEX_RANK_EXACT )))
+        strlcpy( steamIDOut, sidToStr( matches[0].key, steamID ), outSize );
 
-    return( steamID );
+    return( steamIDOut );
+}
+
+char *rosterLookupSteamIDFromPartialName( char *partialName )
+{
+    static char steamID[256];
+    return( rosterLookupSteamIDFromPartialName_r( partialName, steamID, sizeof( steamID )));
 }
 
 
@@ -339,18 +541,16 @@ char *rosterLookupSteamIDFromPartialName( char *partialName )
 //  Uses the database to translate player name to IP#.  Empty string (not NULL)
 //  is returned if data is not found.
 //
+char *rosterLookupIPFromName_r( char *playerName, char *playerIPOut, size_t outSize )
+{
+    return( _rosterFindField( offsetof( rconRoster_t, playerName ), playerName, 
+        offsetof( rconRoster_t, IPaddress ), playerIPOut, outSize ));
+}
+
 char *rosterLookupIPFromName( char *playerName )
 {
     static char playerIP[256];
-    int i;
-    strcpy( playerIP, "" );
-    for (i=0; i<ROSTER_MAX; i++) {
-        if ( 0 == strcmp( masterRoster[i].playerName, playerName )) {
-            strlcpy( playerIP, masterRoster[i].IPaddress, 256 ); 
-            break;
-        }
-    }
-    return( playerIP );
+    return( rosterLookupIPFromName_r( playerName, playerIP, sizeof( playerIP )));
 }
 
 
@@ -365,37 +565,48 @@ char *rosterLookupIPFromName( char *playerName )
 //  infoDepth:  0=name 1=name+guid, 2=name+guid+ip, 3=name+score, 4=machine-formatted-easy-parse fmt
 //  delimiter:  string you want between the names, e.g., " ", " : ",  "," , or even a tab character.
 //
-char *rosterPlayerList( int infoDepth, char *delimiter )
+char *rosterPlayerList_r( int infoDepth, char *delimiter, char *listOut, size_t outSize )
 {
-    static char playerList[4096], single[256];
+    rosterSnap_t *snap = rosterSnapAcquire();
+    rconRoster_t *p;
+    char single[256], expandedIP[32];
     int i;
-    strcpy( playerList, "" );
-    for (i=0; i<ROSTER_MAX; i++) {
-        if ( strlen( masterRoster[i].netID ) ) {
-            if ( ( rosterIsValidGUID( masterRoster[i].steamID )) && ( 0 != strlen( masterRoster[i].IPaddress )) )  {   
+
+    strlcpy( listOut, "", outSize );
+    for (i=0; ( snap != NULL ) && ( i<snap->count ); i++) {
+        p = &snap->players[i];
+        if ( strlen( p->netID ) ) {
+            if ( ( rosterIsValidGUID( p->steamID )) && ( 0 != strlen( p->IPaddress )) )  {   
 		switch ( infoDepth ) {
 		case 1:   //  includes name + steamID for identifying names with alt-charsets, less privacy
-                    snprintf( single, 256, "%s[%s]%s", masterRoster[i].playerName, masterRoster[i].steamID, delimiter );
+                    snprintf( single, 256, "%s[%s]%s", p->playerName, p->steamID, delimiter );
 		    break;
 		case 2:   // security web display that includes name:SteamID::IP
                     snprintf( single, 256, "%s[%s:%s]%s", 
-                        masterRoster[i].playerName, masterRoster[i].steamID, masterRoster[i].IPaddress, delimiter );
+                        p->playerName, p->steamID, p->IPaddress, delimiter );
 		    break;
 		case 3:   // alternative web display that includes name:score
-                    snprintf( single, 256, "%s[%s]%s", masterRoster[i].playerName, masterRoster[i].score, delimiter );
+                    snprintf( single, 256, "%s[%s]%s", p->playerName, p->score, delimiter );
 		    break;
 		case 4:   // used for synthetic event handler, for reliable but less responsive player conect/disconnect
                     snprintf( single, 256, "%s %s %s%s", 
-                        masterRoster[i].steamID, reformatIP( masterRoster[i].IPaddress ), masterRoster[i].playerName, delimiter );
+                        p->steamID, reformatIP_r( p->IPaddress, expandedIP, sizeof( expandedIP )), p->playerName, delimiter );
 		    break;
 	        default:  // (case 0) default miniamlist public dispaly, player name only
-                    snprintf( single, 256, "%s%s", masterRoster[i].playerName, delimiter );
+                    snprintf( single, 256, "%s%s", p->playerName, delimiter );
 		}
-                strlcat( playerList, single, 4096 );
+                strlcat( listOut, single, outSize );
             }
         }
     }
-    return( playerList );
+    rosterSnapRelease( snap );
+    return( listOut );
+}
+
+char *rosterPlayerList( int infoDepth, char *delimiter )
+{
+    static char playerList[4096];
+    return( rosterPlayerList_r( infoDepth, delimiter, playerList, sizeof( playerList )));
 }
 
 
@@ -439,9 +650,16 @@ void rosterDump( int humanFlag, int npcFlag )
 //
 void rosterParsePlayerSynthConn( char *connectString, int maxSize,  char *playerName, char *playerGUID, char *playerIP )
 {
+    wordIter_t it;
+    strView_t  w;
+
     strlcpy( playerName, &connectString[ 45 ], maxSize );
-    strlcpy( playerGUID, getWord( connectString, 1, " " ), maxSize );
-    strlcpy( playerIP,   getWord( connectString, 2, " " ), maxSize );
+    strcpy( playerGUID, "" );  strcpy( playerIP, "" );
+    wordIterInit( &it, connectString, " " );
+    if ( wordIterNext( &it, &w ) && wordIterNext( &it, &w )) {
+        strViewCopy( playerGUID, maxSize, &w );
+        if ( wordIterNext( &it, &w )) strViewCopy( playerIP, maxSize, &w );
+    }
     return;
 }
 
@@ -455,9 +673,16 @@ void rosterParsePlayerSynthConn( char *connectString, int maxSize,  char *player
 //
 void rosterParsePlayerSynthDisConn( char *connectString, int maxSize,  char *playerName, char *playerGUID, char *playerIP )
 {
+    wordIter_t it;
+    strView_t  w;
+
     strlcpy( playerName, &connectString[ 45 ], maxSize );
-    strlcpy( playerGUID, getWord( connectString, 1, " " ), maxSize );
-    strlcpy( playerIP,   getWord( connectString, 2, " " ), maxSize );
+    strcpy( playerGUID, "" );  strcpy( playerIP, "" );
+    wordIterInit( &it, connectString, " " );
+    if ( wordIterNext( &it, &w ) && wordIterNext( &it, &w )) {
+        strViewCopy( playerGUID, maxSize, &w );
+        if ( wordIterNext( &it, &w )) strViewCopy( playerIP, maxSize, &w );
+    }
     return;
 }
 
@@ -499,7 +724,8 @@ void rosterParsePlayerDisConn( char *connectString, int maxSize, char *playerNam
 {
     // Call this first THEN refresh the roster from RCON
     //
-    char *w, *v;
+    char *w;
+    strView_t v;
 
     // parse the log string for disconnect - only has IP:port available
     // Example: [2019.07.26-01.47.06:457][106]LogNet: UChannel::Close: Sending CloseBunch. ChIndex == 0. 
@@ -510,8 +736,8 @@ void rosterParsePlayerDisConn( char *connectString, int maxSize, char *playerNam
     w = strstr( connectString, "RemoteAddr: " );
     if ( w != NULL ) {
         // extract player IP# (no port#)
-        if ( NULL != ( v = getWord( w, 1, " :," ))) 
-            strlcpy( playerIP, v, maxSize);
+        if ( wordView( w, 1, " :,", &v )) 
+            strViewCopy( playerIP, maxSize, &v );
         else 
             strlcpy( playerIP, "", maxSize );
 
@@ -557,24 +783,24 @@ void rosterParseMapname( char *mapLogString, int maxChars, char *mapName )
 
 int rosterSyntheticChangeEvent( char *prevRoster, char *currRoster, int (*callback)( char *, char *, char *))
 {
-    char *w;
-    char playerGUID[256], playerIP[256], playerName[256];
-    int i = 0;
+    char *w, *playerGUID, *playerIP, *playerName;
+    size_t len;
+    wordIter_t it;
+    strView_t  elem;
 
-    while (1 == 1) {
-        w = getWord( prevRoster, i++, "\011" );
-        if ( w == NULL )      break;
-        if ( 0 == strlen(w) ) break;
+    wordIterInit( &it, prevRoster, "\011" );
+    while ( wordIterNext( &it, &elem )) {
+        w = arenaStrndup( elem.ptr, elem.len );
 
         if ( NULL == strstr( currRoster, w ) ) {  // if missing
 
-            // parse the w
+            // split the w into per-tick arena strings, bounded by the element length
             //
-            strlcpy( playerGUID, w, SIZEOFGUID+1 );
-            playerGUID[ SIZEOFGUID+1 ] = 0;    // safety (probably not needed)
-            strlcpy( playerIP,   &w[SIZEOFGUID+1], SIZEOFGUID );
-            playerIP[ SIZEOFIP ] = 0;          // safety (probably not needed)
-            strlcpy( playerName,  &w[SIZEOFGUID+SIZEOFIP+2], 256 );
+            len = strlen( w );
+            playerGUID = arenaStrndup( w, (len < SIZEOFGUID) ? len : SIZEOFGUID );
+            playerIP   = ( len <= SIZEOFGUID+1 ) ? "" :
+                arenaStrndup( &w[SIZEOFGUID+1], (len-SIZEOFGUID-1 < SIZEOFIP) ? len-SIZEOFGUID-1 : SIZEOFIP );
+            playerName = ( len <= SIZEOFGUID+SIZEOFIP+2 ) ? "" : &w[SIZEOFGUID+SIZEOFIP+2];
 
             (*callback)( playerName, playerIP, playerGUID );
         }
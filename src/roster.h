@@ -14,6 +14,9 @@
 //  ==============================================================================================
 //
 
+#include <stddef.h>
+#include "nindex.h"
+
 #define ROSTER_MAX       (128)
 #define ROSTER_FIELD_MAX (80)
 
@@ -27,11 +30,26 @@ typedef struct {
 
 } rconRoster_t;
 
+//  Immutable roster snapshot, see rosterSnapAcquire()
+//
+typedef struct {
+
+    int          refCount;
+    int          count;                                           // rows used in players[]
+    int          humanCount;                               // rows with valid GUID and IP#
+    unsigned long version;                  // bumped when players or map change (not score)
+    rconRoster_t players[ROSTER_MAX];
+    char         mapName[256];
+    nindexObj   *nameIndex;                                  // partial name index of players[]
+
+} rosterSnap_t;
+
 
 // extern void rosterSetWebFile( char *webFileName );
 
 extern void rosterSetMapName( char *mapName );
 extern char *rosterGetMapName( void );
+extern char *rosterGetMapName_r( char *mapOut, size_t outSize );
 
 extern void rosterSetServerName( char *serverName );
 extern char *rosterGetServerName( void );
@@ -44,8 +62,18 @@ extern int  rosterCount( void );
 extern char *rosterLookupNameFromIP( char *playerIP );
 extern char *rosterLookupSteamIDFromName( char *playerName );
 extern char *rosterLookupSteamIDFromPartialName( char *partialName );
+extern int  rosterLookupPartialName( char *partialName, nindexMatch_t *matches, int maxMatches );
 extern char *rosterLookupIPFromName( char *playerName );
 extern char *rosterPlayerList( int infoDepth, char *delimeter );
+
+extern rosterSnap_t *rosterSnapAcquire( void );
+extern unsigned long rosterGetVersion( void );
+extern void rosterSnapRelease( rosterSnap_t *snap );
+extern char *rosterLookupNameFromIP_r( char *playerIP, char *nameOut, size_t outSize );
+extern char *rosterLookupSteamIDFromName_r( char *playerName, char *steamIDOut, size_t outSize );
+extern char *rosterLookupSteamIDFromPartialName_r( char *partialName, char *steamIDOut, size_t outSize );
+extern char *rosterLookupIPFromName_r( char *playerName, char *playerIPOut, size_t outSize );
+extern char *rosterPlayerList_r( int infoDepth, char *delimeter, char *listOut, size_t outSize );
 extern void rosterDump( int humanFlag, int npcFlag );
 // extern int rosterWeb( void );
 
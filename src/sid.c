@@ -0,0 +1,294 @@
+//  ==============================================================================================
+//
+//  Module: SID
+//
+//  Description:
+//  SteamID64 value type, validated parser and integer identity sets
+//
+//  SteamIDs arrive from the game as 17-digit strings.  They are converted once, at the edge,
+//  to a 64-bit integer so that identity lists (admins, incognito, priority, bans) are held as
+//  hash sets of integers: membership is a hash probe and an integer compare rather than a
+//  scan of string compares, and each entry is 12 bytes instead of a 40-byte string.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "sid.h"
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define SID_SET_MINCAP       (64)                          // initial slot count (power of 2)
+
+
+//  ==============================================================================================
+//  sidParse
+//
+//  Convert a SteamID64 string to its integer value.  The string must be exactly 17 digits
+//  and within the individual account range.  Returns 0 on invalid input.
+//
+sid_t sidParse( char *strIn )
+{
+    sid_t id = 0;
+    unsigned int d;
+    int i;
+
+    if ( strIn == NULL ) return( 0 );
+    for ( i=0; i<SID_STRLEN; i++ ) {
+        d = (unsigned int) (unsigned char) strIn[i] - '0';
+        if ( d > 9 ) return( 0 );                                    // also catches early NUL
+        id = id * 10 + d;
+    }
+    if (( strIn[SID_STRLEN] != 0 ) || ( id < SID_MIN ) || ( id > SID_MAX )) id = 0;
+    return( id );
+}
+
+
+//  ==============================================================================================
+//  sidIsValid
+//
+//  Returns non-zero if string is a valid SteamID64
+//
+int sidIsValid( char *strIn )
+{
+    return( 0 != sidParse( strIn ));
+}
+
+
+//  ==============================================================================================
+//  sidToStr
+//
+//  Format a SteamID64 into strOut (at least SID_STRLEN+1 bytes).  Returns strOut.
+//
+char *sidToStr( sid_t id, char *strOut )
+{
+    snprintf( strOut, SID_STRLEN+1, "%llu", (unsigned long long) id );
+    return( strOut );
+}
+
+
+//  ==============================================================================================
+//  sidHash
+//
+//  Mixes the SteamID64 bits (splitmix64 finalizer) - SteamIDs share the upper 32 bits so
+//  the raw value makes a poor hash on its own.
+//
+uint32_t sidHash( sid_t x )
+{
+    x ^= x >> 30;  x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;  x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return( (uint32_t) x );
+}
+
+
+//  ==============================================================================================
+//  _sidSetSlot (local)
+//
+//  Linear-probe for id.  Returns the slot holding it or the empty slot where it would go.
+//  Set must have capacity.
+//
+static uint32_t _sidSetSlot( sidSet_t *sPtr, sid_t id )
+{
+    uint32_t i, mask;
+
+    mask = sPtr->capacity - 1;
+    i = sidHash( id ) & mask;
+    while (( sPtr->keys[i] != 0 ) && ( sPtr->keys[i] != id ))
+        i = (i + 1) & mask;
+    return( i );
+}
+
+
+//  ==============================================================================================
+//  _sidSetResize (local)
+//
+//  Rehash into a table of newCapacity slots.  Returns 0 on success.
+//
+static int _sidSetResize( sidSet_t *sPtr, uint32_t newCapacity )
+{
+    sidSet_t newSet;
+    uint32_t i, j;
+
+    newSet.keys   = (sid_t *)    calloc( newCapacity, sizeof( sid_t ));
+    newSet.values = (uint32_t *) calloc( newCapacity, sizeof( uint32_t ));
+    newSet.capacity = newCapacity;
+    newSet.count = sPtr->count;
+    if (( newSet.keys == NULL ) || ( newSet.values == NULL )) {
+        free( newSet.keys );  free( newSet.values );
+        return 1;
+    }
+    for ( i=0; i<sPtr->capacity; i++ ) {
+        if ( sPtr->keys[i] != 0 ) {
+            j = _sidSetSlot( &newSet, sPtr->keys[i] );
+            newSet.keys[j] = sPtr->keys[i];
+            newSet.values[j] = sPtr->values[i];
+        }
+    }
+    free( sPtr->keys );  free( sPtr->values );
+    *sPtr = newSet;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  sidSetInit
+//
+//  Initialize an empty set (no allocation until the first add)
+//
+void sidSetInit( sidSet_t *sPtr )
+{
+    memset( sPtr, 0, sizeof( sidSet_t ));
+    return;
+}
+
+
+//  ==============================================================================================
+//  sidSetClear
+//
+//  Remove all entries, keeping the table allocated.
+//
+void sidSetClear( sidSet_t *sPtr )
+{
+    if ( sPtr->capacity != 0 ) {
+        memset( sPtr->keys,   0, sPtr->capacity * sizeof( sid_t ));
+        memset( sPtr->values, 0, sPtr->capacity * sizeof( uint32_t ));
+    }
+    sPtr->count = 0;
+    return;
+}
+
+
+//  ==============================================================================================
+//  sidSetFree
+//
+//  Release the set memory.  The set is left empty and usable.
+//
+void sidSetFree( sidSet_t *sPtr )
+{
+    free( sPtr->keys );
+    free( sPtr->values );
+    sidSetInit( sPtr );
+    return;
+}
+
+
+//  ==============================================================================================
+//  sidSetAdd
+//
+//  Add id to the set, or update its value if already there.  Returns 0 on success.
+//
+int sidSetAdd( sidSet_t *sPtr, sid_t id, uint32_t value )
+{
+    uint32_t i;
+
+    if ( id == 0 ) return 1;
+    if ( (sPtr->count + 1) * 2 > sPtr->capacity ) {
+        if ( _sidSetResize( sPtr, sPtr->capacity ? sPtr->capacity * 2 : SID_SET_MINCAP )) return 1;
+    }
+    i = _sidSetSlot( sPtr, id );
+    if ( sPtr->keys[i] == 0 ) {
+        sPtr->keys[i] = id;
+        sPtr->count++;
+    }
+    sPtr->values[i] = value;
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  sidSetFind
+//
+//  Returns 1 and the stored value (if value is not NULL) if id is in the set, else 0.
+//
+int sidSetFind( sidSet_t *sPtr, sid_t id, uint32_t *value )
+{
+    uint32_t i;
+
+    if (( id == 0 ) || ( sPtr->count == 0 )) return 0;
+    i = _sidSetSlot( sPtr, id );
+    if ( sPtr->keys[i] == 0 ) return 0;
+    if ( value != NULL ) *value = sPtr->values[i];
+    return 1;
+}
+
+
+//  ==============================================================================================
+//  sidSetHas
+//
+//  Returns 1 if id is in the set, else 0.
+//
+int sidSetHas( sidSet_t *sPtr, sid_t id )
+{
+    return( sidSetFind( sPtr, id, NULL ));
+}
+
+
+//  ==============================================================================================
+//  sidSetRemove
+//
+//  Remove id from the set.  Entries that follow in the same probe run are shifted back so
+//  that no tombstones are needed.  Returns 0 if removed, 1 if not found.
+//
+int sidSetRemove( sidSet_t *sPtr, sid_t id )
+{
+    uint32_t i, j, home, mask;
+
+    if (( id == 0 ) || ( sPtr->count == 0 )) return 1;
+    i = _sidSetSlot( sPtr, id );
+    if ( sPtr->keys[i] == 0 ) return 1;
+
+    mask = sPtr->capacity - 1;
+    j = i;
+    while ( 1 == 1 ) {
+        sPtr->keys[i] = 0;
+        do {
+            j = (j + 1) & mask;
+            if ( sPtr->keys[j] == 0 ) {
+                sPtr->count--;
+                return 0;
+            }
+            home = sidHash( sPtr->keys[j] ) & mask;
+        } while ( (i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)) );
+        sPtr->keys[i] = sPtr->keys[j];
+        sPtr->values[i] = sPtr->values[j];
+        i = j;
+    }
+}
+
+
+//  ==============================================================================================
+//  sidSetParseList
+//
+//  Add every valid SteamID64 found in a space, comma or semicolon separated string.
+//  Returns the number of IDs added.
+//
+int sidSetParseList( sidSet_t *sPtr, char *strIn )
+{
+    char word[SID_STRLEN+2];
+    int n, count = 0;
+
+    while ( *strIn != 0 ) {
+        n = (int) strcspn( strIn, " ,;\011\012\015" );
+        if (( n == SID_STRLEN ) && ( n < (int) sizeof( word ))) {
+            memcpy( word, strIn, n );
+            word[n] = 0;
+            if ( 0 == sidSetAdd( sPtr, sidParse( word ), 0 )) count++;
+        }
+        strIn += n;
+        if ( *strIn != 0 ) strIn++;
+    }
+    return( count );
+}
+
@@ -0,0 +1,53 @@
+//  ==============================================================================================
+//
+//  Module: SID
+//
+//  Description:
+//  SteamID64 value type, validated parser and integer identity sets
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#ifndef _SID_H
+#define _SID_H
+
+#include <stdint.h>
+
+#define SID_STRLEN             (17)                      // digits in a SteamID64, e.g. 76561198...
+#define SID_MIN   (76561100000000000ULL)                              // accepted range, inclusive
+#define SID_MAX   (76561199999999999ULL)
+
+typedef uint64_t sid_t;                                                  // 0 = none / invalid
+
+//  Open-addressing hash set of SteamID64s, each carrying a 32-bit payload (caller defined,
+//  e.g., record# or expiry).  An all-zero sidSet_t is a valid empty set.
+//
+typedef struct {
+
+    sid_t    *keys;                                                          // 0 = empty slot
+    uint32_t *values;
+    uint32_t  capacity;                                                         // power of 2
+    uint32_t  count;
+
+} sidSet_t;
+
+extern sid_t sidParse( char *strIn );
+extern int   sidIsValid( char *strIn );
+extern char *sidToStr( sid_t id, char *strOut );
+extern uint32_t sidHash( sid_t x );
+
+extern void  sidSetInit( sidSet_t *sPtr );
+extern void  sidSetClear( sidSet_t *sPtr );
+extern void  sidSetFree( sidSet_t *sPtr );
+extern int   sidSetAdd( sidSet_t *sPtr, sid_t id, uint32_t value );
+extern int   sidSetFind( sidSet_t *sPtr, sid_t id, uint32_t *value );
+extern int   sidSetHas( sidSet_t *sPtr, sid_t id );
+extern int   sidSetRemove( sidSet_t *sPtr, sid_t id );
+extern int   sidSetParseList( sidSet_t *sPtr, char *strIn );
+
+#endif
@@ -44,6 +44,11 @@
 #include "ftrack.h"
 #include "events.h"
 #include "alarm.h"
+#include "arena.h"
+#include "iopoll.h"
+#include "httpd.h"
+#include "ctl.h"
+#include "metrics.h"
 #include "rdrv.h"
 #include "roster.h"
 
@@ -62,6 +67,7 @@
 #include "piwebgen.h"
 #include "pioverride.h"
 #include "picladmin.h"
+#include "pichatmod.h"
 
 
 //  ==============================================================================================
@@ -78,6 +84,7 @@
 #define SM_INVALID               (-1)      // internal error
 
 #define SISSM_POLLING_INTERVAL_MICROSEC (50000)        // 50ms file polling interval
+#define SISSM_LOGLINE_MAX               (4096)         // game log line, from the per-tick arena
 
 // Configuration variables read from the .cfg file
 // at start of this app.  Each plugin (including this one) should 
@@ -102,9 +109,19 @@ static struct {
     int  restartDelay;                          // number of seconds required for server to reboot
 
     int  gracefulExit;           // 1=install sig handler and generate SIGTERM event to the plugins
+
+    int  metricsPort;                                   // Prometheus /metrics port, 0=disabled
+    char metricsBind[CFS_FETCH_MAX];             // listen address, or a Unix socket path '/...'
+
+    char controlSocket[CFS_FETCH_MAX];                   // local control socket path, ""=none
     
 } sissmConfig;
 
+static httpdObj   *metricsHttpdPtr = NULL;
+static metricsObj *logLinesMetric = NULL, *logLinesMatchedMetric = NULL;
+
+static fileWatch_t configWatch;                              // .cfg file change detection
+
 
 
 //  ==============================================================================================
@@ -151,6 +168,31 @@ void sissmSigHandler( int signum )
 }
 #endif
  
+//  ==============================================================================================
+//  sissmSigReloadHandler
+//
+//  SIGHUP handler - request a configuration reload
+//  ==============================================================================================
+
+static volatile sig_atomic_t reloadRequested = 0;
+
+#ifndef _WIN32
+void sissmSigReloadHandler( int signum )
+{
+    reloadRequested = 1;      // checked by master loop, reload is done between events
+}
+#endif
+
+//  ==============================================================================================
+//  sissmReloadRequest
+//
+//  Request a configuration reload, done by the master loop between events.
+//
+void sissmReloadRequest( void )
+{
+    reloadRequested = 1;
+}
+
 //  ==============================================================================================
 //  sissmSigInstall
 //
@@ -178,6 +220,38 @@ int sissmSigInstall( void )
     return errCode;
 }
 
+//  ==============================================================================================
+//  sissmSigReloadInstall
+//
+//  SIGHUP handler for 'kill -HUP' configuration reload.  There is no equivalent on Windows,
+//  where the .cfg file change detection alone applies.
+//  ==============================================================================================
+
+int sissmSigReloadInstall( void )
+{
+#ifndef _WIN32
+    signal(SIGHUP,  sissmSigReloadHandler );  // reload .cfg and lists
+#endif
+    return 0;
+}
+
+//  ==============================================================================================
+//  sissmLogRotateConfig
+//
+//  Reads the log rotation policy and passes it to the log module
+//
+void sissmLogRotateConfig( cfsPtr cP )
+{
+    double rotateSizeMB, rotateHours;
+
+    rotateSizeMB = cfsFetchNum( cP, "sissm.logRotateSizeMB", 0.0 );
+    rotateHours  = cfsFetchNum( cP, "sissm.logRotateHours", 0.0 );
+    logRotateInit( (long long) (rotateSizeMB * 1024.0 * 1024.0), (long) (rotateHours * 3600.0),
+        (int) cfsFetchNum( cP, "sissm.logRotateKeep", 10.0 ),
+        (int) cfsFetchNum( cP, "sissm.logRotateCompress", 1.0 ));
+    return;
+}
+
 //  ==============================================================================================
 //  sissmInitLogAndConfig
 //
@@ -203,6 +277,7 @@ int sissmInitLogAndConfig( char *configPath )
     // Options for loglevel: _DEBUG _INFO _WARN _CRITICAL 
     // 
     logPrintfInit( sissmConfig.loglevel, sissmConfig.logFile, sissmConfig.logEchoToScreen ); 
+    sissmLogRotateConfig( cP );
 
     // read the RCON parameters
     //
@@ -228,35 +303,90 @@ int sissmInitLogAndConfig( char *configPath )
     //
     sissmConfig.gracefulExit = (int) cfsFetchNum( cP, "sissm.gracefulExit", 1.0 );
 
+    // metrics endpoint - served on a TCP port, or a Unix socket if metricsBind is a path
+    //
+    sissmConfig.metricsPort = (int) cfsFetchNum( cP, "sissm.metricsPort", 0.0 );
+    strlcpy( sissmConfig.metricsBind, cfsFetchStr( cP, "sissm.metricsBind", "127.0.0.1" ), CFS_FETCH_MAX );
+
+    // control socket for local admin tools (Unix domain socket path)
+    //
+    strlcpy( sissmConfig.controlSocket, cfsFetchStr( cP, "sissm.controlSocket", "" ), CFS_FETCH_MAX );
+
     cfsDestroy( cP );
 
+    fileWatchInit( &configWatch, configPath );
+
+    return 0;
+}
+
+//  ==============================================================================================
+//  sissmReloadConfig
+//
+//  Reload the .cfg file into a new configuration snapshot and notify the plugins with a 
+//  "~RELOAD~" event, so that each re-reads its own parameters.  This is called from the 
+//  main loop between events, so no plugin observes a partly applied configuration.  If the 
+//  file cannot be parsed, the running configuration is left in place.
+//
+//  Log level, console echo and the restart script are applied here.  The log file, RCON and
+//  game log parameters, as well as enabling or disabling a plugin, require a restart.
+//
+int sissmReloadConfig( void )
+{
+    cfsPtr cP;
+
+    if ( 0 != cfsReload( sissmConfig.configFile )) {
+        logPrintf( LOG_LEVEL_CRITICAL, "sissm", "Config reload of ::%s:: failed, keeping previous", 
+            sissmConfig.configFile );
+        return 1;
+    }
+
+    cP = cfsCreate( sissmConfig.configFile );
+
+    sissmConfig.loglevel = (int) cfsFetchNum( cP, "sissm.loglevel", 2.0 );
+    sissmConfig.logEchoToScreen = (int) cfsFetchNum( cP, "sissm.logechotoscreen", LOG_LEVEL_DEBUG );
+    logPrintfInit( sissmConfig.loglevel, sissmConfig.logFile, sissmConfig.logEchoToScreen ); 
+    sissmLogRotateConfig( cP );
+
+#if !SISSM_RESTRICTED
+    strlcpy( sissmConfig.restartScript, cfsFetchStr( cP, "sissm.restartscript", "" ), CFS_FETCH_MAX );
+#endif
+    sissmConfig.restartDelay = (int) cfsFetchNum( cP, "sissm.restartdelay", 30.0 );
+
+    if (( 0 != strcmp( sissmConfig.rconIP, cfsFetchStr( cP, "sissm.rconip", "127.0.0.1" ))) ||
+        ( 0 != strcmp( sissmConfig.rconPassword, cfsFetchStr( cP, "sissm.rconpassword", "" ))) ||
+        ( sissmConfig.rconPort != (int) cfsFetchNum( cP, "sissm.rconport", 27015 )) ||
+        ( 0 != strcmp( sissmConfig.gameLogFile, cfsFetchStr( cP, "sissm.gamelogfile", "Insurgency.log" ))) ||
+        ( 0 != strcmp( sissmConfig.logFile, cfsFetchStr( cP, "sissm.logfile", "sissm.log" ))))
+        logPrintf( LOG_LEVEL_CRITICAL, "sissm", "** Warning: RCON, game log and log file changes require a restart" );
+
+    cfsDestroy( cP );
+
+    logPrintf( LOG_LEVEL_CRITICAL, "sissm", "Config reloaded from ::%s::", sissmConfig.configFile );
+    eventsDispatch( "~RELOAD~" );
+
     return 0;
 }
 
 //  ==============================================================================================
 //  sissmVersion
 //
-//  Returns the version string.
+//  Returns the version string (a constant, safe from any thread; do not modify).
 //  
 char *sissmVersion( void )
 {
-    static char versionString[ 255 ];
-
-    strlcpy( versionString, VERSION, 255 );
-    return( versionString );
+    return( (char *) VERSION );
 }
 
 //  ==============================================================================================
 //  sissmGetConfigPath
 //
 //  Returns a configuration path.  This function is exported so that plugins can use and
-//  read from the same configuratino file used by the main SISSM module.
+//  read from the same configuratino file used by the main SISSM module.  The path is set 
+//  once at startup, so the returned string is safe from any thread; do not modify.
 //
 char *sissmGetConfigPath( void )
 {
-    static char systemConfigFilePath[256];
-    strlcpy( systemConfigFilePath, sissmConfig.configFile, 256 );
-    return( systemConfigFilePath );
+    return( sissmConfig.configFile );
 }
 
 //  ==============================================================================================
@@ -283,6 +413,7 @@ int sissmInitPlugins( void )
     piwebgenInstallPlugin();                                       // web status generator
     pioverrideInstallPlugin();                   // gamemodeproperty override for rulesets
     picladminInstallPlugin();     // admin in-game command executioner from the chat input
+    pichatmodInstallPlugin();                 // chat moderation: bad words warn, then kick
 
     // "Third Party" Plugins - for customizations
     //
@@ -316,6 +447,64 @@ int sissmServerRestartPending( void ) {
     return retValue;
 }
 
+//  ==============================================================================================
+//  sissmCtlMetrics, sissmCtlConfig, sissmCtlReload, sissmCtlRestart, sissmCtlVersion (local)
+//
+//  Control socket commands of the core.  Reload and restart are requests, carried out by
+//  the main loop as for SIGHUP and the in-game commands.  Variables with "password" in
+//  the name are not disclosed.
+//
+static int sissmCtlMetrics( char *args, strBuf_t *bPtr )
+{
+    return( metricsRender( bPtr ));
+}
+
+static int sissmCtlConfig( char *args, strBuf_t *bPtr )
+{
+    char keyName[CFS_FETCH_MAX], *value;
+    cfsPtr cP;
+
+    strlcpy( keyName, args, CFS_FETCH_MAX );
+    strTrimInPlace( keyName );
+    if ( 0 == keyName[0] ) {
+        strBufPrintf( bPtr, "usage: config <key>" );
+        return 1;
+    }
+    strToLowerInPlace( keyName );
+    if ( NULL != strstr( keyName, "password" )) {
+        strBufPrintf( bPtr, "'%s' is not disclosed", args );
+        return 1;
+    }
+
+    cP = cfsCreate( sissmGetConfigPath() );
+    value = cfsFetchStr( cP, keyName, NULL );
+    if ( value == NULL ) strBufPrintf( bPtr, "'%s' is not set", args );
+    else strBufPrintf( bPtr, "%s\n", value );
+    cfsDestroy( cP );
+    return( value == NULL );
+}
+
+static int sissmCtlReload( char *args, strBuf_t *bPtr )
+{
+    sissmReloadRequest();
+    strBufPrintf( bPtr, "reload requested\n" );
+    return 0;
+}
+
+static int sissmCtlRestart( char *args, strBuf_t *bPtr )
+{
+    sissmServerRestart();
+    strBufPrintf( bPtr, "restart requested\n" );
+    return 0;
+}
+
+static int sissmCtlVersion( char *args, strBuf_t *bPtr )
+{
+    strBufPrintf( bPtr, "%s\n", sissmVersion() );
+    return 0;
+}
+
+
 //  ==============================================================================================
 //  sissmInitInternal
 //
@@ -326,8 +515,25 @@ int sissmInitInternal( void )
     int errCode = 0;
 
     alarmInit();
+    iopollInit();
+    arenaInit();
     eventsInit();
 
+    logLinesMetric = metricsCounter( "sissm_log_lines_total", "Game log lines read", "" );
+    logLinesMatchedMetric = metricsCounter( "sissm_log_lines_matched_total", "Game log lines that triggered an event", "" );
+
+    if (( 0 != sissmConfig.metricsPort ) || ( '/' == sissmConfig.metricsBind[0] )) {
+        metricsHttpdPtr = httpdCreate( sissmConfig.metricsBind, sissmConfig.metricsPort, 16 );
+        httpdRoute( metricsHttpdPtr, "/metrics", "text/plain; version=0.0.4", metricsRender );
+    }
+
+    ctlInit( sissmConfig.controlSocket );
+    ctlRegister( "metrics", "metrics in Prometheus text format", sissmCtlMetrics );
+    ctlRegister( "config",  "config <key>: value of a .cfg variable", sissmCtlConfig );
+    ctlRegister( "reload",  "reload the .cfg file", sissmCtlReload );
+    ctlRegister( "restart", "restart the game server", sissmCtlRestart );
+    ctlRegister( "version", "sissm version", sissmCtlVersion );
+
     return errCode;
 }
 
@@ -423,7 +629,7 @@ int sissmMainLoop( void )
     int errCode = 0;
     int masterState = SM_STARTUP;
     ftrackObj *fPtr = NULL;
-    char strBuffer[4096];
+    char *strBuffer;
     unsigned long timePrev;          // for tracking periodic 1.0 Hz call
 
 
@@ -461,8 +667,11 @@ int sissmMainLoop( void )
             if (fPtr != NULL)  {
                 logPrintf( LOG_LEVEL_CRITICAL, "sissm", "Tracking game logfile ::%s::", 
                     sissmConfig.gameLogFile );
-                ftrackTailOfFile( fPtr, strBuffer, sizeof( strBuffer ), 1 );       // seek to end
-                masterState = SM_POLLING_INIT;
+                strBuffer = (char *) arenaAlloc( SISSM_LOGLINE_MAX );
+                if ( strBuffer != NULL ) {
+                    ftrackTailOfFile( fPtr, strBuffer, SISSM_LOGLINE_MAX, 1 );       // seek to end
+                    masterState = SM_POLLING_INIT;
+                }
             }
             else {
                 logPrintf( LOG_LEVEL_CRITICAL, "sissm", "Trying to open game logfile ::%s::", 
@@ -476,12 +685,15 @@ int sissmMainLoop( void )
             masterState = SM_POLLING_TRACKING;
             break;
         case SM_POLLING_TRACKING:
-            if ( 0 == ftrackTailOfFile( fPtr, strBuffer, sizeof( strBuffer ), 0 ) ) {
+            strBuffer = (char *) arenaAlloc( SISSM_LOGLINE_MAX );
+            if (( strBuffer != NULL ) && ( 0 == ftrackTailOfFile( fPtr, strBuffer, SISSM_LOGLINE_MAX, 0 ) )) {
                 logPrintf(LOG_LEVEL_RAWDUMP, "sissm", "::%s::", strBuffer);
-                eventsDispatch( strBuffer );
+                metricsInc( logLinesMetric );
+                if ( 0 <= eventsDispatch( strBuffer )) metricsInc( logLinesMatchedMetric );
+                iopollWait( 0 );                    // serve ready sockets between log lines
             }
             else { 
-                usleep( SISSM_POLLING_INTERVAL_MICROSEC );
+                iopollWait( SISSM_POLLING_INTERVAL_MICROSEC / 1000 );  // wakes for alarms, sockets
             }
             break;
         case SM_SYS_RESTART:
@@ -497,22 +709,36 @@ int sissmMainLoop( void )
         }
 
         // 3. periodic callbacks and alarms processing
-	// currently at 1.0Hz polling rate
-        //   
+        // alarms are millisecond resolution and checked every pass; periodic is 1.0Hz
+        //
+        alarmDispatch();
         if ( timePrev != time( NULL ) ) {
-	    alarmDispatch();
-            eventsDispatch( "~PERIODIC~" );
+            eventsDispatchID( SISSM_EV_PERIODIC, "~PERIODIC~" );    // legacy 1Hz tick
             timePrev = time( NULL );
             ftrackResync( fPtr );                          // check for log file rotate and follow
+
+            // configuration reload on SIGHUP or .cfg file change
+            //
+            if ( fileWatchChanged( &configWatch, sissmConfig.configFile )) reloadRequested = 1;
+            if ( reloadRequested ) {
+                reloadRequested = 0;
+                sissmReloadConfig();
+            }
         }
+
+        // 4. end of dispatch cycle: drop this pass's transient (arena) allocations
+        //
+        arenaReset();
     }
 
-    // 4. graceful exit
+    // 5. graceful exit
     // This only happens if "sissm.gracefulExit" flag is set in the .cfg file.
     // Before SISSM shuts down, generate a synthetic event to all plugins so that 
     // they can take actions to leave the server in a playable state without SISSM.
     //
     eventsDispatch( "~SIGTERM~" );
+    httpdDestroy( metricsHttpdPtr );
+    ctlDestroy();
 
     return errCode;
 }
@@ -569,6 +795,7 @@ int main( int argc, char *argv[] )
     // a playable state in the absense of SISSM.
     //
     if ( sissmConfig.gracefulExit ) sissmSigInstall();
+    if ( !errCode ) sissmSigReloadInstall();
 
     // Initialize the system, plugins, then spin the main loop
     //
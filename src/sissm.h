@@ -19,5 +19,6 @@ extern char *sissmGetConfigPath( void );
 extern void sissmServerRestart( void );
 extern char *sissmVersion( void );
 extern int  sissmRestartServer( void );
+extern void sissmReloadRequest( void );
 
 
@@ -0,0 +1,473 @@
+//  ==============================================================================================
+//
+//  Module: TMPL
+//
+//  Description:
+//  Text templates compiled once into literal spans and variable slots, rendered many times
+//
+//  Syntax (a subset of the familiar "mustache" style):
+//
+//      {{name}}                value of a variable, escaped for the template's output format
+//      {{&name}}               value, not escaped
+//      {{#list}} .. {{/list}}  repeat for each row of a list; variables inside see that row
+//      {{#name}} .. {{/name}}  include if the variable is not empty and not "0"
+//      {{^name}} .. {{/name}}  include if it is (empty, "0", or a list without rows)
+//      {{#first}}, {{#last}}   conditions on the row of the innermost list, e.g. separators:
+//                              {{#players}}{{^first}}, {{/first}}{{name}}{{/players}}
+//      {{! comment }}
+//
+//  A template is compiled into an array of operations (literal span of the template text,
+//  variable slot, section start/end with a precomputed jump), with every name resolved to
+//  an index of the caller's binding.  Rendering is one pass over that array, appending spans
+//  and values to a reusable buffer; nothing is parsed or looked up per render.  Unknown
+//  names and unbalanced sections are compile errors (with the line number), so a bad
+//  template is rejected at load time rather than rendering garbage.
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bsd.h"
+#include "util.h"
+#include "tmpl.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+#define TMPL_OP_LITERAL     (1)                                  // text[off], len bytes
+#define TMPL_OP_VAR         (2)                                      // value of 'index'
+#define TMPL_OP_SECTION     (3)                  // condition or list, 'jump' = matching END
+#define TMPL_OP_INVERTED    (4)
+#define TMPL_OP_END         (5)                                  // 'jump' = section start
+
+#define TMPL_REF_VAR        (1)                          // what a section or slot refers to
+#define TMPL_REF_LIST       (2)
+#define TMPL_REF_FIRST      (3)
+#define TMPL_REF_LAST       (4)
+
+#define TMPL_MAXFILE        (256*1024)                            // largest template file
+
+typedef struct {
+
+    unsigned char kind;
+    unsigned char ref;                                                   // TMPL_REF_*
+    unsigned char raw;                                               // {{&name}}: no escape
+    int           index;                                     // into varNames or listNames
+    size_t        off, len;                                               // literal span
+    int           jump;
+
+} tmplOp_t;
+
+struct tmplObj {
+
+    char                *text;                                 // template source (spans)
+    tmplOp_t            *ops;
+    int                  opCount, opSize;
+    int                  escape;
+    const tmplBinding_t *binding;
+
+};
+
+
+//  ==============================================================================================
+//  tmplAppendEscaped
+//
+//  Append str escaped for an output format: HTML text/attribute, the inside of a JSON
+//  string, or a CSV field (quoted only if needed, RFC 4180).
+//
+void tmplAppendEscaped( strBuf_t *bPtr, const char *str, size_t len, int escape )
+{
+    size_t i, start;
+    unsigned char c;
+
+    if (( escape == TMPL_ESC_CSV ) && ( len == strcspn( str, ",\"\r\n" ))) escape = TMPL_ESC_NONE;
+
+    switch ( escape ) {
+    case TMPL_ESC_HTML:
+    case TMPL_ESC_JSON:
+        for ( i = start = 0; i<len; i++ ) {
+            c = (unsigned char) str[i];
+            if ( escape == TMPL_ESC_JSON ) {
+                if (( c != '"' ) && ( c != '\\' ) && ( c >= 0x20 )) continue;
+                strBufAppend( bPtr, &str[start], i - start );
+                if ( c >= 0x20 ) strBufPrintf( bPtr, "\\%c", c );
+                else             strBufPrintf( bPtr, "\\u%04x", c );
+            }
+            else {
+                if (( c != '<' ) && ( c != '>' ) && ( c != '&' ) && ( c != '"' )) continue;
+                strBufAppend( bPtr, &str[start], i - start );
+                if      ( c == '<' )  strBufAppend( bPtr, "&lt;", 4 );
+                else if ( c == '>' )  strBufAppend( bPtr, "&gt;", 4 );
+                else if ( c == '&' )  strBufAppend( bPtr, "&amp;", 5 );
+                else                  strBufAppend( bPtr, "&quot;", 6 );
+            }
+            start = i + 1;
+        }
+        strBufAppend( bPtr, &str[start], len - start );
+        break;
+    case TMPL_ESC_CSV:
+        strBufAppend( bPtr, "\"", 1 );
+        for ( i=0; i<len; i++ ) {
+            if ( str[i] == '"' ) strBufAppend( bPtr, "\"\"", 2 );
+            else                 strBufAppend( bPtr, &str[i], 1 );
+        }
+        strBufAppend( bPtr, "\"", 1 );
+        break;
+    default:
+        strBufAppend( bPtr, str, len );
+        break;
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  tmplEscapeForFile
+//
+//  Escape mode by file name extension: .json, .csv, .txt (none), otherwise HTML.
+//
+int tmplEscapeForFile( char *fileName )
+{
+    char ext[8], *dot = strrchr( fileName, '.' );
+
+    if ( dot == NULL ) return( TMPL_ESC_HTML );
+    strlcpy( ext, dot, sizeof( ext ));
+    strToLowerInPlace( ext );
+    if ( 0 == strcmp( ext, ".json" ))   return( TMPL_ESC_JSON );
+    if ( 0 == strcmp( ext, ".csv" ))    return( TMPL_ESC_CSV );
+    if ( 0 == strcmp( ext, ".txt" ))    return( TMPL_ESC_NONE );
+    return( TMPL_ESC_HTML );
+}
+
+
+//  ==============================================================================================
+//  _tmplAddOp (local)
+//
+static tmplOp_t *_tmplAddOp( tmplObj *tPtr, int kind )
+{
+    tmplOp_t *newOps;
+    int newSize;
+
+    if ( tPtr->opCount >= tPtr->opSize ) {
+        newSize = ( tPtr->opSize == 0 ) ? 32 : 2 * tPtr->opSize;
+        if ( NULL == (newOps = (tmplOp_t *) realloc( tPtr->ops, newSize * sizeof( tmplOp_t )))) return( NULL );
+        tPtr->ops = newOps;
+        tPtr->opSize = newSize;
+    }
+    memset( &tPtr->ops[ tPtr->opCount ], 0, sizeof( tmplOp_t ));
+    tPtr->ops[ tPtr->opCount ].kind = (unsigned char) kind;
+    return( &tPtr->ops[ tPtr->opCount++ ] );
+}
+
+
+//  ==============================================================================================
+//  _tmplLookup (local)
+//
+//  Resolve a tag name to what it refers to.  Returns TMPL_REF_* and sets *index, or 0 if
+//  the name is unknown.
+//
+static int _tmplLookup( const tmplBinding_t *binding, const char *name, size_t len, int *index )
+{
+    int i;
+
+    *index = 0;
+    for ( i=0; ( binding->listNames != NULL ) && ( binding->listNames[i] != NULL ); i++ )
+        if (( len == strlen( binding->listNames[i] )) && ( 0 == strncmp( name, binding->listNames[i], len ))) {
+            *index = i;
+            return( TMPL_REF_LIST );
+        }
+    for ( i=0; ( binding->varNames != NULL ) && ( binding->varNames[i] != NULL ); i++ )
+        if (( len == strlen( binding->varNames[i] )) && ( 0 == strncmp( name, binding->varNames[i], len ))) {
+            *index = i;
+            return( TMPL_REF_VAR );
+        }
+    if (( len == 5 ) && ( 0 == strncmp( name, "first", 5 ))) return( TMPL_REF_FIRST );
+    if (( len == 4 ) && ( 0 == strncmp( name, "last", 4 )))  return( TMPL_REF_LAST );
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _tmplLine (local)
+//
+static int _tmplLine( const char *text, const char *p )
+{
+    int line = 1;
+
+    for ( ; text < p; text++ ) if ( *text == '\n' ) line++;
+    return( line );
+}
+
+
+//  ==============================================================================================
+//  tmplCompile
+//
+//  Compile template text (len bytes, need not be NUL terminated) against a binding, which
+//  must stay valid while the template is used.  'escape' is the TMPL_ESC_* applied to
+//  {{name}} values.  Returns NULL on error, with a message in errOut.
+//
+tmplObj *tmplCompile( const char *text, size_t len, const tmplBinding_t *binding, int escape, char *errOut, size_t errSize )
+{
+    tmplObj  *tPtr;
+    tmplOp_t *op;
+    const char *p, *end, *open, *close, *name;
+    size_t nameLen;
+    int stack[TMPL_MAXDEPTH], depth = 0, kind, ref, index, raw;
+
+    strlcpy( errOut, "", errSize );
+    if ( NULL == (tPtr = (tmplObj *) calloc( 1, sizeof( tmplObj )))) return( NULL );
+    if ( NULL == (tPtr->text = (char *) malloc( len + 1 ))) {
+        free( tPtr );
+        return( NULL );
+    }
+    memcpy( tPtr->text, text, len );
+    tPtr->text[len] = 0;
+    tPtr->escape = escape;
+    tPtr->binding = binding;
+
+    p = tPtr->text;
+    end = tPtr->text + len;
+    while ( p < end ) {
+
+        // literal span up to the next tag
+        //
+        if ( NULL == (open = strstr( p, "{{" ))) open = end;
+        if ( open > p ) {
+            if ( NULL == (op = _tmplAddOp( tPtr, TMPL_OP_LITERAL ))) goto nomem;
+            op->off = p - tPtr->text;
+            op->len = open - p;
+        }
+        if ( open == end ) break;
+
+        if ( NULL == (close = strstr( open + 2, "}}" ))) {
+            snprintf( errOut, errSize, "line %d: unterminated {{", _tmplLine( tPtr->text, open ));
+            goto fail;
+        }
+        p = close + 2;
+
+        // tag: {{name}} {{&name}} {{#name}} {{^name}} {{/name}} {{!comment}}
+        //
+        name = open + 2;
+        kind = TMPL_OP_VAR;
+        raw = 0;
+        switch ( *name ) {
+        case '!':  continue;
+        case '&':  raw = 1;                  name++;  break;
+        case '#':  kind = TMPL_OP_SECTION;   name++;  break;
+        case '^':  kind = TMPL_OP_INVERTED;  name++;  break;
+        case '/':  kind = TMPL_OP_END;       name++;  break;
+        default:   break;
+        }
+        while (( name < close ) && ( *name == ' ' )) name++;
+        for ( nameLen = close - name; ( nameLen > 0 ) && ( name[nameLen-1] == ' ' ); nameLen-- ) ;
+
+        if ( kind == TMPL_OP_END ) {
+            if (( depth == 0 ) ||
+                ( nameLen != tPtr->ops[ stack[depth-1] ].len ) ||
+                ( 0 != strncmp( name, tPtr->text + tPtr->ops[ stack[depth-1] ].off, nameLen ))) {
+                snprintf( errOut, errSize, "line %d: unexpected {{/%.*s}}", _tmplLine( tPtr->text, open ), (int) nameLen, name );
+                goto fail;
+            }
+            if ( NULL == (op = _tmplAddOp( tPtr, TMPL_OP_END ))) goto nomem;
+            op->jump = stack[--depth];
+            tPtr->ops[ op->jump ].jump = tPtr->opCount - 1;
+            continue;
+        }
+
+        if ( 0 == (ref = _tmplLookup( binding, name, nameLen, &index ))) {
+            snprintf( errOut, errSize, "line %d: unknown name {{%.*s}}", _tmplLine( tPtr->text, open ), (int) nameLen, name );
+            goto fail;
+        }
+        if (( kind == TMPL_OP_VAR ) && ( ref != TMPL_REF_VAR )) {
+            snprintf( errOut, errSize, "line %d: {{%.*s}} can only be a section", _tmplLine( tPtr->text, open ), (int) nameLen, name );
+            goto fail;
+        }
+        if (( kind != TMPL_OP_VAR ) && ( depth >= TMPL_MAXDEPTH )) {
+            snprintf( errOut, errSize, "line %d: sections nested too deep", _tmplLine( tPtr->text, open ));
+            goto fail;
+        }
+
+        if ( NULL == (op = _tmplAddOp( tPtr, kind ))) goto nomem;
+        op->ref = (unsigned char) ref;
+        op->index = index;
+        op->raw = (unsigned char) raw;
+        op->off = name - tPtr->text;                      // section name, matched by {{/name}}
+        op->len = nameLen;
+        if ( kind != TMPL_OP_VAR ) stack[depth++] = tPtr->opCount - 1;
+    }
+
+    if ( depth != 0 ) {
+        snprintf( errOut, errSize, "missing {{/%.*s}}", (int) tPtr->ops[ stack[depth-1] ].len, tPtr->text + tPtr->ops[ stack[depth-1] ].off );
+        goto fail;
+    }
+    return( tPtr );
+
+nomem:
+    snprintf( errOut, errSize, "out of memory" );
+fail:
+    tmplDestroy( tPtr );
+    return( NULL );
+}
+
+
+//  ==============================================================================================
+//  tmplLoad
+//
+//  Read and compile a template file.  Returns NULL on error, with a message in errOut.
+//
+tmplObj *tmplLoad( char *fileName, const tmplBinding_t *binding, int escape, char *errOut, size_t errSize )
+{
+    FILE *fpr;
+    char *text;
+    size_t len;
+    tmplObj *tPtr;
+
+    if ( NULL == (fpr = fopen( fileName, "rb" ))) {
+        snprintf( errOut, errSize, "unable to read" );
+        return( NULL );
+    }
+    if ( NULL == (text = (char *) malloc( TMPL_MAXFILE ))) {
+        fclose( fpr );
+        snprintf( errOut, errSize, "out of memory" );
+        return( NULL );
+    }
+    len = fread( text, 1, TMPL_MAXFILE, fpr );
+    fclose( fpr );
+
+    if ( len >= TMPL_MAXFILE ) {
+        snprintf( errOut, errSize, "larger than %d bytes", TMPL_MAXFILE );
+        tPtr = NULL;
+    }
+    else {
+        tPtr = tmplCompile( text, len, binding, escape, errOut, errSize );
+    }
+    free( text );
+    return( tPtr );
+}
+
+
+//  ==============================================================================================
+//  _tmplIsTrue (local)
+//
+//  How many times a section runs: rows of a list, or 1/0 for a condition.  row is the
+//  current row of the innermost list (-1 if none), rows its row count.
+//
+static int _tmplIsTrue( tmplObj *tPtr, tmplOp_t *op, int row, int rows, void *userData )
+{
+    const char *value;
+
+    switch ( op->ref ) {
+    case TMPL_REF_LIST:   return( (*tPtr->binding->rowsFn)( op->index, userData ));
+    case TMPL_REF_FIRST:  return( row == 0 );
+    case TMPL_REF_LAST:   return(( row >= 0 ) && ( row == rows - 1 ));
+    default:
+        value = (*tPtr->binding->valueFn)( op->index, row, userData );
+        return(( value != NULL ) && ( value[0] != 0 ) && ( 0 != strcmp( value, "0" )));
+    }
+}
+
+
+//  ==============================================================================================
+//  tmplRender
+//
+//  Append the rendered template to bPtr.  userData is passed to the binding functions.
+//  Returns the buffer overflow flag (0 = complete).
+//
+int tmplRender( tmplObj *tPtr, strBuf_t *bPtr, void *userData )
+{
+    struct {
+        int start, row, count, isList;
+    } stack[TMPL_MAXDEPTH];
+    int depth = 0, i = 0, d, row = -1, rows = 0, count;
+    tmplOp_t *op;
+    const char *value;
+
+    if ( tPtr == NULL ) return( 1 );
+
+    while ( i < tPtr->opCount ) {
+        op = &tPtr->ops[i];
+        switch ( op->kind ) {
+
+        case TMPL_OP_LITERAL:
+            strBufAppend( bPtr, tPtr->text + op->off, op->len );
+            i++;
+            break;
+
+        case TMPL_OP_VAR:
+            if ( NULL != (value = (*tPtr->binding->valueFn)( op->index, row, userData )))
+                tmplAppendEscaped( bPtr, value, strlen( value ), op->raw ? TMPL_ESC_NONE : tPtr->escape );
+            i++;
+            break;
+
+        case TMPL_OP_SECTION:
+        case TMPL_OP_INVERTED:
+            count = _tmplIsTrue( tPtr, op, row, rows, userData );
+            if ( op->kind == TMPL_OP_INVERTED ) count = ( count <= 0 );
+            if ( count <= 0 ) {
+                i = op->jump + 1;                                     // skip to past {{/name}}
+                break;
+            }
+            stack[depth].start = i;
+            stack[depth].row = 0;
+            stack[depth].count = count;
+            stack[depth].isList = ( op->kind == TMPL_OP_SECTION ) && ( op->ref == TMPL_REF_LIST );
+            depth++;
+            if ( stack[depth-1].isList ) {
+                row = 0;
+                rows = count;
+            }
+            i++;
+            break;
+
+        case TMPL_OP_END:
+            if ( ++stack[depth-1].row < stack[depth-1].count ) {
+                if ( stack[depth-1].isList ) row = stack[depth-1].row;
+                i = stack[depth-1].start + 1;                                // next row
+                break;
+            }
+            depth--;
+
+            // back to the row of the enclosing list, if any
+            //
+            row = -1;  rows = 0;
+            for ( d = depth - 1; d >= 0; d-- ) {
+                if ( stack[d].isList ) {
+                    row = stack[d].row;
+                    rows = stack[d].count;
+                    break;
+                }
+            }
+            i++;
+            break;
+
+        default:
+            i++;
+            break;
+        }
+    }
+    return( bPtr->overflow );
+}
+
+
+//  ==============================================================================================
+//  tmplDestroy
+//
+void tmplDestroy( tmplObj *tPtr )
+{
+    if ( tPtr == NULL ) return;
+    free( tPtr->ops );
+    free( tPtr->text );
+    free( tPtr );
+    return;
+}
+
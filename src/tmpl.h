@@ -0,0 +1,46 @@
+//  ==============================================================================================
+//
+//  Module: TMPL
+//
+//  Description:
+//  Text templates compiled once into literal spans and variable slots, rendered many times
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#include <stddef.h>
+#include "util.h"
+
+#define TMPL_ESC_NONE       (0)                          // how {{var}} values are escaped
+#define TMPL_ESC_HTML       (1)
+#define TMPL_ESC_JSON       (2)                                  // inside a "string"
+#define TMPL_ESC_CSV        (3)                                        // as one field
+
+#define TMPL_MAXDEPTH       (8)                                   // nested sections
+
+//  What a template may refer to, and how the values are fetched at render time.  Names are
+//  resolved to indexes when the template is compiled, so rendering does no lookups.
+//
+typedef struct {
+
+    const char *const *varNames;          // NULL terminated: {{name}}, or {{#name}} condition
+    const char *const *listNames;            // NULL terminated: {{#name}}..{{/name}} per row
+    const char *(*valueFn)( int varIndex, int row, void *userData );   // row -1 outside lists
+    int (*rowsFn)( int listIndex, void *userData );
+
+} tmplBinding_t;
+
+typedef struct tmplObj tmplObj;
+
+extern tmplObj *tmplCompile( const char *text, size_t len, const tmplBinding_t *binding, int escape, char *errOut, size_t errSize );
+extern tmplObj *tmplLoad( char *fileName, const tmplBinding_t *binding, int escape, char *errOut, size_t errSize );
+extern int tmplRender( tmplObj *tPtr, strBuf_t *bPtr, void *userData );
+extern void tmplDestroy( tmplObj *tPtr );
+extern void tmplAppendEscaped( strBuf_t *bPtr, const char *str, size_t len, int escape );
+extern int tmplEscapeForFile( char *fileName );
+
@@ -22,32 +22,118 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <stdint.h>
+
+#include "bsd.h"
+#include "util.h"
+
+//  ==============================================================================================
+//  wordIterInit
+//
+//  Prepare to walk the words of strIn separated by any of the characters in delim.  Neither
+//  string is copied, so both must stay unchanged while the iterator is in use.
+//
+void wordIterInit( wordIter_t *it, const char *strIn, const char *delim )
+{
+    it->next  = strIn;
+    it->delim = delim;
+    return;
+}
+
+
+//  ==============================================================================================
+//  wordIterNext
+//
+//  Returns 1 and the next word as a view, or 0 at the end of the string.
+//
+int wordIterNext( wordIter_t *it, strView_t *word )
+{
+    const char *p;
+
+    if ( it->next == NULL ) return 0;
+    p = it->next + strspn( it->next, it->delim );                      // skip delimiter run
+    if ( *p == 0 ) {
+        it->next = NULL;
+        return 0;
+    }
+    word->ptr = p;
+    word->len = strcspn( p, it->delim );
+    it->next  = p + word->len;
+    return 1;
+}
+
+
+//  ==============================================================================================
+//  wordView
+//
+//  Returns 1 and the n-th word (first word is wordIndex=0) as a view into strIn, or 0 if
+//  there are not that many words.  Use wordIterNext() to walk all words in one pass.
+//
+int wordView( const char *strIn, int wordIndex, const char *delim, strView_t *word )
+{
+    wordIter_t it;
+
+    wordIterInit( &it, strIn, delim );
+    while ( wordIterNext( &it, word )) {
+        if ( 0 == wordIndex-- ) return 1;
+    }
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  strViewCopy
+//
+//  Copy a word to a NUL-terminated buffer, truncating to outSize-1 characters (strlcpy
+//  semantics).  A NULL word gives an empty string.  Returns strOut.
+//
+char *strViewCopy( char *strOut, size_t outSize, const strView_t *word )
+{
+    size_t n = 0;
+
+    if ( outSize == 0 ) return strOut;
+    if ( word != NULL ) {
+        n = ( word->len < outSize - 1 ) ? word->len : outSize - 1;
+        memcpy( strOut, word->ptr, n );
+    }
+    strOut[n] = 0;
+    return strOut;
+}
+
+
+//  ==============================================================================================
+//  strViewEq
+//
+//  Returns true (!=0) if the word is exactly equal to str.
+//
+int strViewEq( const strView_t *word, const char *str )
+{
+    return(( 0 == strncmp( word->ptr, str, word->len )) && ( str[ word->len ] == 0 ));
+}
+
 
 //  ==============================================================================================
 //  getWord
 //
 //  Returns n-th word from a string using specified delimiter(s).  First word is wordIndex=0.
-//  
+//  The word is copied to a static buffer overwritten by the next call; kept for plugins 
+//  written against the old interface, in-tree code uses wordView() / wordIterNext().
+//  getWord_r copies to the caller's buffer instead.
 //
 #define BUFSIZE ( 16*1024 )
 
-char *getWord( char *strIn, int wordIndex, char *delim )
+char *getWord_r( char *strIn, int wordIndex, char *delim, char *wordOut, size_t outSize )
 {
-    static char retStr[BUFSIZE];
+    strView_t word;
 
-    char  *pch = NULL;
-    int   i = 0;
+    if ( !wordView( strIn, wordIndex, delim, &word )) return NULL;
+    return( strViewCopy( wordOut, outSize, &word ));
+}
 
-    retStr[BUFSIZE-1] = 0;
-    strncpy( retStr, strIn, BUFSIZE-2);
-    pch = strtok( retStr, delim );
-    while (pch != NULL) {
-        if ( i++ == wordIndex ) {
-            break;
-        }
-        pch = strtok( NULL, delim );
-    }
-    return pch;
+char *getWord( char *strIn, int wordIndex, char *delim )
+{
+    static char retStr[BUFSIZE];
+    return( getWord_r( strIn, wordIndex, delim, retStr, BUFSIZE ));
 }
 
 //  ==============================================================================================
@@ -61,7 +147,7 @@ int foundMatch( char *line, char *table[], int caseConvert )
 {
     int foundMe = 0;
     int p;
-    static char lineCopy[4096];
+    char lineCopy[4096];
 
     strncpy( lineCopy, line, 4096 );
 
@@ -117,27 +203,64 @@ void strToLowerInPlace(char * s)
 }
 
 
+//  ==============================================================================================
+//  parseIPv4
+//
+//  Converts dotted IPv4 string e.g., "111.22.3.4" or zero-padded "111.022.003.004" to a
+//  host-order number.  Parsing stops at the first character after the 4th octet.
+//  Returns the number of characters consumed, or 0 on formatting error.
+//
+int parseIPv4( char *strIn, uint32_t *ipOut )
+{
+    unsigned int octet, digit;
+    uint32_t ip = 0;
+    int i, n, pos = 0;
+
+    for ( i=0; i<4; i++ ) {
+        if (( i != 0 ) && ( strIn[pos++] != '.' )) return 0;
+        octet = 0;
+        for ( n=0; n<3; n++ ) {
+            digit = (unsigned int) (unsigned char) strIn[pos] - '0';
+            if ( digit > 9 ) break;
+            octet = octet * 10 + digit;
+            pos++;
+        }
+        if (( n == 0 ) || ( octet > 255 )) return 0;
+        ip = (ip << 8) | octet;
+    }
+    if (( strIn[pos] >= '0' ) && ( strIn[pos] <= '9' )) return 0;           // 4+ digit octet
+    *ipOut = ip;
+    return( pos );
+}
+
+
 //  ==============================================================================================
 //  reformatIP
 //
 //  Covert IP# string e.g., "111.22.3.4" to "111.022.003.004"
 //  which makes for convenient conversion at string level.
 //  On formatting error, or subnet exceeding 255, "000.000.000.000" is
-//  returned with error code set.
+//  returned with error code set.  reformatIP_r writes to the caller's buffer (16 bytes
+//  is enough).
 //
-char *reformatIP( char *originalIP )
+char *reformatIP_r( char *originalIP, char *expandedIP, size_t outSize )
 {
-    static char expandedIP[256];
-    unsigned int n1, n2, n3, n4;
-    strcpy( expandedIP,  "000.000.000.000" );
-    if ( 4 == sscanf( originalIP, "%d.%d.%d.%d", &n1, &n2, &n3, &n4 )) {
-        if ((n1<256) && (n2<256) && (n3<256) && (n4<256)) {
-            snprintf( expandedIP, 256, "%03d.%03d.%03d.%03d", n1, n2, n3, n4 );
-        }
+    uint32_t ip;
+
+    strlcpy( expandedIP,  "000.000.000.000", outSize );
+    if ( 0 != parseIPv4( originalIP, &ip )) {
+        snprintf( expandedIP, outSize, "%03u.%03u.%03u.%03u", 
+            (unsigned) (ip >> 24), (unsigned) (ip >> 16) & 255, (unsigned) (ip >> 8) & 255, (unsigned) ip & 255 );
     }
     return( expandedIP );
 }
 
+char *reformatIP( char *originalIP )
+{
+    static char expandedIP[256];
+    return( reformatIP_r( originalIP, expandedIP, sizeof( expandedIP )));
+}
+
 //  ==============================================================================================
 //  isReadable
 //
@@ -158,3 +281,143 @@ int isReadable( char *fileName )
     return fileReadOk;
 }
 
+
+
+//  ==============================================================================================
+//  fileWatchInit
+//
+//  Record the current modification time and size of a file, so that later changes can be
+//  detected with fileWatchChanged().  A missing file is recorded as such.
+//
+void fileWatchInit( fileWatch_t *wPtr, char *fileName )
+{
+    struct stat st;
+
+    if (( fileName == NULL ) || ( 0 != stat( fileName, &st ))) {
+        wPtr->mtime = -1;
+        wPtr->size  = -1;
+    }
+    else {
+        wPtr->mtime = (long long) st.st_mtime;
+        wPtr->size  = (long long) st.st_size;
+    }
+    wPtr->pendMtime = wPtr->mtime;
+    wPtr->pendSize  = wPtr->size;
+    return;
+}
+
+
+//  ==============================================================================================
+//  fileWatchChanged
+//
+//  Returns 1 if the file changed since the last call that returned 1 (or since fileWatchInit),
+//  and has stayed unchanged between this call and the previous one.  Called periodically,
+//  this debounces editors and copy tools that write a file in several steps, so the file is
+//  not picked up half written.
+//
+int fileWatchChanged( fileWatch_t *wPtr, char *fileName )
+{
+    fileWatch_t now;
+    int isChanged = 0;
+
+    fileWatchInit( &now, fileName );
+    if (( now.mtime != wPtr->mtime ) || ( now.size != wPtr->size )) {
+        if (( now.mtime == wPtr->pendMtime ) && ( now.size == wPtr->pendSize )) {
+            *wPtr = now;                                                 // settled: report it
+            isChanged = 1;
+        }
+        else {
+            wPtr->pendMtime = now.mtime;                           // still moving: wait a tick
+            wPtr->pendSize  = now.size;
+        }
+    }
+    return( isChanged );
+}
+
+
+//  ==============================================================================================
+//  strBufReset
+//
+//  Empty the buffer but keep its memory for the next render.  A zeroed strBuf_t is a valid
+//  empty buffer.
+//
+void strBufReset( strBuf_t *bPtr )
+{
+    bPtr->len = 0;
+    bPtr->overflow = 0;
+    if ( bPtr->data != NULL ) bPtr->data[0] = 0;
+    return;
+}
+
+
+//  ==============================================================================================
+//  _strBufReserve (local)
+//
+static int _strBufReserve( strBuf_t *bPtr, size_t extra )
+{
+    size_t newSize;
+    char *p;
+
+    if ( bPtr->len + extra + 1 <= bPtr->size ) return( 0 );
+
+    newSize = ( bPtr->size == 0 ) ? 1024 : bPtr->size;
+    while ( newSize < bPtr->len + extra + 1 ) newSize *= 2;
+    if ( NULL == (p = (char *) realloc( bPtr->data, newSize ))) {
+        bPtr->overflow = 1;
+        return( 1 );
+    }
+    bPtr->data = p;
+    bPtr->size = newSize;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  strBufAppend
+//
+//  Append len bytes.  Returns non-zero (and sets overflow) if out of memory.
+//
+int strBufAppend( strBuf_t *bPtr, const char *data, size_t len )
+{
+    if ( 0 != _strBufReserve( bPtr, len )) return( 1 );
+    memcpy( &bPtr->data[ bPtr->len ], data, len );
+    bPtr->len += len;
+    bPtr->data[ bPtr->len ] = 0;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  strBufPrintf
+//
+//  Append printf-formatted text.  Returns non-zero (and sets overflow) if out of memory.
+//
+int strBufPrintf( strBuf_t *bPtr, const char *format, ... )
+{
+    va_list args;
+    int n;
+
+    va_start( args, format );
+    n = vsnprintf( NULL, 0, format, args );
+    va_end( args );
+    if (( n < 0 ) || ( 0 != _strBufReserve( bPtr, (size_t) n ))) return( 1 );
+
+    va_start( args, format );
+    vsnprintf( &bPtr->data[ bPtr->len ], (size_t) n + 1, format, args );
+    va_end( args );
+    bPtr->len += (size_t) n;
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  strBufFree
+//
+void strBufFree( strBuf_t *bPtr )
+{
+    free( bPtr->data );
+    memset( bPtr, 0, sizeof( strBuf_t ));
+    return;
+}
+
+
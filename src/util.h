@@ -13,10 +13,65 @@
 //
 //  ==============================================================================================
 
+#ifndef _UTIL_H
+#define _UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+
+    long long mtime, size;                                 // last reported state, -1 = missing
+    long long pendMtime, pendSize;                      // last polled state, for debouncing
+
+} fileWatch_t;
+
+//  Zero-copy tokenizer: a word is a view into the caller's string (not NUL terminated).
+//  Delimiter runs are skipped, as with strtok(), but the input is never modified.
+//
+typedef struct {
+
+    const char *ptr;                                          // first character of the word
+    size_t      len;                                                  // length of the word
+
+} strView_t;
+
+typedef struct {
+
+    const char *next;                                          // where the next word search starts
+    const char *delim;                                                  // delimiter characters
+
+} wordIter_t;
+
+//  Growable output buffer for rendering text (web pages, JSON), reused across renders
+//
+typedef struct {
+
+    char   *data;                                             // NUL terminated, NULL if empty
+    size_t  len, size;
+    int     overflow;                                       // set if an append ran out of memory
+
+} strBuf_t;
+
 extern char *getWord( char *strIn, int wordIndex, char *delim );
+extern char *getWord_r( char *strIn, int wordIndex, char *delim, char *wordOut, size_t outSize );
+extern void wordIterInit( wordIter_t *it, const char *strIn, const char *delim );
+extern int wordIterNext( wordIter_t *it, strView_t *word );
+extern int wordView( const char *strIn, int wordIndex, const char *delim, strView_t *word );
+extern char *strViewCopy( char *strOut, size_t outSize, const strView_t *word );
+extern int strViewEq( const strView_t *word, const char *str );
 extern int foundMatch( char *line, char *table[], int caseConvert );
 extern char *reformatIP( char *originalIP );
+extern char *reformatIP_r( char *originalIP, char *expandedIP, size_t outSize );
+extern int parseIPv4( char *strIn, uint32_t *ipOut );
 extern void strTrimInPlace(char * s);
 extern void strToLowerInPlace(char * s);
 extern int isReadable( char *fileName );
+extern void fileWatchInit( fileWatch_t *wPtr, char *fileName );
+extern int fileWatchChanged( fileWatch_t *wPtr, char *fileName );
+extern void strBufReset( strBuf_t *bPtr );
+extern int strBufAppend( strBuf_t *bPtr, const char *data, size_t len );
+extern int strBufPrintf( strBuf_t *bPtr, const char *format, ... );
+extern void strBufFree( strBuf_t *bPtr );
 
+#endif
@@ -0,0 +1,206 @@
+//  ==============================================================================================
+//
+//  Module: SISSMJQ
+//
+//  Description:
+//  Query tool for the SISSM binary event journal (sissm.journalFilePath)
+//
+//  Usage:  sissmjq <journal> [options]
+//
+//      -f "YYYY-mm-dd HH:MM:SS"    from time (local), or epoch seconds
+//      -t "YYYY-mm-dd HH:MM:SS"    to time (local), or epoch seconds
+//      -p <steamid64|name>         only entries for this player (name: partial, any case)
+//      -k <kind>                   only this kind: start event rcon join leave action
+//      -w "YYYY-mm-dd HH:MM:SS"    who was online at that time
+//
+//  Build:  make tools   (binary is build/sissmjq)
+//
+//  Original Author:
+//  J.S. Schroeder (schroeder-lvb@outlook.com)    2019.08.14
+//
+//  Released under MIT License
+//  ID Authenticator: c4c5a1eda6815f65bb2eefd15c5b5058f996add99fa8800831599a7eb5c2a04c
+//
+//  ==============================================================================================
+
+#define _GNU_SOURCE                                            // strcasestr(), strptime()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "sid.h"
+#include "events.h"
+#include "journal.h"
+
+
+//  ==============================================================================================
+//  Data definition
+//
+
+static const char *kindNames[] = { "start", "event", "rcon", "join", "leave", "action" };
+#define KIND_COUNT  ( (int) (sizeof( kindNames ) / sizeof( kindNames[0] )))
+
+static const char *eventNames[] = {
+    "init", "restart", "client-add", "client-del", "mapchange", "game-start", "game-end",
+    "round-start", "round-end", "captured", "periodic", "synth-add", "synth-del", "shutdown",
+    "chat", "sigterm", "reload"
+};
+#define EVENT_COUNT  ( (int) (sizeof( eventNames ) / sizeof( eventNames[0] )))
+
+
+//  ==============================================================================================
+//  _parseTime (local)
+//
+//  "YYYY-mm-dd HH:MM:SS" local time, or epoch seconds.  Returns epoch ms, or 0 on error.
+//
+static uint64_t _parseTime( char *s )
+{
+    struct tm tm;
+    char *end;
+    unsigned long long sec;
+
+    memset( &tm, 0, sizeof( tm ));
+    end = strptime( s, "%Y-%m-%d %H:%M:%S", &tm );
+    if (( end != NULL ) && ( *end == 0 )) {
+        tm.tm_isdst = -1;
+        return( (uint64_t) mktime( &tm ) * 1000 );
+    }
+    sec = strtoull( s, &end, 10 );
+    if (( *end == 0 ) && ( end != s )) return( (uint64_t) sec * 1000 );
+    return( 0 );
+}
+
+
+//  ==============================================================================================
+//  _printRec (local)
+//
+static void _printRec( journalReader_t *jr, journalRec_t *r )
+{
+    char timeStr[32], idStr[SID_STRLEN+1];
+    time_t t = (time_t) (r->timeMs / 1000);
+    const char *kind, *what;
+
+    strftime( timeStr, sizeof( timeStr ), "%Y-%m-%d %H:%M:%S", localtime( &t ));
+    kind = ( r->kind < KIND_COUNT ) ? kindNames[ r->kind ] : "?";
+    if ( r->steamID != 0 ) sidToStr( r->steamID, idStr );
+    else strcpy( idStr, "-" );
+
+    switch ( r->kind ) {
+    case JOURNAL_KIND_EVENT:
+        what = (( r->code >= 0 ) && ( r->code < EVENT_COUNT )) ? eventNames[ r->code ] : "?";
+        printf( "%s.%03u %-6s %-17s %s %s\n", timeStr, (unsigned) (r->timeMs % 1000), kind, idStr,
+            what, journalReadStr( jr, r->str1 ));
+        break;
+    case JOURNAL_KIND_RCON:
+        printf( "%s.%03u %-6s %-17s %s status=%d\n", timeStr, (unsigned) (r->timeMs % 1000), kind, idStr,
+            journalReadStr( jr, r->str1 ), r->code );
+        break;
+    default:
+        printf( "%s.%03u %-6s %-17s %s %s\n", timeStr, (unsigned) (r->timeMs % 1000), kind, idStr,
+            journalReadStr( jr, r->str1 ), journalReadStr( jr, r->str2 ));
+        break;
+    }
+    return;
+}
+
+
+//  ==============================================================================================
+//  _whoOnline (local)
+//
+//  Replay joins and leaves up to timeMs and print who was in game.  A START record (sissm
+//  restart) clears the roster.
+//
+static int _whoOnline( journalReader_t *jr, uint64_t timeMs )
+{
+    sidSet_t online;
+    uint64_t i, end;
+    uint32_t j;
+    char idStr[SID_STRLEN+1];
+
+    sidSetInit( &online );
+    end = journalReadSeek( jr, timeMs + 1 );
+    for ( i=0; i<end; i++ ) {
+        switch ( jr->recs[i].kind ) {
+        case JOURNAL_KIND_START:
+            sidSetClear( &online );
+            break;
+        case JOURNAL_KIND_JOIN:
+            sidSetAdd( &online, jr->recs[i].steamID, jr->recs[i].str1 );
+            break;
+        case JOURNAL_KIND_LEAVE:
+            sidSetRemove( &online, jr->recs[i].steamID );
+            break;
+        }
+    }
+    for ( j=0; j<online.capacity; j++ ) {
+        if ( online.keys[j] != 0 )
+            printf( "%s %s\n", sidToStr( online.keys[j], idStr ), journalReadStr( jr, online.values[j] ));
+    }
+    printf( "%u online\n", online.count );
+    sidSetFree( &online );
+    return 0;
+}
+
+
+//  ==============================================================================================
+//  main
+//
+int main( int argc, char *argv[] )
+{
+    journalReader_t jr;
+    uint64_t fromMs = 0, toMs = UINT64_MAX, whoMs = 0, i;
+    sid_t playerID = 0;
+    char *playerName = NULL;
+    int kind = -1, k, errCode = 0;
+    journalRec_t *r;
+
+    if ( argc < 2 ) errCode = 1;
+    for ( k=2; ( k<argc ) && !errCode; k++ ) {
+        if ( k + 1 >= argc ) { errCode = 1; break; }
+        if      ( 0 == strcmp( argv[k], "-f" )) errCode = ( 0 == (fromMs = _parseTime( argv[++k] )));
+        else if ( 0 == strcmp( argv[k], "-t" )) errCode = ( 0 == (toMs = _parseTime( argv[++k] )));
+        else if ( 0 == strcmp( argv[k], "-w" )) errCode = ( 0 == (whoMs = _parseTime( argv[++k] )));
+        else if ( 0 == strcmp( argv[k], "-p" )) {
+            if ( 0 == (playerID = sidParse( argv[++k] ))) playerName = argv[k];
+        }
+        else if ( 0 == strcmp( argv[k], "-k" )) {
+            for ( kind=KIND_COUNT-1; kind>=0; kind-- ) if ( 0 == strcmp( argv[k+1], kindNames[kind] )) break;
+            errCode = ( kind < 0 );
+            k++;
+        }
+        else errCode = 1;
+    }
+    if ( errCode ) {
+        printf( "Syntax: sissmjq <journal> [-f from] [-t to] [-p steamid64|name] [-k kind] [-w time]\n" );
+        printf( "        time is \"YYYY-mm-dd HH:MM:SS\" or epoch seconds\n" );
+        return 1;
+    }
+
+    if ( 0 != journalReadOpen( argv[1], &jr )) {
+        printf( "Unable to open journal %s(.jrn .jrs .jri)\n", argv[1] );
+        return 1;
+    }
+
+    if ( whoMs != 0 ) {
+        errCode = _whoOnline( &jr, whoMs );
+    }
+    else {
+        for ( i = journalReadSeek( &jr, fromMs ); i < jr.recCount; i++ ) {
+            r = &jr.recs[i];
+            if ( r->timeMs > toMs ) break;
+            if (( kind >= 0 ) && ( (int) r->kind != kind )) continue;
+            if (( playerID != 0 ) && ( r->steamID != playerID )) continue;
+            if (( playerName != NULL ) &&
+                (( r->kind != JOURNAL_KIND_JOIN ) && ( r->kind != JOURNAL_KIND_LEAVE )) ) continue;
+            if (( playerName != NULL ) && ( NULL == strcasestr( journalReadStr( &jr, r->str1 ), playerName ))) continue;
+            _printRec( &jr, r );
+        }
+    }
+
+    journalReadClose( &jr );
+    return( errCode );
+}
+